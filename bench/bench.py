@@ -0,0 +1,357 @@
+#!/usr/bin/env python3
+"""
+@file bench.py
+@author Onegen Something <xkrame00@vutbr.cz>
+@brief Loopback throughput/latency benchmark of tftp-server and tftp-client
+@date 2023-11-19
+
+Starts `tftp-server` on loopback and runs `tftp-client` downloads (or
+uploads) over a matrix of file sizes, block sizes, transfer modes and
+concurrency levels, optionally over a netem-shaped loopback (root only).
+Results are printed (or written with -o) as JSON, so that runs of two
+commits can be diffed or compared by a script.
+
+Every matrix cell runs `concurrency` transfers at once, `--repeat` times.
+For a cell it reports:
+  - mb_per_s             aggregate throughput (10^6 B/s of payload)
+  - p50_s, p99_s         transfer times (each client from start to exit)
+  - server_cpu_s_per_mb  server CPU (user + system) per MB transferred
+  - client_cpu_s_per_mb  same for all clients together
+Throughput and transfer times count successful transfers only (failures
+are reported apart). Block numbers roll over (-r 0 on both sides), so
+that files of more than 65535 blocks can be sent.
+
+Usage: bench.py [--preset quick|full] [--sizes 1K,1M] [--blksizes 512]
+                [--modes octet,netascii] [--concurrency 1,10] [-o out.json]
+"""
+
+import argparse
+import json
+import math
+import os
+import platform
+import shutil
+import socket
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+PRESETS = {
+    "quick": {
+        "sizes": "1K,1M,32M",
+        "blksizes": "512,1468,8192,65464",
+        "modes": "octet,netascii",
+        "concurrency": "1,16",
+    },
+    "full": {
+        "sizes": "1K,64K,1M,64M,1G",
+        "blksizes": "512,1468,8192,65464",
+        "modes": "octet,netascii",
+        "concurrency": "1,10,100,1000",
+    },
+}
+
+UNITS = {"K": 1 << 10, "M": 1 << 20, "G": 1 << 30}
+
+
+# === Helpers ===
+
+
+def parse_size(txt):
+    """Parses a size with an optional K/M/G suffix (ex. 64K)."""
+    txt = txt.strip().upper()
+    if txt and txt[-1] in UNITS:
+        return int(txt[:-1]) * UNITS[txt[-1]]
+    return int(txt)
+
+
+def parse_list(txt, conv=str):
+    return [conv(item) for item in txt.split(",") if item.strip()]
+
+
+def percentile(values, pct):
+    """Nearest-rank percentile of a non-empty list."""
+    ordered = sorted(values)
+    rank = max(1, math.ceil(pct / 100 * len(ordered)))
+    return ordered[rank - 1]
+
+
+def free_port():
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as sock:
+        sock.bind(("127.0.0.1", 0))
+        return sock.getsockname()[1]
+
+
+def proc_cpu(pid):
+    """CPU time (seconds, all threads) of a running process."""
+    try:
+        # Nanosecond on-CPU time of every thread, `stat` only has ticks
+        total = 0
+        for task in os.listdir(f"/proc/{pid}/task"):
+            with open(f"/proc/{pid}/task/{task}/schedstat") as stat:
+                total += int(stat.read().split()[0])
+        return total / 1e9
+    except OSError:
+        with open(f"/proc/{pid}/stat") as stat:
+            fields = stat.read().rsplit(")", 1)[1].split()
+        return (int(fields[11]) + int(fields[12])) / os.sysconf("SC_CLK_TCK")
+
+
+def make_file(path, size, text):
+    """Creates a test file, text (lines) for netascii, random otherwise."""
+    if text:
+        line = b"".join(bytes([32 + (i % 95)]) for i in range(71)) + b"\n"
+        chunk = line * (1 << 14)
+    else:
+        chunk = os.urandom(1 << 20)
+    with open(path, "wb") as out:
+        left = size
+        while left > 0:
+            out.write(chunk[:left])
+            left -= min(left, len(chunk))
+
+
+def git_commit():
+    try:
+        return subprocess.run(["git", "-C", ROOT, "rev-parse", "HEAD"],
+                              capture_output=True, text=True,
+                              check=True).stdout.strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+# === Netem ===
+
+
+def netem_add(spec):
+    subprocess.run(["tc", "qdisc", "add", "dev", "lo", "root", "netem"]
+                   + spec.split(), check=True)
+
+
+def netem_del():
+    subprocess.run(["tc", "qdisc", "del", "dev", "lo", "root"],
+                   stderr=subprocess.DEVNULL, check=False)
+
+
+# === Benchmark ===
+
+
+class Bench:
+    def __init__(self, args):
+        self.args = args
+        self.client = os.path.join(ROOT, "tftp-client")
+        self.server = os.path.join(ROOT, "tftp-server")
+        self.workdir = tempfile.mkdtemp(prefix="tftp-bench-")
+        self.srvdir = os.path.join(self.workdir, "srv")
+        self.cltdir = os.path.join(self.workdir, "clt")
+        os.mkdir(self.srvdir)
+        os.mkdir(self.cltdir)
+        self.port = free_port()
+        self.srv = None
+
+    def start_server(self):
+        cmd = [self.server, "-p", str(self.port), "-j",
+               str(self.args.threads), "-r", "0"] \
+            + self.args.server_opts.split()
+        self.srv = subprocess.Popen(cmd + [self.srvdir],
+                                    stdout=subprocess.DEVNULL,
+                                    stderr=subprocess.DEVNULL)
+        time.sleep(0.3)
+        if self.srv.poll() is not None:
+            raise RuntimeError("tftp-server failed to start")
+
+    def stop_server(self):
+        if self.srv and self.srv.poll() is None:
+            self.srv.send_signal(2)  # SIGINT
+            try:
+                self.srv.wait(timeout=30)
+            except subprocess.TimeoutExpired:
+                self.srv.kill()
+
+    def src_name(self, size, mode):
+        name = f"{mode}_{size}.bin"
+        path = os.path.join(self.srvdir, name)
+        if not os.path.exists(path):
+            make_file(path, size, mode == "netascii")
+        return name
+
+    def client_cmd(self, name, blksize, mode, idx):
+        cmd = [self.client, "-h", "127.0.0.1", "-p", str(self.port),
+               "-m", mode, "-r", "0"]
+        if blksize != 512:
+            cmd += ["-o", "blksize", str(blksize)]
+        if self.args.direction == "get":
+            return cmd + ["-f", name, "-t",
+                          os.path.join(self.cltdir, f"{idx}_{name}")]
+        return cmd + ["-t", f"up_{idx}_{name}"]
+
+    def run_cell(self, size, blksize, mode, conc):
+        name = self.src_name(size, mode)
+        src = os.path.join(self.srvdir, name)
+        times, failures, clt_cpu = [], 0, 0.0
+        srv_cpu0 = proc_cpu(self.srv.pid)
+        wall = 0.0
+
+        for _ in range(self.args.repeat):
+            pending, stdins = {}, []
+            start = time.monotonic()
+            for idx in range(conc):
+                stdin = open(src, "rb") \
+                    if self.args.direction == "put" else None
+                stdins.append(stdin)
+                proc = subprocess.Popen(
+                    self.client_cmd(name, blksize, mode, idx),
+                    stdin=stdin, stdout=subprocess.DEVNULL,
+                    stderr=subprocess.DEVNULL)
+                pending[proc.pid] = (time.monotonic(), proc)
+
+            # Kill stuck clients, so that the waiting below ends
+            watchdog = threading.Timer(
+                self.args.timeout,
+                lambda: [p.kill() for _, p in list(pending.values())])
+            watchdog.start()
+
+            # Reap clients in the order they finish
+            while pending:
+                pid, status, usage = os.wait4(-1, 0)
+                code = os.waitstatus_to_exitcode(status)
+                if pid == self.srv.pid:
+                    self.srv.returncode = code
+                    raise RuntimeError("tftp-server exited")
+                launched, proc = pending.pop(pid)
+                proc.returncode = code
+                if code == 0:
+                    times.append(time.monotonic() - launched)
+                failures += code != 0
+                clt_cpu += usage.ru_utime + usage.ru_stime
+            watchdog.cancel()
+
+            wall += time.monotonic() - start
+            for stdin in stdins:
+                if stdin:
+                    stdin.close()
+            self.clean_outputs()
+
+        transfers = conc * self.args.repeat
+        mbytes = size * (transfers - failures) / 1e6
+        srv_cpu = proc_cpu(self.srv.pid) - srv_cpu0
+        return {
+            "size": size,
+            "blksize": blksize,
+            "mode": mode,
+            "concurrency": conc,
+            "transfers": transfers,
+            "failures": failures,
+            "mb_per_s": round(mbytes / wall, 3) if wall > 0 else None,
+            "p50_s": round(percentile(times, 50), 6) if times else None,
+            "p99_s": round(percentile(times, 99), 6) if times else None,
+            "server_cpu_s_per_mb":
+                round(srv_cpu / mbytes, 6) if mbytes > 0 else None,
+            "client_cpu_s_per_mb":
+                round(clt_cpu / mbytes, 6) if mbytes > 0 else None,
+        }
+
+    def clean_outputs(self):
+        for entry in os.listdir(self.cltdir):
+            os.unlink(os.path.join(self.cltdir, entry))
+        for entry in os.listdir(self.srvdir):
+            if entry.startswith("up_"):
+                os.unlink(os.path.join(self.srvdir, entry))
+
+    def run(self):
+        args = self.args
+        results = []
+        self.start_server()
+        try:
+            for size in args.sizes:
+                for blksize in args.blksizes:
+                    for mode in args.modes:
+                        for conc in args.concurrency:
+                            cell = {"size": size, "blksize": blksize,
+                                    "mode": mode, "concurrency": conc}
+                            if size * conc > args.max_bytes:
+                                results.append(dict(cell, skipped=True))
+                                continue
+                            print(f"bench: {cell}", file=sys.stderr)
+                            results.append(self.run_cell(size, blksize,
+                                                         mode, conc))
+        finally:
+            self.stop_server()
+            shutil.rmtree(self.workdir, ignore_errors=True)
+        return results
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Loopback benchmark of tftp-server and tftp-client")
+    parser.add_argument("--preset", choices=PRESETS, default="quick")
+    parser.add_argument("--sizes", help="file sizes (ex. 1K,1M,1G)")
+    parser.add_argument("--blksizes", help="block sizes (ex. 512,1468)")
+    parser.add_argument("--modes", help="transfer modes (octet,netascii)")
+    parser.add_argument("--concurrency", help="parallel transfers (ex. 1,10)")
+    parser.add_argument("--direction", choices=["get", "put"], default="get",
+                        help="download (RRQ) or upload (WRQ)")
+    parser.add_argument("--repeat", type=int, default=3,
+                        help="runs of every cell (default: 3)")
+    parser.add_argument("--threads", type=int, default=1,
+                        help="server worker threads (default: 1)")
+    parser.add_argument("--server-opts", default="",
+                        help="extra tftp-server options")
+    parser.add_argument("--netem", help="netem spec for lo, ex. "
+                        "'delay 5ms loss 1%%' (needs root and tc)")
+    parser.add_argument("--max-bytes", type=parse_size, default="4G",
+                        help="skip cells moving more (size * concurrency)")
+    parser.add_argument("--timeout", type=float, default=600,
+                        help="timeout of a single transfer (s)")
+    parser.add_argument("-o", "--output", help="output file (default: "
+                        "stdout)")
+    args = parser.parse_args()
+
+    preset = PRESETS[args.preset]
+    args.sizes = parse_list(args.sizes or preset["sizes"], parse_size)
+    args.blksizes = parse_list(args.blksizes or preset["blksizes"], int)
+    args.modes = parse_list(args.modes or preset["modes"])
+    args.concurrency = parse_list(args.concurrency or preset["concurrency"],
+                                  int)
+
+    for binary in ("tftp-client", "tftp-server"):
+        if not os.access(os.path.join(ROOT, binary), os.X_OK):
+            sys.exit(f"bench: {binary} not built (run `make` first)")
+
+    if args.netem:
+        netem_add(args.netem)
+    try:
+        results = Bench(args).run()
+    finally:
+        if args.netem:
+            netem_del()
+
+    report = {
+        "meta": {
+            "commit": git_commit(),
+            "date": time.strftime("%Y-%m-%dT%H:%M:%S%z"),
+            "host": platform.node(),
+            "kernel": platform.release(),
+            "cpus": os.cpu_count(),
+            "direction": args.direction,
+            "repeat": args.repeat,
+            "server_threads": args.threads,
+            "server_opts": args.server_opts,
+            "netem": args.netem,
+        },
+        "results": results,
+    }
+    text = json.dumps(report, indent=2)
+    if args.output:
+        with open(args.output, "w") as out:
+            out.write(text + "\n")
+    else:
+        print(text)
+
+
+if __name__ == "__main__":
+    main()
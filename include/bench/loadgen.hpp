@@ -0,0 +1,224 @@
+/**
+ * @file loadgen.hpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Load generator simulating many concurrent TFTP clients
+ * @date 2023-11-25
+ */
+
+#pragma once
+#ifndef TFTP_BENCH_LOADGEN_HPP
+#     define TFTP_BENCH_LOADGEN_HPP
+#     include <chrono>
+#     include <map>
+#     include <memory>
+#     include <random>
+#     include <unordered_map>
+
+#     include "client/client.hpp"
+#     include "util/eventloop.hpp"
+#     include "util/hdrhistogram.hpp"
+
+/**
+ * @brief Class for load testing a TFTP server with simulated clients
+ * @details Clients arrive at random (a Poisson process of the given
+ *          rate), each downloading a file of the mix to `/dev/null` as
+ *          a non-blocking `TFTPClient` on one shared `EventLoop` (the
+ *          way `TFTPBatchClient` runs its jobs), so one process can keep
+ *          thousands of them running. Completion times of transfers go
+ *          into HDR histograms; retransmits and ERROR codes are counted.
+ */
+class TFTPLoadGenerator {
+   public:
+     /**
+      * @brief File of the mix
+      */
+     struct File {
+          std::string path;  /**< File on the server */
+          double weight = 1; /**< Share of the clients downloading it */
+     };
+
+     /**
+      * @brief Constructs a new load generator
+      * @throws std::runtime_error when the server cannot be resolved, or
+      *         without files
+      * @param hostname IPv4 address or hostname of the server
+      * @param port Server port
+      * @param files File mix
+      * @param clients Number of clients (transfers) in total
+      */
+     TFTPLoadGenerator(const std::string& hostname, int port,
+                       std::vector<File> files, size_t clients);
+
+     TFTPLoadGenerator& operator=(TFTPLoadGenerator&& other) = delete;
+     TFTPLoadGenerator& operator=(const TFTPLoadGenerator&) = delete;
+     TFTPLoadGenerator(TFTPLoadGenerator&& other) = delete;
+     TFTPLoadGenerator(const TFTPLoadGenerator&) = delete;
+
+     /**
+      * @brief Parses a file of the mix
+      * @param str "path" or "path:weight"
+      * @return std::optional<File> file, nullopt if the weight is invalid
+      */
+     static std::optional<File> parse_file(const std::string& str);
+
+     /* === Getters and setters === */
+
+     /**
+      * @brief Sets the arrival rate
+      * @param rate Clients per second on average, 0 to start all at once
+      */
+     void set_rate(double rate) { this->rate = rate; }
+
+     /**
+      * @brief Caps the number of clients running at once (arrivals over
+      *        the cap wait for a running one to finish)
+      * @param max_active Cap, 0 for no cap
+      */
+     void set_max_active(size_t max_active) {
+          this->max_active = max_active;
+     }
+
+     /**
+      * @brief Sets options of all transfers
+      * @param options TFTP options (ex. `blksize`, `windowsize`)
+      */
+     void set_options(
+         const std::vector<std::pair<std::string, std::string>>& options) {
+          this->options = options;
+     }
+
+     /**
+      * @brief Sets the transfer mode of all transfers
+      * @param format Transfer mode
+      */
+     void set_format(TFTPDataFormat format) { this->format = format; }
+
+     /**
+      * @brief Sets the injected loss of received packets (see
+      *        `TFTPConnectionBase::set_loss`)
+      * @param loss Probability a packet is dropped
+      */
+     void set_loss(double loss) { this->loss = loss; }
+
+     /**
+      * @brief Seeds the arrivals and the file picks (repeatable runs)
+      * @param seed Seed
+      */
+     void set_seed(uint64_t seed) { this->rng.seed(seed); }
+
+     /* === Core methods === */
+
+     /**
+      * @brief Runs all clients and prints the report (blocking)
+      * @return size_t number of failed transfers
+      */
+     size_t run();
+
+     /**
+      * @brief Formats the results as JSON (after `run`)
+      * @return std::string JSON object
+      */
+     std::string to_json() const;
+
+   private:
+     /**
+      * @brief Results of the transfers of one file (or of all)
+      */
+     struct Results {
+          uint64_t ok = 0;             /**< Completed transfers */
+          uint64_t failed = 0;         /**< Failed transfers */
+          uint64_t bytes = 0;          /**< DATA payload bytes received */
+          uint64_t blocks = 0;         /**< DATA blocks received */
+          uint64_t retransmits = 0;    /**< Packets sent again */
+          uint64_t timeouts = 0;       /**< Retransmission timeouts */
+          uint64_t dup_rx = 0;         /**< DATA received again */
+          uint64_t dropped = 0;        /**< Packets dropped (injected) */
+          HdrHistogram completion_us;  /**< Completed transfer times */
+
+          /**
+           * @brief Adds the statistics of a finished transfer
+           */
+          void add(const ConnStats& stats, bool failed, uint64_t us);
+     };
+
+     /**
+      * @brief Running client
+      */
+     struct Running {
+          std::unique_ptr<TFTPClient> conn; /**< Transfer */
+          size_t file;                      /**< File index */
+          std::chrono::steady_clock::time_point start; /**< Start time */
+     };
+
+     /* === Helper methods === */
+
+     /**
+      * @brief Starts the next client
+      */
+     void launch();
+
+     /**
+      * @brief Continues a transfer after an event, then either finishes
+      *        it or syncs its retransmit timer
+      * @param conn Transfer
+      */
+     void conn_exec(TFTPClient* conn);
+
+     /**
+      * @brief Records the results of a finished transfer and removes it
+      * @param conn Transfer
+      */
+     void finish(TFTPClient* conn);
+
+     /**
+      * @brief Gets the time until the next arrival
+      * @return std::chrono::nanoseconds gap (exponentially distributed)
+      */
+     std::chrono::nanoseconds next_gap();
+
+     /**
+      * @brief Logs the progress of the run
+      */
+     void report_progress() const;
+
+     /**
+      * @brief Prints the report of the run
+      */
+     void report_summary() const;
+
+     /* === Variables === */
+
+     /* == Config == */
+     sockaddr_in addr;        /**< Server address (resolved once) */
+     std::vector<File> files; /**< File mix */
+     size_t clients;          /**< Number of clients in total */
+     double rate = 0;         /**< Arrivals per second (0 = at once) */
+     size_t max_active = 0;   /**< Cap of running clients (0 = none) */
+     std::vector<std::pair<std::string, std::string>>
+         options;             /**< TFTP options of all transfers */
+     TFTPDataFormat format = TFTPDataFormat::Octet; /**< Transfer mode */
+     double loss = 0;         /**< Injected loss of received packets */
+
+     /* == State == */
+     std::mt19937_64 rng;              /**< Arrivals and file picks */
+     std::discrete_distribution<size_t> pick; /**< File by weight */
+     std::unique_ptr<EventLoop> loop;  /**< Event loop of all clients */
+     size_t launched = 0;              /**< Number of clients started */
+     size_t n_done = 0;                /**< Number of finished clients */
+     size_t peak_active = 0;           /**< Most clients running at once */
+     std::unordered_map<int, Running>
+         active; /**< Running clients by their socket fd */
+     std::chrono::steady_clock::time_point start; /**< Start of the run */
+     std::chrono::steady_clock::time_point end;   /**< End of the run */
+
+     /* == Results == */
+     Results total;                 /**< Results of all transfers */
+     std::vector<Results> per_file; /**< Results by file index */
+     std::map<uint16_t, uint64_t>
+         err_recv; /**< Transfers failed by a server ERROR, by code */
+     std::map<uint16_t, uint64_t>
+         err_sent; /**< Transfers aborted by the client, by code */
+     uint64_t err_local = 0; /**< Clients failed to start (ex. sockets) */
+};
+
+#endif
@@ -0,0 +1,194 @@
+/**
+ * @file batch.hpp
+ * @author Onegen Something (xkrame00@vutbr.cz)
+ * @brief Concurrent multi-file TFTP client
+ * @date 2023-11-20
+ */
+
+#pragma once
+#ifndef TFTP_CLIENT_BATCH_HPP
+#     define TFTP_CLIENT_BATCH_HPP
+#     include <chrono>
+#     include <memory>
+#     include <unordered_map>
+
+#     include "client/client.hpp"
+#     include "util/eventloop.hpp"
+
+/**
+ * @brief Class for running many TFTP client transfers in one process
+ * @details Transfers (jobs) run concurrently, up to `parallel` at once,
+ *          as non-blocking `TFTPClient`s on one shared `EventLoop` (the
+ *          way the server worker runs its connections). The server
+ *          address is resolved once for all of them. Progress is logged
+ *          every second and a summary is printed at the end.
+ */
+class TFTPBatchClient {
+   public:
+     /**
+      * @brief Transfer of one file
+      */
+     struct Job {
+          TFTPRequestType type; /**< Read (get) or Write (put) */
+          std::string remote;   /**< File on the server */
+          std::string local;    /**< Local file */
+          std::optional<std::pair<uint64_t, uint64_t>> range
+              = std::nullopt; /**< Byte range of a get (see `split`) */
+     };
+
+     /**
+      * @brief Constructs a new batch client
+      * @throws std::runtime_error when the server cannot be resolved
+      * @param hostname IPv4 address or hostname of the server
+      * @param port Server port
+      * @param jobs Transfers to run
+      * @param parallel Maximum number of transfers running at once
+      */
+     TFTPBatchClient(const std::string& hostname, int port,
+                     std::vector<Job> jobs, size_t parallel);
+
+     TFTPBatchClient& operator=(TFTPBatchClient&& other) = delete;
+     TFTPBatchClient& operator=(const TFTPBatchClient&) = delete;
+     TFTPBatchClient(TFTPBatchClient&& other) = delete;
+     TFTPBatchClient(const TFTPBatchClient&) = delete;
+
+     /**
+      * @brief Parses a manifest file
+      * @details One job per line – `get <remote> <local>` or
+      *          `put <local> <remote>`; empty lines and lines starting
+      *          with `#` are skipped.
+      * @throws std::runtime_error when the file cannot be read, or on
+      *         an invalid line
+      * @param path Manifest path
+      * @return std::vector<Job> jobs
+      */
+     static std::vector<Job> parse_manifest(const std::string& path);
+
+     /**
+      * @brief Splits a download into byte ranges of (about) equal size
+      * @details The ranges fill the part file of `local` (see
+      *          `TFTPClient::part_path`), which is then complete.
+      * @param remote File on the server
+      * @param local Local file
+      * @param size File size
+      * @param parts Number of ranges (at most one per byte)
+      * @return std::vector<Job> jobs
+      */
+     static std::vector<Job> split(const std::string& remote,
+                                   const std::string& local, uint64_t size,
+                                   size_t parts);
+
+     /* === Getters and setters === */
+
+     /**
+      * @brief Sets options of all transfers
+      * @param options TFTP options
+      */
+     void set_options(
+         const std::vector<std::pair<std::string, std::string>>& options) {
+          this->options = options;
+     }
+
+     /**
+      * @brief Sets the block number rollover mode of all transfers
+      * @param rollover Rollover mode
+      */
+     void set_rollover(TFTPBlockRollover rollover) {
+          this->rollover = rollover;
+     }
+
+     /**
+      * @brief Sets the transfer mode of all transfers
+      * @param format Transfer mode
+      */
+     void set_format(TFTPDataFormat format) { this->format = format; }
+
+     /**
+      * @brief Resumes downloads from their part files (see
+      *        `TFTPClient::set_resume`)
+      */
+     void set_resume() { this->resume = true; }
+
+     /* === Core methods === */
+
+     /**
+      * @brief Runs all transfers and prints the summary (blocking)
+      * @return size_t number of failed transfers
+      */
+     size_t run();
+
+   private:
+     /**
+      * @brief Result of a transfer
+      */
+     struct Result {
+          bool done = false;   /**< Flag if the transfer finished */
+          bool failed = false; /**< Flag if the transfer failed */
+          std::string error;   /**< Reason of a failure */
+          uint64_t bytes = 0;  /**< DATA payload bytes transferred */
+          double secs = 0;     /**< Duration of the transfer */
+     };
+
+     /**
+      * @brief Running transfer
+      */
+     struct Running {
+          std::unique_ptr<TFTPClient> conn; /**< Transfer */
+          size_t job;                       /**< Job index */
+          std::chrono::steady_clock::time_point start; /**< Start time */
+     };
+
+     /* === Helper methods === */
+
+     /**
+      * @brief Starts the next job
+      */
+     void launch();
+
+     /**
+      * @brief Continues a transfer after an event, then either finishes
+      *        it or syncs its retransmit timer
+      * @param conn Transfer
+      */
+     void conn_exec(TFTPClient* conn);
+
+     /**
+      * @brief Records the result of a finished transfer and removes it
+      * @param conn Transfer
+      */
+     void finish(TFTPClient* conn);
+
+     /**
+      * @brief Logs the progress of the batch
+      */
+     void report_progress() const;
+
+     /**
+      * @brief Prints the summary of the batch
+      */
+     void report_summary() const;
+
+     /* === Variables === */
+
+     /* == Config == */
+     sockaddr_in addr;        /**< Server address (resolved once) */
+     std::vector<Job> jobs;   /**< Transfers to run */
+     size_t parallel;         /**< Maximum transfers at once */
+     std::vector<std::pair<std::string, std::string>>
+         options;             /**< TFTP options of all transfers */
+     TFTPBlockRollover rollover
+         = TFTPBlockRollover::None; /**< Block number rollover mode */
+     TFTPDataFormat format = TFTPDataFormat::Octet; /**< Transfer mode */
+     bool resume = false; /**< Flag if downloads are resumed */
+
+     /* == State == */
+     std::unique_ptr<EventLoop> loop; /**< Event loop of all transfers */
+     size_t next = 0;                 /**< Index of the next job to start */
+     size_t n_done = 0;               /**< Number of finished jobs */
+     std::vector<Result> results;     /**< Results by job index */
+     std::unordered_map<int, Running>
+         active; /**< Running transfers by their socket fd */
+     std::chrono::steady_clock::time_point start; /**< Start of the batch */
+};
+
+#endif
@@ -10,9 +10,12 @@
 #     define TFTP_CLIENT_HPP
 #     include <netdb.h>
 
+#     include <atomic>
 #     include <csignal>
 
 #     include "util/connection.hpp"
+#     include "util/filemap.hpp"
+#     include "util/readahead.hpp"
 
 /**
  * @brief Class for TFTP client
@@ -33,11 +36,97 @@ class TFTPClient : public TFTPConnectionBase {
          const std::optional<std::string>& filepath,
          const std::vector<std::pair<std::string, std::string>>& options);
 
+     /**
+      * @brief Constructs a new TFTP client object with an already
+      *        resolved server address (see `resolve`)
+      * @param addr Server address
+      * @param destpath Destination path
+      * @param filepath Remote file to download (upload if unset)
+      * @param options TFTP options
+      */
+     TFTPClient(
+         const sockaddr_in& addr, const std::string& destpath,
+         const std::optional<std::string>& filepath,
+         const std::vector<std::pair<std::string, std::string>>& options);
+
+     /**
+      * @brief Closes the upload source (unless stdin)
+      */
+     ~TFTPClient();
+
      TFTPClient& operator=(TFTPClient&& other) = delete;
      TFTPClient& operator=(const TFTPClient&) = delete;
      TFTPClient(TFTPClient&& other) = delete;
      TFTPClient(const TFTPClient&) = delete;
 
+     /** @note `exec()` is made public for `TFTPBatchClient` */
+     using TFTPConnectionBase::exec;
+
+     /**
+      * @brief Resolves the server address
+      * @throws std::runtime_error on invalid hostname or port, or when
+      *         the host is not found
+      * @param hostname IPv4 address or hostname
+      * @param port Port
+      * @return sockaddr_in server address
+      */
+     static sockaddr_in resolve(const std::string& hostname, int port);
+
+     /**
+      * @brief Sets the file uploaded data are read from
+      * @param fd File descriptor (owned by the client from now on)
+      */
+     void set_source(int fd);
+
+     /**
+      * @brief Downloads into the part file (see `part_path`), resuming
+      *        from its size (octet mode, `range` option); renamed to the
+      *        destination once complete, kept on failure for a retry
+      */
+     void set_resume();
+
+     /**
+      * @brief Downloads only a byte range of the file into the part file
+      *        (see `part_path`), at its offset in the file
+      * @details Several clients can fill one part file this way; putting
+      *          it in place is up to the caller. Fails unless the server
+      *          accepts the `range` option.
+      * @param start First byte
+      * @param end End of the range (exclusive)
+      */
+     void set_range(uint64_t start, uint64_t end);
+
+     /**
+      * @brief Gets the size of a remote file (RRQ with `tsize`, aborted
+      *        after the OACK) – blocking
+      * @param addr Server address
+      * @param destpath Destination path (not written to)
+      * @param filepath Remote file
+      * @param options TFTP options
+      * @return std::optional<uint64_t> size, nullopt if unknown
+      */
+     static std::optional<uint64_t> probe_size(
+         const sockaddr_in& addr, const std::string& destpath,
+         const std::string& filepath,
+         std::vector<std::pair<std::string, std::string>> options);
+
+     /**
+      * @brief Gets the part file of a destination (resumed or split
+      *        downloads)
+      * @param destpath Destination path
+      * @return std::string part file path
+      */
+     static std::string part_path(const std::string& destpath) {
+          return destpath + ".part";
+     }
+
+     /**
+      * @brief Checks if SIGINT was received
+      * @return true if interrupted,
+      * @return false otherwise
+      */
+     static bool is_interrupted();
+
    protected:
      /* === Overrides === */
 
@@ -51,24 +140,76 @@ class TFTPClient : public TFTPConnectionBase {
 
      void handle_request_upload() override;
      void handle_request_download() override;
-     void handle_oack(const OptionAckPacket& oack) override;
+     void handle_oack(const OackView& oack) override;
+     void handle_download() override;
+     void handle_await_download() override;
      bool should_shutd() override;
-     std::vector<char> next_data() override;
+     size_t next_data(std::span<char> payload) override;
+     std::optional<std::span<const char>> next_slice(size_t max) override;
+     void release_data(size_t len) override;
+
+     /* === Helper methods === */
+
+     /**
+      * @brief Sets up reading of the octet upload source (on first DATA,
+      *        once `blksize` and `windowsize` are final)
+      */
+     void open_source();
+
+     /**
+      * @brief Picks up the part file of a resumed download (on first RRQ),
+      *        asking for the rest of the file only
+      */
+     void resume_part();
+
+     /**
+      * @brief Joins the multicast group of the session (`mcast`)
+      * @return true if listening on the group (`group_fd`),
+      * @return false on error
+      */
+     bool mcast_join();
+
+     /**
+      * @brief Handles a datagram received on the group socket (DATA of
+      *        the session, at its offset in the file)
+      * @param origin Origin address of the datagram
+      * @param len Length of the datagram (in `rx_buffer`)
+      */
+     void mcast_data(const sockaddr_in& origin, size_t len);
+
+     /**
+      * @brief Acknowledges all blocks received in order (`mc_upto`)
+      */
+     void mcast_ack();
 
      /* === Variables === */
 
      /* == Connection params == */
-     std::string hostname;                /**< Hostname to connect to */
-     int port = TFTP_STD_PORT;            /**< Port to connect to */
      std::string destpath;                /**< Destination path */
      std::optional<std::string> filepath; /**< Filepath to download */
+     bool discard = false; /**< Flag if downloading to `/dev/null` */
+
+     /* == Part file (resumed or split downloads) == */
+     bool part = false;   /**< Flag if downloading into the part file */
+     bool resume = false; /**< Flag if resuming from the part file */
+     bool probe = false;  /**< Flag if only getting the size (no file) */
+     std::optional<std::pair<uint64_t, uint64_t>>
+         range_req; /**< Byte range to download (`set_range`) */
 
-     /* == Host entity == */
-     struct hostent* host; /**< Host entity */
+     /* == Multicast download (RFC 2090) == */
+     std::vector<bool> mc_have; /**< Flags of the blocks received */
+     uint64_t mc_upto = 0;      /**< Last block received in order */
+     std::optional<uint64_t> mc_last; /**< Number of the final block */
 
-     /* == File buffer == */
-     std::vector<char> file_buffer; /**< File buffer */
-     ssize_t file_rx_len = 0;       /**< File buffer size */
+     /* == Upload source == */
+     int src_fd = STDIN_FILENO; /**< File uploaded data are read from */
+     bool src_opened = false;   /**< Flag if `open_source` was called */
+     std::unique_ptr<FileMap> src_map; /**< Mapping of a source file */
+     size_t src_off = 0;               /**< Offset of the next block */
+     std::unique_ptr<ReadAhead>
+         read_ahead; /**< Read-ahead buffer of a source stream */
+     NetASCII::Encoder na_encoder{
+         STDIN_FILENO}; /**< Streaming source NetASCII encoder */
 };
 
 #endif
\ No newline at end of file
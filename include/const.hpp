@@ -19,7 +19,7 @@ static const size_t TFTP_DFLT_BLKSIZE = 512;
 static const size_t TFTP_DFLT_MAXSIZE = TFTP_DFLT_BLKSIZE + 4;
 
 /**
- * @brief Maximum number of blocks TFTP can transfer.
+ * @brief Maximum number of blocks TFTP can transfer (without rollover).
  */
 static const uint16_t TFTP_MAX_FILE_BLOCKS = UINT16_MAX;
 
@@ -29,25 +29,212 @@ static const uint16_t TFTP_MAX_FILE_BLOCKS = UINT16_MAX;
  */
 static const uint16_t TFTP_STD_PORT = 69;
 
+/**
+ * @brief Default port of multicast groups (server `-G`).
+ * @see https://datatracker.ietf.org/doc/html/rfc2090
+ */
+static const uint16_t TFTP_MCAST_PORT = 1758;
+
+/**
+ * @brief Number of multicast groups (concurrent multicast sessions).
+ */
+static const size_t TFTP_MCAST_GROUPS = 256;
+
 /**
  * @brief Timeout for the TFTP server in seconds.
  */
 static const int TFTP_TIMEO = 4;
 
+/**
+ * @brief Maximum time a request waits for admission in seconds.
+ * @note Later, the client has likely given up already.
+ */
+static const int TFTP_QUEUE_TIMEO = 4;
+
+/**
+ * @brief Event loop wait while requests wait for admission (ms).
+ * @note Slots may be freed by other workers, which do not wake this one.
+ */
+static const int TFTP_QUEUE_POLL_MS = 100;
+
 /**
  * @brief Timeout for TFTP packets (retransmit after) in seconds.
+ * @note Only used when no retransmission deadline is armed, otherwise
+ *       the retransmission timeout adapts to the measured RTT (unless
+ *       set with the `timeout` option).
  */
 static const int TFTP_PACKET_TIMEO = 3;
 
+/**
+ * @brief Initial retransmission timeout in milliseconds (before any
+ *        RTT sample).
+ * @see https://datatracker.ietf.org/doc/html/rfc6298#section-2
+ */
+static const int TFTP_INIT_RTO_MS = 1000;
+
+/**
+ * @brief Minimum adaptive retransmission timeout in milliseconds.
+ */
+static const int TFTP_MIN_RTO_MS = 200;
+
+/**
+ * @brief Maximum adaptive retransmission timeout in milliseconds.
+ * @see https://datatracker.ietf.org/doc/html/rfc6298#section-2
+ */
+static const int TFTP_MAX_RTO_MS = 60000;
+
 /**
  * @brief Maximum numbeer of retransmit attempts.
  */
 static const int TFTP_MAX_RETRIES = 4;
 
 /**
- * @brief Short delay for the handling loop in miliseconds.
+ * @brief Maximum number of datagrams per `sendmmsg`/`recvmmsg` call.
+ */
+static const int TFTP_MMSG_BATCH = 64;
+
+/**
+ * @brief Maximum number of DATA packets per GSO datagram (`UDP_SEGMENT`,
+ *        segmented by the kernel or the NIC), 1 turns GSO off.
+ * @note The kernel takes up to 64 segments.
+ */
+static const size_t TFTP_GSO_SEGMENTS = 64;
+
+/**
+ * @brief Maximum size of a GSO datagram (largest UDP payload over IPv4).
+ */
+static const size_t TFTP_GSO_MAX_BYTES = 65507;
+
+/**
+ * @brief Size of the receive buffer of a GRO socket (`UDP_GRO`, largest
+ *        batch of coalesced datagrams).
+ */
+static const size_t TFTP_GRO_BUFFER = 65535;
+
+/**
+ * @brief Bytes a paced transfer gets per deficit round-robin turn
+ *        (server `-R`).
+ * @note Windows bigger than that take several turns, bigger packets
+ *       save up over turns.
+ */
+static const size_t TFTP_DRR_QUANTUM = 16 * 1024;
+
+/**
+ * @brief Time of sending a pacer lets go out as one burst (us).
+ * @note Bursts are at least two packets (ex. slow lock-step transfers
+ *       are never held back by their own pacer).
+ */
+static const int TFTP_PACE_BURST_US = 1000;
+
+/**
+ * @brief Maximum (and initial) pacing gain: a paced transfer sends its
+ *        window in SRTT / gain.
+ */
+static const double TFTP_PACE_GAIN_MAX = 8.0;
+
+/**
+ * @brief Minimum pacing gain (the window spread over a whole SRTT).
+ */
+static const double TFTP_PACE_GAIN_MIN = 1.0;
+
+/**
+ * @brief Pacing gain added per window acknowledged without a loss
+ *        (halved on every loss).
+ */
+static const double TFTP_PACE_GAIN_STEP = 0.25;
+
+/**
+ * @brief Number of records in the asynchronous log ring.
  */
-static const int TFTP_THREAD_DELAY = 100;
+static const size_t TFTP_LOG_RING_SIZE = 4096;
+
+/**
+ * @brief Number of trace spans kept per thread (latest ones).
+ * @note 48 bytes each, allocated once a thread records its first span.
+ */
+static const size_t TFTP_TRACE_EVENTS = 1 << 17;
+
+/**
+ * @brief Size of one (preformatted) log record in bytes.
+ */
+static const size_t TFTP_LOG_RECORD_SIZE = 256;
+
+/**
+ * @brief Minimum size of files served from a memory mapping (bytes).
+ * @note Smaller files are read with `pread` (a mapping costs more
+ *       syscalls than it saves).
+ */
+static const size_t TFTP_MMAP_MIN_SIZE = 256 * 1024;
+
+/**
+ * @brief Download destination discarding the data (client).
+ * @note Taken even though it exists; used by reachability checks and
+ *       load tests (see `tftp-bench`).
+ */
+static const char* const TFTP_DISCARD_PATH = "/dev/null";
+
+/**
+ * @brief Lifetime of a resolved path in the path cache (ms).
+ * @note Bounds how long changes inotify does not report (ex. made on
+ *       another host of a network filesystem) go unnoticed.
+ */
+static const int TFTP_PATH_CACHE_TTL_MS = 2000;
+
+/**
+ * @brief Readahead window of memory-mapped files (bytes).
+ */
+static const size_t TFTP_MMAP_READAHEAD = 4 * 1024 * 1024;
+
+/**
+ * @brief Size of the coalesced writes of downloaded files (bytes).
+ */
+static const size_t TFTP_WRITE_CHUNK = 1024 * 1024;
+
+/**
+ * @brief Maximum number of coalesced writes in flight per download.
+ */
+static const size_t TFTP_WRITE_DEPTH = 4;
+
+/**
+ * @brief Number of pre-bound connection sockets kept per worker.
+ */
+static const size_t TFTP_SOCKET_POOL = 64;
+
+/**
+ * @brief Number of connection buffer sets kept per worker.
+ */
+static const size_t TFTP_BUFFER_POOL = 64;
+
+/**
+ * @brief Maximum size of a kept connection buffer set (bytes).
+ * @note Buffers of transfers with big blocks or windows are freed.
+ */
+static const size_t TFTP_BUFFER_POOL_MAX = 256 * 1024;
+
+/**
+ * @brief Receive/send buffer size of sockets shared by connections
+ *        (bytes).
+ * @note Capped by `net.core.rmem_max` and `net.core.wmem_max`.
+ */
+static const int TFTP_DEMUX_SOCKBUF = 8 * 1024 * 1024;
+
+/**
+ * @brief Size of the reads ahead of uploads from pipes (bytes).
+ */
+static const size_t TFTP_READ_CHUNK = 1024 * 1024;
+
+/**
+ * @brief Minimum number of chunks read ahead per upload from a pipe.
+ * @note Raised to cover the whole upload window (chunks are kept until
+ *       all their blocks are acknowledged).
+ */
+static const size_t TFTP_READ_DEPTH = 4;
+
+/**
+ * @brief Interval of checking for SIGINT while waiting for the upload
+ *        source.
+ */
+static const int TFTP_READ_POLL_MS = 100;
 
 /**
  * @brief Minimum value of `blksize` option
@@ -61,6 +248,67 @@ static const uint16_t TFTP_MIN_BLKSIZE = 8;
  */
 static const uint16_t TFTP_MAX_BLKSIZE = 65464;
 
+/**
+ * @brief Bytes of a DATA datagram on top of its block (IPv4 header
+ *        without options, UDP header and TFTP DATA header)
+ * @note A path MTU of N bytes fits blocks of up to N - 32 bytes unfragmented.
+ */
+static const uint16_t TFTP_DATA_OVERHEAD = 20 + 8 + 4;
+
+/**
+ * @brief Minimum MTU of an IPv4 path (RFC 791)
+ */
+static const int TFTP_MIN_MTU = 68;
+
+/**
+ * @brief Minimum value of `timeout` option (seconds)
+ * @see https://datatracker.ietf.org/doc/html/rfc2349#section-3
+ */
+static const int TFTP_MIN_TIMEOUT = 1;
+
+/**
+ * @brief Maximum value of `timeout` option (seconds)
+ * @see https://datatracker.ietf.org/doc/html/rfc2349#section-3
+ */
+static const int TFTP_MAX_TIMEOUT = 255;
+
+/**
+ * @brief Default value of `windowsize` option (lock-step)
+ * @see https://datatracker.ietf.org/doc/html/rfc7440#section-3
+ */
+static const uint16_t TFTP_DFLT_WINDOWSIZE = 1;
+
+/**
+ * @brief Minimum value of `windowsize` option
+ * @see https://datatracker.ietf.org/doc/html/rfc7440#section-3
+ */
+static const uint16_t TFTP_MIN_WINDOWSIZE = 1;
+
+/**
+ * @brief Maximum value of `windowsize` option
+ * @see https://datatracker.ietf.org/doc/html/rfc7440#section-3
+ */
+static const uint16_t TFTP_MAX_WINDOWSIZE = UINT16_MAX;
+
+/**
+ * @brief Maximum `windowsize` with block number rollover, a window within
+ *        half of the wire numbers keeps them unambiguous
+ */
+static const uint16_t TFTP_MAX_ROLLOVER_WINDOWSIZE = INT16_MAX;
+
+/**
+ * @brief Maximum bytes of a connection's window (`windowsize` times
+ *        `blksize` + 4), a larger `windowsize` is answered lower
+ * @note 64 blocks of the largest `blksize`, 8128 of the default one.
+ */
+static const size_t TFTP_MAX_WINDOW_BYTES = 4 * 1024 * 1024;
+
+/**
+ * @brief Largest announced `tsize` preallocated for a download, larger
+ *        files are written without reserving their blocks up front
+ */
+static const uint64_t TFTP_MAX_PREALLOC = 4ULL * 1024 * 1024 * 1024;
+
 /* === Enumerations === */
 
 /**
@@ -109,6 +357,18 @@ enum TFTPDataFormat {
      NetASCII = 1, /**< NetASCII mode */
 };
 
+/**
+ * @brief Enumeration of block number rollover (wraparound) modes
+ * @details Block numbers are 16-bit on the wire. Without rollover a
+ *          transfer ends at block 65535; with it, the number wraps to 0
+ *          or to 1 (both are used by PXE implementations in the wild).
+ */
+enum class TFTPBlockRollover {
+     None, /**< No rollover (transfer limited to 65535 blocks) */
+     Zero, /**< Block 65535 is followed by block 0 */
+     One,  /**< Block 65535 is followed by block 1 */
+};
+
 /**
  * @brief Enumeration for all possible states of a connection
  */
@@ -62,11 +62,11 @@ class AcknowledgementPacket : public BasePacket {
       * Attempts to parse a binary vector into an ACK packet.
       * @throws std::invalid_argument when vector is not a proper ACK packet
       *
-      * @param std::vector<char> packet in binary
+      * @param std::span<const char> packet in binary
       * @return AcknowledgementPacket
       */
      static AcknowledgementPacket from_binary(
-         const std::vector<char>& bin_data);
+         std::span<const char> bin_data);
 
      /* === Getters and Setters === */
 
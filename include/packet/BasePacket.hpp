@@ -9,6 +9,7 @@
 #ifndef TFTP_BASE_PACKET_HPP
 #     define TFTP_BASE_PACKET_HPP
 #     include <iomanip>
+#     include <span>
 
 #     include "common.hpp"
 
@@ -40,14 +41,14 @@ class BasePacket {
      /* === Helper Methods === */
 
      /**
-      * @brief Searches for a null-terminated string in a binary data vector.
-      * @param std::vector<char> binary data vector
+      * @brief Searches for a null-terminated string in binary data.
+      * @param std::span<const char> binary data
       * @param size_t offset to start searching from
       * @param std::string& string to store the result in
       * @return size_t - position of the next character after the null
       * terminator
       */
-     static inline size_t findcstr(const std::vector<char>& bin_data,
+     static inline size_t findcstr(std::span<const char> bin_data,
                                    size_t offset, std::string& result) {
           /* Search for a null terminator */
           size_t end = offset;
@@ -103,23 +103,37 @@ class DataPacket : public BasePacket {
       * @throws std::invalid_argument when vector is not a proper DATA packet
       * @note Prefer to use `from_binary()` with mode parameter.
       *
-      * @param std::vector<char> packet in binary
+      * @param std::span<const char> packet in binary
       * @return DataPacket
       */
-     static DataPacket from_binary(const std::vector<char>& bin_data);
+     static DataPacket from_binary(std::span<const char> bin_data);
 
      /**
       * @brief Creates a new DATA packet from a binary representation (with
       * mode). Attempts to parse a binary vector into a DATA packet.
       * @throws std::invalid_argument when vector is not a proper DATA packet
       *
-      * @param std::vector<char> packet in binary
+      * @param std::span<const char> packet in binary
       * @param TFTPDataFormat mode
       * @return DataPacket
       */
-     static DataPacket from_binary(const std::vector<char>& bin_data,
+     static DataPacket from_binary(std::span<const char> bin_data,
                                    TFTPDataFormat mode);
 
+     /**
+      * @brief Writes a DATA packet header (opcode + block number) in place.
+      * Lets senders build packets in their own buffers, with the payload
+      * right after the header.
+      * @param char* buffer (at least 4B)
+      * @param uint16_t block number
+      */
+     static void write_header(char* buf, uint16_t block_n) {
+          uint16_t opcode = htons(static_cast<uint16_t>(TFTPOpcode::DATA));
+          uint16_t block_n_net = htons(block_n);
+          std::memcpy(buf, &opcode, sizeof(opcode));
+          std::memcpy(buf + 2, &block_n_net, sizeof(block_n_net));
+     }
+
      /* === Getters and Setters === */
 
      /**
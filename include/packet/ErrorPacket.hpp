@@ -68,10 +68,10 @@ class ErrorPacket : public BasePacket {
       * @brief Creates an ERROR packet from binary representation.
       * @throws std::invalid_argument when vector is not a proper ERROR packet
       *
-      * @param std::vector<char> packet in binary
+      * @param std::span<const char> packet in binary
       * @return ErrorPacket
       */
-     static ErrorPacket from_binary(const std::vector<char>& bin_data);
+     static ErrorPacket from_binary(std::span<const char> bin_data);
 
      /* === Getters and Setters === */
 
@@ -72,10 +72,10 @@ class OptionAckPacket : public BasePacket {
       * @details Attempts to parse a binary vector into a OACK packet
       * @throws std::invalid_argument when vector is not a proper OACK packet
       *
-      * @param std::vector<char> packet in binary
+      * @param std::span<const char> packet in binary
       * @return OptionACkPacket
       */
-     static OptionAckPacket from_binary(const std::vector<char>& bin_data);
+     static OptionAckPacket from_binary(std::span<const char> bin_data);
 
      /* === Getters and Setters === */
 
@@ -25,13 +25,13 @@
 class PacketFactory {
    public:
      /**
-      * @brief Create TFTP packet from a binary vector.
-      * @param bin_data Binary vector to be parsed.
+      * @brief Create TFTP packet from binary data.
+      * @param bin_data Binary data to be parsed.
       * @return std::unique_ptr<BasePacket> Pointer to created packet.
       */
      static std::unique_ptr<BasePacket> create(
-         const std::vector<char>& bin_data) {
-          if (bin_data.empty()) {
+         std::span<const char> bin_data) {
+          if (bin_data.size() < 2) {
                return nullptr;
           }
 
@@ -70,8 +70,7 @@ class PacketFactory {
       */
      static std::unique_ptr<BasePacket> create(
          std::array<char, TFTP_DFLT_MAXSIZE>& bin_data, size_t size) {
-          return create(
-              std::vector<char>(bin_data.begin(), bin_data.begin() + size));
+          return create(std::span<const char>(bin_data.data(), size));
      }
 };
 
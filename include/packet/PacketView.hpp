@@ -0,0 +1,122 @@
+/**
+ * @file PacketView.hpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Non-owning views of received TFTP packets.
+ * @date 2023-11-18
+ */
+
+#pragma once
+#ifndef TFTP_PACKET_VIEW_HPP
+#     define TFTP_PACKET_VIEW_HPP
+#     include <span>
+#     include <string_view>
+#     include <variant>
+
+#     include "common.hpp"
+
+/**
+ * @brief View of a DATA packet (opcode 3)
+ */
+struct DataView {
+     uint16_t block_n;           /**< Block number */
+     std::span<const char> data; /**< Payload */
+};
+
+/**
+ * @brief View of an ACK packet (opcode 4)
+ */
+struct AckView {
+     uint16_t block_n; /**< Acknowledged block number */
+};
+
+/**
+ * @brief View of an ERROR packet (opcode 5)
+ */
+struct ErrorView {
+     TFTPErrorCode errcode;    /**< Error code */
+     std::string_view message; /**< Message (NetASCII, may be empty) */
+};
+
+/**
+ * @brief View of an OACK packet (opcode 6)
+ */
+struct OackView {
+     std::span<const char> opts; /**< Options (`name\0value\0`...) */
+
+     /**
+      * @brief Iterates over the options without copying them
+      * @param func Callable taking (std::string_view, std::string_view)
+      */
+     template <typename F>
+     void for_each_option(F&& func) const {
+          size_t offset = 0;
+          while (offset < this->opts.size()) {
+               std::string_view name(this->opts.data() + offset);
+               offset += name.size() + 1;
+               std::string_view value(this->opts.data() + offset);
+               offset += value.size() + 1;
+               func(name, value);
+          }
+     }
+
+     /**
+      * @brief Copies the options out of the view
+      * @return std::vector<std::pair<std::string, std::string>> options
+      */
+     std::vector<std::pair<std::string, std::string>> get_options() const {
+          std::vector<std::pair<std::string, std::string>> res;
+          this->for_each_option([&res](std::string_view name,
+                                       std::string_view value) {
+               res.emplace_back(std::string(name), std::string(value));
+          });
+          return res;
+     }
+};
+
+/**
+ * @brief Non-owning view of a received TFTP packet
+ * @details Decodes a datagram in place – the view only references the
+ *          buffer it was parsed from, so it must not outlive it (nor
+ *          its next overwrite). Parsing neither allocates nor throws
+ *          and type dispatch is a `std::variant` (no virtual calls).
+ *          Owning packet classes (see `PacketFactory`) remain for
+ *          building outgoing packets.
+ * @note RRQ and WRQ are recognised (`get_opcode`) but not decoded,
+ *       as they are only parsed into owning `RequestPacket`s.
+ */
+class PacketView {
+   public:
+     /**
+      * @brief Parses a packet view from binary data
+      * @param bin_data Received datagram
+      * @return std::optional<PacketView> view, nullopt if invalid
+      */
+     static std::optional<PacketView> parse(std::span<const char> bin_data);
+
+     /**
+      * @brief Returns the opcode of the packet
+      * @return TFTPOpcode
+      */
+     TFTPOpcode get_opcode() const { return this->opcode; }
+
+     /**
+      * @brief Returns the packet as a specific view type
+      * @return const T* view, nullptr if the packet is of another type
+      */
+     template <typename T>
+     const T* get() const {
+          return std::get_if<T>(&this->view);
+     }
+
+   private:
+     using Variant = std::variant<std::monostate, DataView, AckView,
+                                  ErrorView, OackView>;
+
+     PacketView(TFTPOpcode opcode, Variant view)
+         : opcode(opcode), view(view) {}
+
+     TFTPOpcode opcode; /**< Opcode of the packet */
+     Variant view;      /**< Decoded view (monostate for RRQ/WRQ) */
+};
+
+#endif
@@ -82,10 +82,10 @@ class RequestPacket : public BasePacket {
       * @details Attempts to parse a binary vector into a {W,R}RQ packet.
       * @throws std::invalid_argument when vector is not a proper RQ packet
       *
-      * @param std::vector<char> packet in binary
+      * @param std::span<const char> packet in binary
       * @return RequestPacket
       */
-     static RequestPacket from_binary(const std::vector<char>& bin_data);
+     static RequestPacket from_binary(std::span<const char> bin_data);
 
      /* === Getters and Setters === */
 
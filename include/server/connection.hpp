@@ -9,7 +9,14 @@
 #ifndef TFTP_CONNECTION_HPP
 #     define TFTP_CONNECTION_HPP
 
+#     include <strings.h>
+
+#     include <atomic>
+
 #     include "util/connection.hpp"
+#     include "util/filecache.hpp"
+#     include "util/filemap.hpp"
+#     include "util/pathcache.hpp"
 
 /**
  * @brief Class for TFTPserver connections
@@ -22,20 +29,54 @@ class TFTPServerConnection : public TFTPConnectionBase {
       * @param req_packet Request packet (RRQ / WRQ)
       * @param root_dir Server root directory
       * @param shutd_flag Shared shutdown flag
+      * @param rollover Default block number rollover mode
+      */
+     TFTPServerConnection(
+         const sockaddr_in& clt_addr, const RequestPacket& req_packet,
+         const std::string& root_dir,
+         const std::shared_ptr<std::atomic<bool>>& shutd_flag,
+         TFTPBlockRollover rollover = TFTPBlockRollover::None);
+
+     /**
+      * @brief Leaves a descriptor shared through the path cache open
       */
-     TFTPServerConnection(const sockaddr_in& clt_addr,
-                          const RequestPacket& req_packet,
-                          const std::string& root_dir,
-                          const std::shared_ptr<std::atomic<bool>>& shutd_flag);
+     ~TFTPServerConnection();
 
      TFTPServerConnection& operator=(TFTPServerConnection&& other) = delete;
      TFTPServerConnection& operator=(const TFTPServerConnection&) = delete;
      TFTPServerConnection(TFTPServerConnection&& other) = delete;
      TFTPServerConnection(const TFTPServerConnection&) = delete;
 
-     /** @note `exec()` is made public to allow for `poll()` handling */
+     /** @note `exec()` is made public for the worker event loop */
      using TFTPConnectionBase::exec;
 
+     /**
+      * @brief Sets the shared file cache (before the request is handled)
+      * @param cache File cache, nullptr to read files directly
+      */
+     void set_cache(FileCache* cache) { this->cache = cache; }
+
+     /**
+      * @brief Sets the shared path cache (before the request is handled)
+      * @param paths Path cache, nullptr to open files directly
+      */
+     void set_paths(PathCache* paths) { this->paths = paths; }
+
+     /**
+      * @brief Sets the MTU `blksize` is lowered to fit (before the
+      *        request is handled)
+      * @param mtu MTU of the path to clients, 0 to ask the kernel for
+      *            the path MTU of each client, -1 to accept any `blksize`
+      */
+     void set_mtu(int mtu) { this->mtu = mtu; }
+
+     /**
+      * @brief Gets the path MTU to a host, as known to the kernel
+      * @param addr Remote host
+      * @return int MTU, 0 if unknown
+      */
+     static int path_mtu(const sockaddr_in& addr);
+
    protected:
      /* === Overrides === */
 
@@ -50,10 +91,35 @@ class TFTPServerConnection : public TFTPConnectionBase {
      void handle_request_upload() override;
      void handle_request_download() override;
      bool should_shutd() override;
-     std::vector<char> next_data() override;
+     size_t next_data(std::span<char> payload) override;
+     std::optional<std::span<const char>> next_slice(size_t max) override;
+
+     /* === Helper methods === */
+
+     /**
+      * @brief Lowers a `blksize` option over the MTU (see `set_mtu`)
+      */
+     void clamp_blksize();
+
+     /**
+      * @brief Sends the ERROR for a file that failed to open
+      * @param err `errno` of the failure
+      */
+     void send_open_error(int err);
 
      /* === Variables === */
      std::atomic<bool>& shutd_flag; /**< Flag to signal shutdown */
+     off_t file_off = 0;            /**< Offset of the next block to read */
+     off_t file_end = 0;            /**< End of the sent data (`range`) */
+     NetASCII::Encoder na_encoder;  /**< Streaming RRQ NetASCII encoder */
+     FileCache* cache = nullptr;    /**< Shared file cache (optional) */
+     std::shared_ptr<FileCache::Image>
+         image; /**< Cached image served instead of the file */
+     std::unique_ptr<FileMap> map; /**< Mapping of a large octet file */
+     PathCache* paths = nullptr;   /**< Shared path cache (optional) */
+     std::shared_ptr<const PathCache::File>
+         shared_file; /**< File of `file_fd` if shared (path cache) */
+     int mtu = -1; /**< MTU `blksize` fits in (0 = path MTU, -1 = off) */
 };
 
 #endif
\ No newline at end of file
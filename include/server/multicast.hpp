@@ -0,0 +1,152 @@
+/**
+ * @file multicast.hpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief TFTP multicast session (RFC 2090) implementation.
+ * @date 2023-11-25
+ */
+
+#pragma once
+#ifndef TFTP_MULTICAST_HPP
+#     define TFTP_MULTICAST_HPP
+
+#     include <deque>
+
+#     include "server/connection.hpp"
+#     include "util/grouppool.hpp"
+
+/**
+ * @brief Class for a TFTP multicast session (RFC 2090)
+ * @details Serves one file to any number of clients at once: DATA go
+ *          (once) to a multicast group, the clients of the session
+ *          listen on it. Only the master client (the first one) ACKs
+ *          them – the upload runs as for a single client, but from
+ *          the block the master is missing. Clients joining later get
+ *          the blocks from then on, the one they missed once they
+ *          become master themselves: when the master has the whole
+ *          file (or leaves, or stops answering), the next client is
+ *          sent a unicast OACK making it master, and the upload starts
+ *          over from its first missing block, ACKed by it.
+ * @details The session ends once every client got the file. Other
+ *          clients only send a final ACK (or an ERROR, if they give
+ *          up) to leave the session; any other packets of theirs are
+ *          ignored.
+ * @note Sessions serve octet-mode RRQs without the `range` and
+ *       `rollover` options, with equal `blksize` and `windowsize`
+ *       (see `session_key`).
+ */
+class TFTPMulticastSession : public TFTPServerConnection {
+   public:
+     /**
+      * @brief Constructs a new multicast session for its first client
+      * @param clt_addr Client address (the first master)
+      * @param req_packet Request packet (RRQ with `multicast`)
+      * @param root_dir Server root directory
+      * @param shutd_flag Shared shutdown flag
+      * @param groups Pool the group was taken from
+      * @param group Group address of the session (given back to
+      *              `groups` on destruction)
+      */
+     TFTPMulticastSession(const sockaddr_in& clt_addr,
+                          const RequestPacket& req_packet,
+                          const std::string& root_dir,
+                          const std::shared_ptr<std::atomic<bool>>& shutd_flag,
+                          GroupPool& groups, const sockaddr_in& group);
+
+     /**
+      * @brief Gives the group back to the pool
+      */
+     ~TFTPMulticastSession();
+
+     TFTPMulticastSession& operator=(TFTPMulticastSession&& other) = delete;
+     TFTPMulticastSession& operator=(const TFTPMulticastSession&) = delete;
+     TFTPMulticastSession(TFTPMulticastSession&& other) = delete;
+     TFTPMulticastSession(const TFTPMulticastSession&) = delete;
+
+     /**
+      * @brief Gets the key of the session a request can join
+      * @param req Request
+      * @return std::optional<std::string> key (file and options
+      *         shared by the clients), nullopt if the request cannot be
+      *         served by a multicast session
+      */
+     static std::optional<std::string> session_key(const RequestPacket& req);
+
+     /**
+      * @brief Adds a client (requesting the session's file) to the
+      *        session, answering it with an OACK of the session
+      * @note A client already in the session gets its OACK again
+      *       (retransmitted RRQ), the master none (the session
+      *       retransmits it).
+      * @param clt_addr Client address
+      * @param req Request
+      */
+     void join(const sockaddr_in& clt_addr, const RequestPacket& req);
+
+   protected:
+     /* === Overrides === */
+
+     void handle_request_upload() override;
+     void handle_await_upload() override;
+     bool handle_ack(const AckView& ack) override;
+     void handle_error(const ErrorView& err) override;
+     void handle_stray(const sockaddr_in& origin,
+                       const PacketView& packet) override;
+     const sockaddr_in& data_addr() const override { return this->group; }
+
+   private:
+     /**
+      * @brief Client of the session
+      */
+     struct Member {
+          sockaddr_in addr;               /**< Client address (TID) */
+          std::vector<std::string> names; /**< Options it asked for */
+     };
+
+     /* === Helper methods === */
+
+     /**
+      * @brief Builds the OACK options of a client: the options of the
+      *        session it asked for, and the group
+      * @param member Client
+      * @param master Whether the client is (made) master
+      * @return std::vector<std::pair<std::string, std::string>> options
+      */
+     std::vector<std::pair<std::string, std::string>> member_opts(
+         const Member& member, bool master) const;
+
+     /**
+      * @brief Finds a client of the session
+      * @param addr Client address
+      * @return std::deque<Member>::iterator client, `end()` if not found
+      */
+     std::deque<Member>::iterator find_member(const sockaddr_in& addr);
+
+     /**
+      * @brief Drops the master and makes the next client master (or
+      *        completes the session, if none is left)
+      */
+     void next_master();
+
+     /**
+      * @brief Restarts the upload after a block
+      * @param block Last block the master has (in order)
+      */
+     void restart(uint64_t block);
+
+     /**
+      * @brief Formats an address for logging
+      * @param addr Address
+      * @return std::string "addr:port"
+      */
+     static std::string addr_str(const sockaddr_in& addr);
+
+     /* === Variables === */
+     GroupPool& groups;          /**< Pool of `group` */
+     sockaddr_in group;          /**< Group address of the session */
+     std::deque<Member> members; /**< Clients, the master first */
+     std::vector<std::pair<std::string, std::string>>
+         session_opts;        /**< Options of the session (all asked for) */
+     uint64_t last_block = 0; /**< Number of the final block */
+};
+
+#endif
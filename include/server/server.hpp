@@ -8,23 +8,22 @@
 #pragma once
 #ifndef TFTP_SERVER_HPP
 #     define TFTP_SERVER_HPP
-#     include <fcntl.h>
-#     include <poll.h>
 #     include <sys/stat.h>
 
 #     include <csignal>
 #     include <memory>
+#     include <thread>
 
 #     include "common.hpp"
-#     include "server/connection.hpp"
+#     include "server/worker.hpp"
 #     include "util/logger.hpp"
-
-#     define POLL_TIMEO 1000
-#     define CONN_TIMEOUT (TFTP_PACKET_TIMEO * 3) * 1000
-#     define CONN_CLEANUP_INTERVAL 10000
+#     include "util/trace.hpp"
 
 /**
  * @brief Class for TFTP server.
+ * @details Server runs `threads` workers (see `TFTPServerWorker`), each
+ *          in its own thread with its own listening socket on the same
+ *          port (`SO_REUSEPORT`), connections and event loop.
  */
 class TFTPServer {
    public:
@@ -50,11 +49,21 @@ class TFTPServer {
       */
      explicit TFTPServer(std::string rootdir, int port);
 
+     /**
+      * @brief Constructs a new TFTP server object with set root directory,
+      * port and number of worker threads.
+      * @param std::string rootdir
+      * @param int port
+      * @param int threads
+      * @return TFTPServer
+      */
+     explicit TFTPServer(std::string rootdir, int port, int threads);
+
      /**
       * @brief Deconstructs the TFTP server object.
       */
      ~TFTPServer() {
-          if (this->fd > 0) this->stop();
+          if (!this->threads.empty()) this->stop();
      }
 
      TFTPServer& operator=(TFTPServer&& other) = delete;
@@ -62,51 +71,115 @@ class TFTPServer {
      TFTPServer(TFTPServer&& other) = delete;
      TFTPServer(const TFTPServer&) = delete;
 
-     /* === Core Methods === */
+     /* === Getters and setters === */
 
      /**
-      * @brief Starts the TFTP server
+      * @brief Sets the event loop backend of the workers
+      * @param backend Event loop backend
       */
-     void start();
+     void set_backend(EventLoopBackend backend) { this->backend = backend; }
 
      /**
-      * @brief Stops the TFTP server
+      * @brief Sets the block number rollover mode of connections
+      * @param rollover Rollover mode
       */
-     void stop();
-
-   private:
-     /* === Core methods === */
+     void set_rollover(TFTPBlockRollover rollover) {
+          this->rollover = rollover;
+     }
 
      /**
-      * @brief Listens for incoming connections
+      * @brief Sets the file metrics are dumped to (stdout if empty)
+      * @param path File path
       */
-     void srv_poll();
+     void set_metrics_file(std::string path) {
+          this->metrics_file = std::move(path);
+     }
 
      /**
-      * @brief Handles a new incoming connection
+      * @brief Sets the file the trace is written to at exit (tracing
+      *        runs from the start, SIGUSR2 stops or restarts it)
+      * @param path File path (empty for no tracing)
       */
-     void new_conn();
+     void set_trace_file(std::string path) {
+          this->trace_file = std::move(path);
+     }
 
      /**
-      * @brief Removes a connection from `connections` and `fds`
+      * @brief Sets the memory budget of the shared RRQ file cache
+      * @param budget Budget in bytes (0 disables the cache)
+      * @param netascii Whether to cache NetASCII-encoded images too
       */
-     void conn_remove(int fd);
+     void set_cache(size_t budget, bool netascii = true) {
+          this->cache_budget = budget;
+          this->cache_netascii = netascii;
+     }
 
      /**
-      * @brief Cleanup all finished connections
+      * @brief Sets the size of the shared RRQ path cache
+      * @param entries Maximum cached paths (open files), 0 disables it
       */
-     void conn_cleanup();
+     void set_paths(size_t entries) { this->path_entries = entries; }
 
      /**
-      * @brief Checks if connections should be cleaned up
-      * @returns true when cleanup is needed,
-      * @returns false otherwise
+      * @brief Sets the admission control of connections
+      * @param max_total Maximum connections in total (0 = unlimited)
+      * @param max_per_client Maximum connections per client IP address
+      *                       (0 = unlimited)
+      * @param queue_max Maximum requests waiting for admission, per
+      *                  worker (0 to refuse them right away)
       */
-     bool should_cleanup() const {
-          return std::chrono::steady_clock::now() - this->last_cleanup
-                 > std::chrono::milliseconds(CONN_CLEANUP_INTERVAL);
+     void set_admission(size_t max_total, size_t max_per_client,
+                        size_t queue_max) {
+          this->max_conns = max_total;
+          this->max_client_conns = max_per_client;
+          this->queue_max = queue_max;
      }
 
+     /**
+      * @brief Makes connections share sockets for their replies
+      * @param socks 0 to reply from the server port, N for N sockets
+      *              per worker, -1 for a socket per connection
+      * @see TFTPServerWorker::set_demux
+      */
+     void set_demux(int socks) { this->demux_socks = socks; }
+
+     /**
+      * @brief Serves RRQs asking for `multicast` (RFC 2090) in
+      *        multicast sessions
+      * @param base First of the `TFTP_MCAST_GROUPS` group addresses
+      *             and their port
+      * @see TFTPMulticastSession
+      */
+     void set_multicast(const sockaddr_in& base) { this->mcast_base = base; }
+
+     /**
+      * @brief Lowers `blksize` options so that DATA fit the MTU
+      * @param mtu MTU, 0 for the path MTU of each client, -1 for off
+      * @see TFTPServerConnection::set_mtu
+      */
+     void set_mtu(int mtu) { this->mtu = mtu; }
+
+     /**
+      * @brief Paces transfers, sharing the egress limit fairly
+      * @param rate Egress limit of all workers (bytes per second, 0 to
+      *             pace without a limit)
+      * @see TFTPServerWorker::set_pacing
+      */
+     void set_pacing(double rate) { this->egress_rate = rate; }
+
+     /* === Core Methods === */
+
+     /**
+      * @brief Starts the TFTP server
+      */
+     void start();
+
+     /**
+      * @brief Stops the TFTP server
+      */
+     void stop();
+
+   private:
      /* === Helper methods === */
 
      /**
@@ -118,34 +191,52 @@ class TFTPServer {
      bool check_dir() const;
 
      /**
-      * @brief Finds a TFTPServerConnection by its socket file descriptor
-      * @return shared_ptr<TFTPServerConnection>* when found,
-      * @return NULL otherwise
+      * @brief Dumps the metrics of all workers (Prometheus text format)
+      *        to the metrics file, or stdout
       */
-     std::shared_ptr<TFTPServerConnection>* find_conn(int fd);
+     void dump_metrics() const;
 
      /* === Variables === */
 
-     /* == Server config and fd == */
+     /* == Server config == */
      int port;            /**< Port to listen on */
      std::string rootdir; /**< Root directory of the server */
-
-     /* == Poll == */
-     std::vector<struct pollfd> fds; /**< Poll file descriptors */
-     struct pollfd srv_fd {};        /**< Server file descriptor */
-
-     /* == Server address and fd == */
-     int fd = -1;                       /**< Socket file descriptor */
-     struct sockaddr_in addr {};        /**< Socket address */
-     socklen_t addr_len = sizeof(addr); /**< Socket address length */
+     int n_threads = 1;   /**< Number of worker threads */
+     EventLoopBackend backend
+         = EventLoop::default_backend(); /**< Worker event loop backend */
+     TFTPBlockRollover rollover
+         = TFTPBlockRollover::None; /**< Block number rollover mode */
+     std::string metrics_file;      /**< Metrics dump file (or stdout) */
+     std::string trace_file;        /**< Trace file (empty = no tracing) */
+     size_t cache_budget = 0;       /**< File cache budget (0 = off) */
+     bool cache_netascii = true;    /**< Flag to cache NetASCII images */
+     size_t path_entries = 0;       /**< Path cache size (0 = off) */
+     size_t max_conns = 0;          /**< Connection cap (0 = none) */
+     size_t max_client_conns = 0;   /**< Per-client cap (0 = none) */
+     size_t queue_max = 0;          /**< Admission queue (per worker) */
+     int demux_socks = -1;          /**< Shared reply sockets (-1 = off) */
+     int mtu = -1;                  /**< MTU of `blksize` (-1 = off) */
+     std::optional<sockaddr_in>
+         mcast_base; /**< First multicast group (nullopt = off) */
+     std::optional<double>
+         egress_rate; /**< Egress limit (bytes/s, nullopt = no pacing) */
+
+     /* == Workers == */
+     std::vector<std::unique_ptr<TFTPServerWorker>>
+         workers;                      /**< Workers (one per thread) */
+     std::vector<std::thread> threads; /**< Worker threads */
+     std::shared_ptr<FileCache> cache; /**< File cache shared by workers */
+     std::shared_ptr<PathCache> paths; /**< Path cache shared by workers */
+     std::shared_ptr<AdmissionControl>
+         admission; /**< Admission control shared by workers */
+     std::shared_ptr<GroupPool>
+         groups; /**< Multicast groups shared by workers */
+     std::shared_ptr<EgressLimit>
+         egress; /**< Egress limit shared by workers */
 
      /* == Other == */
-     std::vector<std::shared_ptr<TFTPServerConnection>>
-         connections; /**< Connections vector */
      std::shared_ptr<std::atomic<bool>>
          shutd_flag; /**< Flag to signal shutdown */
-     std::chrono::time_point<std::chrono::steady_clock>
-         last_cleanup; /**< Last cleanup time */
 };
 
 #endif
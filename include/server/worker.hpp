@@ -0,0 +1,437 @@
+/**
+ * @file worker.hpp
+ * @author Onegen Something (xkrame00@vutbr.cz)
+ * @brief TFTP server worker (reactor thread) implementation.
+ * @date 2023-10-21
+ */
+
+#pragma once
+#ifndef TFTP_SERVER_WORKER_HPP
+#     define TFTP_SERVER_WORKER_HPP
+#     include <fcntl.h>
+
+#     include <atomic>
+#     include <deque>
+#     include <memory>
+#     include <unordered_map>
+
+#     include "common.hpp"
+#     include "server/connection.hpp"
+#     include "server/multicast.hpp"
+#     include "util/admission.hpp"
+#     include "util/batchcounter.hpp"
+#     include "util/eventloop.hpp"
+#     include "util/diskwriter.hpp"
+#     include "util/drrqueue.hpp"
+#     include "util/egresslimit.hpp"
+#     include "util/filecache.hpp"
+#     include "util/grouppool.hpp"
+#     include "util/pathcache.hpp"
+#     include "util/logger.hpp"
+#     include "util/metrics.hpp"
+#     include "util/peertable.hpp"
+#     include "util/socketpool.hpp"
+
+#     define POLL_TIMEO 1000
+
+/**
+ * @brief Class for a TFTP server worker.
+ * @details Worker owns its own listening socket (bound to the server
+ *          port with `SO_REUSEPORT`, so the kernel spreads incoming
+ *          requests across all workers), its own connections and its
+ *          own event loop. It is meant to be run in its own thread.
+ * @details Requests already being served (or queued) are dropped, so a
+ *          client retransmitting its RRQ/WRQ does not get a second
+ *          transfer. Requests over the caps of the shared admission
+ *          control wait in a bounded queue, or are refused right away
+ *          with an ERROR.
+ * @details New connections get a pre-bound socket from `sockets` and
+ *          the buffers left by a finished connection, so setting up a
+ *          transfer costs no socket syscalls nor buffer allocations.
+ * @details In the demultiplexed mode (see `set_demux`), connections
+ *          instead share a few sockets: the worker receives their
+ *          packets in `recvmmsg` batches and hands every one to the
+ *          connection of its origin, looked up in a flat table of
+ *          peers (which also makes the TID check). Their retransmit
+ *          timers live in a queue of the worker, as they have no fd.
+ * @details Connections are keyed by their socket fd, or by
+ *          `demux_key(slot)` (below -1) when demultiplexed.
+ * @details With multicast groups (see `set_groups`), RRQs asking for
+ *          the `multicast` option join the session of the worker
+ *          serving the same file (see `TFTPMulticastSession`), or
+ *          start one.
+ * @details When pacing (see `set_pacing`), connections leave their
+ *          DATA to the worker, which sends them in deficit round-robin
+ *          turns (`drr`), each paced by its connection, all within the
+ *          shared egress limit.
+ */
+class TFTPServerWorker {
+   public:
+     /**
+      * @brief Constructs a new TFTP server worker object.
+      * @param id Worker number (for logging)
+      * @param rootdir Root directory of the server
+      * @param port Port to listen on
+      * @param shutd_flag Shared shutdown flag
+      * @param backend Event loop backend
+      * @param rollover Block number rollover mode of connections
+      */
+     TFTPServerWorker(int id, std::string rootdir, int port,
+                      std::shared_ptr<std::atomic<bool>> shutd_flag,
+                      EventLoopBackend backend, TFTPBlockRollover rollover);
+
+     /**
+      * @brief Deconstructs the TFTP server worker object.
+      */
+     ~TFTPServerWorker() {
+          if (this->fd > 0) this->drain();
+     }
+
+     TFTPServerWorker& operator=(TFTPServerWorker&& other) = delete;
+     TFTPServerWorker& operator=(const TFTPServerWorker&) = delete;
+     TFTPServerWorker(TFTPServerWorker&& other) = delete;
+     TFTPServerWorker(const TFTPServerWorker&) = delete;
+
+     /* === Core Methods === */
+
+     /**
+      * @brief Creates and binds the worker listening socket
+      * @throws std::runtime_error on socket setup error
+      */
+     void sock_init();
+
+     /**
+      * @brief Runs the worker loop until the shutdown flag is set,
+      *        then drains all its connections (blocking)
+      */
+     void run();
+
+     /**
+      * @brief Gets the worker metrics (readable from any thread)
+      * @return const ServerMetrics&
+      */
+     const ServerMetrics& get_metrics() const { return this->metrics; }
+
+     /**
+      * @brief Sets the file cache shared by the workers (before `run()`)
+      * @param cache File cache, nullptr to read files directly
+      */
+     void set_cache(std::shared_ptr<FileCache> cache) {
+          this->cache = std::move(cache);
+     }
+
+     /**
+      * @brief Sets the path cache shared by the workers (before `run()`)
+      * @param paths Path cache, nullptr to open files directly
+      */
+     void set_paths(std::shared_ptr<PathCache> paths) {
+          this->paths = std::move(paths);
+     }
+
+     /**
+      * @brief Sets the admission control shared by the workers (before
+      *        `run()`)
+      * @param admission Admission control, nullptr for no caps
+      * @param queue_max Maximum requests waiting for admission (0 to
+      *                  refuse those over the caps right away)
+      */
+     void set_admission(std::shared_ptr<AdmissionControl> admission,
+                        size_t queue_max) {
+          this->admission = std::move(admission);
+          this->queue_max = queue_max;
+     }
+
+     /**
+      * @brief Sets the multicast groups shared by the workers (before
+      *        `run()`)
+      * @param groups Group pool, nullptr for no multicast sessions
+      * @note Not used when demultiplexing.
+      */
+     void set_groups(std::shared_ptr<GroupPool> groups) {
+          this->groups = std::move(groups);
+     }
+
+     /**
+      * @brief Sets the egress limit shared by the workers (before
+      *        `run()`), pacing the connections
+      * @param egress Egress limit, nullptr for no pacing
+      */
+     void set_pacing(std::shared_ptr<EgressLimit> egress) {
+          this->egress = std::move(egress);
+     }
+
+     /**
+      * @brief Makes connections share sockets for their replies (before
+      *        `sock_init`)
+      * @param socks 0 to reply from the listening socket (server port;
+      *              needs clients that do not insist on a new TID),
+      *              N for N sockets per worker, -1 for a socket per
+      *              connection (default)
+      */
+     void set_demux(int socks) { this->demux_socks = socks; }
+
+     /**
+      * @brief Sets the MTU `blksize` options are lowered to fit
+      * @param mtu MTU, 0 for the path MTU of each client, -1 for off
+      * @see TFTPServerConnection::set_mtu
+      */
+     void set_mtu(int mtu) { this->mtu = mtu; }
+
+   private:
+     /**
+      * @brief Connection on a shared socket
+      */
+     struct DemuxSlot {
+          TFTPServerConnection* conn = nullptr; /**< Connection */
+          sockaddr_in peer{};                     /**< Remote host */
+     };
+
+     /**
+      * @brief Identity of a request (for dropping duplicates)
+      */
+     struct RequestKey {
+          in_addr_t addr;       /**< Client address */
+          in_port_t port;       /**< Client port (TID) */
+          TFTPRequestType type; /**< RRQ or WRQ */
+          std::string filename; /**< Requested file */
+
+          bool operator==(const RequestKey& other) const = default;
+     };
+
+     /**
+      * @brief Hash of `RequestKey`
+      */
+     struct RequestKeyHash {
+          size_t operator()(const RequestKey& key) const;
+     };
+
+     /**
+      * @brief Request waiting for admission
+      */
+     struct QueuedRequest {
+          std::vector<char> data; /**< Request datagram */
+          sockaddr_in addr;       /**< Client address */
+          RequestKey key;         /**< Request identity */
+          std::chrono::steady_clock::time_point since; /**< Queued at */
+     };
+
+     /* === Core methods === */
+
+     /**
+      * @brief Listens for incoming connections
+      */
+     void srv_poll();
+
+     /**
+      * @brief Terminates all connections and closes the socket
+      */
+     void drain();
+
+     /**
+      * @brief Drains queued datagrams from the listening socket (or
+      *        a shared reply socket) in `recvmmsg` batches
+      * @param sock Socket fd
+      */
+     void srv_recv(int sock);
+
+     /**
+      * @brief Hands a datagram received on a shared socket over to its
+      *        connection (requests to `new_conn`)
+      * @param sock Socket fd the datagram arrived on
+      * @param data Datagram
+      * @param c_addr Origin address
+      */
+     void demux(int sock, std::span<const char> data,
+                const sockaddr_in& c_addr);
+
+     /**
+      * @brief Continues demultiplexed connections with expired timers
+      */
+     void demux_expire();
+
+     /**
+      * @brief Checks if a socket is a shared reply socket
+      * @param sock Socket fd
+      * @return true if it is,
+      * @return false otherwise
+      */
+     bool is_reply_sock(int sock) const {
+          for (const auto& reply : this->reply_socks)
+               if (reply.fd == sock) return true;
+          return false;
+     }
+
+     /**
+      * @brief Gets the key of a demultiplexed connection
+      * @param slot Slot in `demuxed`
+      * @return int key
+      */
+     static int demux_key(int slot) { return -2 - slot; }
+
+     /**
+      * @brief Handles a new incoming connection
+      * @param data Received request datagram
+      * @param c_addr Client address
+      */
+     void new_conn(std::span<const char> data, const sockaddr_in& c_addr);
+
+     /**
+      * @brief Instantiates the connection of an admitted request
+      * @param req Request
+      * @param c_addr Client address
+      * @param key Request identity
+      */
+     void open_conn(const RequestPacket& req, const sockaddr_in& c_addr,
+                    const RequestKey& key);
+
+     /**
+      * @brief Opens connections of the queued requests now within the
+      *        caps, refuses those queued for too long
+      */
+     void admit_queued();
+
+     /**
+      * @brief Refuses a request with an ERROR (sent from the listening
+      *        socket, no connection is set up)
+      * @param c_addr Client address
+      * @param msg Error message
+      */
+     void refuse(const sockaddr_in& c_addr, const std::string& msg);
+
+     /**
+      * @brief Gives the connections with DATA waiting their turns to
+      *        send (pacing)
+      */
+     void sched_flush();
+
+     /**
+      * @brief Continues a connection after an event, then either
+      *        removes it (if finished) or syncs its retransmit timer
+      * @param conn Connection
+      * @param key Connection key
+      */
+     void conn_exec(TFTPServerConnection* conn, int key);
+
+     /**
+      * @brief Syncs the retransmit timer of a connection with its
+      *        deadline
+      * @param conn Connection
+      * @param key Connection key
+      */
+     void conn_arm(TFTPServerConnection* conn, int key);
+
+     /**
+      * @brief Removes a connection from `connections` and the event loop
+      * @param key Connection key
+      */
+     void conn_remove(int key);
+
+     /**
+      * @brief Stops watching a connection (event loop or peer table)
+      *        and cancels its timer
+      * @param key Connection key
+      */
+     void conn_unwatch(int key);
+
+     /**
+      * @brief Cleanup all finished connections
+      */
+     void conn_cleanup();
+
+     /**
+      * @brief Accounts a finished connection in the worker totals
+      * @param conn Connection
+      */
+     void conn_account(const TFTPServerConnection& conn);
+
+     /**
+      * @brief Forgets the request of a finished connection and gives
+      *        back its admission slot
+      * @param key Connection key
+      */
+     void conn_release(int key);
+
+     /**
+      * @brief Takes the socket and buffers of a finished connection back
+      *        into the pools
+      * @param conn Connection (removed from the event loop)
+      * @param key Connection key
+      */
+     void conn_recycle(TFTPServerConnection& conn, int key);
+
+     /* === Variables === */
+
+     /* == Worker config == */
+     int id;              /**< Worker number */
+     int port;            /**< Port to listen on */
+     std::string rootdir; /**< Root directory of the server */
+     TFTPBlockRollover rollover; /**< Block number rollover mode */
+     std::shared_ptr<FileCache> cache; /**< Shared file cache (optional) */
+     std::shared_ptr<PathCache> paths; /**< Shared path cache (optional) */
+     std::shared_ptr<AdmissionControl>
+         admission;        /**< Shared admission control (optional) */
+     std::shared_ptr<GroupPool>
+         groups;           /**< Shared multicast groups (optional) */
+     std::shared_ptr<EgressLimit>
+         egress;           /**< Shared egress limit (if pacing) */
+     size_t queue_max = 0; /**< Maximum requests waiting for admission */
+     int demux_socks = -1; /**< Shared reply sockets (-1 if not shared) */
+     int mtu = -1;         /**< MTU of `blksize` (0 = path MTU, -1 = off) */
+
+     /* == Event loop == */
+     std::unique_ptr<EventLoop> loop; /**< Event loop */
+
+     /* == Listening address and fd == */
+     int fd = -1;                       /**< Socket file descriptor */
+     struct sockaddr_in addr {};        /**< Socket address */
+     socklen_t addr_len = sizeof(addr); /**< Socket address length */
+
+     /* == Listener `recvmmsg` buffers == */
+     std::vector<std::vector<char>>
+         rx_bufs; /**< Datagram buffers (fit any DATA, if demultiplexing) */
+     std::vector<struct sockaddr_in> rx_addrs; /**< Request origins */
+     std::vector<struct iovec> rx_iovs;        /**< Request iovecs */
+     std::vector<struct mmsghdr> rx_msgs;      /**< Request headers */
+
+     /* == Batch counters == */
+     BatchCounter rx_batches; /**< Listener `recvmmsg` batches */
+     BatchCounter tx_batches; /**< DATA `sendmmsg` batches (finished) */
+
+     /* == Metrics == */
+     ServerMetrics metrics; /**< Worker metrics (written by this thread) */
+
+     /* == Other == */
+     DiskWriter writer; /**< Thread of download writes (outlives conns) */
+     SocketPool sockets{TFTP_SOCKET_POOL}; /**< Idle connection sockets */
+     std::vector<TFTPConnectionBase::Buffers>
+         buffers; /**< Idle connection buffers */
+     std::unordered_map<int, std::shared_ptr<TFTPServerConnection>>
+         connections; /**< Connections by their key */
+     std::unordered_map<RequestKey, int, RequestKeyHash>
+         requests; /**< Requests served (key) or queued (-1) */
+     std::unordered_map<int, RequestKey>
+         conn_requests; /**< Requests of the connections by their key */
+     std::deque<QueuedRequest> queue; /**< Requests waiting for admission */
+     std::unordered_map<std::string, int>
+         sessions; /**< Multicast sessions by `session_key` */
+
+     /* == Pacing == */
+     DrrQueue drr; /**< Connections with DATA waiting (by key) */
+     TimerQueue::TimePoint
+         tx_wake{}; /**< Time the next of `drr` may send */
+
+     /* == Demultiplexing == */
+     std::vector<SocketPool::Socket>
+         reply_socks;         /**< Shared reply sockets (own ports) */
+     size_t reply_next = 0;   /**< Next reply socket (round-robin) */
+     PeerTable peers;         /**< Remote host => slot in `demuxed` */
+     std::vector<DemuxSlot> demuxed; /**< Connections on shared sockets */
+     std::vector<int> demux_free;    /**< Free slots of `demuxed` */
+     TimerQueue demux_timers; /**< Retransmit timers (by slot) */
+     std::vector<TimerQueue::Expired>
+         demux_expired; /**< Expiry buffer of `demux_timers` */
+     std::shared_ptr<std::atomic<bool>>
+         shutd_flag; /**< Flag to signal shutdown */
+};
+
+#endif
@@ -0,0 +1,72 @@
+/**
+ * @file admission.hpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Admission control of server connections
+ * @date 2023-11-22
+ */
+
+#pragma once
+#ifndef TFTP_ADMISSION_HPP
+#     define TFTP_ADMISSION_HPP
+#     include <netinet/in.h>
+
+#     include <cstddef>
+#     include <cstdint>
+#     include <mutex>
+#     include <unordered_map>
+
+/**
+ * @brief Admission control of server connections
+ * @details Caps the number of concurrent connections, in total and per
+ *          client IP address. A connection takes a slot on `acquire`
+ *          and gives it back on `release`. Shared by all workers, as
+ *          requests of one client are spread across them.
+ * @note Thread-safe (one mutex, held only for the counter updates).
+ */
+class AdmissionControl {
+   public:
+     /**
+      * @brief Constructs a new admission control
+      * @param max_total Maximum connections in total (0 = unlimited)
+      * @param max_per_client Maximum connections per client IP address
+      *                       (0 = unlimited)
+      */
+     AdmissionControl(size_t max_total, size_t max_per_client)
+         : max_total(max_total), max_per_client(max_per_client) {}
+
+     AdmissionControl& operator=(AdmissionControl&& other) = delete;
+     AdmissionControl& operator=(const AdmissionControl&) = delete;
+     AdmissionControl(AdmissionControl&& other) = delete;
+     AdmissionControl(const AdmissionControl&) = delete;
+
+     /**
+      * @brief Takes a connection slot for a client, if within the caps
+      * @param client Client IP address
+      * @return true if admitted (release the slot later),
+      * @return false if over a cap
+      */
+     bool acquire(in_addr_t client);
+
+     /**
+      * @brief Gives back a connection slot taken by `acquire`
+      * @param client Client IP address
+      */
+     void release(in_addr_t client);
+
+     /**
+      * @brief Gets the number of slots taken
+      * @return size_t connections admitted
+      */
+     size_t get_active() const;
+
+   private:
+     size_t max_total;      /**< Cap of connections in total */
+     size_t max_per_client; /**< Cap of connections per client */
+
+     mutable std::mutex mtx; /**< Lock of the counters */
+     size_t active = 0;      /**< Slots taken in total */
+     std::unordered_map<in_addr_t, size_t>
+         per_client; /**< Slots taken by client (only non-zero) */
+};
+
+#endif
@@ -0,0 +1,78 @@
+/**
+ * @file batchcounter.hpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Batched I/O syscall counter
+ * @date 2023-11-18
+ */
+
+#pragma once
+#ifndef TFTP_BATCHCOUNTER_HPP
+#     define TFTP_BATCHCOUNTER_HPP
+#     include <cstdint>
+#     include <sstream>
+#     include <string>
+
+/**
+ * @brief Counter of batched I/O calls (`recvmmsg`, `sendmmsg`)
+ * @details Counts calls and the datagrams they moved, so that the
+ *          average batch size achieved can be reported.
+ */
+class BatchCounter {
+   public:
+     /**
+      * @brief Records one batched call
+      * @param n_msgs Number of datagrams the call moved
+      */
+     void add(uint64_t n_msgs) {
+          this->calls++;
+          this->msgs += n_msgs;
+     }
+
+     /**
+      * @brief Adds up another counter
+      * @param other Counter to add
+      */
+     void merge(const BatchCounter& other) {
+          this->calls += other.calls;
+          this->msgs += other.msgs;
+     }
+
+     /**
+      * @brief Returns the average batch size
+      * @return double datagrams per call (0 if no calls)
+      */
+     double average() const {
+          return this->calls ? static_cast<double>(this->msgs) / this->calls
+                             : 0.0;
+     }
+
+     /**
+      * @brief Formats the counter as "<msgs> in <calls> (avg. <avg>)"
+      * @return std::string
+      */
+     std::string to_string() const {
+          std::ostringstream stream;
+          stream.precision(2);
+          stream << std::fixed << this->msgs << " in " << this->calls
+                 << " batches (avg. " << this->average() << ")";
+          return stream.str();
+     }
+
+     /**
+      * @brief Gets the number of calls
+      * @return uint64_t calls
+      */
+     uint64_t get_calls() const { return this->calls; }
+
+     /**
+      * @brief Gets the number of datagrams
+      * @return uint64_t datagrams
+      */
+     uint64_t get_msgs() const { return this->msgs; }
+
+   private:
+     uint64_t calls = 0; /**< Number of calls */
+     uint64_t msgs = 0;  /**< Number of datagrams */
+};
+
+#endif
@@ -8,19 +8,61 @@
 #ifndef TFTP_CONNECTION_BASE_HPP
 #define TFTP_CONNECTION_BASE_HPP
 
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 
-#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <span>
 
 #include "common.hpp"
 #include "packet/PacketFactory.hpp"
+#include "packet/PacketView.hpp"
+#include "util/batchcounter.hpp"
 #include "util/logger.hpp"
+#include "util/metrics.hpp"
+#include "util/rttestimator.hpp"
+#include "util/task.hpp"
+#include "util/tokenbucket.hpp"
+#include "util/trace.hpp"
+#include "util/writebehind.hpp"
 
 /**
  * @brief Abstract base class for TFTP connection handling
  */
 class TFTPConnectionBase {
    public:
+     /**
+      * @brief Packet buffers of a connection, kept at capacity when
+      *        handed over to the next one (see `TFTPServerWorker`)
+      */
+     struct Buffers {
+          std::vector<char> rx; /**< Incoming packets (`rx_buffer`) */
+          std::vector<char> na; /**< Decoded NetASCII (`na_buffer`) */
+          std::vector<std::vector<char>>
+              window; /**< DATA packets (`window`) */
+
+          /**
+           * @brief Gets the memory held by the buffers
+           * @return size_t capacity in bytes
+           */
+          size_t capacity() const {
+               size_t bytes = this->rx.capacity() + this->na.capacity();
+               for (const auto& buf : this->window) bytes += buf.capacity();
+               return bytes;
+          }
+     };
+
+     /**
+      * @brief Multicast session of a download (RFC 2090 `multicast`)
+      */
+     struct Multicast {
+          sockaddr_in group{}; /**< Group address DATA are sent to */
+          bool master = false; /**< Flag if the client is to ACK */
+     };
+
      /* === Constructors === */
 
      /**
@@ -47,12 +89,115 @@ class TFTPConnectionBase {
       */
      void sock_init();
 
+     /**
+      * @brief Initialises the connection with an already bound socket
+      *        (see `SocketPool`) instead of `sock_init`
+      * @param fd Non-blocking socket, owned by the connection from now
+      *           on (until `take_socket`)
+      * @param port Port the socket is bound to (TID)
+      */
+     void sock_adopt(int fd, uint16_t port);
+
+     /**
+      * @brief Initialises the connection on a socket shared with other
+      *        connections (see `TFTPServerWorker`) instead of `sock_init`
+      * @details The connection sends from the socket, but never reads
+      *          it, nor closes it – the owner receives the packets and
+      *          hands those of this connection's remote host over with
+      *          `deliver`.
+      * @param fd Non-blocking socket (not owned)
+      * @param port Port the socket is bound to (TID)
+      */
+     void sock_share(int fd, uint16_t port);
+
+     /**
+      * @brief Hands a received packet over to a connection on a shared
+      *        socket, to be processed on the next `exec`
+      * @param data Packet (from the remote host; truncated to the
+      *             receive buffer, as `recvfrom` would)
+      */
+     void deliver(std::span<const char> data);
+
+     /**
+      * @brief Takes the socket back from a finished connection (it is
+      *        not closed then)
+      * @return int socket fd
+      */
+     int take_socket() {
+          int fd = this->conn_fd;
+          this->conn_fd = -1;
+          return fd;
+     }
+
+     /**
+      * @brief Hands buffers of a finished connection over (before
+      *        `sock_init` or `sock_adopt`)
+      * @param buffers Buffers
+      */
+     void set_buffers(Buffers&& buffers);
+
+     /**
+      * @brief Takes the buffers from a finished connection
+      * @return Buffers buffers
+      */
+     Buffers take_buffers();
+
      /**
       * @brief Starts the TFTP connection, creating a socket
-      *        for this connection and starting the main loop.
+      *        for this connection and driving `exec` until the
+      *        transfer ends (blocking).
       */
      void run();
 
+     /**
+      * @brief Parses a block number rollover mode (the value it
+      *        rolls over to)
+      * @param str "0" or "1"
+      * @return std::optional<TFTPBlockRollover> mode, nullopt if invalid
+      */
+     static std::optional<TFTPBlockRollover> parse_rollover(
+         const std::string& str) {
+          if (str == "0") return TFTPBlockRollover::Zero;
+          if (str == "1") return TFTPBlockRollover::One;
+          return std::nullopt;
+     }
+
+     /**
+      * @brief Parses a decimal option value (19 digits at most)
+      * @param str digits only
+      * @return std::optional<uint64_t> number, nullopt if invalid
+      */
+     static std::optional<uint64_t> parse_number(const std::string& str);
+
+     /**
+      * @brief Parses a byte range (`range` option)
+      * @param str "start-end" (half-open, in bytes), or "start-" for
+      *            a range to the end of the file
+      * @return std::optional<std::pair<uint64_t, std::optional<uint64_t>>>
+      *         start and end (nullopt = end of file), nullopt if invalid
+      */
+     static std::optional<std::pair<uint64_t, std::optional<uint64_t>>>
+     parse_range(const std::string& str);
+
+     /**
+      * @brief Parses a `multicast` option value of an OACK
+      * @param str "addr,port,mc" (group address, port, 1 for the master
+      *            client, 0 for the others)
+      * @return std::optional<Multicast> session, nullopt if invalid
+      */
+     static std::optional<Multicast> parse_multicast(const std::string& str);
+
+     /**
+      * @brief Parses a transfer mode
+      * @param str "octet" or "netascii"
+      * @return std::optional<TFTPDataFormat> mode, nullopt if invalid
+      */
+     static std::optional<TFTPDataFormat> parse_format(const std::string& str) {
+          if (str == "octet") return TFTPDataFormat::Octet;
+          if (str == "netascii") return TFTPDataFormat::NetASCII;
+          return std::nullopt;
+     }
+
      /* === Public getters, setters and checkers === */
 
      /**
@@ -65,34 +210,32 @@ class TFTPConnectionBase {
       * @brief Gets the block number as a hexadecimal string
       * @return std::string hex block_n
       */
-     std::string get_block_n_hex() const {
-          std::stringstream sstream;
-          sstream << std::hex << std::uppercase << this->block_n;
-          return sstream.str();
-     }
+     std::string get_block_n_hex() const { return to_hex(this->block_n); }
 
      /**
-      * @brief Makes remote address static (does not rewrite on first packet)
+      * @brief Sets the block number rollover mode
+      * @param rollover Rollover mode
+      * @note A negotiated `rollover` option takes precedence.
       */
-     void set_addr_static() { this->addr_static = true; }
+     void set_rollover(TFTPBlockRollover rollover) {
+          this->rollover = rollover;
+     }
 
      /**
-      * @brief Unsets remote address static flag (rewrites on first packet)
+      * @brief Sets the transfer mode (before the request is sent)
+      * @param format Transfer mode
       */
-     void unset_addr_static() { this->addr_static = false; }
+     void set_format(TFTPDataFormat format) { this->format = format; }
 
      /**
-      * @brief Enables `exit_on_await`, which makes `exec()` handling
-      *        loop break on `Awaiting` state. This is useful for
-      *        more custom handling, ex. `poll()`.
+      * @brief Makes remote address static (does not rewrite on first packet)
       */
-     void set_await_exit() { this->exit_on_await = true; }
+     void set_addr_static() { this->addr_static = true; }
 
      /**
-      * @brief Unsets `exit_on_await`, making `exec()` handling loop
-      *        blocking on `Awaiting` state as is default.
+      * @brief Unsets remote address static flag (rewrites on first packet)
       */
-     void unset_await_exit() { this->exit_on_await = false; }
+     void unset_addr_static() { this->addr_static = false; }
 
      /**
       * @brief Checks if the connection is running
@@ -154,14 +297,117 @@ class TFTPConnectionBase {
           return this->last_packet_time;
      }
 
+     /**
+      * @brief Gets the DATA transmit batch counter
+      * @return const BatchCounter&
+      */
+     const BatchCounter& get_tx_batches() const { return this->tx_batches; }
+
+     /**
+      * @brief Gets the connection statistics
+      * @return const ConnStats&
+      */
+     const ConnStats& get_stats() const { return this->stats; }
+
+     /**
+      * @brief Sets metrics to record RTT samples into (owner thread's)
+      * @param metrics Metrics, nullptr to disable
+      */
+     void set_metrics(ServerMetrics* metrics) { this->metrics = metrics; }
+
+     /**
+      * @brief Sets the thread downloaded data are written on
+      * @param writer Writer thread, nullptr to write synchronously
+      */
+     void set_writer(DiskWriter* writer) { this->writer = writer; }
+
+     /**
+      * @brief Drops received packets at random, as if lost on the way
+      *        (load testing, see `TFTPLoadGenerator`)
+      * @param rate Probability a packet is dropped (0 to disable)
+      */
+     void set_loss(double rate) { this->loss = rate; }
+
+     /**
+      * @brief Gets the retransmission timeout estimator
+      * @return const RttEstimator&
+      */
+     const RttEstimator& get_rtt() const { return this->rtt; }
+
+     /**
+      * @brief Gets the retransmission deadline
+      * @return std::optional<std::chrono::steady_clock::time_point>
+      *         deadline, nullopt if nothing awaits acknowledgement
+      */
+     std::optional<std::chrono::steady_clock::time_point> get_deadline()
+         const {
+          return this->deadline;
+     }
+
+     /* == Pacing == */
+
+     /**
+      * @brief Leaves sending DATA to the owner's scheduler (`flush`),
+      *        paced by the connection (see `pace_update`)
+      * @param scheduled Whether DATA are flushed by the owner
+      */
+     void set_scheduled(bool scheduled) { this->scheduled = scheduled; }
+
+     /**
+      * @brief Checks if the upload window has packets not sent yet
+      *        (waiting for `flush`)
+      * @return true if it has,
+      * @return false otherwise
+      */
+     bool has_unsent() const {
+          return this->is_awaiting() && this->win_sent < this->win_count;
+     }
+
+     /**
+      * @brief Gets the size of the next packet to send
+      * @return size_t bytes (0 if none waits)
+      */
+     size_t unsent_size() const {
+          if (!this->has_unsent()) return 0;
+          size_t i = (this->win_head + this->win_sent) % this->window.size();
+          return this->window[i].size() + this->win_data[i].size();
+     }
+
+     /**
+      * @brief Gets the time the pacer lets the next packet go (out of
+      *        debt, as of the last `flush`)
+      * @return std::chrono::steady_clock::time_point time (past if now)
+      */
+     std::chrono::steady_clock::time_point pace_ready() const {
+          return this->pacer.ready_at(0);
+     }
+
+     /**
+      * @brief Sends packets of the window not sent yet, as far as the
+      *        pacer and `allowance` let
+      * @param allowance Bytes that can be sent (whole packets)
+      * @return size_t bytes sent
+      */
+     size_t flush(size_t allowance);
+
    protected:
      /* === Core private methods === */
 
      /**
-      * @brief Handles the connection main loop
+      * @brief Continues the connection `flow` until it awaits a packet
+      *        (or the transfer ends), never blocking
+      * @note Call again when the socket is readable, a packet was
+      *       delivered or the `deadline` passed.
       */
      void exec();
 
+     /**
+      * @brief The connection main loop, as a coroutine suspended
+      *        whenever it awaits a packet
+      * @return Task the coroutine (started by `exec`)
+      */
+     Task flow();
+
      /**
       * @brief Handles an incoming or outgoing upload request
       * @note Made virtual due to stark differences between client-side
@@ -185,6 +431,14 @@ class TFTPConnectionBase {
      std::vector<std::pair<std::string, std::string>> proc_opts(
          const std::vector<std::pair<std::string, std::string>>& opts);
 
+     /**
+      * @brief Lowers `windowsize` to fit the window limits, also in the
+      *        accepted options (answered as such)
+      * @param acc_opts Accepted options (of `proc_opts`)
+      */
+     void fit_window(
+         std::vector<std::pair<std::string, std::string>>& acc_opts);
+
      /**
       * @brief Handles upload of a DATA packet
       */
@@ -194,19 +448,57 @@ class TFTPConnectionBase {
       * @brief Handles download of a DATA packet
       *        ands its ACKnowledgement
       */
-     void handle_download();
+     virtual void handle_download();
+
+     /**
+      * @brief Sends `window` packets not sent yet (`win_sent`) in
+      *        `sendmmsg` batches, runs of full blocks as GSO datagrams
+      * @param max_pkts Maximum number of packets to send
+      */
+     void send_window(size_t max_pkts = SIZE_MAX);
+
+     /**
+      * @brief Adapts the pacing rate to the SRTT and a loss (or a window
+      *        acknowledged without one)
+      * @param loss Whether the window was (partly) lost
+      */
+     void pace_update(bool loss);
+
+     /**
+      * @brief Turns UDP GRO on for the own socket of a windowed download
+      *        and grows its receive buffer to the window (once, before
+      *        the first DATA arrive)
+      */
+     void gro_init();
+
+     /**
+      * @brief Lets the own socket fragment DATA after the path MTU
+      *        dropped below the block size (`EMSGSIZE`)
+      * @return true if switched (resend),
+      * @return false if not possible (already fragmenting, shared socket)
+      */
+     bool pmtu_fallback();
 
      /**
       * @brief Handles waiting for an ACK packet
       *       (upload awaiting state)
       */
-     void handle_await_upload();
+     virtual void handle_await_upload();
+
+     /**
+      * @brief Handles an ACK of the upload window (see
+      *        `handle_await_upload`)
+      * @param ack ACK packet view
+      * @return true if the window slid (continue uploading),
+      * @return false if the ACK was ignored or ended the connection
+      */
+     virtual bool handle_ack(const AckView& ack);
 
      /**
       * @brief Handles waiting for an DATA packet
       *       (download awaiting state)
       */
-     void handle_await_download();
+     virtual void handle_await_download();
 
      /* === Utility methods === */
 
@@ -218,6 +510,14 @@ class TFTPConnectionBase {
       */
      void send_error(TFTPErrorCode code, const std::string& msg);
 
+     /**
+      * @brief Receives a datagram or a GRO batch of them (`recvmsg`)
+      *        into `rx_buffer`, the first one as the incoming packet
+      * @param origin_addr Origin address of the datagram(s)
+      * @return ssize_t length of the first datagram, -1 on error
+      */
+     ssize_t recv_gro(struct sockaddr_in& origin_addr);
+
      /**
       * @brief Receives a packet from the remote host with
       *        packet parsing. On error, method calls
@@ -225,11 +525,25 @@ class TFTPConnectionBase {
       *        stored `rem_addr`, it is ignored.
       * @param addr_overwrite Overwrite stored remote addr?
       *                       Use when remote TID is not decided.
-      * @return unique_ptr<BasePacket>> Received packet,
-      * @return nullptr if no packet (or invalid) received
+      * @return PacketView Received packet (view of `rx_buffer`),
+      * @return nullopt if no packet (or invalid) received
+      */
+     std::optional<PacketView> recv_packet(bool addr_overwrite = false);
+
+     /**
+      * @brief Handles an ERROR packet received from the remote host
+      * @param err ERROR packet view
+      */
+     virtual void handle_error(const ErrorView& err);
+
+     /**
+      * @brief Handles a packet from another host than the remote one
+      *        (answered with an unknown TID ERROR by default)
+      * @param origin Origin address of the packet
+      * @param packet Packet view
       */
-     std::optional<std::unique_ptr<BasePacket>> recv_packet(bool addr_overwrite
-                                                            = false);
+     virtual void handle_stray(const sockaddr_in& origin,
+                               const PacketView& packet);
 
      /**
       * @brief Change `state` to a new state, pushing the old
@@ -238,17 +552,19 @@ class TFTPConnectionBase {
       * @return TFTPConnectionState – Previous state
       */
      TFTPConnectionState set_state(TFTPConnectionState new_state) {
+          if (Trace::enabled()) this->trace_state();
+
           /* Transition to new state */
           this->pstate = this->state;
           this->state = new_state;
-
-          /* Toggle `exec_unblock` if applicable */
-          if (this->exit_on_await && new_state == TFTPConnectionState::Awaiting)
-               this->exec_unblock = true;
-
           return this->pstate;
      }
 
+     /**
+      * @brief Records the span of the state being left (tracing)
+      */
+     void trace_state();
+
      /**
       * @brief Change both `state` and `pstate` to a new state
       *        (used for initial state setting)
@@ -257,33 +573,138 @@ class TFTPConnectionBase {
      void set_init_state(TFTPConnectionState new_state) {
           this->state = new_state;
           this->pstate = new_state;
+     }
+
+     /**
+      * @brief Stores current time in `last_packet_time` and arms
+      *        the retransmission `deadline` (after the current RTO)
+      * @param rtt_sample Whether the response to this packet can be
+      *                   used as an RTT sample (unless retransmitted)
+      */
+     void update_sent_time(bool rtt_sample = true) {
+          this->last_packet_time = std::chrono::steady_clock::now();
+          this->deadline = this->last_packet_time + this->rtt.get_rto();
+          this->rtt_pending = rtt_sample && !this->retransmit;
+          this->retransmit = false;
+     }
 
-          /* Toggle `exec_unblock` if applicable */
-          if (this->exit_on_await && new_state == TFTPConnectionState::Awaiting)
-               this->exec_unblock = true;
+     /**
+      * @brief Cancels the retransmission `deadline` (packet acknowledged)
+      *        and samples the RTT of the acknowledged packet, if it was
+      *        not retransmitted (Karn's rule)
+      */
+     void disarm_timeout() {
+          if (this->rtt_pending) {
+               auto sample = std::chrono::duration_cast<RttEstimator::Duration>(
+                   std::chrono::steady_clock::now() - this->last_packet_time);
+               this->rtt.sample(sample);
+               if (this->metrics) this->metrics->rtt_us.observe(sample.count());
+          }
+          this->rtt_pending = false;
+          this->deadline.reset();
+     }
 
-          return;
+     /**
+      * @brief Backs the RTO off after a timeout and marks the next
+      *        sent packet as a retransmission
+      */
+     void on_timeout() {
+          this->stats.timeouts++;
+          this->rtt.backoff();
+          this->retransmit = true;
      }
 
      /**
-      * @brief Stores current time in `last_packet_time`
+      * @brief Preallocates `size` bytes of the downloaded file
+      *        (file size stays unchanged)
+      * @param size Expected file size (ex. `tsize`)
+      * @return true on success (or if not supported or skipped),
+      * @return false if there is not enough space
       */
-     void update_sent_time() {
-          this->last_packet_time = std::chrono::steady_clock::now();
+     bool prealloc(uint64_t size);
+
+     /**
+      * @brief Blocks until the connection socket (or the multicast
+      *        group socket) is readable or the retransmission
+      *        `deadline` passes
+      */
+     void await_readable() const;
+
+     /**
+      * @brief Gets the `i`-th packet of the upload window
+      * @param i Index from the oldest unacknowledged packet
+      * @return std::vector<char>& packet buffer
+      */
+     std::vector<char>& win_slot(size_t i) {
+          return this->window[(this->win_head + i) % this->window.size()];
+     }
+
+     /**
+      * @brief Gets the data slice of the `i`-th packet of the upload
+      *        window (sent after the packet buffer, see `next_slice`)
+      * @param i Index from the oldest unacknowledged packet
+      * @return std::span<const char>& slice (empty for copied data)
+      */
+     std::span<const char>& win_slice(size_t i) {
+          return this->win_data[(this->win_head + i) % this->win_data.size()];
+     }
+
+     /**
+      * @brief Adds a packet slot to the (full) upload window ring,
+      *        unwrapping it first
+      */
+     void win_grow();
+
+     /**
+      * @brief Converts a block (transfer) number to its 16-bit
+      *        on-the-wire number according to `rollover`
+      * @param n Block number
+      * @return uint16_t wire block number
+      */
+     uint16_t wire_block(uint64_t n) const;
+
+     /**
+      * @brief Gets the distance of a received wire block number
+      *        from a reference block (transfer) number
+      * @param wire Received wire block number
+      * @param ref Reference block number
+      * @return int64_t signed distance (negative for older blocks)
+      */
+     int64_t block_delta(uint16_t wire, uint64_t ref) const;
+
+     /**
+      * @brief Formats a (block) number as a hexadecimal string
+      * @param num Number to format
+      * @return std::string hex number
+      */
+     static std::string to_hex(uint64_t num) {
+          std::stringstream sstream;
+          sstream << std::hex << std::uppercase << num;
+          return sstream.str();
      }
 
      /**
       * @brief Logs a connection INFO message to the standard output
       */
      void log_info(const std::string& msg) const {
-          Logger::conn_info(std::to_string(this->tid), msg);
+          Logger::conn_info(this->tid, msg);
+     };
+
+     /**
+      * @brief Logs a connection block-level (DATA/ACK) INFO message
+      *        to the standard output
+      * @note Callers should check `Logger::enabled(LogLevel::Block)`
+      *       before building the message.
+      */
+     void log_block(const std::string& msg) const {
+          Logger::conn_block(this->tid, msg);
      };
 
      /**
       * @brief Logs a connection ERROR message to the standard output
       */
      void log_error(const std::string& msg) const {
-          Logger::conn_err(std::to_string(this->tid), msg);
+          Logger::conn_err(this->tid, msg);
      };
 
      /* == Internal getters, setters and checkers == */
@@ -302,17 +723,13 @@ class TFTPConnectionBase {
      }
 
      /**
-      * @brief Checks if the connection timeout has been reached
+      * @brief Checks if the retransmission deadline has passed
       * @return true if did timeout,
       * @return false otherwise
       */
-     bool is_timedout() {
-          /** @see https://en.cppreference.com/w/cpp/chrono#Example */
-          auto now = std::chrono::steady_clock::now();
-          auto diff = std::chrono::duration_cast<std::chrono::seconds>(
-                          now - this->last_packet_time)
-                          .count();
-          return diff > TFTP_PACKET_TIMEO;
+     bool is_timedout() const {
+          return this->deadline.has_value()
+                 && std::chrono::steady_clock::now() >= *this->deadline;
      }
 
      /**
@@ -333,40 +750,99 @@ class TFTPConnectionBase {
      virtual bool should_shutd() = 0;
 
      /**
-      * @brief Obtains the next DataPacket payload to be sent
-      * @return std::vector<char> Serialised DataPacket payload
+      * @brief Writes the next block of data to be sent
+      * @param payload Buffer for the data (`blksize` bytes, right after
+      *                the DATA header)
+      * @return size_t number of bytes written, less than `blksize`
+      *         only for the last block
+      */
+     virtual size_t next_data(std::span<char> payload) = 0;
+
+     /**
+      * @brief Gets the next block of data to be sent without copying it
+      * @details Optional fast path of `next_data` for sources already in
+      *          memory. The data must stay valid and unchanged until
+      *          `release_data` covers them (they are retransmitted from
+      *          there).
+      * @param max Maximum block size (`blksize`)
+      * @return std::optional<std::span<const char>> the block (shorter
+      *         than `max` only for the last one), std::nullopt to use
+      *         `next_data` instead
       */
-     virtual std::vector<char> next_data() = 0;
+     virtual std::optional<std::span<const char>> next_slice(size_t max) {
+          (void)max;
+          return std::nullopt;
+     }
+
+     /**
+      * @brief Notifies that the oldest sent data were acknowledged
+      * @details Called in order, as the window slides, for the data of
+      *          both `next_data` and `next_slice`.
+      * @param len Number of bytes acknowledged
+      */
+     virtual void release_data(size_t len) { (void)len; }
 
      /**
       * @brief Handles OACK packet (for client use only)
       */
-     virtual void handle_oack(const OptionAckPacket& oack) { (void)oack; };
+     virtual void handle_oack(const OackView& oack) { (void)oack; };
+
+     /**
+      * @brief Gets the address DATA are sent to
+      * @return const sockaddr_in& the remote host (or a multicast group)
+      */
+     virtual const sockaddr_in& data_addr() const { return this->rem_addr; }
 
      /* === Variables === */
 
      /* == File descriptors ==*/
-     int tid = -1;     /**< Transfer ID (local) */
-     int conn_fd = -1; /**< Connection socket file descriptor */
-     int file_fd = -1; /**< File socket file descriptor */
+     int tid = -1;      /**< Transfer ID (local) */
+     int conn_fd = -1;  /**< Connection socket file descriptor */
+     int file_fd = -1;  /**< File socket file descriptor */
+     int group_fd = -1; /**< Multicast group socket (client) */
 
      /* == Counters == */
-     int block_n = 0;    /**< Number of the currently transferred block */
-     int send_tries = 0; /**< Number of packet retransmission attempts */
+     uint64_t block_n = 0;   /**< Number of the currently transferred block */
+     uint64_t block_ack = 0; /**< Number of the last acknowledged block */
+     int send_tries = 0;  /**< Number of packet retransmission attempts */
+     int win_recv = 0;    /**< DATA blocks received since last sent ACK */
+     size_t win_sent = 0; /**< Number of `window` packets already sent */
+     size_t win_head = 0; /**< Ring index of the oldest `window` packet */
+     size_t win_count = 0; /**< Number of packets in `window` */
 
      /* == Options == */
-     uint16_t blksize = TFTP_DFLT_BLKSIZE; /**< Block size */
+     uint16_t blksize = TFTP_DFLT_BLKSIZE;       /**< Block size */
+     uint16_t windowsize = TFTP_DFLT_WINDOWSIZE; /**< Window size */
+     TFTPBlockRollover rollover
+         = TFTPBlockRollover::None; /**< Block number rollover mode */
+     std::optional<uint64_t> tsize; /**< Transfer size (RFC 2349) */
+     bool ranged = false;           /**< Flag if `range` was negotiated */
+     uint64_t range_start = 0;      /**< First byte of the range */
+     std::optional<uint64_t>
+         range_end; /**< End of the range (exclusive), nullopt = EOF */
+     bool mcast_req = false;         /**< Flag if `multicast` was asked */
+     std::optional<Multicast> mcast; /**< Multicast session (client) */
 
      /* == Flags == */
      bool is_last = false;      /**< Flag for last packet */
-     bool cr_end = false;       /**< Flad if last DATA ended with CR */
      bool file_created = false; /**< Flag if the file `filename` was created */
-     bool exec_unblock = false; /**< Flag to return from `exec()` */
      bool oack_expect = false;  /**< Flag to allow OACK packet recv */
      bool oack_init = false;    /**< Flag if OACK replaces first response */
+     bool win_gap = false;      /**< Flag if window gap was already ACK'd */
+     bool rtt_pending = false;  /**< Flag if awaited response is RTT sample */
+     bool retransmit = false;   /**< Flag if next sent packet is a resend */
+     bool win_ready = false;    /**< Flag if `window` is set up */
+     bool sock_shared = false;  /**< Flag if `conn_fd` is not owned */
+     bool pmtu_frag = false;    /**< Flag if fragmenting after a PMTU drop */
+     bool rx_pending = false;   /**< Flag if `rx_buffer` holds a delivered
+                                     packet (shared socket) or more of
+                                     a GRO batch */
+     bool gso = TFTP_GSO_SEGMENTS > 1; /**< Flag if sending GSO datagrams */
+     bool gro = false;          /**< Flag if receiving GRO batches */
+     bool scheduled = false;    /**< Flag if DATA are sent by `flush` */
+     bool preallocated = false; /**< Flag if blocks past EOF are reserved */
 
      /* == Toggles == */
-     bool exit_on_await = false; /**< Makes `exec()` exit on `Awaiting` */
      bool addr_static = false;   /**< Stops rem_addr override on first packet */
 
      /* == State-tracking enums == */
@@ -388,11 +864,37 @@ class TFTPConnectionBase {
      /* == Buffers == */
      std::vector<char> rx_buffer; /**< Buffer for incoming packets */
      ssize_t rx_len = 0;          /**< Length of the incoming packet */
+     size_t rx_off = 0; /**< Offset of the incoming packet (GRO batch) */
+     size_t rx_seg = 0; /**< Datagram size of the GRO batch */
+     size_t rx_end = 0; /**< Length of the GRO batch */
+     std::vector<char> na_buffer; /**< Buffer for decoded NetASCII DATA */
+     NetASCII::State na_state;    /**< NetASCII state between DATA blocks */
+     std::unique_ptr<WriteBehind>
+         write_behind; /**< Write-behind buffer of the downloaded file */
+     std::vector<std::vector<char>>
+         window; /**< Ring of DATA packet buffers (sent, but not yet
+                    acknowledged), allocated once per transfer */
+     std::vector<std::span<const char>>
+         win_data; /**< Data slices of the `window` packets (see
+                      `next_slice`) */
+     BatchCounter tx_batches; /**< DATA `sendmmsg` batches */
+     Task task;               /**< Coroutine of `flow` (owned frame) */
 
      /* == Other == */
      std::string file_name; /**< Name of downloaded/uploaded file */
      std::chrono::steady_clock::time_point
          last_packet_time; /**< Time of last packet */
+     std::optional<std::chrono::steady_clock::time_point>
+         deadline;     /**< Retransmission deadline */
+     RttEstimator rtt; /**< Retransmission timeout estimator */
+     TokenBucket pacer; /**< Pacer of DATA (if `scheduled`) */
+     double pace_gain = TFTP_PACE_GAIN_MAX; /**< Window per SRTT sent */
+     Trace::Clock::time_point
+         state_since; /**< Time `state` was entered (while tracing) */
+     ConnStats stats;  /**< Connection statistics */
+     ServerMetrics* metrics = nullptr; /**< Metrics for RTT samples */
+     DiskWriter* writer = nullptr;     /**< Thread of download writes */
+     double loss = 0; /**< Probability of dropping a received packet */
      std::vector<std::pair<std::string, std::string>>
          opts; /**< Vector of options */
 };
@@ -0,0 +1,59 @@
+/**
+ * @file diskwriter.hpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Background thread for file writes
+ * @date 2023-11-20
+ */
+
+#pragma once
+#ifndef TFTP_DISKWRITER_HPP
+#     define TFTP_DISKWRITER_HPP
+#     include <condition_variable>
+#     include <deque>
+#     include <functional>
+#     include <mutex>
+#     include <thread>
+
+/**
+ * @brief Background thread running file writes off the event thread
+ * @details Tasks (see `WriteBehind`) are run one at a time, in the order
+ *          they were submitted, so writes of one file never reorder.
+ *          One writer is shared by all connections of a worker.
+ */
+class DiskWriter {
+   public:
+     /**
+      * @brief Starts the writer thread
+      */
+     DiskWriter();
+
+     /**
+      * @brief Runs the remaining tasks and joins the writer thread
+      */
+     ~DiskWriter();
+
+     DiskWriter& operator=(DiskWriter&& other) = delete;
+     DiskWriter& operator=(const DiskWriter&) = delete;
+     DiskWriter(DiskWriter&& other) = delete;
+     DiskWriter(const DiskWriter&) = delete;
+
+     /**
+      * @brief Queues a task to run on the writer thread
+      * @param task Task
+      */
+     void submit(std::function<void()> task);
+
+   private:
+     /**
+      * @brief Writer thread loop
+      */
+     void run();
+
+     std::mutex mtx;                        /**< Lock of the queue */
+     std::condition_variable cv;            /**< Signals queued tasks */
+     std::deque<std::function<void()>> queue; /**< Queued tasks */
+     bool stop = false;                     /**< Flag to end the thread */
+     std::thread thread;                    /**< Writer thread */
+};
+
+#endif
@@ -0,0 +1,129 @@
+/**
+ * @file drrqueue.hpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Deficit round-robin queue of backlogged transfers
+ * @date 2023-11-25
+ */
+
+#pragma once
+#ifndef TFTP_DRRQUEUE_HPP
+#     define TFTP_DRRQUEUE_HPP
+#     include <cstddef>
+#     include <cstdint>
+#     include <deque>
+#     include <functional>
+#     include <unordered_map>
+
+#     include "common.hpp"
+
+/**
+ * @brief Deficit round-robin (DRR) queue
+ * @details Keeps the flows (keyed by the owner, ex. connections) with
+ *          data waiting to be sent, in round-robin order. A flow's turn
+ *          tops its deficit up by `quantum` bytes and lets it send up
+ *          to that, so flows get equal shares of bytes whatever their
+ *          packet sizes. A turn cut short by the budget of `serve`
+ *          goes on in the next call.
+ * @details Flows that just got data (ex. a window after its ACK) take
+ *          their first turn before the others (as in FQ-CoDel), so
+ *          sparse flows – lock-step transfers, small windows – are not
+ *          held up behind bulk ones.
+ *          A flow held back by its own pacer gives its deficit up, as
+ *          an empty one would, so it does not save up for a burst.
+ * @details Removing a flow is O(1): its entry in the order turns stale
+ *          (generation mismatch) and is skipped.
+ * @see https://doi.org/10.1109/90.502236
+ * @see https://datatracker.ietf.org/doc/html/rfc8290#section-4.2
+ */
+class DrrQueue {
+   public:
+     /**
+      * @brief Result of a flow's turn
+      */
+     struct Served {
+          size_t bytes;       /**< Bytes sent */
+          bool more;          /**< Whether data are still waiting */
+          bool paced = false; /**< Whether held back by its pacer */
+     };
+
+     /**
+      * @brief Sends data of a flow: key, data pointer given on `push`
+      *        and allowance (bytes), returns what was sent
+      */
+     using Sender = std::function<Served(int key, void* data, size_t allow)>;
+
+     /**
+      * @brief Constructs a new DRR queue
+      * @param quantum Bytes added to the deficit of a flow per turn
+      */
+     explicit DrrQueue(size_t quantum = TFTP_DRR_QUANTUM)
+         : quantum(quantum) {}
+
+     /* === Core methods === */
+
+     /**
+      * @brief Queues a flow with data waiting (no-op if queued)
+      * @param key Flow key
+      * @param data Data pointer passed to the sender
+      */
+     void push(int key, void* data);
+
+     /**
+      * @brief Removes a flow (no-op if not queued)
+      * @param key Flow key
+      */
+     void remove(int key);
+
+     /**
+      * @brief Gives turns to the queued flows, each at most one, until
+      *        the budget is spent
+      * @param budget Bytes all flows may send in total
+      * @param send Sender of the flows
+      * @return size_t bytes sent
+      */
+     size_t serve(size_t budget, const Sender& send);
+
+     /* === Getters === */
+
+     /**
+      * @brief Checks if any flow is queued
+      * @return true if none is,
+      * @return false otherwise
+      */
+     bool empty() const { return this->flows.empty(); }
+
+     /**
+      * @brief Gets the number of queued flows
+      * @return size_t count
+      */
+     size_t size() const { return this->flows.size(); }
+
+   private:
+     /**
+      * @brief Queued flow
+      */
+     struct Flow {
+          void* data;         /**< Data pointer */
+          size_t deficit = 0; /**< Bytes the flow may send */
+          uint64_t gen = 0;   /**< Generation of its order entry */
+          uint64_t round = 0; /**< Last `serve` call it had a turn in */
+          bool turn = false;  /**< Flag if its turn is going on */
+     };
+
+     /**
+      * @brief Entry of the round-robin order
+      */
+     struct Entry {
+          int key;      /**< Flow key */
+          uint64_t gen; /**< Flow generation when queued */
+     };
+
+     size_t quantum;                      /**< Bytes per flow and turn */
+     std::unordered_map<int, Flow> flows; /**< Queued flows by key */
+     std::deque<Entry> fresh;             /**< Flows before their 1st turn */
+     std::deque<Entry> order;             /**< Round-robin order of others */
+     uint64_t gen = 0;                    /**< Last flow generation */
+     uint64_t round = 0;                  /**< Number of `serve` calls */
+};
+
+#endif
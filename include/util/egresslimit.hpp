@@ -0,0 +1,66 @@
+/**
+ * @file egresslimit.hpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Egress rate limit shared by the server workers
+ * @date 2023-11-25
+ */
+
+#pragma once
+#ifndef TFTP_EGRESSLIMIT_HPP
+#     define TFTP_EGRESSLIMIT_HPP
+#     include <cstddef>
+#     include <mutex>
+
+#     include "util/tokenbucket.hpp"
+
+/**
+ * @brief Egress rate limit of the server
+ * @details Token bucket of all the DATA sent by the workers, each of
+ *          which takes a budget from it per scheduling round (see
+ *          `TFTPServerWorker::sched_flush`). Unlike connection pacers,
+ *          rounds never overdraw it: the budget only covers whole
+ *          packets, so the bucket holds any packet (at least
+ *          `TFTP_MAX_BLKSIZE` + 4 bytes).
+ * @note Thread-safe (one mutex, held only for the bucket updates).
+ */
+class EgressLimit {
+   public:
+     using TimePoint = TokenBucket::TimePoint; /**< Refill time */
+
+     /**
+      * @brief Constructs a new egress limit
+      * @param rate Rate limit (bytes per second, 0 for unlimited)
+      */
+     explicit EgressLimit(double rate);
+
+     EgressLimit& operator=(EgressLimit&& other) = delete;
+     EgressLimit& operator=(const EgressLimit&) = delete;
+     EgressLimit(EgressLimit&& other) = delete;
+     EgressLimit(const EgressLimit&) = delete;
+
+     /**
+      * @brief Gets the bytes that can be sent now
+      * @param now Current time
+      * @return size_t budget (`SIZE_MAX` if unlimited)
+      */
+     size_t budget(TimePoint now);
+
+     /**
+      * @brief Takes sent bytes from the budget
+      * @param bytes Bytes sent (at most the last `budget`)
+      */
+     void consume(size_t bytes);
+
+     /**
+      * @brief Gets the time the budget covers `bytes`
+      * @param bytes Bytes wanted
+      * @return TimePoint time (as of the last `budget`)
+      */
+     TimePoint ready_at(size_t bytes) const;
+
+   private:
+     mutable std::mutex mtx; /**< Lock of the bucket */
+     TokenBucket bucket;     /**< Bucket of the egress */
+};
+
+#endif
@@ -0,0 +1,213 @@
+/**
+ * @file eventloop.hpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Pluggable I/O event loop (poll, epoll, io_uring)
+ * @date 2023-11-18
+ */
+
+#pragma once
+#ifndef TFTP_EVENTLOOP_HPP
+#     define TFTP_EVENTLOOP_HPP
+#     include <poll.h>
+#     include <sys/epoll.h>
+
+#     include <memory>
+
+#     include "common.hpp"
+#     include "util/timerqueue.hpp"
+
+/**
+ * @brief Enumeration of event loop backends
+ */
+enum class EventLoopBackend {
+     Poll,    /**< `poll()` over a vector of `pollfd`s */
+     Epoll,   /**< `epoll` (Linux) */
+     IoUring, /**< `io_uring` poll requests (Linux, build with IO_URING=1) */
+};
+
+/**
+ * @brief Abstract I/O event loop
+ * @details Watches registered file descriptors for readability. Every
+ *          descriptor carries an opaque `data` pointer that is handed
+ *          back with its events, so that the owner does not have to
+ *          look the descriptor up. Registration, removal and event
+ *          dispatch are all O(1) per descriptor.
+ * @details Every descriptor can also have one deadline timer armed
+ *          (see `TimerQueue`). `wait()` never sleeps past the nearest
+ *          deadline and reports expired timers as events too.
+ */
+class EventLoop {
+   public:
+     /**
+      * @brief A readiness event
+      */
+     struct Event {
+          int fd;               /**< Ready file descriptor */
+          void* data;           /**< Data pointer given on `add` */
+          bool expired = false; /**< Flag if this is a timer expiry */
+     };
+
+     virtual ~EventLoop() = default;
+
+     /* === Core methods === */
+
+     /**
+      * @brief Starts watching a file descriptor for incoming data
+      * @param fd File descriptor
+      * @param data Data pointer to return with events of `fd`
+      * @throws std::runtime_error on registration error
+      */
+     void add(int fd, void* data) { this->add_io(fd, data); }
+
+     /**
+      * @brief Stops watching a file descriptor and cancels its timer
+      * @details Events of `fd` from the last `wait()` that were not
+      *          handled yet get their `data` cleared.
+      * @note Must be called before the descriptor is closed.
+      * @param fd File descriptor
+      */
+     void remove(int fd);
+
+     /**
+      * @brief Waits for events, at most until the nearest timer deadline
+      * @param timeout_ms Timeout in milliseconds (-1 for infinite)
+      * @throws std::runtime_error on wait error
+      * @return int number of events (0 on timeout or interrupt),
+      *         available through `get_events()`
+      */
+     int wait(int timeout_ms);
+
+     /* === Timers === */
+
+     /**
+      * @brief Arms (or re-arms) the deadline timer of a file descriptor
+      * @param fd File descriptor
+      * @param data Data pointer to return with the expiry event
+      * @param deadline Expiry time
+      */
+     void arm_timer(int fd, void* data, TimerQueue::TimePoint deadline) {
+          this->timers.arm(fd, data, deadline);
+     }
+
+     /**
+      * @brief Cancels the deadline timer of a file descriptor
+      * @param fd File descriptor
+      */
+     void cancel_timer(int fd) { this->timers.cancel(fd); }
+
+     /**
+      * @brief Returns events of the last `wait()`
+      * @return const std::vector<Event>& events
+      */
+     const std::vector<Event>& get_events() const { return this->events; }
+
+     /* === Factory === */
+
+     /**
+      * @brief Creates an event loop of the given backend
+      * @param backend Event loop backend
+      * @throws std::runtime_error when backend is not available
+      * @return std::unique_ptr<EventLoop>
+      */
+     static std::unique_ptr<EventLoop> create(EventLoopBackend backend);
+
+     /**
+      * @brief Returns the default backend (io_uring when built
+      *        with it, epoll otherwise)
+      * @return EventLoopBackend
+      */
+     static EventLoopBackend default_backend() {
+#     ifdef TFTP_IO_URING
+          return EventLoopBackend::IoUring;
+#     else
+          return EventLoopBackend::Epoll;
+#     endif
+     }
+
+     /**
+      * @brief Parses a backend name ("poll", "epoll", "uring")
+      * @param name Backend name
+      * @return std::optional<EventLoopBackend> backend if valid
+      */
+     static std::optional<EventLoopBackend> parse_backend(
+         const std::string& name) {
+          if (name == "poll") return EventLoopBackend::Poll;
+          if (name == "epoll") return EventLoopBackend::Epoll;
+          if (name == "uring") return EventLoopBackend::IoUring;
+          return std::nullopt;
+     }
+
+   protected:
+     /* === Backend methods === */
+
+     /**
+      * @brief Registers a file descriptor with the backend
+      * @param fd File descriptor
+      * @param data Data pointer to return with events of `fd`
+      * @throws std::runtime_error on registration error
+      */
+     virtual void add_io(int fd, void* data) = 0;
+
+     /**
+      * @brief Unregisters a file descriptor from the backend
+      * @param fd File descriptor
+      */
+     virtual void remove_io(int fd) = 0;
+
+     /**
+      * @brief Waits for I/O readiness, appending to `events`
+      * @param timeout_ms Timeout in milliseconds (-1 for infinite)
+      * @throws std::runtime_error on wait error
+      */
+     virtual void wait_io(int timeout_ms) = 0;
+
+     std::vector<Event> events; /**< Events of the last `wait()` */
+
+   private:
+     TimerQueue timers;                         /**< Deadline timers */
+     std::vector<TimerQueue::Expired> expired; /**< Expiry buffer */
+};
+
+/**
+ * @brief `poll()` event loop
+ * @details Keeps a dense `pollfd` vector and an fd-indexed table of
+ *          positions in it, so that removal is a swap with the last
+ *          element instead of a linear search and erase.
+ */
+class PollEventLoop : public EventLoop {
+   protected:
+     void add_io(int fd, void* data) override;
+     void remove_io(int fd) override;
+     void wait_io(int timeout_ms) override;
+
+   private:
+     std::vector<struct pollfd> fds; /**< Polled descriptors */
+     std::vector<void*> fds_data;    /**< Data pointers (same order) */
+     std::vector<ssize_t> fd_pos;    /**< fd => position in `fds` */
+};
+
+/**
+ * @brief `epoll` event loop
+ */
+class EpollEventLoop : public EventLoop {
+   public:
+     EpollEventLoop();
+     ~EpollEventLoop() override;
+
+     EpollEventLoop& operator=(EpollEventLoop&& other) = delete;
+     EpollEventLoop& operator=(const EpollEventLoop&) = delete;
+     EpollEventLoop(EpollEventLoop&& other) = delete;
+     EpollEventLoop(const EpollEventLoop&) = delete;
+
+   protected:
+     void add_io(int fd, void* data) override;
+     void remove_io(int fd) override;
+     void wait_io(int timeout_ms) override;
+
+   private:
+     int epfd = -1;                         /**< epoll instance */
+     std::vector<struct epoll_event> ready; /**< `epoll_wait` buffer */
+     std::vector<void*> fd_data;            /**< fd => data pointer */
+};
+
+#endif
@@ -0,0 +1,89 @@
+/**
+ * @file eventloop_uring.hpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief io_uring event loop backend (built with IO_URING=1)
+ * @date 2023-11-18
+ */
+
+#pragma once
+#ifndef TFTP_EVENTLOOP_URING_HPP
+#     define TFTP_EVENTLOOP_URING_HPP
+#     include <linux/io_uring.h>
+
+#     include "util/eventloop.hpp"
+
+/**
+ * @brief io_uring event loop
+ * @details Uses one-shot `IORING_OP_POLL_ADD` requests that are
+ *          re-armed after every completion. All re-arms, additions
+ *          and removals queued between two `wait()`s are submitted
+ *          together in a single `io_uring_enter` call. Implemented
+ *          directly on top of the kernel ABI (no liburing needed).
+ * @note Requires kernel 5.11+ (`IORING_FEAT_EXT_ARG`).
+ */
+class UringEventLoop : public EventLoop {
+   public:
+     UringEventLoop();
+     ~UringEventLoop() override;
+
+     UringEventLoop& operator=(UringEventLoop&& other) = delete;
+     UringEventLoop& operator=(const UringEventLoop&) = delete;
+     UringEventLoop(UringEventLoop&& other) = delete;
+     UringEventLoop(const UringEventLoop&) = delete;
+
+   protected:
+     void add_io(int fd, void* data) override;
+     void remove_io(int fd) override;
+     void wait_io(int timeout_ms) override;
+
+   private:
+     /**
+      * @brief Registered descriptor
+      */
+     struct Registration {
+          void* data = nullptr; /**< Data pointer */
+          uint32_t gen = 0;     /**< Generation (to drop stale CQEs) */
+          bool active = false;  /**< Flag if registered */
+     };
+
+     /**
+      * @brief Obtains a free SQE (submitting the queue if full)
+      * @return io_uring_sqe* zeroed SQE
+      */
+     struct io_uring_sqe* get_sqe();
+
+     /**
+      * @brief Queues (re-)arming of a poll request for `fd`
+      */
+     void arm(int fd);
+
+     /**
+      * @brief Encodes fd and its generation into SQE user data
+      */
+     uint64_t user_data(int fd) const {
+          return (static_cast<uint64_t>(this->regs[fd].gen) << 32)
+                 | static_cast<uint32_t>(fd);
+     }
+
+     int ring_fd = -1;               /**< io_uring instance */
+     unsigned entries = 0;           /**< Number of SQ entries */
+     std::vector<Registration> regs; /**< fd => registration */
+
+     /* == Mapped rings == */
+     void* sq_ring = nullptr;             /**< Mapped SQ ring */
+     void* cq_ring = nullptr;             /**< Mapped CQ ring */
+     size_t sq_ring_sz = 0;               /**< SQ ring mapping size */
+     size_t cq_ring_sz = 0;               /**< CQ ring mapping size */
+     struct io_uring_sqe* sqes = nullptr; /**< Mapped SQE array */
+     size_t sqes_sz = 0;                  /**< SQE array mapping size */
+     unsigned* sq_head = nullptr;         /**< SQ head (kernel) */
+     unsigned* sq_tail = nullptr;         /**< SQ tail (us) */
+     unsigned* sq_mask = nullptr;         /**< SQ index mask */
+     unsigned* sq_array = nullptr;        /**< SQ index array */
+     unsigned* cq_head = nullptr;         /**< CQ head (us) */
+     unsigned* cq_tail = nullptr;         /**< CQ tail (kernel) */
+     unsigned* cq_mask = nullptr;         /**< CQ index mask */
+     struct io_uring_cqe* cqes = nullptr; /**< CQE array */
+};
+
+#endif
@@ -0,0 +1,147 @@
+/**
+ * @file filecache.hpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Shared read-only cache of file images
+ * @date 2023-11-19
+ */
+
+#pragma once
+#ifndef TFTP_FILECACHE_HPP
+#     define TFTP_FILECACHE_HPP
+#     include <sys/stat.h>
+
+#     include <cstdint>
+#     include <list>
+#     include <memory>
+#     include <mutex>
+#     include <string>
+#     include <unordered_map>
+#     include <vector>
+
+#     include "common.hpp"
+
+/**
+ * @brief Shared read-only cache of file images for RRQs
+ * @details Images are whole file contents (octet), or the whole file
+ *          already encoded (NetASCII), loaded once and shared by all
+ *          connections of all workers. Entries are keyed by path and
+ *          transfer mode and stamped with the file identity (device,
+ *          inode, size, mtime and ctime) – a stat not matching the stamp
+ *          invalidates the entry. The total size of images is kept
+ *          within a memory budget by evicting the least recently used
+ *          ones; an evicted image lives on until its last transfer ends.
+ * @note Thread-safe (one mutex, held only for map/list updates).
+ */
+class FileCache {
+   public:
+     /**
+      * @brief Immutable file image (shared by transfers)
+      */
+     using Image = const std::vector<char>;
+
+     /**
+      * @brief Cache statistics
+      */
+     struct Stats {
+          uint64_t hits = 0;      /**< Lookups served from the cache */
+          uint64_t misses = 0;    /**< Lookups not served */
+          uint64_t evictions = 0; /**< Entries evicted (LRU or stale) */
+          size_t entries = 0;     /**< Cached entries */
+          size_t bytes = 0;       /**< Bytes of cached images */
+     };
+
+     /**
+      * @brief Constructs a new cache
+      * @param budget Memory budget in bytes
+      * @param netascii Whether to cache NetASCII-encoded images
+      */
+     explicit FileCache(size_t budget, bool netascii = true)
+         : budget(budget), netascii(netascii) {}
+
+     FileCache& operator=(FileCache&& other) = delete;
+     FileCache& operator=(const FileCache&) = delete;
+     FileCache(FileCache&& other) = delete;
+     FileCache(const FileCache&) = delete;
+
+     /**
+      * @brief Looks up a fresh image of a file
+      * @param path File path
+      * @param st Current `stat` of the file
+      * @param format Transfer mode
+      * @return std::shared_ptr<Image> image, nullptr if not cached
+      */
+     std::shared_ptr<Image> get(const std::string& path, const struct stat& st,
+                                TFTPDataFormat format);
+
+     /**
+      * @brief Loads a file image and caches it
+      * @details The file is read (and encoded) without holding the lock.
+      * @throws std::runtime_error when reading from the file fails
+      * @param path File path
+      * @param fd Open file descriptor (read with `pread`)
+      * @param st `fstat` of the open file
+      * @param format Transfer mode
+      * @return std::shared_ptr<Image> image (not cached if the encoded
+      *         image exceeds the budget), nullptr if the mode is not
+      *         cached or the file exceeds the budget
+      */
+     std::shared_ptr<Image> load(const std::string& path, int fd,
+                                 const struct stat& st, TFTPDataFormat format);
+
+     /**
+      * @brief Gets the cache statistics
+      * @return Stats statistics
+      */
+     Stats get_stats() const;
+
+     /**
+      * @brief Formats the statistics (Prometheus text format)
+      * @return std::string metrics
+      */
+     std::string to_prometheus() const;
+
+   private:
+     /**
+      * @brief File identity an image was loaded from
+      */
+     struct Stamp {
+          dev_t dev;
+          ino_t ino;
+          off_t size;
+          struct timespec mtime;
+          struct timespec ctime;
+
+          explicit Stamp(const struct stat& st);
+          bool operator==(const Stamp& other) const;
+     };
+
+     /**
+      * @brief Cache entry
+      */
+     struct Entry {
+          Stamp stamp;                            /**< File identity */
+          std::shared_ptr<Image> image;           /**< Image */
+          std::list<std::string>::iterator lru_it; /**< Position in `lru` */
+     };
+
+     /**
+      * @brief Builds the entry key of a path and mode
+      */
+     static std::string make_key(const std::string& path,
+                                 TFTPDataFormat format);
+
+     /**
+      * @brief Removes an entry (lock held)
+      */
+     void erase(std::unordered_map<std::string, Entry>::iterator it);
+
+     size_t budget;  /**< Memory budget (bytes) */
+     bool netascii;  /**< Flag if NetASCII images are cached */
+
+     mutable std::mutex mtx; /**< Lock of everything below */
+     std::unordered_map<std::string, Entry> entries; /**< Entries by key */
+     std::list<std::string> lru; /**< Keys, most recently used first */
+     Stats stats;                /**< Statistics */
+};
+
+#endif
@@ -0,0 +1,74 @@
+/**
+ * @file filemap.hpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Read-only memory mapping of a file
+ * @date 2023-11-19
+ */
+
+#pragma once
+#ifndef TFTP_FILEMAP_HPP
+#     define TFTP_FILEMAP_HPP
+#     include <cstddef>
+#     include <span>
+
+/**
+ * @brief Read-only memory mapping of a whole file, read sequentially
+ * @details The file is mapped once with `MADV_SEQUENTIAL`, and the pages
+ *          ahead of the reader are requested (`MADV_WILLNEED`) one
+ *          readahead window at a time, so that serving a large file
+ *          takes a handful of syscalls instead of one (or more) a block.
+ * @note Pages past the end of a file truncated while mapped cannot be
+ *       read: `read` throws, and slices fail in the kernel (`EFAULT`).
+ */
+class FileMap {
+   public:
+     /**
+      * @brief Maps a file
+      * @throws std::runtime_error when the file cannot be mapped
+      * @param fd File descriptor (open for reading)
+      * @param size Size of the file (bytes mapped)
+      */
+     FileMap(int fd, size_t size);
+
+     /**
+      * @brief Unmaps the file
+      */
+     ~FileMap();
+
+     FileMap& operator=(FileMap&& other) = delete;
+     FileMap& operator=(const FileMap&) = delete;
+     FileMap(FileMap&& other) = delete;
+     FileMap(const FileMap&) = delete;
+
+     /**
+      * @brief Copies data out of the mapping
+      * @param out Output buffer
+      * @param len Size of the output buffer
+      * @param off Offset in the file
+      * @return size_t number of bytes copied (less than `len` at the end)
+      * @throws std::runtime_error when the file was truncated under it
+      */
+     size_t read(char* out, size_t len, size_t off);
+
+     /**
+      * @brief Gets a part of the mapping (valid while mapped)
+      * @param len Maximum size of the part
+      * @param off Offset in the file
+      * @return std::span<const char> the part (shorter than `len` at
+      *         the end)
+      */
+     std::span<const char> slice(size_t len, size_t off);
+
+     /**
+      * @brief Gets the size of the mapping
+      * @return size_t size in bytes
+      */
+     size_t get_size() const { return this->size; }
+
+   private:
+     const char* data = nullptr; /**< Mapped file */
+     size_t size = 0;            /**< Size of the mapping */
+     size_t advised = 0;         /**< End of the pages requested ahead */
+};
+
+#endif
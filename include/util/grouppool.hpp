@@ -0,0 +1,73 @@
+/**
+ * @file grouppool.hpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Pool of multicast group addresses (RFC 2090 sessions)
+ * @date 2023-11-25
+ */
+
+#pragma once
+#ifndef TFTP_GROUP_POOL_HPP
+#     define TFTP_GROUP_POOL_HPP
+#     include <netinet/in.h>
+
+#     include <cstddef>
+#     include <mutex>
+#     include <optional>
+#     include <vector>
+
+/**
+ * @brief Pool of multicast group addresses
+ * @details Hands out `size` consecutive group addresses from `base`,
+ *          all on the port of `base`, one per multicast session (see
+ *          `TFTPMulticastSession`). Groups are taken round-robin, so
+ *          a group just given back is the last to be reused (late DATA
+ *          of its old session do not reach clients of a new one).
+ *          Shared by all workers.
+ * @note Thread-safe (one mutex, held only for the slot updates).
+ */
+class GroupPool {
+   public:
+     /**
+      * @brief Constructs a new pool of group addresses
+      * @throws std::runtime_error if some of the addresses are not
+      *         multicast ones
+      * @param base First group address and the port of all of them
+      * @param size Number of groups
+      */
+     GroupPool(const sockaddr_in& base, size_t size);
+
+     GroupPool& operator=(GroupPool&& other) = delete;
+     GroupPool& operator=(const GroupPool&) = delete;
+     GroupPool(GroupPool&& other) = delete;
+     GroupPool(const GroupPool&) = delete;
+
+     /**
+      * @brief Takes a free group
+      * @return std::optional<sockaddr_in> group address, nullopt if all
+      *         are taken
+      */
+     std::optional<sockaddr_in> acquire();
+
+     /**
+      * @brief Gives back a group taken by `acquire`
+      * @param group Group address
+      */
+     void release(const sockaddr_in& group);
+
+     /**
+      * @brief Gets the number of groups taken
+      * @return size_t groups in use
+      */
+     size_t get_active() const;
+
+   private:
+     in_addr_t base;         /**< First group address (host byte order) */
+     in_port_t port;         /**< Port of the groups (network byte order) */
+     std::vector<bool> used; /**< Flags of the groups taken */
+
+     mutable std::mutex mtx; /**< Lock of the slots */
+     size_t next = 0;        /**< Slot tried first by `acquire` */
+     size_t active = 0;      /**< Groups taken */
+};
+
+#endif
@@ -0,0 +1,103 @@
+/**
+ * @file hdrhistogram.hpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief High dynamic range histogram (percentiles of latencies)
+ * @date 2023-11-25
+ */
+
+#pragma once
+#ifndef TFTP_HDRHISTOGRAM_HPP
+#     define TFTP_HDRHISTOGRAM_HPP
+#     include <cstddef>
+#     include <cstdint>
+#     include <vector>
+
+/**
+ * @brief Histogram of `uint64_t` values with a bounded relative error
+ *        (HdrHistogram-style log-linear buckets)
+ * @details Values below 2^`SUB_BITS` are counted exactly; larger ones
+ *          fall into buckets of 2^(`SUB_BITS` - 1) per power of two, so
+ *          a value is off by less than 1/2^(`SUB_BITS` - 1) (< 0.8 %).
+ *          Unlike `Histogram`, good for percentiles (ex. p99.9 of
+ *          transfer times) over the whole `uint64_t` range.
+ * @note Not thread-safe (merge histograms of threads instead).
+ */
+class HdrHistogram {
+   public:
+     static const unsigned SUB_BITS = 8; /**< Precision (bits) */
+
+     /**
+      * @brief Constructs an empty histogram
+      */
+     HdrHistogram();
+
+     /**
+      * @brief Records a value
+      * @param value Value
+      * @param n Number of times
+      */
+     void record(uint64_t value, uint64_t n = 1);
+
+     /**
+      * @brief Adds up another histogram
+      * @param other Histogram to add
+      */
+     void merge(const HdrHistogram& other);
+
+     /**
+      * @brief Gets a percentile
+      * @details Equal values of the percentile bucket are reported as
+      *          its highest one (at most the maximum recorded).
+      * @param pct Percentile (0 to 100)
+      * @return uint64_t value, 0 if empty
+      */
+     uint64_t percentile(double pct) const;
+
+     /* === Getters === */
+
+     /**
+      * @brief Gets the number of recorded values
+      * @return uint64_t count
+      */
+     uint64_t get_count() const { return this->count; }
+
+     /**
+      * @brief Gets the lowest recorded value (exact)
+      * @return uint64_t minimum, 0 if empty
+      */
+     uint64_t get_min() const { return this->count ? this->min : 0; }
+
+     /**
+      * @brief Gets the highest recorded value (exact)
+      * @return uint64_t maximum, 0 if empty
+      */
+     uint64_t get_max() const { return this->max; }
+
+     /**
+      * @brief Gets the mean of the recorded values (exact)
+      * @return double mean, 0 if empty
+      */
+     double get_mean() const {
+          return this->count ? this->sum / static_cast<double>(this->count)
+                             : 0.0;
+     }
+
+   private:
+     /**
+      * @brief Gets the bucket of a value
+      */
+     static size_t index_of(uint64_t value);
+
+     /**
+      * @brief Gets the highest value of a bucket
+      */
+     static uint64_t highest_of(size_t idx);
+
+     std::vector<uint64_t> buckets; /**< Counts */
+     uint64_t count = 0;            /**< Number of values */
+     uint64_t min = UINT64_MAX;     /**< Lowest value */
+     uint64_t max = 0;              /**< Highest value */
+     double sum = 0;                /**< Sum of the values (mean) */
+};
+
+#endif
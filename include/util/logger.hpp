@@ -7,58 +7,173 @@
 
 #pragma once
 #ifndef TFTP_LOGGER_HPP
-
+#     define TFTP_LOGGER_HPP
+#     include <atomic>
+#     include <charconv>
+#     include <concepts>
 #     include <optional>
+#     include <string_view>
 
 #     include "packet/PacketFactory.hpp"
+#     include "packet/PacketView.hpp"
+#     include "util/logring.hpp"
+
+/**
+ * @brief Highest log level compiled in (see `LogLevel`), entries
+ *        above it are removed at compile time
+ */
+#     ifndef TFTP_LOG_MAX_LEVEL
+#          define TFTP_LOG_MAX_LEVEL 3
+#     endif
+
+/**
+ * @brief Enumeration of log levels (verbosity)
+ */
+enum class LogLevel : int {
+     Error = 0,  /**< Errors only */
+     Info = 1,   /**< Operations, events and connection info (default) */
+     Packet = 2, /**< + every received packet (stderr) */
+     Block = 3,  /**< + every sent/received DATA block and ACK */
+};
+
+/**
+ * @brief Formats a log line right into a `LogRecord`
+ * @details Appends are truncated at the record size; numbers and
+ *          addresses are formatted without allocations.
+ */
+class LogLine {
+   public:
+     /**
+      * @brief Starts a new line in the record
+      * @param rec Record to format into
+      * @param stream Target stream
+      */
+     LogLine(LogRecord& rec, LogStream stream) : rec(rec) {
+          this->rec.stream = stream;
+          this->rec.len = 0;
+     }
+
+     LogLine& operator<<(std::string_view str) {
+          size_t n
+              = std::min(str.size(), sizeof(this->rec.text) - this->rec.len);
+          memcpy(this->rec.text + this->rec.len, str.data(), n);
+          this->rec.len += n;
+          return *this;
+     }
+
+     LogLine& operator<<(char chr) {
+          return *this << std::string_view(&chr, 1);
+     }
+
+     template <std::integral T>
+     LogLine& operator<<(T num) {
+          char buf[24];
+          auto res = std::to_chars(buf, buf + sizeof(buf), num);
+          return *this << std::string_view(buf, res.ptr - buf);
+     }
+
+     LogLine& operator<<(const in_addr& addr) {
+          char buf[INET_ADDRSTRLEN];
+          inet_ntop(AF_INET, &addr, buf, sizeof(buf));
+          return *this << std::string_view(buf);
+     }
+
+   private:
+     LogRecord& rec; /**< Record formatted into */
+};
 
 /**
  * @brief Logger utility class
+ * @details Entries are formatted into fixed-size records of a lock-free
+ *          ring (`LogRing`), which a background thread writes out in
+ *          batches – logging never blocks on (or flushes) the output.
+ *          Packet and block entries are off by default (`set_level`).
  * @note Style very loosely based on `yay` AUR helper logs.
  *       Why? Just because I like it. Styling is used just
  *       on stdout, stderr logs follow the assignment specs.
  */
 class Logger {
    public:
+     /* === Levels === */
+
+     /**
+      * @brief Sets the log level (verbosity)
+      * @param lvl Log level
+      */
+     static void set_level(LogLevel lvl) {
+          Logger::level.store(lvl, std::memory_order_relaxed);
+     }
+
+     /**
+      * @brief Checks if entries of a log level are logged
+      * @details Guard any costly message building with this; levels
+      *          above `TFTP_LOG_MAX_LEVEL` fold to `false` when compiled.
+      * @param lvl Log level
+      * @return true if enabled,
+      * @return false otherwise
+      */
+     static bool enabled(LogLevel lvl) {
+          return static_cast<int>(lvl) <= TFTP_LOG_MAX_LEVEL
+                 && lvl <= Logger::level.load(std::memory_order_relaxed);
+     }
+
+     /**
+      * @brief Blocks until all logged entries are written out
+      */
+     static void flush();
+
+     /* === Global logs === */
+
      /**
       * @brief Prints global operation info to stdout.
       * @param txt Text to print
       */
-     static void glob_op(const std::string& txt) {
-          std::cout << ":: " << txt << std::endl;
+     static void glob_op(std::string_view txt) {
+          Logger::emit(LogLevel::Info, LogStream::Out, ":: ", txt);
      }
 
      /**
       * @brief Prints global event info to stdout.
       * @param txt Text to print
       */
-     static void glob_event(const std::string& txt) {
-          std::cout << "==> " << txt << std::endl;
+     static void glob_event(std::string_view txt) {
+          Logger::emit(LogLevel::Info, LogStream::Out, "==> ", txt);
      }
 
      /**
       * @brief Prints a global information log to stdout.
       * @param txt Text to print
       */
-     static void glob_info(const std::string& txt) {
-          std::cout << "  " << txt << std::endl;
+     static void glob_info(std::string_view txt) {
+          Logger::emit(LogLevel::Info, LogStream::Out, "  ", txt);
      }
 
      /**
       * @brief Prints a global error log to stderr.
       * @param txt Text to print
       */
-     static void glob_err(const std::string& txt) {
-          std::cerr << "!ERR! " << txt << std::endl;
+     static void glob_err(std::string_view txt) {
+          Logger::emit(LogLevel::Error, LogStream::Err, "!ERR! ", txt);
      }
 
+     /* === Connection logs === */
+
      /**
       * @brief Prints connection info to stdout.
       * @param id Connection ID
       * @param txt Text to print
       */
-     static void conn_info(const std::string& id, const std::string& txt) {
-          std::cout << "  [" << id << "] - INFO  - " << txt << std::endl;
+     static void conn_info(int id, std::string_view txt) {
+          Logger::emit_conn(LogLevel::Info, id, "INFO ", txt);
+     }
+
+     /**
+      * @brief Prints connection block-level info (DATA/ACK) to stdout.
+      * @param id Connection ID
+      * @param txt Text to print
+      */
+     static void conn_block(int id, std::string_view txt) {
+          Logger::emit_conn(LogLevel::Block, id, "INFO ", txt);
      }
 
      /**
@@ -66,10 +181,12 @@ class Logger {
       * @param id Connection ID
       * @param txt Text to print
       */
-     static void conn_err(const std::string& id, const std::string& txt) {
-          std::cout << "  [" << id << "] - ERROR - " << txt << std::endl;
+     static void conn_err(int id, std::string_view txt) {
+          Logger::emit_conn(LogLevel::Error, id, "ERROR", txt);
      }
 
+     /* === Packet logs === */
+
      /**
       * @brief Prints a packet to stderr
       * @param BasePacket Packet to print
@@ -77,93 +194,32 @@ class Logger {
       * @param optional<sockaddr_in> Address of the receiver (dst)
       */
      static void packet(const BasePacket& packet, const sockaddr_in& src,
-                        const std::optional<sockaddr_in>& dst = std::nullopt) {
-          std::string msg;
-
-          /* Opcode */
-          switch (packet.get_opcode()) {
-               case TFTPOpcode::RRQ:
-                    msg = "RRQ ";
-                    break;
-               case TFTPOpcode::WRQ:
-                    msg = "WRQ ";
-                    break;
-               case TFTPOpcode::ACK:
-                    msg = "ACK ";
-                    break;
-               case TFTPOpcode::DATA:
-                    msg = "DATA ";
-                    break;
-               case TFTPOpcode::ERROR:
-                    msg = "ERROR ";
-                    break;
-               case TFTPOpcode::OACK:
-                    msg = "OACK ";
-                    break;
-               default:
-                    return;
-          }
-
-          /* SRC_IP:SRC_PORT */
-          msg += std::string(inet_ntoa(src.sin_addr)) + ":"
-                 + std::to_string(ntohs(src.sin_port));
-
-          /* DST_PORT (only for DATA and ERROR + if defined) */
-          if (dst.has_value()
-              && (packet.get_opcode() == TFTPOpcode::DATA
-                  || packet.get_opcode() == TFTPOpcode::ERROR)) {
-               msg += ":" + std::to_string(ntohs(dst.value().sin_port));
-          }
-
-          /* Type-specific */
-          switch (packet.get_opcode()) {
-               case TFTPOpcode::RRQ:
-               case TFTPOpcode::WRQ: {
-                    auto rq_packet = dynamic_cast<const RequestPacket&>(packet);
-                    msg += " \"" + rq_packet.get_filename() + "\"";
-                    msg += " " + rq_packet.get_mode_str();
-                    if (rq_packet.get_options_count() == 0) break;
-                    for (size_t i = 0; i < rq_packet.get_options_count(); i++)
-                         msg += " " + rq_packet.get_option_str(i);
-                    break;
-               }
-
-               case TFTPOpcode::ACK: {
-                    auto ack_packet
-                        = dynamic_cast<const AcknowledgementPacket&>(packet);
-                    msg += " " + std::to_string(ack_packet.get_block_number());
-                    break;
-               }
-
-               case TFTPOpcode::DATA: {
-                    auto data_packet = dynamic_cast<const DataPacket&>(packet);
-                    msg += " " + std::to_string(data_packet.get_block_number());
-                    break;
-               }
-
-               case TFTPOpcode::ERROR: {
-                    auto err_packet = dynamic_cast<const ErrorPacket&>(packet);
-                    msg += " " + std::to_string(err_packet.get_errcode());
-                    if (err_packet.get_message().has_value())
-                         msg += " \"" + err_packet.get_message().value() + "\"";
-                    break;
-               }
-
-               case TFTPOpcode::OACK: {
-                    auto oack_packet
-                        = dynamic_cast<const OptionAckPacket&>(packet);
-                    for (size_t i = 0; i < oack_packet.get_options_count(); i++)
-                         msg += " " + oack_packet.get_option_str(i);
-                    break;
-               }
-
-               default:
-                    break;
-          }
-
-          /* Print */
-          std::cerr << msg << std::endl;
-     }
+                        const std::optional<sockaddr_in>& dst = std::nullopt);
+
+     /**
+      * @brief Prints a received packet view to stderr
+      * @param PacketView Packet to print
+      * @param sockaddr_in Address of the sender (src)
+      * @param optional<sockaddr_in> Address of the receiver (dst)
+      */
+     static void packet(const PacketView& packet, const sockaddr_in& src,
+                        const std::optional<sockaddr_in>& dst = std::nullopt);
+
+   private:
+     /**
+      * @brief Logs `prefix` + `txt` as one entry (if `lvl` is enabled)
+      */
+     static void emit(LogLevel lvl, LogStream stream, std::string_view prefix,
+                      std::string_view txt);
+
+     /**
+      * @brief Logs a connection entry (if `lvl` is enabled)
+      */
+     static void emit_conn(LogLevel lvl, int id, std::string_view tag,
+                           std::string_view txt);
+
+     static inline std::atomic<LogLevel> level{
+         LogLevel::Info}; /**< Current log level */
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,141 @@
+/**
+ * @file logring.hpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Lock-free ring buffer of fixed-size log records
+ * @date 2023-11-18
+ */
+
+#pragma once
+#ifndef TFTP_LOGRING_HPP
+#     define TFTP_LOGRING_HPP
+#     include <atomic>
+#     include <cstddef>
+#     include <cstdint>
+#     include <memory>
+
+#     include "common.hpp"
+
+/**
+ * @brief Output stream of a log record
+ */
+enum class LogStream : uint8_t {
+     Out = 1, /**< Standard output */
+     Err = 2, /**< Standard error output */
+};
+
+/**
+ * @brief Preformatted log line of a fixed size
+ * @details Lines are formatted right into the record (see `LogLine`),
+ *          longer lines are truncated.
+ */
+struct LogRecord {
+     LogStream stream = LogStream::Out; /**< Target stream */
+     uint16_t len = 0;                  /**< Length of `text` */
+     char text[TFTP_LOG_RECORD_SIZE - 4]; /**< Line (w/o newline) */
+};
+
+/**
+ * @brief Bounded lock-free multi-producer single-consumer ring
+ *        of `LogRecord`s
+ * @details Every cell carries a sequence number telling whose turn
+ *          it is (D. Vyukov's bounded queue). Producers claim a cell
+ *          with a CAS on the enqueue position and fill it in place;
+ *          the single consumer needs no atomic read-modify-write.
+ * @see https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+ */
+class LogRing {
+   public:
+     /**
+      * @brief Constructs a new ring
+      * @param size Number of records (rounded up to a power of two)
+      */
+     explicit LogRing(size_t size = TFTP_LOG_RING_SIZE) {
+          size_t cap = 1;
+          while (cap < size) cap <<= 1;
+
+          this->mask = cap - 1;
+          this->cells = std::make_unique<Cell[]>(cap);
+          for (size_t i = 0; i < cap; i++)
+               this->cells[i].seq.store(i, std::memory_order_relaxed);
+     }
+
+     LogRing& operator=(LogRing&& other) = delete;
+     LogRing& operator=(const LogRing&) = delete;
+     LogRing(LogRing&& other) = delete;
+     LogRing(const LogRing&) = delete;
+
+     /**
+      * @brief Pushes a record, filling it in place (any thread)
+      * @param fill Callable taking `LogRecord&`
+      * @return true if pushed,
+      * @return false if the ring is full
+      */
+     template <typename F>
+     bool try_push(F&& fill) {
+          size_t pos = this->enq_pos.load(std::memory_order_relaxed);
+          Cell* cell;
+
+          while (true) {
+               cell = &this->cells[pos & this->mask];
+               size_t seq = cell->seq.load(std::memory_order_acquire);
+               auto diff = static_cast<intptr_t>(seq)
+                           - static_cast<intptr_t>(pos);
+
+               if (diff == 0) {
+                    /* Free cell => claim it */
+                    if (this->enq_pos.compare_exchange_weak(
+                            pos, pos + 1, std::memory_order_relaxed))
+                         break;
+               } else if (diff < 0) {
+                    return false;  // Consumer is a lap behind => full
+               } else {
+                    pos = this->enq_pos.load(std::memory_order_relaxed);
+               }
+          }
+
+          fill(cell->rec);
+          cell->seq.store(pos + 1, std::memory_order_release);
+          return true;
+     }
+
+     /**
+      * @brief Pops a record (consumer thread only)
+      * @param consume Callable taking `const LogRecord&`
+      * @return true if popped,
+      * @return false if the ring is empty
+      */
+     template <typename F>
+     bool try_pop(F&& consume) {
+          Cell* cell = &this->cells[this->deq_pos & this->mask];
+          if (cell->seq.load(std::memory_order_acquire) != this->deq_pos + 1)
+               return false;
+
+          consume(cell->rec);
+          cell->seq.store(this->deq_pos + this->mask + 1,
+                          std::memory_order_release);
+          this->deq_pos++;
+          return true;
+     }
+
+     /**
+      * @brief Gets the capacity of the ring
+      * @return size_t number of records
+      */
+     size_t capacity() const { return this->mask + 1; }
+
+   private:
+     /**
+      * @brief Ring cell
+      */
+     struct Cell {
+          std::atomic<size_t> seq; /**< Sequence number */
+          LogRecord rec;           /**< Record */
+     };
+
+     std::unique_ptr<Cell[]> cells; /**< Ring cells */
+     size_t mask = 0;               /**< Capacity - 1 */
+     alignas(64) std::atomic<size_t> enq_pos{0}; /**< Next push position */
+     alignas(64) size_t deq_pos = 0;             /**< Next pop position */
+};
+
+#endif
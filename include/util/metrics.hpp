@@ -0,0 +1,182 @@
+/**
+ * @file metrics.hpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Transfer and server metrics (counters and histograms)
+ * @date 2023-11-18
+ */
+
+#pragma once
+#ifndef TFTP_METRICS_HPP
+#     define TFTP_METRICS_HPP
+#     include <array>
+#     include <atomic>
+#     include <chrono>
+#     include <cstdint>
+#     include <optional>
+#     include <string>
+
+#     include "common.hpp"
+
+/**
+ * @brief Number of TFTP error codes (for per-code counters)
+ */
+static const size_t TFTP_N_ERRCODES = TFTPErrorCode::OptionNegotiation + 1;
+
+/**
+ * @brief Single-writer counter, readable from any thread
+ * @details Written by the owning thread only, so an increment is a plain
+ *          load and store (no locked read-modify-write); other threads
+ *          read it with a relaxed load.
+ */
+class Counter {
+   public:
+     /**
+      * @brief Adds to the counter (owning thread only)
+      * @param n Amount to add
+      */
+     void add(uint64_t n = 1) {
+          this->val.store(this->val.load(std::memory_order_relaxed) + n,
+                          std::memory_order_relaxed);
+     }
+
+     /**
+      * @brief Gets the counter value
+      * @return uint64_t value
+      */
+     uint64_t get() const { return this->val.load(std::memory_order_relaxed); }
+
+   private:
+     std::atomic<uint64_t> val{0}; /**< Value */
+};
+
+/**
+ * @brief Histogram of (microsecond) values with fixed buckets
+ * @details Bucket `i` counts values up to 4^i (1 us, 4 us, … ~268 s),
+ *          the last bucket is +Inf. Same single-writer rules as `Counter`.
+ */
+class Histogram {
+   public:
+     static const size_t N_BUCKETS = 16; /**< Number of buckets (w/ +Inf) */
+
+     /**
+      * @brief Records a value (owning thread only)
+      * @param value Value to record
+      */
+     void observe(uint64_t value);
+
+     /**
+      * @brief Adds up another histogram (owning thread only)
+      * @param other Histogram to add
+      */
+     void merge(const Histogram& other);
+
+     /**
+      * @brief Gets the upper bound of a bucket
+      * @param i Bucket index (below `N_BUCKETS - 1`)
+      * @return uint64_t upper bound (inclusive)
+      */
+     static uint64_t bound(size_t i) { return uint64_t{1} << (2 * i); }
+
+     /**
+      * @brief Gets the (non-cumulative) count of a bucket
+      * @param i Bucket index
+      * @return uint64_t count
+      */
+     uint64_t get_bucket(size_t i) const { return this->buckets[i].get(); }
+
+     /**
+      * @brief Gets the number of recorded values
+      * @return uint64_t count
+      */
+     uint64_t get_count() const { return this->count.get(); }
+
+     /**
+      * @brief Gets the sum of recorded values
+      * @return uint64_t sum
+      */
+     uint64_t get_sum() const { return this->sum.get(); }
+
+   private:
+     std::array<Counter, N_BUCKETS> buckets; /**< Bucket counts */
+     Counter count;                          /**< Number of values */
+     Counter sum;                            /**< Sum of values */
+};
+
+/**
+ * @brief Statistics of a single connection (owned by the connection)
+ */
+struct ConnStats {
+     uint64_t bytes_tx = 0;       /**< DATA payload bytes sent (new blocks) */
+     uint64_t bytes_rx = 0;       /**< DATA payload bytes received */
+     uint64_t blocks_tx = 0;      /**< DATA blocks sent (new blocks) */
+     uint64_t blocks_rx = 0;      /**< DATA blocks received */
+     uint64_t retransmits = 0;    /**< Retransmitted packets */
+     uint64_t timeouts = 0;       /**< Retransmission timeouts */
+     uint64_t hi_block = 0;       /**< Highest block sent so far */
+     uint64_t blksize_clamps = 0; /**< `blksize` lowered to the path MTU */
+     uint64_t pmtu_fallbacks = 0; /**< Fragmenting after a PMTU drop */
+     uint64_t dup_rx = 0;         /**< DATA blocks received again */
+     uint64_t dropped = 0;        /**< Received packets dropped (loss) */
+     std::optional<TFTPErrorCode> err_sent; /**< Sent ERROR code */
+     std::optional<TFTPErrorCode> err_recv; /**< Received ERROR code */
+     std::chrono::steady_clock::time_point start
+         = std::chrono::steady_clock::now(); /**< Connection start */
+};
+
+/**
+ * @brief Server metrics of one worker (or their aggregate)
+ * @details Every worker owns one and is its only writer; a reader
+ *          aggregates them with `merge` into a fresh instance.
+ *          Durations are kept in microseconds.
+ */
+struct ServerMetrics {
+     /* == Requests and connections == */
+     Counter rrq;            /**< Received RRQs */
+     Counter wrq;            /**< Received WRQs */
+     Counter req_duplicate;  /**< Requests dropped as duplicates */
+     Counter req_rejected;   /**< Requests refused (over the caps) */
+     Counter req_queued;     /**< Requests queued (over the caps) */
+     Counter req_expired;    /**< Queued requests refused (timed out) */
+     Counter conn_opened;    /**< Connections opened */
+     Counter conn_completed; /**< Connections completed */
+     Counter conn_errored;   /**< Connections errored */
+
+     /* == Transfers (of finished connections) == */
+     Counter bytes_tx;       /**< DATA payload bytes sent */
+     Counter bytes_rx;       /**< DATA payload bytes received */
+     Counter blocks_tx;      /**< DATA blocks sent */
+     Counter blocks_rx;      /**< DATA blocks received */
+     Counter retransmits;    /**< Retransmitted packets */
+     Counter timeouts;       /**< Retransmission timeouts */
+     Counter blksize_clamps; /**< `blksize` options lowered to the MTU */
+     Counter pmtu_fallbacks; /**< Transfers fragmenting after a PMTU drop */
+     std::array<Counter, TFTP_N_ERRCODES> errors_sent; /**< By code */
+     std::array<Counter, TFTP_N_ERRCODES> errors_recv; /**< By code */
+
+     /* == Latencies == */
+     Histogram rtt_us;      /**< RTT samples */
+     Histogram transfer_us; /**< Connection durations */
+     Histogram loop_us;     /**< Event loop iteration (handling) times */
+     Histogram setup_us;    /**< Connection setup times */
+
+     /**
+      * @brief Folds the statistics of a finished connection in
+      * @param stats Connection statistics
+      * @param errored Whether the connection errored
+      */
+     void add_conn(const ConnStats& stats, bool errored);
+
+     /**
+      * @brief Adds up metrics of another worker
+      * @param other Metrics to add
+      */
+     void merge(const ServerMetrics& other);
+
+     /**
+      * @brief Formats the metrics in the Prometheus text format
+      * @return std::string exposition text
+      */
+     std::string to_prometheus() const;
+};
+
+#endif
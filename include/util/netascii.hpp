@@ -8,7 +8,13 @@
 #pragma once
 #ifndef TFTP_NETASCII_HPP
 #     define TFTP_NETASCII_HPP
+#     include <unistd.h>
+
 #     include <cstdint>
+#     include <cstring>
+#     include <optional>
+#     include <span>
+#     include <stdexcept>
 #     include <vector>
 
 /**
@@ -18,6 +24,112 @@
  */
 class NetASCII {
    public:
+     /* === Scanning kernels === */
+
+     /**
+      * @brief Enumeration of scanning kernels
+      */
+     enum class Kernel {
+          Scalar, /**< Byte by byte (portable fallback) */
+          SSE2,   /**< 16 bytes at a time (x86) */
+          AVX2,   /**< 32 bytes at a time (x86) */
+          NEON,   /**< 16 bytes at a time (ARM) */
+     };
+
+     /**
+      * @brief Gets the active scanning kernel
+      * @details The widest kernel the CPU supports is picked on first use.
+      * @return Kernel active kernel
+      */
+     static Kernel get_kernel();
+
+     /**
+      * @brief Switches the scanning kernel (for tests and benchmarks)
+      * @note Not thread-safe, switch before any conversions run.
+      * @param kernel Kernel to use
+      * @return true if switched,
+      * @return false if the CPU does not support the kernel
+      */
+     static bool set_kernel(Kernel kernel);
+
+     /**
+      * @brief Finds the first occurence of `a` or `b`
+      * @param data Data to scan
+      * @param len Length of the data
+      * @param a First character
+      * @param b Second character (same as `a` for a single one)
+      * @return size_t index of the first occurence, `len` if none
+      */
+     static size_t scan(const char* data, size_t len, char a, char b);
+
+     /* === Chunked conversion === */
+
+     /**
+      * @brief Conversion state carried between chunks
+      */
+     struct State {
+          bool cr = false; /**< Flag if a CR awaits the next chunk */
+     };
+
+     /**
+      * @brief Gets the output size that `encode` never exceeds
+      * @param len Input length
+      * @return size_t output buffer size
+      */
+     static constexpr size_t max_encoded(size_t len) { return 2 * len + 2; }
+
+     /**
+      * @brief Gets the output size that `decode` never exceeds
+      * @param len Input length
+      * @return size_t output buffer size
+      */
+     static constexpr size_t max_decoded(size_t len) { return len + 1; }
+
+     /**
+      * @brief Encodes a chunk of Unix data to NetASCII
+      * @details Replaces `\n` with `\r\n` and a lone `\r` with `\r\0`,
+      *          `\r\n` is kept. Runs of other bytes are found by `scan`
+      *          and copied in bulk. A CR ending the chunk is held back
+      *          in `state` until the next chunk (or `encode_end`).
+      * @throws std::length_error when `out` is below `max_encoded`
+      * @param in Unix data
+      * @param out Output buffer (at least `max_encoded(in.size())`)
+      * @param state Conversion state
+      * @return size_t length of the encoded data
+      */
+     static size_t encode(std::span<const char> in, std::span<char> out,
+                          State& state);
+
+     /**
+      * @brief Finishes an encoded stream (flushes a held-back CR)
+      * @param out Output buffer (at least 2 bytes)
+      * @param state Conversion state
+      * @return size_t length of the flushed data
+      */
+     static size_t encode_end(std::span<char> out, State& state);
+
+     /**
+      * @brief Decodes a chunk of NetASCII data to Unix data
+      * @details Replaces `\r\n` with `\n` and `\r\0` with `\r`, a lone
+      *          `\r` is kept. A CR ending the chunk is held back in
+      *          `state` until the next chunk (or `decode_end`).
+      * @throws std::length_error when `out` is below `max_decoded`
+      * @param in NetASCII data
+      * @param out Output buffer (at least `max_decoded(in.size())`)
+      * @param state Conversion state
+      * @return size_t length of the decoded data
+      */
+     static size_t decode(std::span<const char> in, std::span<char> out,
+                          State& state);
+
+     /**
+      * @brief Finishes a decoded stream (flushes a held-back CR)
+      * @param out Output buffer (at least 1 byte)
+      * @param state Conversion state
+      * @return size_t length of the flushed data
+      */
+     static size_t decode_end(std::span<char> out, State& state);
+
      /* === Primary conversion methods === */
 
      /**
@@ -28,30 +140,12 @@ class NetASCII {
       * @return NetASCII binary vector
       */
      static std::vector<char> vec_to_na(const std::vector<char>& data) {
-          std::vector<char> netasciiData;
-          for (uint64_t i = 0; i < data.size(); i++) {
-               if (data[i] == '\n') {
-                    // LF -> CR LF
-                    netasciiData.push_back('\r');
-                    netasciiData.push_back('\n');
-               } else if (data[i] == '\r') {
-                    if (i + 1 < data.size() && data[i + 1] == '\n') {
-                         // CR LF -> CR LF
-                         netasciiData.push_back('\r');
-                         netasciiData.push_back('\n');
-                         i++;
-                    } else {
-                         // CR -> CR NUL
-                         netasciiData.push_back('\r');
-                         netasciiData.push_back('\0');
-                    }
-               } else {
-                    // Regular character
-                    netasciiData.push_back(data[i]);
-               }
-          }
-
-          return netasciiData;
+          std::vector<char> out(max_encoded(data.size()));
+          State state;
+          size_t len = encode(data, out, state);
+          len += encode_end(std::span<char>(out).subspan(len), state);
+          out.resize(len);
+          return out;
      }
 
      /**
@@ -62,29 +156,166 @@ class NetASCII {
       * @return Unix binary vector
       */
      static std::vector<char> na_to_vec(const std::vector<char>& data) {
-          std::vector<char> bin_data;
-          for (uint64_t i = 0; i < data.size(); i++) {
-               if (data[i] == '\r') {
-                    if (i + 1 < data.size() && data[i + 1] == '\n') {
-                         // CR LF -> LF
-                         bin_data.push_back('\n');
-                         i++;
-                    } else if (i + 1 < data.size() && data[i + 1] == '\0') {
-                         // CR NUL -> CR
-                         bin_data.push_back('\r');
-                         i++;
-                    } else {
-                         // CR -> CR
-                         bin_data.push_back('\r');
+          std::vector<char> out(max_decoded(data.size()));
+          State state;
+          size_t len = decode(data, out, state);
+          len += decode_end(std::span<char>(out).subspan(len), state);
+          out.resize(len);
+          return out;
+     }
+
+     /**
+      * @brief Converts NetASCII data to Unix data in place
+      * @details Same conversion as `na_to_vec` (`\r\n` to `\n`, `\r\0`
+      * to `\r`). NetASCII never grows when decoded, so the result is
+      * written over the input.
+      * @param data NetASCII data (overwritten)
+      * @param len Length of the data
+      * @return size_t length of the decoded data
+      */
+     static size_t na_decode(char* data, size_t len);
+
+     /* === Streaming === */
+
+     /**
+      * @brief Stateful streaming NetASCII encoder
+      * @details Encodes a file descriptor block by block, remembering
+      *          the source offset (reads are sequential), a CR awaiting
+      *          its look-ahead and an encoded byte spilled over the
+      *          block boundary, so every block costs O(block size)
+      *          instead of re-encoding the file from its start.
+      * @note Blocks must be obtained in order, each exactly once –
+      *       retransmits have to be served from a saved copy.
+      */
+     class Encoder {
+        public:
+          /**
+           * @brief Constructs a new encoder reading from a file descriptor
+           * @param fd File descriptor
+           * @param off Offset to read from with `pread` (leaving the file
+           *            offset alone, ex. for shared descriptors), -1 to
+           *            read sequentially from the file offset (streams)
+           */
+          explicit Encoder(int fd = -1, off_t off = -1) : fd(fd), off(off) {}
+
+          /**
+           * @brief Encodes next block of the file
+           * @throws std::runtime_error when reading from the file fails
+           * @param block_size Size of the block
+           * @return std::vector<char> encoded block, shorter than
+           *         `block_size` only at the end of the file
+           */
+          std::vector<char> next_block(size_t block_size) {
+               std::vector<char> out(block_size);
+               out.resize(this->next_block(out.data(), block_size));
+               return out;
+          }
+
+          /**
+           * @brief Encodes next block of the file into a buffer
+           * @throws std::runtime_error when reading from the file fails
+           * @param out Buffer for the block (at least `block_size` bytes)
+           * @param block_size Size of the block
+           * @return size_t length of the encoded block, shorter than
+           *         `block_size` only at the end of the file
+           */
+          size_t next_block(char* out, size_t block_size) {
+               size_t len = 0;
+
+               while (len < block_size) {
+                    /* Byte spilled from the last emit */
+                    if (this->pending.has_value()) {
+                         out[len++] = this->pending.value();
+                         this->pending.reset();
+                         continue;
+                    }
+
+                    /* Refill the read buffer */
+                    if (this->rd_pos == this->rd_len && !this->eof) {
+                         ssize_t bytes_rx
+                             = this->off < 0
+                                   ? read(this->fd, this->rd_buf.data(),
+                                          this->rd_buf.size())
+                                   : pread(this->fd, this->rd_buf.data(),
+                                           this->rd_buf.size(), this->off);
+                         if (bytes_rx < 0)
+                              throw std::runtime_error("Could not read file");
+                         if (this->off >= 0) this->off += bytes_rx;
+                         this->rd_pos = 0;
+                         this->rd_len = bytes_rx;
+                         this->eof = (bytes_rx == 0);
+                    }
+
+                    /* End of file => only the held-back CR remains */
+                    if (this->rd_pos == this->rd_len) {
+                         if (!this->cr_held) break;
+                         this->cr_held = false;
+                         emit(out, len, block_size, '\r', '\0');  // CR NUL
+                         continue;
+                    }
+
+                    char c = this->rd_buf[this->rd_pos];
+
+                    /* CR needs to look ahead at the following byte */
+                    if (this->cr_held) {
+                         this->cr_held = false;
+                         if (c == '\n') {
+                              this->rd_pos++;
+                              emit(out, len, block_size, '\r', '\n');  // CR LF
+                         } else {
+                              emit(out, len, block_size, '\r', '\0');  // CR NUL
+                         }
+                         continue;
+                    }
+
+                    /* Run of regular characters => copy in bulk */
+                    size_t run = NetASCII::scan(
+                        this->rd_buf.data() + this->rd_pos,
+                        std::min(this->rd_len - this->rd_pos,
+                                 block_size - len),
+                        '\r', '\n');
+                    if (run > 0) {
+                         memcpy(out + len, this->rd_buf.data() + this->rd_pos,
+                                run);
+                         this->rd_pos += run;
+                         len += run;
+                         continue;
                     }
-               } else {
-                    // Regular character
-                    bin_data.push_back(data[i]);
+
+                    this->rd_pos++;
+                    if (c == '\n')
+                         emit(out, len, block_size, '\r', '\n');  // LF -> CR LF
+                    else
+                         this->cr_held = true;  // CR
                }
+
+               return len;
           }
 
-          return bin_data;
-     }
+        private:
+          /**
+           * @brief Appends an encoded two-byte sequence to the block,
+           *        spilling the second byte if the block gets full
+           */
+          void emit(char* out, size_t& len, size_t block_size, char first,
+                    char second) {
+               out[len++] = first;
+               if (len < block_size)
+                    out[len++] = second;
+               else
+                    this->pending = second;
+          }
+
+          int fd;                      /**< Source file descriptor */
+          off_t off;                   /**< `pread` offset (-1 = `read`) */
+          std::vector<char> rd_buf
+              = std::vector<char>(65536); /**< Read buffer */
+          size_t rd_pos = 0;             /**< Position in `rd_buf` */
+          size_t rd_len = 0;             /**< Valid bytes in `rd_buf` */
+          bool eof = false;              /**< Flag if source is read */
+          bool cr_held = false;          /**< Flag if CR awaits look-ahead */
+          std::optional<char> pending;   /**< Byte spilled to next block */
+     };
 
      /* === Variants === */
 
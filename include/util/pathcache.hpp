@@ -0,0 +1,170 @@
+/**
+ * @file pathcache.hpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Shared cache of resolved request paths (open files)
+ * @date 2023-11-25
+ */
+
+#pragma once
+#ifndef TFTP_PATHCACHE_HPP
+#     define TFTP_PATHCACHE_HPP
+#     include <sys/stat.h>
+
+#     include <chrono>
+#     include <cstdint>
+#     include <memory>
+#     include <mutex>
+#     include <string>
+#     include <unordered_map>
+#     include <vector>
+
+#     include "common.hpp"
+
+/**
+ * @brief Shared cache of resolved RRQ paths
+ * @details Maps a requested path to its open read-only descriptor and
+ *          `fstat` – or to the `errno` opening it failed with (ex. a
+ *          missing file), so that repeated requests skip the `access`,
+ *          `open` and `fstat` calls (round trips on a network
+ *          filesystem). Transfers of one file share the descriptor,
+ *          reading it with `pread` only; it is closed once evicted and
+ *          no longer used.
+ * @details Entries are dropped on changes reported by inotify on their
+ *          directories (drained at every lookup, a single non-blocking
+ *          `read`). Changes inotify does not see (ex. made by other
+ *          NFS clients) are picked up once an entry expires after
+ *          `TFTP_PATH_CACHE_TTL_MS`.
+ * @note Thread-safe (one mutex, not held while opening files).
+ */
+class PathCache {
+   public:
+     /**
+      * @brief Open file shared by transfers
+      */
+     struct File {
+          int fd;         /**< Read-only descriptor (`pread` only) */
+          struct stat st; /**< `fstat` of the descriptor */
+
+          File(int fd, const struct stat& st) : fd(fd), st(st) {}
+          ~File() { close(this->fd); }
+
+          File& operator=(File&& other) = delete;
+          File& operator=(const File&) = delete;
+          File(File&& other) = delete;
+          File(const File&) = delete;
+     };
+
+     /**
+      * @brief Result of a lookup
+      */
+     struct Lookup {
+          std::shared_ptr<const File> file; /**< File, nullptr on failure */
+          int err = 0; /**< `errno` of the failed `open` (or `fstat`) */
+     };
+
+     /**
+      * @brief Cache statistics
+      */
+     struct Stats {
+          uint64_t hits = 0;          /**< Lookups served from the cache */
+          uint64_t misses = 0;        /**< Lookups opening the file */
+          uint64_t invalidations = 0; /**< Entries dropped (changes) */
+          size_t entries = 0;         /**< Cached entries */
+     };
+
+     /**
+      * @brief Constructs a new cache
+      * @throws std::runtime_error when inotify is not available
+      * @param max_entries Maximum number of entries (open files)
+      */
+     explicit PathCache(size_t max_entries);
+
+     /**
+      * @brief Closes the inotify descriptor (cached files are closed
+      *        once no transfer uses them)
+      */
+     ~PathCache();
+
+     PathCache& operator=(PathCache&& other) = delete;
+     PathCache& operator=(const PathCache&) = delete;
+     PathCache(PathCache&& other) = delete;
+     PathCache(const PathCache&) = delete;
+
+     /* === Core methods === */
+
+     /**
+      * @brief Opens a file for reading, through the cache
+      * @param path File path
+      * @return Lookup open file or `errno`
+      */
+     Lookup open(const std::string& path);
+
+     /**
+      * @brief Gets the cache statistics
+      * @return Stats statistics
+      */
+     Stats get_stats() const;
+
+     /**
+      * @brief Formats the statistics (Prometheus text format)
+      * @return std::string metrics
+      */
+     std::string to_prometheus() const;
+
+   private:
+     /**
+      * @brief Cache entry
+      */
+     struct Entry {
+          std::shared_ptr<const File> file; /**< File, nullptr if failed */
+          int err;      /**< `errno` if failed, -1 while being opened */
+          uint64_t gen; /**< Lookup that created the entry */
+          std::chrono::steady_clock::time_point expires; /**< Expiry */
+     };
+
+     /**
+      * @brief Opens a file (no caching)
+      */
+     static Lookup open_file(const std::string& path);
+
+     /**
+      * @brief Gets the directory part of a path (up to the last `/`)
+      */
+     static std::string dir_of(const std::string& path);
+
+     /**
+      * @brief Watches a directory (lock held)
+      * @return true if watched (now or already),
+      * @return false if it cannot be watched (entries not cached)
+      */
+     bool watch(const std::string& dir);
+
+     /**
+      * @brief Drops the entries changed since the last call (lock held)
+      */
+     void drain();
+
+     /**
+      * @brief Drops all entries (lock held)
+      */
+     void clear();
+
+     /**
+      * @brief Makes room for a new entry (lock held)
+      */
+     void make_room();
+
+     size_t max_entries; /**< Maximum number of entries */
+     int notify_fd;      /**< inotify descriptor (non-blocking) */
+
+     mutable std::mutex mtx; /**< Lock of everything below */
+     std::unordered_map<std::string, Entry> entries; /**< Entries by path */
+     std::unordered_map<std::string, int> dir_wds; /**< Watched directories */
+     std::unordered_map<int, std::vector<std::string>>
+         wd_dirs;             /**< Directory names of a watch */
+     uint64_t next_gen = 0;   /**< Generation of the next lookup */
+     std::vector<char> events = std::vector<char>(16384); /**< Read buffer */
+     Stats stats;             /**< Statistics */
+};
+
+#endif
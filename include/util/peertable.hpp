@@ -0,0 +1,107 @@
+/**
+ * @file peertable.hpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Flat hash table of remote peers (demultiplexing)
+ * @date 2023-11-23
+ */
+
+#pragma once
+#ifndef TFTP_PEERTABLE_HPP
+#     define TFTP_PEERTABLE_HPP
+#     include <netinet/in.h>
+
+#     include <cstddef>
+#     include <cstdint>
+#     include <vector>
+
+/**
+ * @brief Flat hash table of remote peers (address and port)
+ * @details Maps the origin address of a datagram to a (non-negative)
+ *          value, ex. a connection slot – so that packets of many
+ *          transfers sharing one socket can be handed to their
+ *          connections. Open addressing with linear probing over one
+ *          power-of-two array, kept at most half full: a lookup is
+ *          a multiply, a shift and (mostly) a single cache line.
+ *          Erasing shifts the following entries back (no tombstones),
+ *          so lookups do not slow down with churn.
+ * @note Not thread-safe (one table per worker).
+ */
+class PeerTable {
+   public:
+     /**
+      * @brief Constructs an empty table
+      */
+     PeerTable() : entries(16) {}
+
+     PeerTable& operator=(PeerTable&& other) = delete;
+     PeerTable& operator=(const PeerTable&) = delete;
+     PeerTable(PeerTable&& other) = delete;
+     PeerTable(const PeerTable&) = delete;
+
+     /* === Core methods === */
+
+     /**
+      * @brief Adds a peer
+      * @param peer Peer address
+      * @param value Value (non-negative)
+      * @return true if added,
+      * @return false if the peer is already in the table (unchanged)
+      */
+     bool insert(const sockaddr_in& peer, int value);
+
+     /**
+      * @brief Looks a peer up
+      * @param peer Peer address
+      * @return int value, -1 if not in the table
+      */
+     int find(const sockaddr_in& peer) const;
+
+     /**
+      * @brief Removes a peer (if in the table)
+      * @param peer Peer address
+      */
+     void erase(const sockaddr_in& peer);
+
+     /**
+      * @brief Gets the number of peers
+      * @return size_t peers
+      */
+     size_t size() const { return this->count; }
+
+   private:
+     /**
+      * @brief Table entry
+      */
+     struct Entry {
+          uint64_t key = EMPTY; /**< Packed peer (`EMPTY` if free) */
+          int value = -1;       /**< Value */
+     };
+
+     static constexpr uint64_t EMPTY
+         = ~uint64_t{0}; /**< Key of free entries (not a 48-bit peer) */
+
+     /**
+      * @brief Packs a peer address and port into a key
+      */
+     static uint64_t pack(const sockaddr_in& peer) {
+          return uint64_t{peer.sin_addr.s_addr} << 16 | peer.sin_port;
+     }
+
+     /**
+      * @brief Gets the home index of a key (Fibonacci hashing)
+      */
+     size_t home(uint64_t key) const {
+          return (key * 0x9e3779b97f4a7c15) >> (64 - this->bits);
+     }
+
+     /**
+      * @brief Doubles the table, re-inserting all entries
+      */
+     void grow();
+
+     std::vector<Entry> entries; /**< Slots (power-of-two count) */
+     unsigned bits = 4;          /**< log2 of the slot count */
+     size_t count = 0;           /**< Number of used slots */
+};
+
+#endif
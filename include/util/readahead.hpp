@@ -0,0 +1,114 @@
+/**
+ * @file readahead.hpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Read-ahead buffer of an uploaded stream
+ * @date 2023-11-21
+ */
+
+#pragma once
+#ifndef TFTP_READAHEAD_HPP
+#     define TFTP_READAHEAD_HPP
+#     include <atomic>
+#     include <condition_variable>
+#     include <mutex>
+#     include <span>
+#     include <thread>
+#     include <vector>
+
+/**
+ * @brief Read-ahead buffer of an uploaded stream (ex. a pipe on stdin)
+ * @details A reader thread fills a ring of `depth` chunks in big `read`s
+ *          ahead of the transfer, so sending never waits on the source
+ *          as long as it keeps up. Blocks are handed out as slices of the
+ *          chunks – no copy – and a chunk is refilled only after all of
+ *          its blocks were released (acknowledged), so retransmits can be
+ *          sent from the same slices.
+ * @note Chunks are a multiple of the block size, so a block never spans
+ *       two chunks, and the ring must hold the whole upload window plus
+ *       the chunk being read (see `TFTP_READ_DEPTH`).
+ */
+class ReadAhead {
+   public:
+     /**
+      * @brief Starts reading ahead
+      * @param fd File descriptor (read from its current position)
+      * @param block Block size
+      * @param chunk Size of the reads (rounded down to whole blocks)
+      * @param depth Number of chunks (at least 2)
+      * @param cancel Flag cancelling waits for the source (optional)
+      */
+     ReadAhead(int fd, size_t block, size_t chunk, size_t depth,
+               const std::atomic<bool>* cancel = nullptr);
+
+     /**
+      * @brief Stops reading (even when blocked on the source) and joins
+      *        the reader thread
+      */
+     ~ReadAhead();
+
+     ReadAhead& operator=(ReadAhead&& other) = delete;
+     ReadAhead& operator=(const ReadAhead&) = delete;
+     ReadAhead(ReadAhead&& other) = delete;
+     ReadAhead(const ReadAhead&) = delete;
+
+     /**
+      * @brief Gets the next block, waiting for the source if needed
+      * @throws std::runtime_error when reading from the source fails,
+      *         or when cancelled while waiting
+      * @return std::span<const char> the block (shorter than the block
+      *         size only at the end of the stream)
+      */
+     std::span<const char> next();
+
+     /**
+      * @brief Releases the oldest blocks handed out
+      * @param len Number of bytes released
+      */
+     void release(size_t len);
+
+   private:
+     /**
+      * @brief Chunk of the stream
+      */
+     struct Chunk {
+          std::vector<char> data; /**< Chunk buffer */
+          size_t len = 0;         /**< Bytes read (less only at the end) */
+     };
+
+     /**
+      * @brief Reader thread loop
+      */
+     void run();
+
+     /**
+      * @brief Reads one chunk from the source
+      * @param chunk Chunk to fill
+      * @return bool false if stopped, or on error (`err` set)
+      */
+     bool fill(Chunk& chunk);
+
+     int fd;                          /**< Source file descriptor */
+     const std::atomic<bool>* cancel; /**< Flag cancelling the waits */
+     int stop_fd = -1;          /**< Eventfd interrupting blocked reads */
+     size_t block;              /**< Block size */
+     size_t chunk_size;         /**< Chunk size */
+     std::vector<Chunk> chunks; /**< Ring of chunks */
+
+     /* == Shared with the reader == */
+     std::mutex mtx;                 /**< Lock of the waits */
+     std::condition_variable cv;     /**< Signals filled or freed chunks */
+     std::atomic<size_t> filled = 0; /**< Chunks read so far */
+     std::atomic<size_t> freed = 0;  /**< Chunks released so far */
+     bool eof = false;               /**< Flag if the stream ended */
+     bool stop = false;              /**< Flag if reading should stop */
+     int err = 0;                    /**< `errno` of a failed read */
+
+     /* == Consumer == */
+     size_t cur = 0;      /**< Chunk of the next block */
+     size_t cur_off = 0;  /**< Offset of the next block in `cur` */
+     size_t released = 0; /**< Bytes released so far */
+
+     std::thread thread; /**< Reader thread (started last) */
+};
+
+#endif
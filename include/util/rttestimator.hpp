@@ -0,0 +1,81 @@
+/**
+ * @file rttestimator.hpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Round-trip time estimator for the retransmission timer
+ * @date 2023-11-18
+ */
+
+#pragma once
+#ifndef TFTP_RTTESTIMATOR_HPP
+#     define TFTP_RTTESTIMATOR_HPP
+#     include <chrono>
+#     include <optional>
+
+#     include "common.hpp"
+
+/**
+ * @brief Retransmission timeout (RTO) estimator
+ * @details Implements the RFC 6298 algorithm – smoothed RTT (SRTT) and
+ *          RTT variance (RTTVAR) updated from every valid sample, with
+ *          exponential backoff on timeouts. Samples must follow Karn's
+ *          rule (no samples of retransmitted packets), which is up to
+ *          the caller. A fixed RTO (RFC 2349 `timeout`) disables both.
+ * @see https://datatracker.ietf.org/doc/html/rfc6298
+ */
+class RttEstimator {
+   public:
+     using Duration = std::chrono::microseconds;
+
+     /**
+      * @brief Records a round-trip time sample
+      * @param rtt Measured round-trip time
+      */
+     void sample(Duration rtt);
+
+     /**
+      * @brief Doubles the RTO after a retransmission timeout
+      */
+     void backoff();
+
+     /**
+      * @brief Sets a fixed RTO, disabling adaptation and backoff
+      * @param rto Retransmission timeout
+      */
+     void set_fixed(Duration rto);
+
+     /**
+      * @brief Checks if the RTO is fixed
+      * @return true if fixed,
+      * @return false if adaptive
+      */
+     bool is_fixed() const { return this->fixed; }
+
+     /**
+      * @brief Gets the current retransmission timeout
+      * @return Duration RTO
+      */
+     Duration get_rto() const { return this->rto; }
+
+     /**
+      * @brief Gets the smoothed round-trip time
+      * @return std::optional<Duration> SRTT, nullopt if no samples yet
+      */
+     std::optional<Duration> get_srtt() const {
+          if (!this->has_sample) return std::nullopt;
+          return this->srtt;
+     }
+
+   private:
+     /**
+      * @brief Clamps `rto` to [`TFTP_MIN_RTO_MS`, `TFTP_MAX_RTO_MS`]
+      */
+     void clamp();
+
+     Duration rto = std::chrono::milliseconds(TFTP_INIT_RTO_MS); /**< RTO */
+     Duration srtt{0};        /**< Smoothed round-trip time */
+     Duration rttvar{0};      /**< Round-trip time variance */
+     bool has_sample = false; /**< Flag if a sample was recorded */
+     bool fixed = false;      /**< Flag if the RTO is fixed */
+};
+
+#endif
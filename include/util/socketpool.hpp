@@ -0,0 +1,113 @@
+/**
+ * @file socketpool.hpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Pool of pre-bound connection sockets
+ * @date 2023-11-22
+ */
+
+#pragma once
+#ifndef TFTP_SOCKETPOOL_HPP
+#     define TFTP_SOCKETPOOL_HPP
+#     include <netinet/in.h>
+
+#     include <cstddef>
+#     include <cstdint>
+#     include <vector>
+
+/**
+ * @brief Pool of pre-bound UDP sockets for new connections
+ * @details Sockets are bound to a random (ephemeral) port and made
+ *          non-blocking once, so that a new transfer gets its socket
+ *          (and TID) without any syscall. Released sockets are reset
+ *          (queued datagrams dropped, pending error cleared, options
+ *          a connection set put back) and go to
+ *          the back of the pool, so a port is reused as late as
+ *          possible – late packets of a finished transfer are then long
+ *          gone, or rejected as coming from an unknown TID.
+ * @note Not thread-safe (one pool per worker).
+ */
+class SocketPool {
+   public:
+     /**
+      * @brief Bound socket
+      */
+     struct Socket {
+          int fd = -1;       /**< Socket file descriptor */
+          uint16_t port = 0; /**< Bound port (TID) */
+     };
+
+     /**
+      * @brief Constructs a new pool
+      * @param capacity Maximum number of idle sockets kept
+      */
+     explicit SocketPool(size_t capacity) : idle(capacity) {}
+
+     /**
+      * @brief Closes the idle sockets
+      */
+     ~SocketPool();
+
+     SocketPool& operator=(SocketPool&& other) = delete;
+     SocketPool& operator=(const SocketPool&) = delete;
+     SocketPool(SocketPool&& other) = delete;
+     SocketPool(const SocketPool&) = delete;
+
+     /**
+      * @brief Binds sockets until the pool is full
+      * @throws std::runtime_error on socket setup error
+      */
+     void fill();
+
+     /**
+      * @brief Takes a socket (a new one if the pool is empty)
+      * @throws std::runtime_error on socket setup error
+      * @return Socket socket (owned by the caller until `release`)
+      */
+     Socket acquire();
+
+     /**
+      * @brief Gives a socket back (closes it if the pool is full)
+      * @param sock Socket from `acquire`
+      */
+     void release(Socket sock);
+
+     /**
+      * @brief Gets the number of idle sockets
+      * @return size_t idle sockets
+      */
+     size_t get_idle() const { return this->count; }
+
+     /**
+      * @brief Creates a non-blocking UDP socket bound to a random port
+      * @throws std::runtime_error on socket setup error
+      * @return Socket socket
+      */
+     static Socket open_socket();
+
+   private:
+     /**
+      * @brief Options of a new socket, which released ones get back
+      */
+     struct Defaults {
+          int pmtudisc = IP_PMTUDISC_WANT; /**< `IP_MTU_DISCOVER` mode */
+          int rcvbuf = 0; /**< `SO_RCVBUF` as set (half the reported) */
+     };
+
+     /**
+      * @brief Gets the options of new sockets
+      * @return const Defaults& options
+      */
+     static const Defaults& defaults();
+
+     /**
+      * @brief Appends a socket to the ring (not full)
+      * @param sock Socket
+      */
+     void push(Socket sock);
+
+     std::vector<Socket> idle; /**< Ring of idle sockets */
+     size_t head = 0;          /**< Ring index of the oldest idle socket */
+     size_t count = 0;         /**< Number of idle sockets */
+};
+
+#endif
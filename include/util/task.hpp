@@ -0,0 +1,106 @@
+/**
+ * @file task.hpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Resumable task (C++20 coroutine) of a connection
+ * @date 2023-11-24
+ */
+
+#pragma once
+#ifndef TFTP_TASK_HPP
+#     define TFTP_TASK_HPP
+#     include <coroutine>
+#     include <exception>
+#     include <utility>
+
+/**
+ * @brief Resumable task – a coroutine resumed by its owner
+ * @details The coroutine starts suspended and runs on `resume` until it
+ *          suspends (`co_await std::suspend_always{}`) or returns.
+ *          Nothing resumes it on its own: the owner decides when to
+ *          (ex. on socket readiness or a timer), so one task type fits
+ *          both event loops and blocking callers. The task owns the
+ *          coroutine frame, which stays allocated until the task is
+ *          destroyed (also after the coroutine returned).
+ * @details An exception escaping the coroutine ends it and is rethrown
+ *          by the `resume` call that ran it.
+ */
+class Task {
+   public:
+     /**
+      * @brief Coroutine promise (see `std::coroutine_traits`)
+      */
+     struct promise_type {
+          std::exception_ptr error; /**< Exception escaping the coroutine */
+
+          Task get_return_object() {
+               return Task(
+                   std::coroutine_handle<promise_type>::from_promise(*this));
+          }
+          std::suspend_always initial_suspend() noexcept { return {}; }
+          std::suspend_always final_suspend() noexcept { return {}; }
+          void return_void() noexcept {}
+          void unhandled_exception() noexcept {
+               this->error = std::current_exception();
+          }
+     };
+
+     /**
+      * @brief Constructs an empty task (no coroutine)
+      */
+     Task() = default;
+
+     /**
+      * @brief Destroys the coroutine frame
+      */
+     ~Task() {
+          if (this->handle) this->handle.destroy();
+     }
+
+     Task& operator=(Task&& other) noexcept {
+          if (this == &other) return *this;
+          if (this->handle) this->handle.destroy();
+          this->handle = std::exchange(other.handle, {});
+          return *this;
+     }
+     Task(Task&& other) noexcept
+         : handle(std::exchange(other.handle, {})) {}
+     Task& operator=(const Task&) = delete;
+     Task(const Task&) = delete;
+
+     /**
+      * @brief Runs the coroutine until it suspends or returns
+      * @throws Whatever escaped the coroutine
+      */
+     void resume() {
+          if (!this->handle || this->handle.done()) return;
+          this->handle.resume();
+          if (auto error = std::exchange(this->handle.promise().error, {}))
+               std::rethrow_exception(error);
+     }
+
+     /**
+      * @brief Checks if there is a coroutine
+      * @return true if there is,
+      * @return false for an empty task
+      */
+     bool valid() const { return static_cast<bool>(this->handle); }
+
+     /**
+      * @brief Checks if the coroutine has returned
+      * @return true if returned (or empty task),
+      * @return false if suspended
+      */
+     bool done() const { return !this->handle || this->handle.done(); }
+
+   private:
+     /**
+      * @brief Constructs a task owning a coroutine
+      * @param handle Coroutine handle
+      */
+     explicit Task(std::coroutine_handle<promise_type> handle)
+         : handle(handle) {}
+
+     std::coroutine_handle<promise_type> handle; /**< Coroutine */
+};
+
+#endif
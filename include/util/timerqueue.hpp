@@ -0,0 +1,138 @@
+/**
+ * @file timerqueue.hpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Deadline timer queue (min-heap) for event loops
+ * @date 2023-11-18
+ */
+
+#pragma once
+#ifndef TFTP_TIMERQUEUE_HPP
+#     define TFTP_TIMERQUEUE_HPP
+#     include <chrono>
+#     include <functional>
+#     include <queue>
+
+#     include "common.hpp"
+
+/**
+ * @brief Deadline timer queue
+ * @details Keeps at most one timer per file descriptor in a min-heap
+ *          ordered by deadline. Re-arming or cancelling a timer only
+ *          bumps the generation of its fd slot, so the old heap entry
+ *          becomes stale and is dropped once it reaches the top.
+ *          Arming is O(log n), cancelling O(1) and looking up
+ *          the next deadline amortised O(1).
+ */
+class TimerQueue {
+   public:
+     using Clock = std::chrono::steady_clock; /**< Timer clock */
+     using TimePoint = Clock::time_point;     /**< Timer deadline */
+
+     /**
+      * @brief An expired timer
+      */
+     struct Expired {
+          int fd;     /**< File descriptor of the timer */
+          void* data; /**< Data pointer given on `arm` */
+     };
+
+     /* === Core methods === */
+
+     /**
+      * @brief Arms (or re-arms) the timer of a file descriptor
+      * @param fd File descriptor
+      * @param data Data pointer to return on expiry
+      * @param deadline Expiry time
+      */
+     void arm(int fd, void* data, TimePoint deadline);
+
+     /**
+      * @brief Cancels the timer of a file descriptor (if armed)
+      * @param fd File descriptor
+      */
+     void cancel(int fd);
+
+     /**
+      * @brief Pops all timers with deadline at or before `now`
+      * @param now Current time
+      * @param out Vector to append expired timers to
+      */
+     void expire(TimePoint now, std::vector<Expired>& out);
+
+     /**
+      * @brief Returns the nearest deadline
+      * @return std::optional<TimePoint> deadline, nullopt if no timer
+      */
+     std::optional<TimePoint> next_deadline();
+
+     /**
+      * @brief Computes a wait timeout that ends at the nearest deadline
+      * @param now Current time
+      * @param max_ms Upper bound in milliseconds (-1 for infinite)
+      * @return int timeout in milliseconds (rounded up, -1 for infinite)
+      */
+     int timeout_ms(TimePoint now, int max_ms);
+
+     /* === Getters === */
+
+     /**
+      * @brief Checks if a file descriptor has an armed timer
+      * @param fd File descriptor
+      * @return true if armed,
+      * @return false otherwise
+      */
+     bool is_armed(int fd) const {
+          return static_cast<size_t>(fd) < this->slots.size()
+                 && this->slots[fd].armed;
+     }
+
+     /**
+      * @brief Gets the number of armed timers
+      * @return size_t count
+      */
+     size_t size() const { return this->n_armed; }
+
+   private:
+     /**
+      * @brief Heap entry
+      */
+     struct Entry {
+          TimePoint deadline; /**< Expiry time */
+          int fd;             /**< File descriptor */
+          uint64_t gen;       /**< Slot generation when armed */
+
+          bool operator>(const Entry& other) const {
+               return this->deadline > other.deadline;
+          }
+     };
+
+     /**
+      * @brief Per-fd timer slot
+      */
+     struct Slot {
+          uint64_t gen = 0;     /**< Generation of the live entry */
+          TimePoint deadline{}; /**< Deadline of the live entry */
+          void* data = nullptr; /**< Data pointer */
+          bool armed = false;   /**< Flag if the slot has a live entry */
+     };
+
+     /**
+      * @brief Checks if a heap entry is the live entry of its slot
+      */
+     bool is_live(const Entry& entry) const {
+          const auto& slot = this->slots[entry.fd];
+          return slot.armed && slot.gen == entry.gen;
+     }
+
+     /**
+      * @brief Drops stale entries from the top of the heap
+      */
+     void drop_stale();
+
+     std::priority_queue<Entry, std::vector<Entry>, std::greater<>>
+         heap;                /**< Deadline min-heap */
+     std::vector<Slot> slots; /**< fd => timer slot */
+     size_t n_armed = 0;      /**< Number of armed timers */
+};
+
+#endif
@@ -0,0 +1,94 @@
+/**
+ * @file tokenbucket.hpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Token bucket (byte rate limiter) for pacing transfers
+ * @date 2023-11-25
+ */
+
+#pragma once
+#ifndef TFTP_TOKENBUCKET_HPP
+#     define TFTP_TOKENBUCKET_HPP
+#     include <chrono>
+
+/**
+ * @brief Token bucket of bytes
+ * @details Fills up with `rate` bytes per second, up to `burst` bytes.
+ *          Sending may overdraw the bucket (a packet is sent whole once
+ *          any tokens are left), the debt delays the next send. A rate
+ *          of 0 makes the bucket unlimited.
+ * @note Not thread-safe (see `EgressLimit` for a shared one).
+ */
+class TokenBucket {
+   public:
+     using Clock = std::chrono::steady_clock; /**< Bucket clock */
+     using TimePoint = Clock::time_point;     /**< Refill time */
+
+     /**
+      * @brief Constructs an unlimited bucket
+      */
+     TokenBucket() = default;
+
+     /**
+      * @brief Constructs a new full bucket
+      * @param rate Fill rate (bytes per second, 0 for unlimited)
+      * @param burst Capacity (bytes)
+      */
+     TokenBucket(double rate, double burst) { this->set_rate(rate, burst); }
+
+     /* === Core methods === */
+
+     /**
+      * @brief Changes the fill rate and capacity (tokens are kept, up to
+      *        the new capacity)
+      * @param rate Fill rate (bytes per second, 0 for unlimited)
+      * @param burst Capacity (bytes)
+      */
+     void set_rate(double rate, double burst);
+
+     /**
+      * @brief Gets the tokens after refilling the bucket up to `now`
+      * @param now Current time
+      * @return double bytes that can be sent (negative while in debt,
+      *         infinity if unlimited)
+      */
+     double available(TimePoint now);
+
+     /**
+      * @brief Takes tokens for sent bytes (may overdraw the bucket)
+      * @param bytes Bytes sent
+      */
+     void consume(double bytes);
+
+     /**
+      * @brief Gets the time the bucket holds `bytes` tokens (as of the
+      *        last refill)
+      * @param bytes Tokens wanted (at most the capacity)
+      * @return TimePoint time, the last refill if unlimited or already
+      *         holding them
+      */
+     TimePoint ready_at(double bytes) const;
+
+     /* === Getters === */
+
+     /**
+      * @brief Checks if the bucket limits the rate
+      * @return true if limited,
+      * @return false if unlimited
+      */
+     bool is_limited() const { return this->rate > 0; }
+
+     /**
+      * @brief Gets the fill rate
+      * @return double bytes per second (0 if unlimited)
+      */
+     double get_rate() const { return this->rate; }
+
+   private:
+     double rate = 0;     /**< Fill rate (bytes per second) */
+     double burst = 0;    /**< Capacity (bytes) */
+     double tokens = 0;   /**< Tokens as of `last` (negative = debt) */
+     TimePoint last{};    /**< Time of the last refill */
+     bool primed = false; /**< Flag if `last` was set by a refill */
+};
+
+#endif
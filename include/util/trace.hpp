@@ -0,0 +1,137 @@
+/**
+ * @file trace.hpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Low-overhead tracing of connections (Chrome trace events)
+ * @date 2023-11-25
+ */
+
+#pragma once
+#ifndef TFTP_TRACE_HPP
+#     define TFTP_TRACE_HPP
+#     include <atomic>
+#     include <chrono>
+#     include <cstdint>
+#     include <string>
+
+#     include "common.hpp"
+
+/**
+ * @brief Whether tracing is compiled in (`make TRACE=0` compiles it
+ *        out, every `Trace::enabled` check is then constant false)
+ */
+#     ifndef TFTP_TRACE
+#          define TFTP_TRACE 1
+#     endif
+
+/**
+ * @brief Tracer of timed spans (connection states, packet I/O, file I/O)
+ * @details Spans are recorded into a ring of the recording thread (no
+ *          locks, no allocations once the ring exists), keeping the
+ *          latest `TFTP_TRACE_EVENTS` of every thread. Tracing is off
+ *          until `start` and can be stopped and started again at any
+ *          time; `write` exports all rings as Chrome trace-event JSON
+ *          (chrome://tracing, Perfetto), one row per connection (TID)
+ *          grouped by thread.
+ * @note Names and categories must be string literals (only the pointers
+ *       are stored).
+ */
+class Trace {
+   public:
+     using Clock = std::chrono::steady_clock;
+
+     /**
+      * @brief Starts (or resumes) tracing
+      */
+     static void start();
+
+     /**
+      * @brief Stops tracing (recorded spans are kept)
+      */
+     static void stop() { Trace::on.store(false, std::memory_order_relaxed); }
+
+     /**
+      * @brief Checks if spans are recorded
+      * @details Guard taking timestamps with this; constant false when
+      *          compiled out.
+      * @return true if tracing,
+      * @return false otherwise
+      */
+     static bool enabled() {
+          return TFTP_TRACE && Trace::on.load(std::memory_order_relaxed);
+     }
+
+     /**
+      * @brief Records a span ending now
+      * @details Spans that began before tracing was (last) started are
+      *          cut at the start (ex. a state entered while stopped).
+      * @param cat Category (ex. "state", "net", "file")
+      * @param name Name
+      * @param id Connection (TID) the span belongs to
+      * @param begin Start of the span
+      * @param bytes Bytes handled, -1 if not applicable
+      */
+     static void span(const char* cat, const char* name, int id,
+                      Clock::time_point begin, int64_t bytes = -1);
+
+     /**
+      * @brief Writes the spans of all threads as Chrome trace-event JSON
+      * @note Call once the traced threads are done (or tracing is
+      *       stopped), the rings are read without locks.
+      * @param path File path
+      * @return true if written,
+      * @return false on error
+      */
+     static bool write(const std::string& path);
+
+   private:
+     static std::atomic<bool> on; /**< Flag if tracing */
+     static std::atomic<Clock::rep>
+         started; /**< Time of the last `start` (ticks of `Clock`) */
+};
+
+/**
+ * @brief Span of a scope, recorded when the scope ends (if tracing)
+ */
+class TraceSpan {
+   public:
+     /**
+      * @brief Starts the span (no-op unless tracing)
+      * @param cat Category (string literal)
+      * @param name Name (string literal)
+      * @param id Connection (TID)
+      */
+     TraceSpan(const char* cat, const char* name, int id)
+         : cat(cat), name(name), id(id), active(Trace::enabled()) {
+          if (this->active) this->begin = Trace::Clock::now();
+     }
+
+     /**
+      * @brief Ends and records the span
+      */
+     ~TraceSpan() {
+          if (this->active)
+               Trace::span(this->cat, this->name, this->id, this->begin,
+                           this->bytes);
+     }
+
+     TraceSpan& operator=(TraceSpan&& other) = delete;
+     TraceSpan& operator=(const TraceSpan&) = delete;
+     TraceSpan(TraceSpan&& other) = delete;
+     TraceSpan(const TraceSpan&) = delete;
+
+     /**
+      * @brief Sets the bytes handled in the span
+      * @param bytes Bytes
+      */
+     void set_bytes(int64_t bytes) { this->bytes = bytes; }
+
+   private:
+     const char* cat;                /**< Category */
+     const char* name;               /**< Name */
+     int id;                         /**< Connection (TID) */
+     bool active;                    /**< Flag if recorded */
+     int64_t bytes = -1;             /**< Bytes handled */
+     Trace::Clock::time_point begin; /**< Start of the span */
+};
+
+#endif
@@ -0,0 +1,106 @@
+/**
+ * @file writebehind.hpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Write-behind buffer of a downloaded file
+ * @date 2023-11-20
+ */
+
+#pragma once
+#ifndef TFTP_WRITEBEHIND_HPP
+#     define TFTP_WRITEBEHIND_HPP
+#     include <sys/types.h>
+
+#     include <condition_variable>
+#     include <memory>
+#     include <mutex>
+#     include <vector>
+
+#     include "util/diskwriter.hpp"
+
+/**
+ * @brief Write-behind buffer of a downloaded file
+ * @details Received data are appended to a chunk buffer, and full chunks
+ *          are written (`pwrite`, one call per chunk) on the `DiskWriter`
+ *          thread, so that a slow disk does not hold up the ACKs. At most
+ *          `depth` chunks are in flight – appending waits for the disk
+ *          beyond that, which bounds the memory of a connection. Without a
+ *          writer, chunks are written right away (still coalesced).
+ * @note A failed write is reported by the next `append` or `finish`
+ *       (as its `errno`); data appended after that are dropped.
+ */
+class WriteBehind {
+   public:
+     /**
+      * @brief Constructs a new write-behind buffer
+      * @param fd File descriptor
+      * @param writer Writer thread, nullptr to write synchronously
+      * @param chunk Size of the written chunks
+      * @param depth Maximum number of chunks in flight (at least 1)
+      * @param start File offset of the first appended byte
+      */
+     WriteBehind(int fd, DiskWriter* writer, size_t chunk, size_t depth,
+                 off_t start = 0);
+
+     /**
+      * @brief Waits for the chunks in flight (data not flushed are lost)
+      */
+     ~WriteBehind();
+
+     WriteBehind& operator=(WriteBehind&& other) = delete;
+     WriteBehind& operator=(const WriteBehind&) = delete;
+     WriteBehind(WriteBehind&& other) = delete;
+     WriteBehind(const WriteBehind&) = delete;
+
+     /**
+      * @brief Appends data to the file
+      * @param data Data
+      * @param len Data length
+      * @return int `errno` of a failed write, 0 if none failed so far
+      */
+     int append(const char* data, size_t len);
+
+     /**
+      * @brief Writes all buffered data and waits until they are written
+      * @return int `errno` of a failed write, 0 on success
+      */
+     int finish();
+
+   private:
+     /**
+      * @brief State shared with the chunks in flight
+      */
+     struct Flight {
+          std::mutex mtx;             /**< Lock of everything below */
+          std::condition_variable cv; /**< Signals a finished chunk */
+          size_t pending = 0;         /**< Chunks in flight */
+          int err = 0;                /**< First failed write `errno` */
+          std::vector<std::vector<char>> spare; /**< Written chunk buffers */
+     };
+
+     /**
+      * @brief Writes the buffered chunk (in the background if possible)
+      */
+     void flush();
+
+     /**
+      * @brief Waits until at most `max` chunks are in flight
+      * @return int `errno` of a failed write, 0 if none failed so far
+      */
+     int wait(size_t max);
+
+     /**
+      * @brief Writes a whole buffer at an offset
+      * @return int `errno` on failure, 0 on success
+      */
+     static int write_all(int fd, const std::vector<char>& buf, off_t off);
+
+     int fd;                       /**< File descriptor */
+     DiskWriter* writer;           /**< Writer thread (optional) */
+     size_t chunk;                 /**< Chunk size */
+     size_t depth;                 /**< Maximum chunks in flight */
+     off_t off = 0;                /**< File offset of the buffered chunk */
+     std::vector<char> buf;        /**< Buffered chunk */
+     std::shared_ptr<Flight> flight; /**< State shared with the writes */
+};
+
+#endif
@@ -0,0 +1,333 @@
+/**
+ * @file loadgen.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Load generator simulating many concurrent TFTP clients
+ * @date 2023-11-25
+ */
+
+#include "bench/loadgen.hpp"
+
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+/* === Constructors === */
+
+TFTPLoadGenerator::TFTPLoadGenerator(const std::string& hostname, int port,
+                                     std::vector<File> files,
+                                     size_t clients)
+    : addr(TFTPClient::resolve(hostname, port)),
+      files(std::move(files)),
+      clients(clients),
+      rng(std::random_device{}()),
+      loop(EventLoop::create(EventLoop::default_backend())),
+      per_file(this->files.size()) {
+     if (this->files.empty()) throw std::runtime_error("No files to get");
+
+     std::vector<double> weights;
+     for (const auto& file : this->files) weights.push_back(file.weight);
+     this->pick = std::discrete_distribution<size_t>(weights.begin(),
+                                                     weights.end());
+}
+
+/* === Core methods === */
+
+/**
+ * @details The weight is taken from after the last `:`, so paths with
+ *          colons need an explicit one (ex. `a:b:1`).
+ */
+std::optional<TFTPLoadGenerator::File> TFTPLoadGenerator::parse_file(
+    const std::string& str) {
+     size_t colon = str.rfind(':');
+     if (colon == std::string::npos) return File{str};
+
+     std::string path = str.substr(0, colon);
+     char* end = nullptr;
+     double weight = std::strtod(str.c_str() + colon + 1, &end);
+     if (path.empty() || end == str.c_str() + colon + 1 || *end != '\0'
+         || !(weight > 0) || !std::isfinite(weight))
+          return std::nullopt;
+     return File{path, weight};
+}
+
+/**
+ * @details Clients are started on schedule (those over the cap as soon
+ *          as it lets them) and their events and retransmit deadlines
+ *          are waited for on the shared event loop, until all of them
+ *          finished. Completion times are taken from the start of a
+ *          client, not its arrival. On SIGINT, no more clients start
+ *          and the running ones are terminated.
+ */
+size_t TFTPLoadGenerator::run() {
+     this->start = std::chrono::steady_clock::now();
+     auto next_arrival = this->start;
+     auto last_report = this->start;
+
+     while (this->n_done < this->clients) {
+          auto now = std::chrono::steady_clock::now();
+
+          /* Interrupted => terminate running transfers */
+          if (TFTPClient::is_interrupted()) {
+               while (!this->active.empty())
+                    this->conn_exec(this->active.begin()->second.conn.get());
+               break;
+          }
+
+          /* Start clients that arrived (up to the cap) */
+          auto can_launch = [this]() {
+               return this->launched < this->clients
+                      && (this->max_active == 0
+                          || this->active.size() < this->max_active);
+          };
+          while (can_launch() && next_arrival <= now) {
+               this->launch();
+               next_arrival += this->next_gap();
+          }
+
+          /* Wait for events, at most until the next arrival */
+          int timeout_ms = 1000;
+          if (can_launch())
+               timeout_ms = std::clamp<int>(
+                   std::chrono::ceil<std::chrono::milliseconds>(
+                       next_arrival - now)
+                       .count(),
+                   0, timeout_ms);
+          if (this->loop->wait(timeout_ms) > 0) {
+               for (const auto& event : this->loop->get_events()) {
+                    auto* conn = static_cast<TFTPClient*>(event.data);
+                    if (!conn || !this->active.count(conn->get_fd()))
+                         continue;  // Removed earlier in this round
+                    this->conn_exec(conn);
+               }
+          }
+
+          /* Progress (every second) */
+          now = std::chrono::steady_clock::now();
+          if (now - last_report >= std::chrono::seconds(1)) {
+               this->report_progress();
+               last_report = now;
+          }
+     }
+
+     this->end = std::chrono::steady_clock::now();
+     this->report_summary();
+     return this->total.failed + this->err_local;
+}
+
+/* === Helper methods === */
+
+/**
+ * @details A client failing to start (ex. out of sockets) is counted as
+ *          a local failure, not as a transfer.
+ */
+void TFTPLoadGenerator::launch() {
+     this->launched++;
+     size_t file = this->pick(this->rng);
+
+     try {
+          auto conn = std::make_unique<TFTPClient>(
+              this->addr, TFTP_DISCARD_PATH, this->files[file].path,
+              this->options);
+          conn->set_format(this->format);
+          conn->set_loss(this->loss);
+          conn->sock_init();
+
+          TFTPClient* ptr = conn.get();
+          int fd = conn->get_fd();
+          this->active.emplace(
+              fd, Running{std::move(conn), file,
+                          std::chrono::steady_clock::now()});
+          this->peak_active = std::max(this->peak_active, this->active.size());
+          this->loop->add(fd, ptr);
+          this->conn_exec(ptr);  // Send the request
+     } catch (const std::exception& e) {
+          Logger::glob_err(e.what());
+          this->err_local++;
+          this->n_done++;
+     }
+}
+
+void TFTPLoadGenerator::conn_exec(TFTPClient* conn) {
+     conn->exec(); /** @see TFTPConnectionBase::exec */
+
+     if (!conn->is_running()) return this->finish(conn);
+
+     auto deadline = conn->get_deadline();
+     if (deadline.has_value())
+          this->loop->arm_timer(conn->get_fd(), conn, *deadline);
+     else
+          this->loop->cancel_timer(conn->get_fd());
+}
+
+void TFTPLoadGenerator::finish(TFTPClient* conn) {
+     int fd = conn->get_fd();
+     this->loop->remove(fd);
+
+     auto it = this->active.find(fd);
+     if (it == this->active.end()) return;
+
+     const ConnStats& stats = conn->get_stats();
+     bool failed = conn->is_errored();
+     auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                   std::chrono::steady_clock::now() - it->second.start)
+                   .count();
+     this->total.add(stats, failed, us);
+     this->per_file[it->second.file].add(stats, failed, us);
+     if (stats.err_recv.has_value()) this->err_recv[*stats.err_recv]++;
+     if (stats.err_sent.has_value()) this->err_sent[*stats.err_sent]++;
+
+     this->active.erase(it);  // Closes the socket
+     this->n_done++;
+}
+
+void TFTPLoadGenerator::Results::add(const ConnStats& stats, bool failed,
+                                     uint64_t us) {
+     (failed ? this->failed : this->ok)++;
+     this->bytes += stats.bytes_rx;
+     this->blocks += stats.blocks_rx;
+     this->retransmits += stats.retransmits;
+     this->timeouts += stats.timeouts;
+     this->dup_rx += stats.dup_rx;
+     this->dropped += stats.dropped;
+     if (!failed) this->completion_us.record(us);
+}
+
+/**
+ * @details Gaps of a Poisson process are exponentially distributed.
+ */
+std::chrono::nanoseconds TFTPLoadGenerator::next_gap() {
+     if (this->rate <= 0) return std::chrono::nanoseconds(0);
+     std::exponential_distribution<double> gap(this->rate);
+     return std::chrono::duration_cast<std::chrono::nanoseconds>(
+         std::chrono::duration<double>(gap(this->rng)));
+}
+
+void TFTPLoadGenerator::report_progress() const {
+     std::ostringstream line;
+     line << "Progress: " << this->n_done << "/" << this->clients
+          << " done, " << this->active.size() << " running, "
+          << this->total.failed + this->err_local << " failed";
+     Logger::glob_op(line.str());
+}
+
+/**
+ * @brief Formats a duration in microseconds as milliseconds
+ */
+static std::string ms(uint64_t us) {
+     std::ostringstream out;
+     out << std::fixed << std::setprecision(2) << us / 1000.0 << " ms";
+     return out.str();
+}
+
+/**
+ * @details Printed to stdout, after the pending logs.
+ */
+void TFTPLoadGenerator::report_summary() const {
+     double secs = std::chrono::duration<double>(this->end - this->start)
+                       .count();
+     const auto& hist = this->total.completion_us;
+     std::ostringstream out;
+     out << std::fixed << std::setprecision(2);
+
+     out << "Transfers: " << this->total.ok << " ok, " << this->total.failed
+         << " failed, " << this->err_local << " not started in " << secs
+         << " s (peak " << this->peak_active << " running); "
+         << this->total.bytes / 1e6 << " MB ("
+         << (secs > 0 ? this->total.bytes / 1e6 / secs : 0.0) << " MB/s)\n";
+
+     out << "Completion: min " << ms(hist.get_min()) << ", p50 "
+         << ms(hist.percentile(50)) << ", p90 " << ms(hist.percentile(90))
+         << ", p99 " << ms(hist.percentile(99)) << ", p99.9 "
+         << ms(hist.percentile(99.9)) << ", max " << ms(hist.get_max())
+         << "\n";
+     for (size_t i = 0; i < this->files.size(); i++) {
+          const Results& file = this->per_file[i];
+          out << "  " << this->files[i].path << ": " << file.ok << " ok, "
+              << file.failed << " failed, p50 "
+              << ms(file.completion_us.percentile(50)) << ", p99 "
+              << ms(file.completion_us.percentile(99)) << "\n";
+     }
+
+     uint64_t blocks = std::max<uint64_t>(this->total.blocks, 1);
+     out << "Retransmits: " << this->total.retransmits << " sent ("
+         << 1000.0 * this->total.retransmits / blocks
+         << " per 1000 blocks), " << this->total.dup_rx
+         << " duplicate DATA received, " << this->total.timeouts
+         << " timeouts, " << this->total.dropped << " packets dropped\n";
+
+     out << "Errors:";
+     for (const auto& [code, n] : this->err_recv)
+          out << " " << n << "x ERROR " << code << " received,";
+     for (const auto& [code, n] : this->err_sent)
+          out << " " << n << "x ERROR " << code << " sent,";
+     out << " " << this->err_local << " local\n";
+
+     Logger::flush();  // Do not interleave with pending logs
+     std::cout << out.str() << std::flush;
+}
+
+/**
+ * @brief Formats a results object (JSON)
+ */
+static void put_results(std::ostringstream& out, uint64_t ok,
+                        uint64_t failed, const HdrHistogram& hist) {
+     out << "\"ok\": " << ok << ", \"failed\": " << failed
+         << ", \"completion_us\": {\"min\": " << hist.get_min()
+         << ", \"mean\": " << hist.get_mean()
+         << ", \"p50\": " << hist.percentile(50)
+         << ", \"p90\": " << hist.percentile(90)
+         << ", \"p99\": " << hist.percentile(99)
+         << ", \"p999\": " << hist.percentile(99.9)
+         << ", \"max\": " << hist.get_max() << "}";
+}
+
+/**
+ * @brief Formats per-code ERROR counts (JSON)
+ */
+static void put_codes(std::ostringstream& out,
+                      const std::map<uint16_t, uint64_t>& codes) {
+     out << "{";
+     for (auto it = codes.begin(); it != codes.end(); it++)
+          out << (it == codes.begin() ? "" : ", ") << "\"" << it->first
+              << "\": " << it->second;
+     out << "}";
+}
+
+/**
+ * @details File paths are written as they are (no escaping), like the
+ *          rest of the reports.
+ */
+std::string TFTPLoadGenerator::to_json() const {
+     double secs = std::chrono::duration<double>(this->end - this->start)
+                       .count();
+     std::ostringstream out;
+     out << std::fixed << std::setprecision(3);
+
+     out << "{\"clients\": " << this->clients << ", \"rate\": " << this->rate
+         << ", \"loss\": " << this->loss << ", \"secs\": " << secs
+         << ", \"peak_active\": " << this->peak_active
+         << ", \"bytes\": " << this->total.bytes
+         << ", \"blocks\": " << this->total.blocks
+         << ", \"retransmits\": " << this->total.retransmits
+         << ", \"timeouts\": " << this->total.timeouts
+         << ", \"dup_rx\": " << this->total.dup_rx
+         << ", \"dropped\": " << this->total.dropped << ", ";
+     put_results(out, this->total.ok, this->total.failed,
+                 this->total.completion_us);
+
+     out << ", \"errors\": {\"received\": ";
+     put_codes(out, this->err_recv);
+     out << ", \"sent\": ";
+     put_codes(out, this->err_sent);
+     out << ", \"local\": " << this->err_local << "}, \"files\": [";
+
+     for (size_t i = 0; i < this->files.size(); i++) {
+          const Results& file = this->per_file[i];
+          out << (i ? ", " : "") << "{\"path\": \"" << this->files[i].path
+              << "\", \"weight\": " << this->files[i].weight << ", ";
+          put_results(out, file.ok, file.failed, file.completion_us);
+          out << "}";
+     }
+     out << "]}\n";
+     return out.str();
+}
@@ -0,0 +1,228 @@
+/**
+ * @file main.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Entry point of the TFTP load generator.
+ * @date 2023-11-25
+ */
+
+#include <sys/resource.h>
+
+#include <fstream>
+
+#include "bench/loadgen.hpp"
+#include "common.hpp"
+
+/**
+ * @brief Print help message
+ */
+void send_help() {
+     std::cout << "TFTP-Bench (ISA 2023 by Onegen)" << std::endl
+               << "Usage: tftp-bench <-h hostname> [-p port] "
+                  "<-f path[:weight]>... [-n clients]"
+               << std::endl
+               << "                  [-a rate] [-c max] [-o opt val]... "
+                  "[-m mode] [-l loss] [-s seed]"
+               << std::endl
+               << "                  [-J path] [-v]..." << std::endl
+               << std::endl
+               << " Option          Meaning" << std::endl
+               << "  -h              IP or hostname of the TFTP server"
+               << std::endl
+               << "  -p port         Port to connect to (default: 69)"
+               << std::endl
+               << "  -f path[:w]     File to download, weight w in the mix "
+                  "(default: 1)"
+               << std::endl
+               << "  -n clients      Number of clients in total (default: "
+                  "100)"
+               << std::endl
+               << "  -a rate         Clients arriving per second, Poisson "
+                  "(default: 0 = all at once)"
+               << std::endl
+               << "  -c max          Clients running at once at most "
+                  "(default: no limit)"
+               << std::endl
+               << "  -o opt val      Set TFTP option of all transfers (ex. "
+                  "blksize 1428)"
+               << std::endl
+               << "  -m mode         Transfer mode: octet or netascii "
+                  "(default: octet)"
+               << std::endl
+               << "  -l loss         Drop received packets with this "
+                  "probability (ex. 0.01)"
+               << std::endl
+               << "  -s seed         Seed of the arrivals and file picks"
+               << std::endl
+               << "  -J path         Also write the results as JSON to path"
+               << std::endl
+               << "  -v              Log transfers (-vv: also packets)"
+               << std::endl;
+}
+
+/**
+ * @brief Raises the open file limit to its maximum (a socket per client)
+ */
+void raise_fd_limit() {
+     struct rlimit lim {};
+     if (getrlimit(RLIMIT_NOFILE, &lim) != 0 || lim.rlim_cur == lim.rlim_max)
+          return;
+     lim.rlim_cur = lim.rlim_max;
+     if (setrlimit(RLIMIT_NOFILE, &lim) != 0)
+          Logger::glob_err("Failed to raise the open file limit");
+}
+
+int main(int argc, char* argv[]) {
+     /* No options – send help */
+     if (argc == 1) {
+          send_help();
+          return EXIT_SUCCESS;
+     }
+
+     std::string usage
+         = "  Usage: tftp-bench <-h hostname> [-p port] <-f path[:weight]>... "
+           "[-n clients] [-a rate] [-c max] [-o opt val]... [-m mode] "
+           "[-l loss] [-s seed] [-J path] [-v]...\n"
+           "   Try 'tftp-bench' (no opts) for more info.";
+
+     /* Parse command line options */
+     int opt;
+     int port = TFTP_STD_PORT;
+     std::string hostname;
+     std::vector<TFTPLoadGenerator::File> files;
+     long clients = 100;
+     double rate = 0;
+     long max_active = 0;
+     double loss = 0;
+     std::optional<uint64_t> seed;
+     std::string json_path;
+     std::vector<std::pair<std::string, std::string>> tftpOptions;
+     std::optional<TFTPDataFormat> format = TFTPDataFormat::Octet;
+     int verbosity = static_cast<int>(LogLevel::Error);
+     try {
+          while ((opt = getopt(argc, argv, "h:p:f:n:a:c:o:m:l:s:J:v")) != -1) {
+               switch (opt) {
+                    case 'h':
+                         hostname = optarg;
+                         break;
+                    case 'p':
+                         port = std::stoi(optarg);
+                         break;
+                    case 'f': {
+                         auto file = TFTPLoadGenerator::parse_file(optarg);
+                         if (!file.has_value()) {
+                              std::cerr << "!ERR! Invalid file weight: "
+                                        << optarg << std::endl
+                                        << usage << std::endl;
+                              return EXIT_FAILURE;
+                         }
+                         files.push_back(*file);
+                         break;
+                    }
+                    case 'n':
+                         clients = std::stol(optarg);
+                         break;
+                    case 'a':
+                         rate = std::stod(optarg);
+                         break;
+                    case 'c':
+                         max_active = std::stol(optarg);
+                         break;
+                    case 'o':
+                         if (optind < argc && argv[optind][0] != '-') {
+                              tftpOptions.emplace_back(optarg, argv[optind]);
+                              optind++;
+                         } else {
+                              std::cerr << "!ERR! Option -o requires two "
+                                           "arguments"
+                                        << std::endl
+                                        << usage << std::endl;
+                              return EXIT_FAILURE;
+                         }
+                         break;
+                    case 'm':
+                         format = TFTPConnectionBase::parse_format(optarg);
+                         break;
+                    case 'l':
+                         loss = std::stod(optarg);
+                         break;
+                    case 's':
+                         seed = std::stoull(optarg);
+                         break;
+                    case 'J':
+                         json_path = optarg;
+                         break;
+                    case 'v':
+                         verbosity++;
+                         break;
+                    default:
+                         std::cerr << usage << std::endl;
+                         return EXIT_FAILURE;
+               }
+          }
+     } catch (const std::exception&) {
+          std::cerr << "!ERR! Invalid number: " << optarg << std::endl
+                    << usage << std::endl;
+          return EXIT_FAILURE;
+     }
+
+     /* Validate options */
+     if (hostname.empty()) {
+          std::cerr << "!ERR! Hostname not specified!" << std::endl
+                    << usage << std::endl;
+          return EXIT_FAILURE;
+     }
+
+     if (files.empty()) {
+          std::cerr << "!ERR! No file to download (-f) specified!"
+                    << std::endl
+                    << usage << std::endl;
+          return EXIT_FAILURE;
+     }
+
+     if (clients < 1 || max_active < 0 || !(rate >= 0)) {
+          std::cerr << "!ERR! Invalid number of clients, cap or rate!"
+                    << std::endl
+                    << usage << std::endl;
+          return EXIT_FAILURE;
+     }
+
+     if (!(loss >= 0 && loss < 1)) {
+          std::cerr << "!ERR! Invalid loss (expected 0 <= loss < 1)!"
+                    << std::endl
+                    << usage << std::endl;
+          return EXIT_FAILURE;
+     }
+
+     if (!format.has_value()) {
+          std::cerr << "!ERR! Invalid mode (expected octet or netascii)!"
+                    << std::endl
+                    << usage << std::endl;
+          return EXIT_FAILURE;
+     }
+
+     Logger::set_level(static_cast<LogLevel>(
+         std::min(verbosity, static_cast<int>(LogLevel::Packet))));
+     raise_fd_limit();
+
+     try {
+          TFTPLoadGenerator bench(hostname, port, std::move(files), clients);
+          bench.set_rate(rate);
+          bench.set_max_active(max_active);
+          bench.set_options(tftpOptions);
+          bench.set_format(*format);
+          bench.set_loss(loss);
+          if (seed.has_value()) bench.set_seed(*seed);
+
+          size_t failed = bench.run();
+          if (!json_path.empty()) {
+               std::ofstream out(json_path);
+               out << bench.to_json();
+               if (!out)
+                    throw std::runtime_error("Failed to write " + json_path);
+          }
+          return failed > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+     } catch (const std::exception& e) {
+          std::cerr << "!ERR! " << e.what() << std::endl;
+          return EXIT_FAILURE;
+     }
+}
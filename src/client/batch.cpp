@@ -0,0 +1,263 @@
+/**
+ * @file batch.cpp
+ * @author Onegen Something (xkrame00@vutbr.cz)
+ * @brief Concurrent multi-file TFTP client
+ * @date 2023-11-20
+ */
+
+#include "client/batch.hpp"
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+/* === Constructors === */
+
+TFTPBatchClient::TFTPBatchClient(const std::string& hostname, int port,
+                                 std::vector<Job> jobs, size_t parallel)
+    : addr(TFTPClient::resolve(hostname, port)),
+      jobs(std::move(jobs)),
+      parallel(std::max<size_t>(parallel, 1)),
+      loop(EventLoop::create(EventLoop::default_backend())),
+      results(this->jobs.size()) {}
+
+/* === Core methods === */
+
+/**
+ * @details Lines are split on whitespace, so paths with spaces are not
+ *          supported (as in the usual `tftp` batch scripts).
+ */
+std::vector<TFTPBatchClient::Job> TFTPBatchClient::parse_manifest(
+    const std::string& path) {
+     std::ifstream in(path);
+     if (!in) throw std::runtime_error("Failed to read manifest " + path);
+
+     std::vector<Job> jobs;
+     std::string line;
+     for (size_t line_n = 1; std::getline(in, line); line_n++) {
+          std::istringstream fields(line);
+          std::string verb, first, second, extra;
+          fields >> verb;
+          if (verb.empty() || verb[0] == '#') continue;
+
+          fields >> first >> second >> extra;
+          if (second.empty() || !extra.empty()
+              || (verb != "get" && verb != "put"))
+               throw std::runtime_error(
+                   path + ":" + std::to_string(line_n)
+                   + ": expected `get <remote> <local>` or `put <local> "
+                     "<remote>`");
+
+          if (verb == "get")
+               jobs.push_back({TFTPRequestType::Read, first, second});
+          else
+               jobs.push_back({TFTPRequestType::Write, second, first});
+     }
+
+     return jobs;
+}
+
+/**
+ * @details Keeps up to `parallel` transfers running and waits for their
+ *          events (or retransmit deadlines) on the shared event loop,
+ *          until all jobs finished. On SIGINT, no more jobs start and
+ *          the running transfers are terminated (each sends an ERROR).
+ */
+size_t TFTPBatchClient::run() {
+     this->start = std::chrono::steady_clock::now();
+     auto last_report = this->start;
+
+     while (this->n_done < this->jobs.size()) {
+          /* Start jobs up to the parallelism limit */
+          while (!TFTPClient::is_interrupted()
+                 && this->active.size() < this->parallel
+                 && this->next < this->jobs.size())
+               this->launch();
+
+          /* Interrupted => terminate running transfers */
+          if (TFTPClient::is_interrupted()) {
+               while (!this->active.empty())
+                    this->conn_exec(this->active.begin()->second.conn.get());
+               break;
+          }
+
+          /* Wait for events (or the nearest retransmit deadline) */
+          if (this->loop->wait(1000) > 0) {
+               for (const auto& event : this->loop->get_events()) {
+                    auto* conn = static_cast<TFTPClient*>(event.data);
+                    if (!conn || !this->active.count(conn->get_fd()))
+                         continue;  // Removed earlier in this round
+                    this->conn_exec(conn);
+               }
+          }
+
+          /* Progress (every second) */
+          auto now = std::chrono::steady_clock::now();
+          if (now - last_report >= std::chrono::seconds(1)) {
+               this->report_progress();
+               last_report = now;
+          }
+     }
+
+     this->report_summary();
+
+     size_t failed = 0;
+     for (const auto& result : this->results)
+          failed += !result.done || result.failed;
+     return failed;
+}
+
+std::vector<TFTPBatchClient::Job> TFTPBatchClient::split(
+    const std::string& remote, const std::string& local, uint64_t size,
+    size_t parts) {
+     parts = std::min<uint64_t>(std::max<size_t>(parts, 1),
+                                std::max<uint64_t>(size, 1));
+     uint64_t len = size / parts, extra = size % parts;  // First ones +1 B
+
+     std::vector<Job> jobs;
+     uint64_t start = 0;
+     for (size_t i = 0; i < parts; i++) {
+          uint64_t end = start + len + (i < extra ? 1 : 0);
+          jobs.push_back({TFTPRequestType::Read, remote, local,
+                          std::make_pair(start, end)});
+          start = end;
+     }
+     return jobs;
+}
+
+/* === Helper methods === */
+
+/**
+ * @details A job failing before its transfer starts (ex. existing
+ *          destination, missing upload source) is finished right away.
+ */
+void TFTPBatchClient::launch() {
+     size_t idx = this->next++;
+     const Job& job = this->jobs[idx];
+
+     try {
+          std::unique_ptr<TFTPClient> conn;
+          if (job.type == TFTPRequestType::Read) {
+               conn = std::make_unique<TFTPClient>(this->addr, job.local,
+                                                   job.remote, this->options);
+               if (job.range.has_value())
+                    conn->set_range(job.range->first, job.range->second);
+               else if (this->resume)
+                    conn->set_resume();
+          } else {
+               int src_fd = open(job.local.c_str(), O_RDONLY);
+               if (src_fd < 0)
+                    throw std::runtime_error("Failed to open " + job.local
+                                             + ": " + strerror(errno));
+               conn = std::make_unique<TFTPClient>(
+                   this->addr, job.remote, std::nullopt, this->options);
+               conn->set_source(src_fd);
+          }
+          conn->set_rollover(this->rollover);
+          conn->set_format(this->format);
+          conn->sock_init();
+
+          TFTPClient* ptr = conn.get();
+          int fd = conn->get_fd();
+          this->active.emplace(
+              fd, Running{std::move(conn), idx,
+                          std::chrono::steady_clock::now()});
+          this->loop->add(fd, ptr);
+          this->conn_exec(ptr);  // Send the request
+     } catch (const std::exception& e) {
+          Logger::glob_err(e.what());
+          this->results[idx] = {true, true, e.what(), 0, 0};
+          this->n_done++;
+     }
+}
+
+void TFTPBatchClient::conn_exec(TFTPClient* conn) {
+     conn->exec(); /** @see TFTPConnectionBase::exec */
+
+     if (!conn->is_running()) return this->finish(conn);
+
+     auto deadline = conn->get_deadline();
+     if (deadline.has_value())
+          this->loop->arm_timer(conn->get_fd(), conn, *deadline);
+     else
+          this->loop->cancel_timer(conn->get_fd());
+}
+
+void TFTPBatchClient::finish(TFTPClient* conn) {
+     int fd = conn->get_fd();
+     this->loop->remove(fd);
+
+     auto it = this->active.find(fd);
+     if (it == this->active.end()) return;
+
+     const ConnStats& stats = conn->get_stats();
+     Result& result = this->results[it->second.job];
+     result.done = true;
+     result.failed = conn->is_errored();
+     result.bytes = stats.bytes_tx + stats.bytes_rx;
+     result.secs = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - it->second.start)
+                       .count();
+     if (stats.err_recv.has_value())
+          result.error = "ERROR " + std::to_string(*stats.err_recv)
+                         + " received";
+     else if (stats.err_sent.has_value())
+          result.error = "ERROR " + std::to_string(*stats.err_sent) + " sent";
+
+     this->active.erase(it);  // Closes the socket (and the files)
+     this->n_done++;
+}
+
+void TFTPBatchClient::report_progress() const {
+     uint64_t bytes = 0;
+     for (const auto& result : this->results) bytes += result.bytes;
+     for (const auto& [fd, running] : this->active) {
+          const ConnStats& stats = running.conn->get_stats();
+          bytes += stats.bytes_tx + stats.bytes_rx;
+     }
+
+     std::ostringstream line;
+     line << "Progress: " << this->n_done << "/" << this->jobs.size()
+          << " done, " << this->active.size() << " running, "
+          << std::fixed << std::setprecision(1) << bytes / 1e6 << " MB";
+     Logger::glob_op(line.str());
+}
+
+/**
+ * @details Failed (or not run) jobs are listed one per line, followed
+ *          by the totals. Printed to stdout, after the pending logs.
+ */
+void TFTPBatchClient::report_summary() const {
+     size_t failed = 0, skipped = 0;
+     uint64_t bytes = 0;
+     std::ostringstream out;
+     out << std::fixed << std::setprecision(2);
+
+     for (size_t i = 0; i < this->jobs.size(); i++) {
+          const Job& job = this->jobs[i];
+          const Result& result = this->results[i];
+          bytes += result.bytes;
+          if (result.done && !result.failed) continue;
+
+          (result.done ? failed : skipped)++;
+          out << (result.done ? "FAILED " : "NOT RUN ")
+              << (job.type == TFTPRequestType::Read ? "get " : "put ")
+              << job.remote << " " << job.local;
+          if (job.range.has_value())
+               out << " [" << job.range->first << "-" << job.range->second
+                   << "]";
+          if (!result.error.empty()) out << " (" << result.error << ")";
+          out << "\n";
+     }
+
+     double secs = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - this->start)
+                       .count();
+     out << "Summary: " << this->jobs.size() - failed - skipped << " ok, "
+         << failed << " failed, " << skipped << " not run; " << bytes / 1e6
+         << " MB in " << secs << " s ("
+         << (secs > 0 ? bytes / 1e6 / secs : 0.0) << " MB/s)\n";
+
+     Logger::flush();  // Do not interleave with pending logs
+     std::cout << out.str() << std::flush;
+}
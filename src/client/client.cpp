@@ -14,13 +14,13 @@
  * @details Atomic flag indicating whether SIGINT was recieved,
  * used to gracefully terminate the client (and send ERROR).
  */
-std::atomic<bool> quit(false);
+static std::atomic<bool> quit(false);
 
 /**
  * @brief Sets the quit flag to true on SIGINT.
  * @param signal - signal number
  */
-void signal_handler(int signal) {
+static void signal_handler(int signal) {
      (void)signal;
      quit.store(true);
 }
@@ -31,16 +31,16 @@ TFTPClient::TFTPClient(
     const std::string &hostname, int port, const std::string &destpath,
     const std::optional<std::string> &filepath,
     const std::vector<std::pair<std::string, std::string>> &options)
-    : hostname(hostname), port(port), destpath(destpath), filepath(filepath) {
+    : TFTPClient(resolve(hostname, port), destpath, filepath, options) {}
+
+TFTPClient::TFTPClient(
+    const sockaddr_in &addr, const std::string &destpath,
+    const std::optional<std::string> &filepath,
+    const std::vector<std::pair<std::string, std::string>> &options)
+    : destpath(destpath), filepath(filepath) {
      this->unset_addr_static();
      this->opts = options;
-
-     /* Verify hostname */
-     if (hostname.empty()) throw std::runtime_error("Invalid hostname");
-
-     /* Verify port number */
-     if (port < 1 || port > 65535)
-          throw std::runtime_error("Invalid port number");
+     this->rem_addr = addr;
 
      /* Verify destination path */
      if (destpath.empty()) throw std::runtime_error("Invalid destination path");
@@ -50,8 +50,9 @@ TFTPClient::TFTPClient(
           if (filepath.value().empty())
                throw std::runtime_error("Invalid filepath");
 
-          /* Check if destination file exists */
-          if (access(destpath.c_str(), F_OK) != -1)
+          /* Check if destination file exists (`/dev/null` discards) */
+          this->discard = destpath == TFTP_DISCARD_PATH;
+          if (!this->discard && access(destpath.c_str(), F_OK) != -1)
                throw std::runtime_error("File " + destpath + " already exists");
 
           this->type = TFTPRequestType::Read;
@@ -60,30 +61,6 @@ TFTPClient::TFTPClient(
           this->type = TFTPRequestType::Write;
      }
 
-     /* Resolve hostname and get host */
-     /** @see
-      * https://moodle.vut.cz/pluginfile.php/550189/mod_folder/content/0/IPK2022-23L-03-PROGRAMOVANI.pdf#page=18
-      */
-     this->host = gethostbyname(this->hostname.c_str());
-     if (this->host == NULL)
-          throw std::runtime_error("Host not found: " + this->hostname);
-
-     memset(reinterpret_cast<char *>(&(this->rem_addr)), 0, this->rem_addr_len);
-     this->rem_addr.sin_family = AF_INET;
-     this->rem_addr.sin_port = htons(this->port);
-     memcpy(this->host->h_addr,
-            reinterpret_cast<char *>(&(this->rem_addr).sin_addr.s_addr),
-            this->host->h_length);
-
-     /* Convert hostname to IP address */
-     /** @see https://beej.us/guide/bgnet/pdf/bgnet_a4_c_1.pdf#page=82 */
-     int ip_vld = inet_pton(AF_INET, this->hostname.c_str(),
-                            &(this->rem_addr.sin_addr));
-     if (ip_vld == 0) throw std::runtime_error("Hostname IP is not valid");
-     if (ip_vld < 0)
-          throw std::runtime_error("Failed to convert IP address: "
-                                   + std::string(strerror(errno)));
-
      /* Set up signal handler */
      /** @see https://gist.github.com/aspyct/3462238 */
      struct sigaction sig_act {};
@@ -93,6 +70,107 @@ TFTPClient::TFTPClient(
      sigaction(SIGINT, &sig_act, NULL);
 }
 
+TFTPClient::~TFTPClient() {
+     this->read_ahead.reset();  // Stops reading before closing
+     if (this->src_fd != STDIN_FILENO) close(this->src_fd);
+
+     /* Put a completed resumed download in place (cut stale data off) */
+     if (!this->resume || this->is_running() || this->is_errored()) return;
+     off_t size = static_cast<off_t>(this->range_start + this->stats.bytes_rx);
+     if (this->format == TFTPDataFormat::Octet
+         && ftruncate(this->file_fd, size) != 0)
+          log_error("Failed to truncate " + this->file_name);
+     if (rename(this->file_name.c_str(), this->destpath.c_str()) != 0)
+          log_error("Failed to rename " + this->file_name + " to "
+                    + this->destpath);
+}
+
+/* === Public methods === */
+
+/**
+ * @details Uses `getaddrinfo` (IPv4 only), which also takes dotted IPv4
+ *          addresses as they are. Resolved once, the address can be
+ *          shared by any number of clients (see `TFTPBatchClient`).
+ * @see https://beej.us/guide/bgnet/pdf/bgnet_a4_c_1.pdf#page=82
+ */
+sockaddr_in TFTPClient::resolve(const std::string &hostname, int port) {
+     /* Verify hostname */
+     if (hostname.empty()) throw std::runtime_error("Invalid hostname");
+
+     /* Verify port number */
+     if (port < 1 || port > 65535)
+          throw std::runtime_error("Invalid port number");
+
+     struct addrinfo hints {};
+     hints.ai_family = AF_INET;
+     hints.ai_socktype = SOCK_DGRAM;
+     struct addrinfo *res = nullptr;
+     if (getaddrinfo(hostname.c_str(), nullptr, &hints, &res) != 0
+         || res == nullptr)
+          throw std::runtime_error("Host not found: " + hostname);
+
+     sockaddr_in addr = *reinterpret_cast<sockaddr_in *>(res->ai_addr);
+     freeaddrinfo(res);
+     addr.sin_port = htons(port);
+     return addr;
+}
+
+/**
+ * @details The previous source (unless stdin) is closed.
+ */
+void TFTPClient::set_source(int fd) {
+     this->read_ahead.reset();
+     this->src_map.reset();
+     this->src_opened = false;
+     this->src_off = 0;
+     if (this->src_fd != STDIN_FILENO) close(this->src_fd);
+     this->src_fd = fd;
+     this->na_encoder = NetASCII::Encoder(fd);
+}
+
+void TFTPClient::set_resume() {
+     this->part = this->resume = true;
+     this->file_name = part_path(this->destpath);
+}
+
+void TFTPClient::set_range(uint64_t start, uint64_t end) {
+     this->part = true;
+     this->file_name = part_path(this->destpath);
+     this->range_req = std::make_pair(start, end);
+     this->opts.emplace_back(
+         "range", std::to_string(start) + "-" + std::to_string(end));
+}
+
+/**
+ * @details The probe asks for the file with `tsize` (RFC 2349), which
+ *          the server answers with the file size in its OACK, and then
+ *          aborts the transfer with an option negotiation ERROR (as
+ *          RFC 2347 lets the client do). A server not answering with
+ *          `tsize` leaves the size unknown.
+ * @details It asks for an empty `range` too, so that the server does
+ *          not refuse a file with more blocks than the block numbers
+ *          cover ("File too big") – the very files worth splitting.
+ */
+std::optional<uint64_t> TFTPClient::probe_size(
+    const sockaddr_in &addr, const std::string &destpath,
+    const std::string &filepath,
+    std::vector<std::pair<std::string, std::string>> options) {
+     std::erase_if(options, [](const auto &opt) {
+          return strcasecmp(opt.first.c_str(), "tsize") == 0
+                 || strcasecmp(opt.first.c_str(), "range") == 0;
+     });
+     options.emplace_back("tsize", "0");
+     options.emplace_back("range", "0-0");
+
+     TFTPClient client(addr, destpath, filepath, options);
+     client.probe = true;
+     client.run();
+     if (client.is_errored()) return std::nullopt;
+     return client.tsize;
+}
+
+bool TFTPClient::is_interrupted() { return quit.load(); }
+
 /* === Virtuals === */
 
 /* == Handlers == */
@@ -128,17 +206,19 @@ void TFTPClient::handle_request_upload() {
 void TFTPClient::handle_request_download() {
      log_info("Requesting read from file " + this->filepath.value());
 
-     /* Create a part file, if not created already */
-     if (!this->file_created) {
-          this->file_fd
-              = open(this->destpath.c_str(), O_WRONLY | O_CREAT | O_TRUNC,
-                     S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+     /* Create a part file, if not created already (kept if resumable) */
+     if (this->file_fd < 0 && !this->probe) {
+          this->file_fd = open(this->file_name.c_str(),
+                               O_WRONLY | O_CREAT | (this->part ? 0 : O_TRUNC),
+                               S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
 
           /* Check if file was created properly */
           if (this->file_fd < 0)
                return send_error(TFTPErrorCode::AccessViolation,
                                  "Failed to create file");
-          this->file_created = true;
+          /* Removed on failure, unless resumable (or `/dev/null`) */
+          this->file_created = !this->part && !this->discard;
+          if (this->resume) this->resume_part();
      }
 
      /* Create request payload */
@@ -163,9 +243,13 @@ void TFTPClient::handle_request_download() {
 /**
  * @details `handle_oack` is called when OACK packet is received and
  *          `oack_expect` is set to true. It parses options from the
- *          OACK and sets them to the connection.
+ *          OACK and sets them to the connection. A `tsize` in the
+ *          OACK of a download is used to preallocate the file.
+ * @details A `multicast` answer makes the download part of a multicast
+ *          session (RFC 2090): DATA arrive on the group (joined here),
+ *          see `handle_await_download`.
  */
-void TFTPClient::handle_oack(const OptionAckPacket &oack) {
+void TFTPClient::handle_oack(const OackView &oack) {
      auto new_opts = oack.get_options();
 
      /* Process and set options */
@@ -174,9 +258,160 @@ void TFTPClient::handle_oack(const OptionAckPacket &oack) {
      this->log_info(
          "Options accepted (count: " + std::to_string(acc_opts.size()) + ")");
 
+     /* Size probe => done, abort the transfer (RFC 2347) */
+     if (this->probe) {
+          ErrorPacket abort = ErrorPacket(TFTPErrorCode::OptionNegotiation,
+                                          "Size probe only");
+          auto payload = abort.to_binary();
+          sendto(this->conn_fd, payload.data(), payload.size(), 0,
+                 reinterpret_cast<const sockaddr *>(&this->rem_addr),
+                 sizeof(this->rem_addr));
+          this->set_state(TFTPConnectionState::Completed);
+          return;
+     }
+
+     /* A requested byte range must be honoured (resumes can do without) */
+     if (this->range_req.has_value() && !this->ranged)
+          return this->send_error(TFTPErrorCode::OptionNegotiation,
+                                  "Server ignored the byte range");
+     if (this->resume && !this->ranged && this->is_download())
+          this->log_info("Server cannot resume, downloading from the start");
+
+     /* Preallocate the file */
+     if (this->is_download() && this->tsize.has_value()) {
+          this->log_info("Server announced size of "
+                         + std::to_string(*this->tsize) + " bytes");
+          if (!this->prealloc(*this->tsize))
+               return this->send_error(TFTPErrorCode::DiskFull,
+                                       "Not enough space for file");
+     }
+
+     /* Multicast session => listen on its group */
+     if (this->is_download() && this->mcast.has_value()) {
+          if (this->format != TFTPDataFormat::Octet || this->ranged)
+               return this->send_error(TFTPErrorCode::OptionNegotiation,
+                                       "Multicast of a whole octet file only");
+          if (!this->mcast_join())
+               return this->send_error(TFTPErrorCode::Unknown,
+                                       "Failed to join the multicast group");
+          if (this->tsize.has_value())
+               this->mc_last = *this->tsize / this->blksize + 1;
+          this->log_info(
+              "Joined multicast group "
+              + std::string(inet_ntoa(this->mcast->group.sin_addr)) + ":"
+              + std::to_string(ntohs(this->mcast->group.sin_port))
+              + (this->mcast->master ? " as the master client" : ""));
+     }
+
      return;
 }
 
+/**
+ * @details In a multicast session, only the master client ACKs (block 0
+ *          first, the one after the OACK); the others wait for DATA on
+ *          the group.
+ */
+void TFTPClient::handle_download() {
+     if (!this->mcast.has_value())
+          return TFTPConnectionBase::handle_download();
+
+     if (this->mcast->master)
+          this->mcast_ack();
+     else
+          this->update_sent_time(false);  // Only the idle timeout
+     this->set_state(TFTPConnectionState::Awaiting);
+}
+
+/**
+ * @details In a multicast session, DATA are read from the group socket
+ *          (and written wherever their block goes, see `mcast_data`),
+ *          the connection socket only gets the unicast packets of the
+ *          session: an OACK making the client master, or an ERROR.
+ *          The master retransmits its ACK on timeouts; other clients
+ *          only give up after as many timeouts without any DATA.
+ */
+void TFTPClient::handle_await_download() {
+     if (!this->mcast.has_value())
+          return TFTPConnectionBase::handle_await_download();
+
+     /* Timeout check */
+     if (this->is_timedout()) {
+          if (++this->send_tries > TFTP_MAX_RETRIES)
+               return this->send_error(TFTPErrorCode::Unknown,
+                                       "Multicast session timed out");
+
+          this->on_timeout();
+          if (!this->mcast->master) return this->update_sent_time(false);
+          this->stats.retransmits++;
+          log_info("Retransmitting ACK for block " + to_hex(this->mc_upto)
+                   + " (attempt " + std::to_string(this->send_tries) + ")");
+          return this->mcast_ack();
+     }
+
+     /* DATA from the group */
+     struct sockaddr_in origin {};
+     socklen_t origin_len = sizeof(origin);
+     ssize_t len;
+     {
+          TraceSpan trace("net", "recvfrom", this->tid);
+          len = recvfrom(this->group_fd, this->rx_buffer.data(),
+                         this->rx_buffer.size(), 0,
+                         reinterpret_cast<struct sockaddr *>(&origin),
+                         &origin_len);
+          trace.set_bytes(len);
+     }
+     if (len >= 0) return this->mcast_data(origin, static_cast<size_t>(len));
+     if (errno != EAGAIN && errno != EWOULDBLOCK)
+          return this->send_error(TFTPErrorCode::Unknown,
+                                  std::string(strerror(errno)));
+
+     /* Unicast from the session */
+     auto packet = this->recv_packet();
+     if (!packet.has_value()) return;
+     if (const auto *err = packet->get<ErrorView>())
+          return this->handle_error(*err);
+     const auto *oack = packet->get<OackView>();
+     if (!oack) return;
+
+     bool master = false;
+     oack->for_each_option([&master](std::string_view name,
+                                     std::string_view value) {
+          if (strcasecmp(std::string(name).c_str(), "multicast") != 0) return;
+          auto mcast = parse_multicast(std::string(value));
+          master = mcast.has_value() && mcast->master;
+     });
+     if (!master) return;
+
+     /* Made master => ACK what we have (again, if the ACK was lost) */
+     if (!this->mcast->master) log_info("Made the master client");
+     this->mcast->master = true;
+     this->send_tries = 0;
+     this->disarm_timeout();
+     this->mcast_ack();
+}
+
+/**
+ * @details A NetASCII download cannot be resumed (offsets of the decoded
+ *          data are not those on the wire), so its part is started over.
+ *          Octet ones ask for the `range` after the data already there;
+ *          if the server ignores it, the download starts from the
+ *          beginning (and the destructor cuts any stale data off).
+ */
+void TFTPClient::resume_part() {
+     struct stat st;
+     if (fstat(this->file_fd, &st) != 0 || st.st_size == 0) return;
+
+     if (this->format != TFTPDataFormat::Octet) {
+          log_info("Cannot resume a netascii download, starting over");
+          if (ftruncate(this->file_fd, 0) != 0)
+               log_error("Failed to truncate " + this->file_name);
+          return;
+     }
+
+     log_info("Resuming from byte " + std::to_string(st.st_size));
+     this->opts.emplace_back("range", std::to_string(st.st_size) + "-");
+}
+
 /**
  * @brief Checks if the client should shut down
  * @return true if should shut down,
@@ -185,24 +420,220 @@ void TFTPClient::handle_oack(const OptionAckPacket &oack) {
 bool TFTPClient::should_shutd() { return quit.load(); }
 
 /**
- * @brief Obtains the next DataPacket payload to be sent
- * @return std::vector<char> Serialised DataPacket payload
+ * @brief Writes the next block of data to be sent
+ * @details Used for NetASCII (taken from the streaming encoder) and for
+ *          small source files, which are read right into the packet
+ *          buffer. Large files and streams go through `next_slice`.
+ * @throws std::runtime_error when reading from the source fails
+ * @param payload Buffer for the data
+ * @return size_t number of bytes written
+ */
+size_t TFTPClient::next_data(std::span<char> payload) {
+     if (this->format == TFTPDataFormat::NetASCII)
+          return this->na_encoder.next_block(payload.data(), payload.size());
+
+     /* Loop on short reads */
+     size_t len = 0;
+     while (len < payload.size()) {
+          ssize_t bytes_rx = read(this->src_fd, payload.data() + len,
+                                  payload.size() - len);
+          if (bytes_rx < 0) {
+               if (errno == EINTR) continue;
+               throw std::runtime_error("Could not read upload source");
+          }
+          if (bytes_rx == 0) break;  // End of file
+          len += bytes_rx;
+     }
+
+     return len;
+}
+
+/**
+ * @brief Gets the next block of octet data without copying it
+ * @details Blocks are slices of the source file mapping, or of the
+ *          read-ahead chunks of a stream (released as ACKed).
+ * @throws std::runtime_error when reading from the source fails
+ * @param max Block size
+ * @return std::optional<std::span<const char>> the block, std::nullopt
+ *         for `next_data`
+ */
+std::optional<std::span<const char>> TFTPClient::next_slice(size_t max) {
+     if (this->format != TFTPDataFormat::Octet) return std::nullopt;
+     if (!this->src_opened) this->open_source();
+
+     if (this->src_map) {
+          auto part = this->src_map->slice(max, this->src_off);
+          this->src_off += part.size();
+          return part;
+     }
+     if (this->read_ahead) return this->read_ahead->next();
+     return std::nullopt;
+}
+
+void TFTPClient::release_data(size_t len) {
+     if (this->read_ahead) this->read_ahead->release(len);
+}
+
+/* === Helper methods === */
+
+/**
+ * @details Regular files of at least `TFTP_MMAP_MIN_SIZE` are mapped
+ *          (from the current position, as a redirected stdin may have
+ *          been read already) and smaller ones are read block by block.
+ *          Anything else (pipes, terminals, sockets) is read ahead on a
+ *          thread, with the ring covering the whole window. A pipe
+ *          buffer is grown to a chunk, so the writer is not held up
+ *          between the reads.
  */
-std::vector<char> TFTPClient::next_data() {
-     this->file_buffer.resize(this->blksize);
+void TFTPClient::open_source() {
+     this->src_opened = true;
+
+     struct stat st {};
+     if (fstat(this->src_fd, &st) == 0 && S_ISREG(st.st_mode)) {
+          off_t pos = lseek(this->src_fd, 0, SEEK_CUR);
+          if (pos < 0 || st.st_size - pos < static_cast<off_t>(
+                             TFTP_MMAP_MIN_SIZE))
+               return;
+          try {
+               this->src_map = std::make_unique<FileMap>(this->src_fd,
+                                                         st.st_size);
+               this->src_off = pos;
+          } catch (const std::runtime_error &e) {
+               log_info(std::string(e.what()) + ", reading it instead");
+          }
+          return;
+     }
 
-     /* Load chunk from stdin */
-     std::fill(file_buffer.begin(), file_buffer.end(), 0);
-     std::cin.read(file_buffer.data(), file_buffer.size());
-     this->file_rx_len = std::cin.gcount();
+     if (S_ISFIFO(st.st_mode))
+          fcntl(this->src_fd, F_SETPIPE_SZ,
+                static_cast<int>(TFTP_READ_CHUNK));  // Only a hint
+
+     size_t window = static_cast<size_t>(this->windowsize) * this->blksize;
+     size_t depth = std::max(TFTP_READ_DEPTH, window / TFTP_READ_CHUNK + 3);
+     this->read_ahead = std::make_unique<ReadAhead>(
+         this->src_fd, this->blksize, TFTP_READ_CHUNK, depth, &quit);
+}
 
-     /* Create data payload */
-     DataPacket packet
-         = DataPacket(std::vector<char>(file_buffer.begin(),
-                                        file_buffer.begin() + file_rx_len),
-                      this->block_n);
-     packet.set_no_seek(true);
-     packet.set_mode(this->format);
-     packet.set_block_size(this->blksize);
-     return packet.to_binary();
-}
\ No newline at end of file
+/**
+ * @details The group socket is bound to the group address and port
+ *          (so that it only gets DATA of this group), with address
+ *          reuse, so that several clients of a host can listen on it.
+ *          Closing it leaves the group.
+ */
+bool TFTPClient::mcast_join() {
+     this->group_fd
+         = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+     if (this->group_fd < 0) return false;
+
+     int val = 1;
+     struct ip_mreq mreq {};
+     mreq.imr_multiaddr = this->mcast->group.sin_addr;
+     mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+     return setsockopt(this->group_fd, SOL_SOCKET, SO_REUSEADDR, &val,
+                       sizeof(val))
+                == 0
+            && bind(this->group_fd,
+                    reinterpret_cast<const sockaddr *>(&this->mcast->group),
+                    sizeof(this->mcast->group))
+                   == 0
+            && setsockopt(this->group_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP,
+                          &mreq, sizeof(mreq))
+                   == 0;
+}
+
+/**
+ * @details Only the DATA of the session are taken – those from its port
+ *          (the source address is that of the interface the server
+ *          sends to the group from, not necessarily the one the client
+ *          talks to). Blocks arrive from wherever the master is in the
+ *          file, so each is written at its offset (`pwrite`, no
+ *          write-behind); blocks already there are counted as
+ *          duplicates. The download completes once all blocks up to
+ *          the final one (the short one, or the one after `tsize`) are
+ *          there, with an ACK of it that makes the session drop the
+ *          client.
+ * @details The master ACKs every `windowsize` blocks in order, and once
+ *          on any other block (a gap, or blocks it got before it became
+ *          master), so that the session continues from `mc_upto`.
+ */
+void TFTPClient::mcast_data(const sockaddr_in &origin, size_t len) {
+     if (origin.sin_port != this->rem_addr.sin_port) return;
+     auto packet = PacketView::parse(
+         std::span<const char>(this->rx_buffer.data(), len));
+     const auto *data = packet.has_value() ? packet->get<DataView>() : nullptr;
+     if (!data || data->block_n == 0 || data->data.size() > this->blksize
+         || (this->mc_last.has_value() && data->block_n > *this->mc_last))
+          return;
+     Logger::packet(*packet, origin, this->con_addr);
+
+     /* Write the block, unless already there */
+     uint64_t block = data->block_n;  // Never rolls over
+     if (block >= this->mc_have.size())
+          this->mc_have.resize(
+              std::max<uint64_t>(block, this->mc_last.value_or(0)) + 1);
+     if (this->mc_have[block]) {
+          this->stats.dup_rx++;
+     } else {
+          TraceSpan trace("file", "write", this->tid);
+          trace.set_bytes(static_cast<int64_t>(data->data.size()));
+          off_t off = static_cast<off_t>((block - 1) * this->blksize);
+          for (size_t done = 0; done < data->data.size();) {
+               ssize_t n = pwrite(this->file_fd, data->data.data() + done,
+                                  data->data.size() - done, off + done);
+               if (n < 0 && errno == EINTR) continue;
+               if (n < 0 && (errno == ENOSPC || errno == EDQUOT))
+                    return this->send_error(TFTPErrorCode::DiskFull,
+                                            "Disk full");
+               if (n < 0)
+                    return this->send_error(TFTPErrorCode::AccessViolation,
+                                            "Failed to write to file");
+               done += n;
+          }
+
+          this->mc_have[block] = true;
+          this->stats.blocks_rx++;
+          this->stats.bytes_rx += data->data.size();
+          if (data->data.size() < this->blksize) this->mc_last = block;
+          while (this->mc_upto + 1 < this->mc_have.size()
+                 && this->mc_have[this->mc_upto + 1])
+               this->mc_upto++;
+     }
+     this->send_tries = 0;
+
+     /* Whole file => final ACK (leaving the session) */
+     if (this->mc_last.has_value() && this->mc_upto >= *this->mc_last) {
+          this->mcast_ack();
+          log_info("Download complete!");
+          this->set_state(TFTPConnectionState::Completed);
+          return;
+     }
+
+     if (!this->mcast->master) return this->update_sent_time(false);
+     this->disarm_timeout();
+
+     /* Block out of order => ACK once */
+     if (block != this->mc_upto) {
+          if (this->win_gap) return this->update_sent_time(false);
+          this->win_gap = true;
+          return this->mcast_ack();
+     }
+     this->win_gap = false;
+
+     /* Window received => ACK */
+     if (++this->win_recv >= this->windowsize) return this->mcast_ack();
+     this->update_sent_time(false);
+}
+
+void TFTPClient::mcast_ack() {
+     if (Logger::enabled(LogLevel::Block))
+          log_block("Sending ACK for block " + to_hex(this->mc_upto));
+     this->win_recv = 0;
+
+     auto payload
+         = AcknowledgementPacket(static_cast<uint16_t>(this->mc_upto))
+               .to_binary();
+     this->update_sent_time();
+     sendto(this->conn_fd, payload.data(), payload.size(), 0,
+            reinterpret_cast<const sockaddr *>(&this->rem_addr),
+            sizeof(this->rem_addr));
+}
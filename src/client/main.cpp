@@ -5,16 +5,27 @@
  * @date 2023-09-26
  */
 
+#include "client/batch.hpp"
 #include "client/client.hpp"
 #include "common.hpp"
+#include "util/trace.hpp"
 
 /**
  * @brief Print help message
  */
 void send_help() {
      std::cout << "TFTP-Client (ISA 2023 by Onegen)" << std::endl
-               << "Usage: tftp-client <-h hostname> [-p port] [-f path] [-o "
-                  "opt val]... <-t dest>"
+               << "Usage: tftp-client <-h hostname> [-p port] [-f path | -i "
+                  "path] [-o opt val]..."
+               << std::endl
+               << "                   [-r 0|1] [-m mode] [-c] [-P parts] "
+                  "[-T file] [-v]... <-t dest>"
+               << std::endl
+               << "       tftp-client <-h hostname> [-p port] [-o opt val]... "
+                  "[-r 0|1] [-m mode]"
+               << std::endl
+               << "                   [-c] [-j parallel] [-v]... "
+                  "<-b manifest | (-f path -t dest)...>"
                << std::endl
                << std::endl
                << " Option       Meaning" << std::endl
@@ -24,9 +35,100 @@ void send_help() {
                << "  -f path      Path to remote file to download" << std::endl
                << "                If unset, data to upload are read from stdin"
                << std::endl
+               << "  -i path      Upload a local file instead of stdin"
+               << std::endl
                << "  -t dest      Path where to upload/download the file"
                << std::endl
-               << "  -o opt val   Set TFTP option (RFC 2347 ext.)" << std::endl;
+               << "                (downloads to /dev/null are discarded)"
+               << std::endl
+               << "  -o opt val   Set TFTP option (RFC 2347 ext.)" << std::endl
+               << "                (`-o multicast ''` joins a multicast "
+                  "download, RFC 2090)"
+               << std::endl
+               << "  -r 0|1       Roll block numbers over to 0 or 1 after "
+                  "65535"
+               << std::endl
+               << "  -m mode      Transfer mode: octet or netascii "
+                  "(default: octet)"
+               << std::endl
+               << "  -b manifest  Run the transfers listed in manifest, one "
+                  "per line:"
+               << std::endl
+               << "                `get <remote> <local>` or `put <local> "
+                  "<remote>`"
+               << std::endl
+               << "                (repeated -f/-t pairs are downloads too)"
+               << std::endl
+               << "  -j parallel  Transfers running at once in a batch "
+                  "(default: 16)"
+               << std::endl
+               << "  -c           Resume downloads from their `dest.part` "
+                  "files (kept on failure)"
+               << std::endl
+               << "  -P parts     Download one file as parts byte ranges "
+                  "at once"
+               << std::endl
+               << "  -T file      Trace the transfers to file (Chrome trace "
+                  "JSON)"
+               << std::endl
+               << "  -v           Log packets (-vv: also every DATA block/ACK)"
+               << std::endl;
+}
+
+/**
+ * @brief Trace file (set by -T)
+ */
+static std::string trace_file;
+
+/**
+ * @brief Writes the trace at exit (registered with -T)
+ */
+static void write_trace() {
+     Trace::stop();
+     if (!Trace::write(trace_file))
+          std::cerr << "!ERR! Failed to write trace to " << trace_file
+                    << std::endl;
+}
+
+/**
+ * @brief Downloads a file as byte ranges over parallel sessions
+ * @details The size is probed first (`tsize`); the ranges are then
+ *          fetched by a batch into the part file, which is put in place
+ *          once all of them are in (and removed otherwise).
+ * @throws std::runtime_error when the server cannot be resolved
+ * @return std::optional<int> exit code, nullopt if the size is unknown
+ *         (so the file is to be downloaded at once)
+ */
+std::optional<int> run_split(
+    const std::string& hostname, int port, const std::string& remote,
+    const std::string& dest, size_t parts,
+    const std::vector<std::pair<std::string, std::string>>& options,
+    TFTPBlockRollover rollover) {
+     auto size = TFTPClient::probe_size(TFTPClient::resolve(hostname, port),
+                                        dest, remote, options);
+     if (!size.has_value()) {
+          Logger::glob_info("File size unknown, downloading it at once");
+          return std::nullopt;
+     }
+
+     TFTPBatchClient client(hostname, port,
+                            TFTPBatchClient::split(remote, dest, *size, parts),
+                            parts);
+     client.set_options(options);
+     client.set_rollover(rollover);
+
+     std::string part = TFTPClient::part_path(dest);
+     if (client.run() > 0) {
+          remove(part.c_str());
+          return EXIT_FAILURE;
+     }
+     if (truncate(part.c_str(), static_cast<off_t>(*size)) != 0
+         || rename(part.c_str(), dest.c_str()) != 0) {
+          std::cerr << "!ERR! Failed to put " << part << " in place: "
+                    << strerror(errno) << std::endl;
+          return EXIT_FAILURE;
+     }
+     return EXIT_SUCCESS;
 }
 
 int main(int argc, char* argv[]) {
@@ -37,18 +139,29 @@ int main(int argc, char* argv[]) {
      }
 
      std::string usage
-         = "  Usage: tftp-client <-h hostname> [-p port] [-f path] [-o opt "
-           "val]... <-t dest>\n"
+         = "  Usage: tftp-client <-h hostname> [-p port] [-f path | -i path] "
+           "[-o opt val]... [-r 0|1] [-m mode] [-c] [-P parts] [-T file] "
+           "[-v]... <-t dest>\n"
+           "         tftp-client <-h hostname> ... [-c] [-j parallel] "
+           "<-b manifest | (-f path -t dest)...>\n"
            "   Try 'tftp-client' (no opts) for more info.";
 
      /* Parse command line options */
      int opt;
      int port = TFTP_STD_PORT;
      std::string hostname;
-     std::optional<std::string> filepath = std::nullopt;
-     std::string destpath;
+     std::vector<std::string> filepaths;
+     std::vector<std::string> destpaths;
+     std::string manifest;
+     std::string inpath;
+     long parallel = 16;
+     long parts = 1;
+     bool resume = false;
      std::vector<std::pair<std::string, std::string>> tftpOptions;
-     while ((opt = getopt(argc, argv, "h:p:f:t:o:")) != -1) {
+     std::optional<TFTPBlockRollover> rollover = TFTPBlockRollover::None;
+     std::optional<TFTPDataFormat> format = TFTPDataFormat::Octet;
+     int verbosity = static_cast<int>(LogLevel::Info);
+     while ((opt = getopt(argc, argv, "h:p:f:t:o:r:m:b:j:i:cP:T:v")) != -1) {
           switch (opt) {
                case 'h':
                     hostname = optarg;
@@ -57,10 +170,10 @@ int main(int argc, char* argv[]) {
                     port = std::stoi(optarg);
                     break;
                case 'f':
-                    filepath = optarg;
+                    filepaths.emplace_back(optarg);
                     break;
                case 't':
-                    destpath = optarg;
+                    destpaths.emplace_back(optarg);
                     break;
                case 'o':
                     if (optind < argc && argv[optind][0] != '-') {
@@ -73,6 +186,33 @@ int main(int argc, char* argv[]) {
                          return EXIT_FAILURE;
                     }
                     break;
+               case 'r':
+                    rollover = TFTPConnectionBase::parse_rollover(optarg);
+                    break;
+               case 'm':
+                    format = TFTPConnectionBase::parse_format(optarg);
+                    break;
+               case 'b':
+                    manifest = optarg;
+                    break;
+               case 'i':
+                    inpath = optarg;
+                    break;
+               case 'j':
+                    parallel = std::stol(optarg);
+                    break;
+               case 'c':
+                    resume = true;
+                    break;
+               case 'P':
+                    parts = std::stol(optarg);
+                    break;
+               case 'T':
+                    trace_file = optarg;
+                    break;
+               case 'v':
+                    verbosity++;
+                    break;
                default:
                     std::cerr << usage << std::endl;
                     return EXIT_FAILURE;
@@ -91,15 +231,139 @@ int main(int argc, char* argv[]) {
           return EXIT_FAILURE;
      }
 
-     if (destpath.empty()) {
+     if (!rollover.has_value()) {
+          std::cerr << "!ERR! Invalid rollover (expected 0 or 1)!" << std::endl
+                    << usage << std::endl;
+          return EXIT_FAILURE;
+     }
+
+     if (!format.has_value()) {
+          std::cerr << "!ERR! Invalid mode (expected octet or netascii)!"
+                    << std::endl
+                    << usage << std::endl;
+          return EXIT_FAILURE;
+     }
+
+     if (parallel < 1) {
+          std::cerr << "!ERR! Invalid number of parallel transfers!"
+                    << std::endl
+                    << usage << std::endl;
+          return EXIT_FAILURE;
+     }
+
+     if (parts < 1) {
+          std::cerr << "!ERR! Invalid number of parts!" << std::endl
+                    << usage << std::endl;
+          return EXIT_FAILURE;
+     }
+
+     /* One -t (and at most one -f) => single transfer, batch otherwise */
+     bool batch = !manifest.empty() || destpaths.size() > 1
+                  || filepaths.size() > 1;
+     if (!batch && destpaths.empty()) {
           std::cerr << "!ERR! Destination path not specified!" << std::endl
                     << usage << std::endl;
           return EXIT_FAILURE;
      }
 
+     if (batch && filepaths.size() != destpaths.size()) {
+          std::cerr << "!ERR! Every -f needs its -t in a batch (uploads are "
+                       "only supported in a manifest)!"
+                    << std::endl
+                    << usage << std::endl;
+          return EXIT_FAILURE;
+     }
+
+     if (!inpath.empty() && (batch || !filepaths.empty())) {
+          std::cerr << "!ERR! Option -i is only valid for a single upload!"
+                    << std::endl
+                    << usage << std::endl;
+          return EXIT_FAILURE;
+     }
+
+     if (parts > 1
+         && (batch || filepaths.empty() || resume
+             || *format != TFTPDataFormat::Octet)) {
+          std::cerr << "!ERR! Option -P is only valid for a single octet "
+                       "download (without -c)!"
+                    << std::endl
+                    << usage << std::endl;
+          return EXIT_FAILURE;
+     }
+
+     bool multicast = std::any_of(
+         tftpOptions.begin(), tftpOptions.end(), [](const auto& opt) {
+              return strcasecmp(opt.first.c_str(), "multicast") == 0;
+         });
+     if (multicast && (batch || filepaths.empty() || parts > 1)) {
+          std::cerr << "!ERR! Option multicast is only valid for a single "
+                       "download (without -P)!"
+                    << std::endl
+                    << usage << std::endl;
+          return EXIT_FAILURE;
+     }
+
+     Logger::set_level(static_cast<LogLevel>(
+         std::min(verbosity, static_cast<int>(LogLevel::Block))));
+
+     /* Trace everything from here, written on any exit */
+     if (!trace_file.empty()) {
+          Trace::start();
+          std::atexit(write_trace);
+     }
+
+     /* Run a batch */
+     if (batch) {
+          try {
+               std::vector<TFTPBatchClient::Job> jobs;
+               if (!manifest.empty())
+                    jobs = TFTPBatchClient::parse_manifest(manifest);
+               for (size_t i = 0; i < filepaths.size(); i++)
+                    jobs.push_back(
+                        {TFTPRequestType::Read, filepaths[i], destpaths[i]});
+
+               TFTPBatchClient client(hostname, port, std::move(jobs),
+                                      parallel);
+               client.set_options(tftpOptions);
+               client.set_rollover(*rollover);
+               client.set_format(*format);
+               if (resume) client.set_resume();
+               return client.run() > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+          } catch (const std::exception& e) {
+               std::cerr << "!ERR! " << e.what() << std::endl;
+               return EXIT_FAILURE;
+          }
+     }
+
+     /* Split a download into byte ranges (if its size is known) */
+     if (parts > 1) {
+          try {
+               auto res = run_split(hostname, port, filepaths.front(),
+                                    destpaths.front(), parts, tftpOptions,
+                                    *rollover);
+               if (res.has_value()) return *res;
+          } catch (const std::exception& e) {
+               std::cerr << "!ERR! " << e.what() << std::endl;
+               return EXIT_FAILURE;
+          }
+     }
+
      /* Create client */
+     std::optional<std::string> filepath = std::nullopt;
+     if (!filepaths.empty()) filepath = filepaths.front();
      try {
-          TFTPClient client(hostname, port, destpath, filepath, tftpOptions);
+          TFTPClient client(hostname, port, destpaths.front(), filepath,
+                            tftpOptions);
+          client.set_rollover(*rollover);
+          client.set_format(*format);
+          if (resume && filepath.has_value()) client.set_resume();
+          if (!inpath.empty()) {
+               int src_fd = open(inpath.c_str(), O_RDONLY);
+               if (src_fd < 0)
+                    throw std::runtime_error("Failed to open " + inpath + ": "
+                                             + strerror(errno));
+               client.set_source(src_fd);
+          }
           client.run();
           return client.is_errored() ? EXIT_FAILURE : EXIT_SUCCESS;
      } catch (const std::exception& e) {
@@ -35,7 +35,7 @@ std::vector<char> AcknowledgementPacket::to_binary() const {
 }
 
 AcknowledgementPacket AcknowledgementPacket::from_binary(
-    const std::vector<char>& bin_data) {
+    std::span<const char> bin_data) {
      if (bin_data.size() != 4)
           throw std::invalid_argument("Incorrect packet size");
 
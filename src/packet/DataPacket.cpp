@@ -122,11 +122,11 @@ std::vector<char> DataPacket::to_binary() const {
      return bin_data;
 }
 
-DataPacket DataPacket::from_binary(const std::vector<char>& bin_data) {
+DataPacket DataPacket::from_binary(std::span<const char> bin_data) {
      return from_binary(bin_data, TFTPDataFormat::Octet);
 }
 
-DataPacket DataPacket::from_binary(const std::vector<char>& bin_data,
+DataPacket DataPacket::from_binary(std::span<const char> bin_data,
                                    TFTPDataFormat mode) {
      if (bin_data.size() < 4)  // Min. size is 4B (2B opcode + 2B block number)
           throw std::invalid_argument("Incorrect packet size");
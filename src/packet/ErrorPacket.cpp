@@ -44,7 +44,7 @@ std::vector<char> ErrorPacket::to_binary() const {
      return bin_data;
 }
 
-ErrorPacket ErrorPacket::from_binary(const std::vector<char>& bin_data) {
+ErrorPacket ErrorPacket::from_binary(std::span<const char> bin_data) {
      if (bin_data.size() < 4) {  // Min. size is 4B (2B opcode + 2B errcode)
           throw std::invalid_argument("Incorrect packet size");
      }
@@ -51,7 +51,7 @@ std::vector<char> OptionAckPacket::to_binary() const {
 }
 
 OptionAckPacket OptionAckPacket::from_binary(
-    const std::vector<char>& bin_data) {
+    std::span<const char> bin_data) {
      if (bin_data.size() < 4)  // Min. size is 4B (2B opcode + 2 terminators)
           throw std::invalid_argument("Incorrect packet size");
      if (bin_data.size() > 512)  // Max. size is 512B
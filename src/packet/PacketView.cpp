@@ -0,0 +1,80 @@
+/**
+ * @file PacketView.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Non-owning views of received TFTP packets.
+ * @date 2023-11-18
+ */
+
+#include "packet/PacketView.hpp"
+
+/**
+ * @brief Checks that `bin_data` from `offset` is a sequence of
+ *        complete `name\0value\0` option pairs
+ */
+static bool valid_opts(std::span<const char> bin_data, size_t offset) {
+     while (offset < bin_data.size()) {
+          for (int i = 0; i < 2; i++) {
+               while (offset < bin_data.size() && bin_data[offset] != 0)
+                    ++offset;
+               if (offset++ >= bin_data.size()) return false;
+          }
+     }
+
+     return true;
+}
+
+/**
+ * @details Performs the same validation as the `from_binary` methods
+ *          of the owning packet classes, reading the (big-endian)
+ *          16-bit fields directly from the buffer.
+ */
+std::optional<PacketView> PacketView::parse(std::span<const char> bin_data) {
+     if (bin_data.size() < 4) return std::nullopt;  // Min. size of any packet
+
+     auto u16 = [&bin_data](size_t offset) {
+          return static_cast<uint16_t>(
+              (static_cast<uint8_t>(bin_data[offset]) << 8)
+              | static_cast<uint8_t>(bin_data[offset + 1]));
+     };
+
+     switch (u16(0)) {
+          case TFTPOpcode::RRQ:
+          case TFTPOpcode::WRQ:
+               if (bin_data.size() > 512) return std::nullopt;
+               return PacketView(static_cast<TFTPOpcode>(u16(0)),
+                                 std::monostate{});
+
+          case TFTPOpcode::DATA:
+               return PacketView(TFTPOpcode::DATA,
+                                 DataView{u16(2), bin_data.subspan(4)});
+
+          case TFTPOpcode::ACK:
+               if (bin_data.size() != 4) return std::nullopt;
+               return PacketView(TFTPOpcode::ACK, AckView{u16(2)});
+
+          case TFTPOpcode::ERROR: {
+               uint16_t errcode = u16(2);
+               if (errcode > TFTPErrorCode::OptionNegotiation)
+                    return std::nullopt;
+
+               /* Message without its NUL terminator */
+               std::string_view msg;
+               if (bin_data.size() > 5)
+                    msg = std::string_view(bin_data.data() + 4,
+                                           bin_data.size() - 5);
+
+               return PacketView(
+                   TFTPOpcode::ERROR,
+                   ErrorView{static_cast<TFTPErrorCode>(errcode), msg});
+          }
+
+          case TFTPOpcode::OACK:
+               if (bin_data.size() > 512 || !valid_opts(bin_data, 2))
+                    return std::nullopt;
+               return PacketView(TFTPOpcode::OACK,
+                                 OackView{bin_data.subspan(2)});
+
+          default:
+               return std::nullopt;
+     }
+}
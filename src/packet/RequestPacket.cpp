@@ -68,7 +68,7 @@ std::vector<char> RequestPacket::to_binary() const {
      return bin_data;
 }
 
-RequestPacket RequestPacket::from_binary(const std::vector<char>& bin_data) {
+RequestPacket RequestPacket::from_binary(std::span<const char> bin_data) {
      if (bin_data.size() < 4)  // Min. size is 4B (2B opcode + 2B separator)
           throw std::invalid_argument("Incorrect packet size");
      if (bin_data.size() > 512)  // Max. size is 512B (as defined by RFC 2347)
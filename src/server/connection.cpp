@@ -12,9 +12,11 @@
 TFTPServerConnection::TFTPServerConnection(
     const sockaddr_in& clt_addr, const RequestPacket& reqPacket,
     const std::string& rootDir,
-    const std::shared_ptr<std::atomic<bool>>& shutd_flag)
+    const std::shared_ptr<std::atomic<bool>>& shutd_flag,
+    TFTPBlockRollover rollover)
     : shutd_flag(*shutd_flag) {
      this->rem_addr = clt_addr;
+     this->rollover = rollover;  // Default, before options can override
 
      this->file_name = rootDir + "/" + reqPacket.get_filename();
      this->type = reqPacket.get_type();
@@ -22,6 +24,10 @@ TFTPServerConnection::TFTPServerConnection(
      this->opts = this->proc_opts(reqPacket.get_options());
 }
 
+TFTPServerConnection::~TFTPServerConnection() {
+     if (this->shared_file) this->file_fd = -1;  // Closed by the path cache
+}
+
 /* === Virtuals === */
 
 /* == Handlers == */
@@ -31,41 +37,102 @@ TFTPServerConnection::TFTPServerConnection(
  */
 void TFTPServerConnection::handle_request_upload() {
      log_info("Requesting read of file " + this->file_name);
+     struct stat st;
 
-     /* Check if file exists */
-     if (access(this->file_name.c_str(), F_OK) != 0)
+     /* Resolve the file through the path cache (shared descriptor) */
+     if (this->paths) {
+          auto res = this->paths->open(this->file_name);
+          if (!res.file) return this->send_open_error(res.err);
+          this->shared_file = std::move(res.file);
+          this->file_fd = this->shared_file->fd;
+          st = this->shared_file->st;
+          if (this->cache)
+               this->image
+                   = this->cache->get(this->file_name, st, this->format);
+     } else if (this->cache) {
+          /* Check if file exists (and if its image is cached) */
+          if (stat(this->file_name.c_str(), &st) != 0)
+               return this->send_error(TFTPErrorCode::FileNotFound,
+                                       "File does not exist");
+          this->image = this->cache->get(this->file_name, st, this->format);
+     } else if (access(this->file_name.c_str(), F_OK) != 0) {
           return this->send_error(TFTPErrorCode::FileNotFound,
                                   "File does not exist");
+     }
 
      /* Open file for reading */
-     this->file_fd = open(this->file_name.c_str(), O_RDONLY);
-     if (this->file_fd < 0) {
-          TFTPErrorCode errcode;
-          std::string errmsg;
-
-          if (errno == ENOENT) {
-               errcode = TFTPErrorCode::FileNotFound;
-               errmsg = "File not found";
-          } else if (errno == EACCES) {
-               errcode = TFTPErrorCode::AccessViolation;
-               errmsg = "Permission denied";
-          } else {
-               errcode = TFTPErrorCode::AccessViolation;
-               errmsg = "Failed to open file";
-          }
-
-          return this->send_error(errcode, errmsg);
+     if (!this->image && this->file_fd < 0) {
+          this->file_fd = open(this->file_name.c_str(), O_RDONLY);
+          if (this->file_fd < 0) return this->send_open_error(errno);
      }
 
-     /* Check if file doesn’t exceed max allowed size */
+     /* Fit blocks in the path MTU (before the size depends on them) */
+     this->clamp_blksize();
+
+     /* Check if the file (range) doesn’t exceed max allowed size
+      * (w/o rollover) */
      /** @see https://stackoverflow.com/a/6039648 */
-     struct stat st;
-     if (fstat(this->file_fd, &st) != 0
-         || static_cast<uint32_t>(st.st_size)
-                > static_cast<uint32_t>(this->blksize) * TFTP_MAX_FILE_BLOCKS
+     if (!this->image && !this->shared_file && fstat(this->file_fd, &st) != 0)
+          return this->send_error(TFTPErrorCode::Unknown,
+                                  "Failed to stat file");
+     uint64_t size = st.st_size;
+     uint64_t end = std::min(this->range_end.value_or(size), size);
+     if (this->range_start > end)
+          return this->send_error(TFTPErrorCode::OptionNegotiation,
+                                  "Range beyond end of file");
+     if (this->rollover == TFTPBlockRollover::None
+         && end - this->range_start
+                > static_cast<uint64_t>(this->blksize) * TFTP_MAX_FILE_BLOCKS
                       - 1) {
           return this->send_error(TFTPErrorCode::Unknown, "File too big");
      }
+     this->file_off = static_cast<off_t>(this->range_start);
+     this->file_end = static_cast<off_t>(end);
+
+     /* Answer `range` with the range sent (whole file by default) */
+     if (this->ranged) {
+          this->range_end = end;
+          for (auto &opt : this->opts)
+               if (strcasecmp(opt.first.c_str(), "range") == 0)
+                    opt.second = std::to_string(this->range_start) + "-"
+                                 + std::to_string(end);
+          log_info("Sending bytes " + std::to_string(this->range_start) + "-"
+                   + std::to_string(end) + " of " + std::to_string(size));
+     }
+
+     /* Answer `tsize` with the file size */
+     if (this->tsize.has_value()) {
+          this->tsize = st.st_size;
+          for (auto &opt : this->opts)
+               if (strcasecmp(opt.first.c_str(), "tsize") == 0)
+                    opt.second = std::to_string(st.st_size);
+     }
+
+     /* Load the image into the cache */
+     if (this->cache && !this->image) {
+          try {
+               this->image = this->cache->load(this->file_name, this->file_fd,
+                                               st, this->format);
+          } catch (const std::runtime_error&) {
+               return this->send_error(TFTPErrorCode::Unknown,
+                                       "Failed to read file");
+          }
+     }
+
+     /* Map large octet files (`pread` if the file cannot be mapped) */
+     if (this->format == TFTPDataFormat::Octet && !this->image
+         && static_cast<size_t>(st.st_size) >= TFTP_MMAP_MIN_SIZE) {
+          try {
+               this->map = std::make_unique<FileMap>(this->file_fd,
+                                                     st.st_size);
+          } catch (const std::runtime_error& e) {
+               log_info(std::string(e.what()) + ", reading it instead");
+          }
+     }
+
+     /* NetASCII is encoded as a stream, block after block */
+     if (this->format == TFTPDataFormat::NetASCII && !this->image)
+          this->na_encoder = NetASCII::Encoder(this->file_fd, 0);
 
      /* If any options were accepted, set `oack_init` */
      this->oack_init = !this->opts.empty();
@@ -97,6 +164,14 @@ void TFTPServerConnection::handle_request_download() {
                                   "Could not create file");
      this->file_created = true;
 
+     /* Preallocate the announced `tsize` */
+     if (this->tsize.has_value() && !this->prealloc(*this->tsize))
+          return this->send_error(TFTPErrorCode::DiskFull,
+                                  "Not enough space for file");
+
+     /* Fit blocks in the path MTU */
+     this->clamp_blksize();
+
      /* If any options were accepted, set `oack_init` */
      this->oack_init = !this->opts.empty();
 
@@ -113,13 +188,132 @@ void TFTPServerConnection::handle_request_download() {
 bool TFTPServerConnection::should_shutd() { return this->shutd_flag.load(); }
 
 /**
- * @brief Obtains the next DataPacket payload to be sent
- * @return std::vector<char> Serialised DataPacket payload
+ * @brief Writes the next block of data to be sent
+ * @details Octet data are `pread` right into the packet buffer from
+ *          `file_off` up to `file_end` (small or unmappable files),
+ *          NetASCII data are taken from the streaming encoder (blocks
+ *          are generated in order exactly once, retransmits are sent
+ *          from the `window` buffers). Cached images and mapped files go
+ *          through `next_slice`.
+ * @throws std::runtime_error when reading from the file fails
+ * @param payload Buffer for the data
+ * @return size_t number of bytes written
  */
-std::vector<char> TFTPServerConnection::next_data() {
-     /* Create data payload from file */
-     DataPacket packet = DataPacket(this->file_fd, this->block_n);
-     packet.set_mode(this->format);
-     packet.set_block_size(this->blksize);
-     return packet.to_binary();
+size_t TFTPServerConnection::next_data(std::span<char> payload) {
+     /* NetASCII data from the streaming encoder */
+     if (this->format == TFTPDataFormat::NetASCII)
+          return this->na_encoder.next_block(payload.data(), payload.size());
+
+     /* Octet data from file (loop on short reads) */
+     size_t len = 0;
+     size_t max = std::min<size_t>(payload.size(),
+                                   this->file_end - this->file_off);
+     while (len < max) {
+          ssize_t bytes_rx = pread(this->file_fd, payload.data() + len,
+                                   max - len, this->file_off);
+          if (bytes_rx < 0) {
+               if (errno == EINTR) continue;
+               throw std::runtime_error("Could not read file");
+          }
+          if (bytes_rx == 0) break;  // End of file
+
+          len += bytes_rx;
+          this->file_off += bytes_rx;
+     }
+
+     return len;
+}
+
+/**
+ * @brief Gets the next block of data without copying it
+ * @details Blocks are slices of the cached image (already encoded for
+ *          NetASCII) or of the file mapping, at `file_off`. Both live as
+ *          long as the connection, so retransmits can use them.
+ * @param max Block size
+ * @return std::optional<std::span<const char>> the block, std::nullopt
+ *         for `next_data`
+ */
+std::optional<std::span<const char>> TFTPServerConnection::next_slice(
+    size_t max) {
+     std::span<const char> part;
+     if (this->format == TFTPDataFormat::Octet)
+          max = std::min<size_t>(max, this->file_end - this->file_off);
+     if (this->image)
+          part = std::span<const char>(*this->image).subspan(
+              this->file_off,
+              std::min<size_t>(max, this->image->size() - this->file_off));
+     else if (this->map)
+          part = this->map->slice(max, this->file_off);
+     else
+          return std::nullopt;
+
+     this->file_off += part.size();
+     return part;
+}
+
+/* === Helper methods === */
+
+void TFTPServerConnection::send_open_error(int err) {
+     if (err == ENOENT)
+          return this->send_error(TFTPErrorCode::FileNotFound,
+                                  "File not found");
+     if (err == EACCES)
+          return this->send_error(TFTPErrorCode::AccessViolation,
+                                  "Permission denied");
+     return this->send_error(TFTPErrorCode::AccessViolation,
+                             "Failed to open file");
+}
+
+/**
+ * @details Asks a UDP socket connected to the host (no packets are sent)
+ *          for `IP_MTU`: the path MTU if the kernel has learned one for
+ *          the route, the MTU of the outgoing link otherwise.
+ */
+int TFTPServerConnection::path_mtu(const sockaddr_in& addr) {
+     int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+     if (fd < 0) return 0;
+
+     int mtu = 0;
+     socklen_t len = sizeof(mtu);
+     if (connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr))
+             != 0
+         || getsockopt(fd, IPPROTO_IP, IP_MTU, &mtu, &len) != 0)
+          mtu = 0;
+     close(fd);
+     return mtu;
+}
+
+/**
+ * @details A `blksize` whose DATA datagrams would not fit the MTU (less
+ *          `TFTP_DATA_OVERHEAD`) is lowered in the OACK, as RFC 2348
+ *          lets the server do, so that no block is sent in fragments
+ *          (losing one of them loses the whole block). Blocks sent from
+ *          an own socket also get `IP_PMTUDISC_DO`, so that a drop of
+ *          the path MTU mid-transfer shows (see `pmtu_fallback`).
+ */
+void TFTPServerConnection::clamp_blksize() {
+     if (this->mtu < 0) return;
+
+     if (this->is_upload() && !this->sock_shared) {
+          int val = IP_PMTUDISC_DO;
+          setsockopt(this->conn_fd, IPPROTO_IP, IP_MTU_DISCOVER, &val,
+                     sizeof(val));
+     }
+
+     int mtu = this->mtu > 0 ? this->mtu : path_mtu(this->data_addr());
+     if (mtu <= 0) return;
+     uint16_t max = static_cast<uint16_t>(
+         std::clamp<int>(mtu - TFTP_DATA_OVERHEAD, TFTP_MIN_BLKSIZE,
+                         TFTP_MAX_BLKSIZE));
+     if (this->blksize <= max) return;
+
+     for (auto& opt : this->opts) {
+          if (strcasecmp(opt.first.c_str(), "blksize") != 0) continue;
+          log_info("Lowering blksize " + std::to_string(this->blksize)
+                   + " to " + std::to_string(max) + " (MTU "
+                   + std::to_string(mtu) + ")");
+          opt.second = std::to_string(max);
+          this->blksize = max;
+          this->stats.blksize_clamps++;
+     }
 }
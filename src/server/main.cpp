@@ -8,12 +8,110 @@
 #include "common.hpp"
 #include "server/server.hpp"
 
+/**
+ * @brief Parses the first multicast group of the server
+ * @param str "addr" or "addr:port"
+ * @return std::optional<sockaddr_in> group, nullopt if invalid
+ */
+std::optional<sockaddr_in> parse_group(const std::string& str) {
+     size_t colon = str.find(':');
+     std::string addr = str.substr(0, colon);
+     int port = TFTP_MCAST_PORT;
+     if (colon != std::string::npos) {
+          try {
+               port = std::stoi(str.substr(colon + 1));
+          } catch (const std::exception&) {
+               return std::nullopt;
+          }
+     }
+
+     sockaddr_in group{};
+     group.sin_family = AF_INET;
+     if (port < 1 || port > 65535
+         || inet_pton(AF_INET, addr.c_str(), &group.sin_addr) != 1
+         || !IN_MULTICAST(ntohl(group.sin_addr.s_addr)))
+          return std::nullopt;
+     group.sin_port = htons(static_cast<uint16_t>(port));
+     return group;
+}
+
 void send_help() {
      std::cout << "TFTP-Server (ISA 2023 by Onegen)" << std::endl
-               << "Usage: tftp-server [-p port] <path>" << std::endl
+               << "Usage: tftp-server [-p port] [-j threads] [-e backend] "
+                  "[-r 0|1] [-m file] [-c MiB] [-A] [-F paths]"
+               << std::endl
+               << "                   [-n conns] [-N conns] [-q len] "
+                  "[-s socks] [-M mtu] [-G group] [-T file]"
+               << std::endl
+               << "                   [-R Mbit/s] [-v]... <path>"
+               << std::endl
                << std::endl
                << " Option       Meaning" << std::endl
                << "  -p port      Port to listen on (default: 69)" << std::endl
+               << "  -j threads   Number of worker threads (default: 1)"
+               << std::endl
+               << "  -e backend   Event loop: poll, epoll or uring "
+                  "(default: "
+#ifdef TFTP_IO_URING
+               << "uring"
+#else
+               << "epoll"
+#endif
+               << ")" << std::endl
+               << "  -r 0|1       Roll block numbers over to 0 or 1 after "
+                  "65535"
+               << std::endl
+               << "                (default: no rollover, max. 65535 blocks)"
+               << std::endl
+               << "  -m file      Dump metrics to file on SIGUSR1 and at exit"
+               << std::endl
+               << "                (default: stdout, on SIGUSR1 only)"
+               << std::endl
+               << "  -c MiB       Cache read files in memory, up to MiB "
+                  "(default: 0, off)"
+               << std::endl
+               << "  -A           Do not cache NetASCII-encoded files"
+               << std::endl
+               << "  -F paths     Keep up to paths requested files open "
+                  "(default: 0, off)"
+               << std::endl
+               << "  -n conns     Maximum connections (default: 0, no limit)"
+               << std::endl
+               << "  -N conns     Maximum connections per client IP "
+                  "(default: 0, no limit)"
+               << std::endl
+               << "  -q len       Requests over the limits waiting per worker"
+               << std::endl
+               << "                (default: 0, refused with an ERROR)"
+               << std::endl
+               << "  -s socks     Reply from socks shared sockets per worker "
+                  "(0: server port)"
+               << std::endl
+               << "                (default: a socket per transfer)"
+               << std::endl
+               << "  -M mtu       Lower blksize so that DATA fit in mtu "
+                  "(0: path MTU)"
+               << std::endl
+               << "                (default: any blksize, fragmented if "
+                  "needed)"
+               << std::endl
+               << "  -G group     Serve multicast RRQs (RFC 2090) on groups "
+                  "from group[:port]"
+               << std::endl
+               << "                (default: off; port 1758, "
+               << TFTP_MCAST_GROUPS << " groups, not with -s)" << std::endl
+               << "  -R Mbit/s    Pace transfers, sharing Mbit/s fairly "
+                  "(0: pacing only)"
+               << std::endl
+               << "                (default: off, windows sent in bursts)"
+               << std::endl
+               << "  -T file      Trace connections to file (Chrome trace "
+                  "JSON) at exit"
+               << std::endl
+               << "                (SIGUSR2 stops or restarts tracing)"
+               << std::endl
+               << "  -v           Log packets (-vv: also every DATA block/ACK)"
+               << std::endl
                << "  <path>       Root folder of the TFTP server" << std::endl;
 }
 
@@ -25,18 +123,91 @@ int main(int argc, char* argv[]) {
      }
 
      std::string usage
-         = "  Usage: tftp-server [-p port] <path>\n"
+         = "  Usage: tftp-server [-p port] [-j threads] [-e backend] [-r 0|1] "
+           "[-m file] [-c MiB] [-A] [-F paths]\n"
+           "                     [-n conns] [-N conns] [-q len] [-s socks] "
+           "[-M mtu] [-G group] [-T file]\n"
+           "                     [-R Mbit/s] [-v]... <path>\n"
            "   Try 'tftp-server' (no opts) for more info.";
 
      /* Parse command line options */
      int opt;
      int port = TFTP_STD_PORT;
+     int threads = 1;
+     std::optional<EventLoopBackend> backend = EventLoop::default_backend();
+     std::optional<TFTPBlockRollover> rollover = TFTPBlockRollover::None;
+     int verbosity = static_cast<int>(LogLevel::Info);
+     std::string metrics_file;
+     std::string trace_file;
+     long cache_mib = 0;
+     bool cache_netascii = true;
+     long path_entries = 0;
+     long max_conns = 0;
+     long max_client_conns = 0;
+     long queue_max = 0;
+     int demux_socks = -1;
+     int mtu = -1;
+     std::optional<sockaddr_in> group;
+     bool multicast = false;
+     long pace_mbps = 0;
+     bool pacing = false;
      std::string rootdir;
-     while ((opt = getopt(argc, argv, "p:")) != -1) {
+     while ((opt = getopt(argc, argv, "p:j:e:r:m:c:AF:n:N:q:s:M:G:R:T:v"))
+            != -1) {
           switch (opt) {
                case 'p':
                     port = std::stoi(optarg);
                     break;
+               case 'j':
+                    threads = std::stoi(optarg);
+                    break;
+               case 'e':
+                    backend = EventLoop::parse_backend(optarg);
+                    break;
+               case 'r':
+                    rollover = TFTPConnectionBase::parse_rollover(optarg);
+                    break;
+               case 'm':
+                    metrics_file = optarg;
+                    break;
+               case 'T':
+                    trace_file = optarg;
+                    break;
+               case 'c':
+                    cache_mib = std::stol(optarg);
+                    break;
+               case 'A':
+                    cache_netascii = false;
+                    break;
+               case 'F':
+                    path_entries = std::stol(optarg);
+                    break;
+               case 'n':
+                    max_conns = std::stol(optarg);
+                    break;
+               case 'N':
+                    max_client_conns = std::stol(optarg);
+                    break;
+               case 'q':
+                    queue_max = std::stol(optarg);
+                    break;
+               case 's':
+                    demux_socks = std::stoi(optarg);
+                    break;
+               case 'M':
+                    mtu = std::stoi(optarg);
+                    break;
+               case 'G':
+                    group = parse_group(optarg);
+                    multicast = true;
+                    break;
+               case 'R':
+                    pace_mbps = std::stol(optarg);
+                    pacing = true;
+                    break;
+               case 'v':
+                    verbosity++;
+                    break;
                default:
                     std::cerr << usage << std::endl;
                     return EXIT_FAILURE;
@@ -58,15 +229,90 @@ int main(int argc, char* argv[]) {
           return EXIT_FAILURE;
      }
 
+     if (threads < 1) {
+          std::cerr << "!ERR! Invalid number of threads!" << std::endl
+                    << usage << std::endl;
+          return EXIT_FAILURE;
+     }
+
+     if (!backend.has_value()) {
+          std::cerr << "!ERR! Invalid event loop backend!" << std::endl
+                    << usage << std::endl;
+          return EXIT_FAILURE;
+     }
+
+     if (!rollover.has_value()) {
+          std::cerr << "!ERR! Invalid rollover (expected 0 or 1)!" << std::endl
+                    << usage << std::endl;
+          return EXIT_FAILURE;
+     }
+
+     if (cache_mib < 0) {
+          std::cerr << "!ERR! Invalid cache size!" << std::endl
+                    << usage << std::endl;
+          return EXIT_FAILURE;
+     }
+
+     if (path_entries < 0) {
+          std::cerr << "!ERR! Invalid path cache size!" << std::endl
+                    << usage << std::endl;
+          return EXIT_FAILURE;
+     }
+
+     if (max_conns < 0 || max_client_conns < 0 || queue_max < 0) {
+          std::cerr << "!ERR! Invalid connection limit!" << std::endl
+                    << usage << std::endl;
+          return EXIT_FAILURE;
+     }
+
+     if (demux_socks < -1) {
+          std::cerr << "!ERR! Invalid number of shared sockets!" << std::endl
+                    << usage << std::endl;
+          return EXIT_FAILURE;
+     }
+
+     if (mtu != -1 && mtu != 0 && (mtu < TFTP_MIN_MTU || mtu > UINT16_MAX)) {
+          std::cerr << "!ERR! Invalid MTU!" << std::endl << usage << std::endl;
+          return EXIT_FAILURE;
+     }
+
+     if (multicast && (!group.has_value() || demux_socks >= 0)) {
+          std::cerr << "!ERR! Invalid multicast group (or used with -s)!"
+                    << std::endl
+                    << usage << std::endl;
+          return EXIT_FAILURE;
+     }
+
+     if (pace_mbps < 0) {
+          std::cerr << "!ERR! Invalid egress limit!" << std::endl
+                    << usage << std::endl;
+          return EXIT_FAILURE;
+     }
+
      if (rootdir.empty()) {
           std::cerr << "!ERR! Root folder not specified!" << std::endl
                     << usage << std::endl;
           return EXIT_FAILURE;
      }
 
+     Logger::set_level(static_cast<LogLevel>(
+         std::min(verbosity, static_cast<int>(LogLevel::Block))));
+
      /* Create server */
      try {
-          TFTPServer server(rootdir, port);
+          TFTPServer server(rootdir, port, threads);
+          server.set_backend(*backend);
+          server.set_rollover(*rollover);
+          server.set_metrics_file(metrics_file);
+          server.set_trace_file(trace_file);
+          server.set_cache(static_cast<size_t>(cache_mib) << 20,
+                           cache_netascii);
+          server.set_paths(static_cast<size_t>(path_entries));
+          server.set_admission(max_conns, max_client_conns, queue_max);
+          server.set_demux(demux_socks);
+          server.set_mtu(mtu);
+          if (group.has_value()) server.set_multicast(*group);
+          if (pacing) server.set_pacing(pace_mbps * 1e6 / 8);
           server.start();
      } catch (const std::exception& e) {
           std::cerr << "!ERR! " << e.what() << std::endl;
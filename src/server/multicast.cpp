@@ -0,0 +1,262 @@
+/**
+ * @file multicast.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief TFTP multicast session (RFC 2090) implementation.
+ * @date 2023-11-25
+ */
+
+#include "server/multicast.hpp"
+
+/**
+ * @brief Gets the (lowercase) names of the options of a request
+ * @param req Request
+ * @return std::vector<std::string> option names
+ */
+static std::vector<std::string> option_names(const RequestPacket& req) {
+     std::vector<std::string> names;
+     for (const auto& opt : req.get_options()) {
+          std::string name = opt.first;
+          std::transform(name.begin(), name.end(), name.begin(),
+                         static_cast<int (*)(int)>(std::tolower));
+          names.push_back(std::move(name));
+     }
+     return names;
+}
+
+/* === Setup methods === */
+
+/**
+ * @details Block numbers never roll over in a session (clients would
+ *          not know which block of the file a number is after joining),
+ *          which limits the file to 65535 blocks like without the
+ *          `rollover` option.
+ */
+TFTPMulticastSession::TFTPMulticastSession(
+    const sockaddr_in& clt_addr, const RequestPacket& req_packet,
+    const std::string& root_dir,
+    const std::shared_ptr<std::atomic<bool>>& shutd_flag, GroupPool& groups,
+    const sockaddr_in& group)
+    : TFTPServerConnection(clt_addr, req_packet, root_dir, shutd_flag,
+                           TFTPBlockRollover::None),
+      groups(groups),
+      group(group) {
+     this->members.push_back({clt_addr, option_names(req_packet)});
+}
+
+TFTPMulticastSession::~TFTPMulticastSession() {
+     this->groups.release(this->group);
+}
+
+/* === Public methods === */
+
+/**
+ * @details Clients of a session must agree on the block size and window
+ *          size as asked for (the session answers them all alike), the
+ *          other options are answered to each client as it asked.
+ */
+std::optional<std::string> TFTPMulticastSession::session_key(
+    const RequestPacket& req) {
+     if (req.get_type() != TFTPRequestType::Read
+         || req.get_mode() != TFTPDataFormat::Octet)
+          return std::nullopt;
+
+     bool multicast = false;
+     std::string blksize, windowsize;
+     for (const auto& [name, value] : req.get_options()) {
+          if (strcasecmp(name.c_str(), "multicast") == 0)
+               multicast = true;
+          else if (strcasecmp(name.c_str(), "blksize") == 0)
+               blksize = value;
+          else if (strcasecmp(name.c_str(), "windowsize") == 0)
+               windowsize = value;
+          else if (strcasecmp(name.c_str(), "range") == 0
+                   || strcasecmp(name.c_str(), "rollover") == 0)
+               return std::nullopt;
+     }
+     if (!multicast) return std::nullopt;
+
+     return req.get_filename() + '\0' + blksize + '\0' + windowsize;
+}
+
+void TFTPMulticastSession::join(const sockaddr_in& clt_addr,
+                                const RequestPacket& req) {
+     auto it = this->find_member(clt_addr);
+     if (it == this->members.begin()) return;
+     if (it == this->members.end()) {
+          log_info("Client " + addr_str(clt_addr) + " joined the session");
+          this->members.push_back({clt_addr, option_names(req)});
+          it = std::prev(this->members.end());
+     }
+
+     auto payload = OptionAckPacket(this->member_opts(*it, false)).to_binary();
+     sendto(this->conn_fd, payload.data(), payload.size(), 0,
+            reinterpret_cast<const sockaddr*>(&clt_addr), sizeof(clt_addr));
+}
+
+/* === Virtuals === */
+
+/* == Handlers == */
+
+/**
+ * @details The size of the file is needed for the final block number
+ *          (clients leave with its ACK), so it is got even if the
+ *          first client did not ask for `tsize`. Options the first
+ *          client asked for are those of the session.
+ */
+void TFTPMulticastSession::handle_request_upload() {
+     if (!this->tsize.has_value()) {
+          this->tsize = 0;
+          this->opts.emplace_back("tsize", "0");
+     }
+
+     TFTPServerConnection::handle_request_upload();
+     if (!this->is_running()) return;
+
+     this->last_block
+         = static_cast<uint64_t>(this->file_end - this->file_off)
+               / this->blksize
+           + 1;
+     this->session_opts = this->opts;
+     this->opts = this->member_opts(this->members.front(), true);
+     this->oack_init = true;
+     log_info("Multicasting to group " + addr_str(this->group));
+}
+
+/**
+ * @details A master not answering after all the retransmissions is
+ *          dropped (as if it left), instead of ending the session.
+ */
+void TFTPMulticastSession::handle_await_upload() {
+     if (this->is_timedout() && this->send_tries >= TFTP_MAX_RETRIES) {
+          log_info("Master client " + addr_str(this->rem_addr)
+                   + " timed out");
+          this->stats.timeouts++;
+          return this->next_master();
+     }
+
+     TFTPServerConnection::handle_await_upload();
+}
+
+/**
+ * @details The ACK of the final block means the master has the whole
+ *          file. A new master (its OACK ACKed) or one ahead of the
+ *          window (it got blocks before it became master) gets the
+ *          blocks after the one it ACKed, otherwise the window slides
+ *          as for any upload.
+ */
+bool TFTPMulticastSession::handle_ack(const AckView& ack) {
+     uint64_t block = ack.block_n;  // Never rolls over
+     if (block >= this->last_block) {
+          log_info("Master client " + addr_str(this->rem_addr)
+                   + " has the file");
+          this->next_master();
+          return false;
+     }
+
+     if (this->oack_init || block > this->block_n) {
+          this->restart(block);
+          return true;
+     }
+
+     return TFTPServerConnection::handle_ack(ack);
+}
+
+void TFTPMulticastSession::handle_error(const ErrorView& err) {
+     this->stats.err_recv = err.errcode;
+     log_info("Master client " + addr_str(this->rem_addr)
+              + " left (error code " + std::to_string(err.errcode) + ")");
+     this->next_master();
+}
+
+/**
+ * @details Clients other than the master leave the session with the
+ *          ACK of the final block, or with an ERROR.
+ */
+void TFTPMulticastSession::handle_stray(const sockaddr_in& origin,
+                                        const PacketView& packet) {
+     auto it = this->find_member(origin);
+     if (it == this->members.end())
+          return TFTPServerConnection::handle_stray(origin, packet);
+
+     const auto* ack = packet.get<AckView>();
+     if (ack && ack->block_n >= this->last_block) {
+          log_info("Client " + addr_str(origin) + " has the file");
+          this->members.erase(it);
+     } else if (packet.get<ErrorView>()) {
+          log_info("Client " + addr_str(origin) + " left the session");
+          this->members.erase(it);
+     }
+}
+
+/* === Helper methods === */
+
+std::vector<std::pair<std::string, std::string>>
+TFTPMulticastSession::member_opts(const Member& member, bool master) const {
+     std::vector<std::pair<std::string, std::string>> res;
+     for (const auto& opt : this->session_opts) {
+          std::string name = opt.first;
+          std::transform(name.begin(), name.end(), name.begin(),
+                         static_cast<int (*)(int)>(std::tolower));
+          if (std::find(member.names.begin(), member.names.end(), name)
+              != member.names.end())
+               res.push_back(opt);
+     }
+
+     /** @see https://datatracker.ietf.org/doc/html/rfc2090#section-3 */
+     res.emplace_back("multicast",
+                      std::string(inet_ntoa(this->group.sin_addr)) + ","
+                          + std::to_string(ntohs(this->group.sin_port)) + ","
+                          + (master ? "1" : "0"));
+     return res;
+}
+
+std::deque<TFTPMulticastSession::Member>::iterator
+TFTPMulticastSession::find_member(const sockaddr_in& addr) {
+     return std::find_if(
+         this->members.begin(), this->members.end(), [&](const Member& m) {
+              return m.addr.sin_port == addr.sin_port
+                     && m.addr.sin_addr.s_addr == addr.sin_addr.s_addr;
+         });
+}
+
+/**
+ * @details The new master is sent its OACK (as the response to its
+ *          request, retransmitted until ACKed) from block 0 on, the
+ *          ACK of which tells the session where to continue.
+ */
+void TFTPMulticastSession::next_master() {
+     this->members.pop_front();
+     this->disarm_timeout();
+     this->send_tries = 0;
+     if (this->members.empty()) {
+          log_info("All clients have the file, ending the session");
+          this->set_state(TFTPConnectionState::Completed);
+          return;
+     }
+
+     this->rem_addr = this->members.front().addr;
+     log_info("Making client " + addr_str(this->rem_addr) + " master");
+     this->opts = this->member_opts(this->members.front(), true);
+     this->oack_init = true;
+     this->restart(0);
+     this->set_state(TFTPConnectionState::Uploading);
+}
+
+/**
+ * @details The window is dropped (blocks are read again from the file,
+ *          image or mapping), the blocks resent are accounted as
+ *          retransmissions.
+ */
+void TFTPMulticastSession::restart(uint64_t block) {
+     if (block != this->block_ack)
+          log_info("Continuing from block " + to_hex(block + 1));
+     this->block_ack = this->block_n = block;
+     this->win_head = this->win_count = this->win_sent = 0;
+     this->is_last = false;
+     this->file_off = static_cast<off_t>(block * this->blksize);
+}
+
+std::string TFTPMulticastSession::addr_str(const sockaddr_in& addr) {
+     return std::string(inet_ntoa(addr.sin_addr)) + ":"
+            + std::to_string(ntohs(addr.sin_port));
+}
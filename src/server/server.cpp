@@ -7,20 +7,41 @@
 
 #include "server/server.hpp"
 
+#include <fstream>
+
 /**
  * @brief SIGINT flag
  * @details Atomic flag indicating whether SIGINT was recieved,
- *          used to gracefully terminate server's connections.
+ *          used to gracefully terminate server's workers.
+ */
+static std::atomic<bool> quit(false);
+
+/**
+ * @brief SIGUSR1 flag
+ * @details Atomic flag indicating whether SIGUSR1 was recieved,
+ *          used to request a metrics dump.
+ */
+static std::atomic<bool> dump(false);
+
+/**
+ * @brief SIGUSR2 flag
+ * @details Atomic flag indicating whether SIGUSR2 was recieved,
+ *          used to stop or restart tracing.
  */
-std::atomic<bool> quit(false);
+static std::atomic<bool> trace_toggle(false);
 
 /**
- * @brief Sets the quit flag to true on SIGINT.
+ * @brief Sets the quit flag to true on SIGINT,
+ *        the dump flag on SIGUSR1 or the trace toggle on SIGUSR2.
  * @param signal - signal number
  */
-void signal_handler(int signal) {
-     (void)signal;
-     quit.store(true);
+static void signal_handler(int signal) {
+     if (signal == SIGUSR1)
+          dump.store(true);
+     else if (signal == SIGUSR2)
+          trace_toggle.store(true);
+     else
+          quit.store(true);
 }
 
 /* === Constructors === */
@@ -43,67 +64,72 @@ TFTPServer::TFTPServer(std::string rootdir, int port)
      if (!this->check_dir()) throw std::runtime_error("Invalid root directory");
 }
 
+TFTPServer::TFTPServer(std::string rootdir, int port, int threads)
+    : port(port), rootdir(std::move(rootdir)), n_threads(threads) {
+     /* Verify port number */
+     if (port < 1 || port > 65535)
+          throw std::runtime_error("Invalid port number");
+
+     /* Verify thread count */
+     if (threads < 1) throw std::runtime_error("Invalid number of threads");
+
+     /* Verify root directory */
+     if (!this->check_dir()) throw std::runtime_error("Invalid root directory");
+}
+
 /* === Server Flow === */
 
 /**
- * @details The `start` method creates a socket for the server, binds it, and
- * then starts listening for new connections in `srv_poll`, making this call
- *          blocking.
+ * @details The `start` method creates and binds a listening socket for
+ *          every worker, spawns the worker threads and then waits for
+ *          SIGINT, making this call blocking. Worker threads are spawned
+ *          with SIGINT (and SIGUSR1) blocked, so that the signals are
+ *          always delivered to the waiting main thread, which dumps the
+ *          metrics on every SIGUSR1. With a trace file, tracing runs from
+ *          the start and every SIGUSR2 stops or restarts it.
  */
 void TFTPServer::start() {
      Logger::glob_op("Starting server...");
+     this->shutd_flag = std::make_shared<std::atomic<bool>>(false);
 
-     /** @see
-      * https://moodle.vut.cz/pluginfile.php/550189/mod_folder/content/0/IPK2022-23L-03-PROGRAMOVANI.pdf#page=21
-      */
-
-     /* Create socket */
-     this->fd = socket(AF_INET, SOCK_DGRAM, 0);
-     if (this->fd == -1) throw std::runtime_error("Failed to create socket");
-
-     Logger::glob_info("socket created with FD " + std::to_string(this->fd));
-
-     /* Set address */
-     memset(&(this->addr), 0, this->addr_len);
-     this->addr.sin_family = AF_INET;
-     this->addr.sin_port = htons(port);
-     this->addr.sin_addr.s_addr = htonl(INADDR_ANY);
-
-     /* Set timeout */
-     struct timeval timeout {
-          TFTP_TIMEO, 0
-     };
-
-     if (setsockopt(this->fd, SOL_SOCKET, SO_RCVTIMEO,
-                    reinterpret_cast<char*>(&timeout), sizeof(timeout))
-         < 0)
-          throw std::runtime_error("Failed to set socket timeout");
-
-     /* Allow address:port reuse */
-     int optval = 1;
-     if (setsockopt(this->fd, SOL_SOCKET, SO_REUSEADDR | SO_REUSEPORT, &optval,
-                    sizeof(optval))
-         < 0)
-          throw std::runtime_error("Failed to set socket options");
-
-     /* Bind socket */
-     if (bind(this->fd, reinterpret_cast<struct sockaddr*>(&this->addr),
-              addr_len)
-         < 0)
-          throw std::runtime_error("Failed to bind socket : "
-                                   + std::string(strerror(errno)));
-
-     Logger::glob_info("socket bound to "
-                       + std::string(inet_ntoa(this->addr.sin_addr)) + ":"
-                       + std::to_string(ntohs(this->addr.sin_port)));
-
-     /* Make the listening socket non-blocking */
-     int flags = fcntl(this->fd, F_GETFL, 0);
-     if (flags < 0) throw std::runtime_error("Failed to get socket flags");
-
-     flags |= O_NONBLOCK;
-     if (fcntl(this->fd, F_SETFL, flags) < 0)
-          throw std::runtime_error("Failed to set socket flags");
+     /* Create the shared file cache */
+     if (this->cache_budget > 0)
+          this->cache = std::make_shared<FileCache>(this->cache_budget,
+                                                    this->cache_netascii);
+
+     /* Create the shared path cache */
+     if (this->path_entries > 0)
+          this->paths = std::make_shared<PathCache>(this->path_entries);
+
+     /* Create the shared admission control */
+     if (this->max_conns > 0 || this->max_client_conns > 0)
+          this->admission = std::make_shared<AdmissionControl>(
+              this->max_conns, this->max_client_conns);
+
+     /* Create the shared multicast groups */
+     if (this->mcast_base.has_value())
+          this->groups = std::make_shared<GroupPool>(*this->mcast_base,
+                                                     TFTP_MCAST_GROUPS);
+
+     /* Create the shared egress limit */
+     if (this->egress_rate.has_value())
+          this->egress = std::make_shared<EgressLimit>(*this->egress_rate);
+
+     /* Create and bind worker sockets */
+     for (int i = 0; i < this->n_threads; i++) {
+          auto worker = std::make_unique<TFTPServerWorker>(
+              i, this->rootdir, this->port, this->shutd_flag, this->backend,
+              this->rollover);
+          worker->set_cache(this->cache);
+          worker->set_paths(this->paths);
+          worker->set_admission(this->admission, this->queue_max);
+          worker->set_groups(this->groups);
+          worker->set_pacing(this->egress);
+          worker->set_demux(this->demux_socks);
+          worker->set_mtu(this->mtu);
+          worker->sock_init();
+          this->workers.push_back(std::move(worker));
+     }
 
      /* Set up signal handler */
      /** @see https://gist.github.com/aspyct/3462238 */
@@ -112,221 +138,116 @@ void TFTPServer::start() {
      sig_act.sa_handler = signal_handler;
      sigfillset(&sig_act.sa_mask);
      sigaction(SIGINT, &sig_act, NULL);
-     this->shutd_flag = std::make_shared<std::atomic<bool>>(false);
-
-     /* Listen */
-     srv_poll();
-}
-
-/**
- * @details `srv_poll` is the main loop of the server, listening for new
- *          connections and executing running connections. The server loop
- *          uses `poll()` to wait for events on `pollfd` objects in `fds`
- *          and handles them accordingly.
- */
-void TFTPServer::srv_poll() {
-     /* Add server to polling vector */
-     this->srv_fd.fd = this->fd;
-     this->srv_fd.events = POLLIN;
-     this->fds.push_back(this->srv_fd);
-     Logger::glob_op("Listening for connections...");
-
-     /** @see https://beej.us/guide/bgnet/pdf/bgnet_a4_c_1.pdf#section.7.2 */
-     while (true) {
-          /* Check for SIGINT */
-          if (quit.load()) return this->stop();
-
-          /* Finished connections cleanup */
-          if (this->should_cleanup())
-               this->conn_cleanup(); /** @see TFTPServer::conn_cleanup */
-
-          /* Poll */
-          int n_events = poll(fds.data(), fds.size(), POLL_TIMEO);
-          if (n_events == 0) continue;  // Nothing new on the server front
-
-          /* Check for errors */
-          if (n_events < 0) {
-               if (errno == EINTR) continue;  // Handled by signal handler
-               throw std::runtime_error("Polling error : "
-                                        + std::string(strerror(errno)));
-          }
-
-          /* Handling loop */
-          for (auto& fd : fds) {
-               if (fd.revents & POLLIN) {
-                    /* Server event => new connection */
-                    if (fd.fd == this->fd) {
-                         this->new_conn();
-                         continue;
-                    }
-
-                    /* Connection event => continue `exec()` */
-                    auto conn = this->find_conn(fd.fd);
-                    if (!conn) continue;
-                    conn->get()->exec(); /** @see TFTPConnectionBase::exec */
-
-                    /* Remove connection, if finished */
-                    if (!conn->get()->is_running())
-                         this->conn_remove(
-                             fd.fd); /** @see TFTPServer::conn_remove */
+     sigaction(SIGUSR1, &sig_act, NULL);
+     if (!this->trace_file.empty()) sigaction(SIGUSR2, &sig_act, NULL);
+
+     /* Block SIGINT, SIGUSR1 and SIGUSR2 (inherited by the workers) */
+     sigset_t sig_mask, orig_mask;
+     sigemptyset(&sig_mask);
+     sigaddset(&sig_mask, SIGINT);
+     sigaddset(&sig_mask, SIGUSR1);
+     sigaddset(&sig_mask, SIGUSR2);
+     pthread_sigmask(SIG_BLOCK, &sig_mask, &orig_mask);
+
+     /* Trace from the start */
+     if (!this->trace_file.empty()) Trace::start();
+
+     /* Spawn workers */
+     for (auto& worker : this->workers) {
+          this->threads.emplace_back([this, &worker]() {
+               try {
+                    worker->run();
+               } catch (const std::exception& e) {
+                    Logger::glob_err(e.what());
+                    kill(getpid(), SIGINT);  // Wake up and stop the server
                }
+          });
+     }
 
-               /* Clear events */
-               fd.revents &= 0;
+     /* Wait for SIGINT, dump metrics on SIGUSR1, toggle trace on SIGUSR2 */
+     while (!quit.load()) {
+          sigsuspend(&orig_mask);
+          if (dump.exchange(false)) this->dump_metrics();
+          if (trace_toggle.exchange(false)) {
+               Logger::glob_event(Trace::enabled() ? "Tracing stopped"
+                                                   : "Tracing started");
+               Trace::enabled() ? Trace::stop() : Trace::start();
           }
      }
+     pthread_sigmask(SIG_SETMASK, &orig_mask, NULL);
+
+     this->stop();
 }
 
+/**
+ * @details Sets the shared shutdown flag, on which all workers
+ *          terminate their connections and exit, and joins them.
+ */
 void TFTPServer::stop() {
      Logger::glob_op("Stopping server...");
 
      /* Set shared shutdown flag */
      this->shutd_flag->store(true);
 
-     /* Wait for all connections to close */
-     while (!this->connections.empty()) {
-          /* `exec` connections to let them transition to `Errored` */
-          for (auto& conn : this->connections) conn->exec();
-
-          /* Cleanup */
-          this->conn_cleanup(); /** @see TFTPServer::conn_cleanup */
-          std::this_thread::sleep_for(
-              std::chrono::milliseconds(TFTP_THREAD_DELAY));
+     /* Wait for all workers to drain */
+     for (auto& thread : this->threads)
+          if (thread.joinable()) thread.join();
+
+     /* Final metrics (all connections finished) */
+     if (!this->metrics_file.empty()) this->dump_metrics();
+
+     /* Trace (no thread records anymore) */
+     if (!this->trace_file.empty()) {
+          Trace::stop();
+          if (Trace::write(this->trace_file))
+               Logger::glob_info("Trace written to " + this->trace_file);
+          else
+               Logger::glob_err("Failed to write trace to "
+                                + this->trace_file);
      }
 
-     shutdown(this->fd, SHUT_RDWR);
-     close(this->fd);
-     this->fd = -1;
+     this->threads.clear();
+     this->workers.clear();
+     this->cache.reset();
+     this->paths.reset();
+     this->admission.reset();
+     this->groups.reset();
+     this->egress.reset();
 }
 
-/* == `poll()` handler methods == */
+/* === Helper Methods === */
 
 /**
- * @details `new_conn` is a `srv_poll` subroutine that handles new connections,
- *          first obtaining and parsing the packet, logging it, validating that
- *          it is a RRQ/WRQ and then instantiating a new connection object.
+ * @details Every worker only writes its own metrics, so they are summed
+ *          up into a fresh instance here (values of a running worker may
+ *          be a few events behind). The file is replaced atomically, so
+ *          that a scraper (ex. node_exporter textfile collector) never
+ *          reads a partial dump.
  */
-void TFTPServer::new_conn() {
-     /* Prepare addr and buffer */
-     struct sockaddr_in c_addr;
-     socklen_t c_addr_len = sizeof(c_addr);
-     std::array<char, TFTP_DFLT_MAXSIZE> buffer{};
-
-     /* Receive packet */
-     ssize_t bytes_rx = recvfrom(srv_fd.fd, buffer.data(), buffer.size(), 0,
-                                 (struct sockaddr*)&c_addr, &c_addr_len);
-     if (bytes_rx <= 0) return;
-
-     /* Parse packet */
-     auto packet_ptr = PacketFactory::create(buffer, bytes_rx);
-     if (!packet_ptr) return Logger::glob_err("Received an unparsable packet!");
-
-     Logger::packet(*packet_ptr, c_addr);
-     if (packet_ptr->get_opcode() != TFTPOpcode::RRQ
-         && packet_ptr->get_opcode() != TFTPOpcode::WRQ) {
-          // Am I supposed to handle this somehow?
+void TFTPServer::dump_metrics() const {
+     ServerMetrics total;
+     for (const auto& worker : this->workers)
+          total.merge(worker->get_metrics());
+     std::string text = total.to_prometheus();
+     if (this->cache) text += this->cache->to_prometheus();
+     if (this->paths) text += this->paths->to_prometheus();
+
+     if (this->metrics_file.empty()) {
+          Logger::flush();  // Do not interleave with pending logs
+          std::cout << text << std::flush;
           return;
      }
 
-     Logger::glob_event("New connection from "
-                        + std::string(inet_ntoa(c_addr.sin_addr)) + ":"
-                        + std::to_string(ntohs(c_addr.sin_port)));
-
-     /* Cast to RRQ/WRQ */
-     RequestPacket* req_packet_ptr
-         = dynamic_cast<RequestPacket*>(packet_ptr.get());
-
-     /* Instantiate a connection */
-     auto conn = std::make_shared<TFTPServerConnection>(
-         c_addr, *req_packet_ptr, this->rootdir, this->shutd_flag);
-     conn->set_addr_static();  // Client already has generated TID
-     conn->set_await_exit();   // `Awaiting` should only progress on `poll()`
-                               // event
-     conn->sock_init();
-
-     /* Add connection to storage and polling vectors */
-     struct pollfd conn_fd {
-          conn->get_fd(), POLLIN, 0
-     };
-
-     this->connections.push_back(conn);
-     this->fds.push_back(conn_fd);
-
-     /* Send response to request */
-     conn->exec();  // With `set_await_exit`, `exec` will stop after sending
-                    // response
-}
-
-/**
- * @details The `conn_remove` is a clean-up method used to remove a specific
- *          fd-identified connection from both the `connections` vector and
- *          `fds` vector. This method is called after a connection finished
- *          execution. The cleanup could be made more efficient by ex. using
- *          a map or something, but… time crunch. :)
- */
-void TFTPServer::conn_remove(int fd) {
-     /* Remove from `connections` */
-     for (size_t i = 0; i < connections.size(); ++i) {
-          if (connections[i]->get_fd() == fd) {
-               connections.erase(connections.begin() + i);
-               break;
-          }
-     }
-
-     /* Remove from `fds` */
-     for (size_t i = 0; i < fds.size(); ++i) {
-          if (fds[i].fd == fd) {
-               fds.erase(fds.begin() + i);
-               break;
-          }
+     std::string tmp = this->metrics_file + ".tmp";
+     std::ofstream out(tmp, std::ios::trunc);
+     out << text;
+     out.close();
+     if (!out || rename(tmp.c_str(), this->metrics_file.c_str()) != 0) {
+          Logger::glob_err("Failed to write metrics to " + this->metrics_file);
+          unlink(tmp.c_str());
      }
 }
 
-/**
- * @details `conn_cleanup` is another clean-up subroutine of `srv_poll`, used
- *          to remove all finished (whether successfully or not) connections
- *          from the `connections` and `fds` vectors. It simply loops over
- *          `connections`, tests if they are running, and if not it calls
- *          `conn_remove` upon them. Simple and straightforward, but not
- *          that performant, so it is called only every 100th iteration of
- *          `srv_poll` (most conns are closed right away anyway).
- */
-void TFTPServer::conn_cleanup() {
-     for (size_t idx = 0; idx < this->connections.size(); idx++) {
-          /* "Stuck in await" timeout */
-          auto now = std::chrono::steady_clock::now();
-          auto diff = now - this->connections[idx]->get_last_send_time();
-          if (this->connections[idx]->is_awaiting()
-              && std::chrono::duration_cast<std::chrono::milliseconds>(diff)
-                         .count()
-                     > CONN_TIMEOUT) {
-               Logger::conn_err(
-                   std::to_string(this->connections[idx]->get_tid()),
-                   "Connection await timeout");
-               this->conn_remove(this->connections[idx]->get_fd());
-          }
-
-          /* Finished cleanup */
-          if (this->connections[idx]->is_running()) continue;
-          this->conn_remove(this->connections[idx]->get_fd());
-     }
-}
-
-/* === Helper Methods === */
-
-/**
- * @details `find_conn` is a helper method used to find a connection object
- *          in the `connections` vector by its file descriptor. It is used
- *          to execute the connection by its `poll()` event. Again, could
- *          be made more efficient with maps or smth.
- */
-std::shared_ptr<TFTPServerConnection>* TFTPServer::find_conn(int fd) {
-     for (auto& conn : this->connections)
-          if (conn->get_fd() == fd) return &conn;
-
-     return nullptr;
-}
-
 /**
  * @details Very straightforward util that just checks whether the root
  *          directory is a valid directory and is readable and writable.
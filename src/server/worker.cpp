@@ -0,0 +1,726 @@
+/**
+ * @file worker.cpp
+ * @author Onegen Something (xkrame00@vutbr.cz)
+ * @brief TFTP server worker (reactor thread) implementation.
+ * @date 2023-10-21
+ */
+
+#include "server/worker.hpp"
+
+/* === Constructors === */
+
+TFTPServerWorker::TFTPServerWorker(
+    int id, std::string rootdir, int port,
+    std::shared_ptr<std::atomic<bool>> shutd_flag, EventLoopBackend backend,
+    TFTPBlockRollover rollover)
+    : id(id),
+      port(port),
+      rootdir(std::move(rootdir)),
+      rollover(rollover),
+      loop(EventLoop::create(backend)),
+      rx_bufs(TFTP_MMSG_BATCH),
+      rx_addrs(TFTP_MMSG_BATCH),
+      rx_iovs(TFTP_MMSG_BATCH),
+      rx_msgs(TFTP_MMSG_BATCH),
+      shutd_flag(std::move(shutd_flag)) {}
+
+/* === Worker Flow === */
+
+/**
+ * @details The `sock_init` method creates the listening socket of the
+ *          worker and binds it. All workers bind the same port, which
+ *          is allowed by `SO_REUSEPORT` – the kernel then balances
+ *          incoming requests between their sockets.
+ * @details When demultiplexing, the shared sockets (the listening one,
+ *          or `demux_socks` reply sockets) get big buffers, as they
+ *          queue the packets of many transfers.
+ */
+void TFTPServerWorker::sock_init() {
+     /** @see
+      * https://moodle.vut.cz/pluginfile.php/550189/mod_folder/content/0/IPK2022-23L-03-PROGRAMOVANI.pdf#page=21
+      */
+
+     /* Create socket */
+     this->fd = socket(AF_INET, SOCK_DGRAM, 0);
+     if (this->fd == -1) throw std::runtime_error("Failed to create socket");
+
+     Logger::glob_info("socket created with FD " + std::to_string(this->fd));
+
+     /* Set address */
+     memset(&(this->addr), 0, this->addr_len);
+     this->addr.sin_family = AF_INET;
+     this->addr.sin_port = htons(port);
+     this->addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+     /* Set timeout */
+     struct timeval timeout {
+          TFTP_TIMEO, 0
+     };
+
+     if (setsockopt(this->fd, SOL_SOCKET, SO_RCVTIMEO,
+                    reinterpret_cast<char*>(&timeout), sizeof(timeout))
+         < 0)
+          throw std::runtime_error("Failed to set socket timeout");
+
+     /* Allow address:port reuse (shared by all workers) */
+     int optval = 1;
+     if (setsockopt(this->fd, SOL_SOCKET, SO_REUSEADDR, &optval,
+                    sizeof(optval))
+             < 0
+         || setsockopt(this->fd, SOL_SOCKET, SO_REUSEPORT, &optval,
+                       sizeof(optval))
+                < 0)
+          throw std::runtime_error("Failed to set socket options");
+
+     /* Bind socket */
+     if (bind(this->fd, reinterpret_cast<struct sockaddr*>(&this->addr),
+              addr_len)
+         < 0)
+          throw std::runtime_error("Failed to bind socket : "
+                                   + std::string(strerror(errno)));
+
+     Logger::glob_info("socket bound to "
+                       + std::string(inet_ntoa(this->addr.sin_addr)) + ":"
+                       + std::to_string(ntohs(this->addr.sin_port)));
+
+     /* Make the listening socket non-blocking */
+     int flags = fcntl(this->fd, F_GETFL, 0);
+     if (flags < 0) throw std::runtime_error("Failed to get socket flags");
+
+     flags |= O_NONBLOCK;
+     if (fcntl(this->fd, F_SETFL, flags) < 0)
+          throw std::runtime_error("Failed to set socket flags");
+
+     /* Size the `recvmmsg` buffers and point the headers at them */
+     size_t rx_size = this->demux_socks < 0 ? TFTP_DFLT_MAXSIZE
+                                            : TFTP_MAX_BLKSIZE + 4;
+     for (int i = 0; i < TFTP_MMSG_BATCH; i++) {
+          this->rx_bufs[i].resize(rx_size);
+          this->rx_iovs[i] = {this->rx_bufs[i].data(), this->rx_bufs[i].size()};
+          this->rx_msgs[i].msg_hdr.msg_iov = &this->rx_iovs[i];
+          this->rx_msgs[i].msg_hdr.msg_iovlen = 1;
+     }
+
+     /* Bind connection sockets ahead of the requests */
+     if (this->demux_socks < 0) return this->sockets.fill();
+
+     /* Shared sockets (best effort buffer sizes, capped by the kernel) */
+     for (int i = 0; i < this->demux_socks; i++)
+          this->reply_socks.push_back(SocketPool::open_socket());
+
+     int bufsize = TFTP_DEMUX_SOCKBUF;
+     auto enlarge = [&bufsize](int sock) {
+          setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &bufsize, sizeof(bufsize));
+          setsockopt(sock, SOL_SOCKET, SO_SNDBUF, &bufsize, sizeof(bufsize));
+     };
+     enlarge(this->fd);
+     for (const auto& reply : this->reply_socks) enlarge(reply.fd);
+
+     Logger::glob_info(
+         "Worker " + std::to_string(this->id) + " demultiplexing on "
+         + (this->demux_socks == 0
+                ? std::string("the listening socket")
+                : std::to_string(this->demux_socks) + " reply socket(s)"));
+}
+
+/**
+ * @details Runs the `srv_poll` loop and, once it returns on shutdown,
+ *          drains the connections of this worker.
+ */
+void TFTPServerWorker::run() {
+     this->srv_poll();
+     this->drain();
+}
+
+/**
+ * @details `srv_poll` is the main loop of the worker, listening for new
+ *          connections and executing running connections. The loop
+ *          waits for events on the worker `EventLoop` and handles them
+ *          accordingly, until the shutdown flag is set. Connection events
+ *          carry the connection pointer, so no lookup is needed.
+ * @details Both socket readiness and an expired retransmit timer of
+ *          a connection just continue its `exec()` – the connection
+ *          checks its deadline itself on entering `Awaiting`.
+ * @details Demultiplexed connections have their timers in
+ *          `demux_timers`, so the wait also ends at their nearest
+ *          deadline.
+ * @details When pacing, connections with DATA waiting get their turns
+ *          after the events of every round (`sched_flush`), and the
+ *          wait ends once the next of them may send.
+ */
+void TFTPServerWorker::srv_poll() {
+     /* Add server (and shared reply sockets) to the event loop */
+     this->loop->add(this->fd, nullptr);
+     for (const auto& reply : this->reply_socks)
+          this->loop->add(reply.fd, nullptr);
+     Logger::glob_op("Worker " + std::to_string(this->id)
+                     + " listening for connections...");
+
+     /** @see https://beej.us/guide/bgnet/pdf/bgnet_a4_c_1.pdf#section.7.2 */
+     while (true) {
+          /* Check for shutdown */
+          if (this->shutd_flag->load()) return;
+
+          /* Admit queued requests (slots may have been freed) */
+          if (!this->queue.empty()) this->admit_queued();
+
+          /* Wait for events (or the nearest retransmit deadline) */
+          auto now = TimerQueue::Clock::now();
+          int timeout = this->demux_timers.timeout_ms(
+              now, this->queue.empty() ? POLL_TIMEO : TFTP_QUEUE_POLL_MS);
+          if (!this->drr.empty())
+               timeout = std::min(
+                   timeout,
+                   static_cast<int>(
+                       std::chrono::ceil<std::chrono::milliseconds>(
+                           std::max(this->tx_wake - now,
+                                    TimerQueue::Clock::duration::zero()))
+                           .count()));
+          if (this->loop->wait(timeout) == 0 && this->demux_timers.size() == 0
+              && this->drr.empty())
+               continue;  // Nothing new on the server front
+          auto iter_start = std::chrono::steady_clock::now();
+
+          /* Handling loop */
+          for (const auto& event : this->loop->get_events()) {
+               /* Server event => new connection(s) or demultiplexing */
+               if (event.fd == this->fd || this->is_reply_sock(event.fd)) {
+                    this->srv_recv(event.fd);
+                    continue;
+               }
+
+               /* Connection event or timeout => continue `exec()` */
+               auto* conn = static_cast<TFTPServerConnection*>(event.data);
+               if (!conn) continue;  // Removed earlier in this round
+               this->conn_exec(conn, event.fd);
+          }
+          if (this->demux_timers.size() > 0) this->demux_expire();
+          if (!this->drr.empty()) this->sched_flush();
+
+          this->metrics.loop_us.observe(
+              std::chrono::duration_cast<std::chrono::microseconds>(
+                  std::chrono::steady_clock::now() - iter_start)
+                  .count());
+     }
+}
+
+/**
+ * @details `drain` lets all the connections of this worker terminate
+ *          (with the shutdown flag set, `exec` makes them send an ERROR
+ *          and transition to `Errored`) and closes the worker socket.
+ *          Queued requests are refused.
+ */
+void TFTPServerWorker::drain() {
+     for (const auto& queued : this->queue)
+          this->refuse(queued.addr, "Server shutting down");
+     this->queue.clear();
+
+     /* Wait for all connections to close */
+     while (!this->connections.empty()) {
+          /* `exec` connections to let them transition to `Errored` */
+          for (auto& [conn_fd, conn] : this->connections) conn->exec();
+
+          /* Cleanup */
+          this->conn_cleanup(); /** @see TFTPServerWorker::conn_cleanup */
+     }
+
+     Logger::glob_info("Worker " + std::to_string(this->id) + " requests: "
+                       + this->rx_batches.to_string() + ", DATA sent: "
+                       + this->tx_batches.to_string());
+
+     for (const auto& reply : this->reply_socks) {
+          this->loop->remove(reply.fd);
+          close(reply.fd);
+     }
+     this->reply_socks.clear();
+
+     if (this->fd < 0) return;
+     this->loop->remove(this->fd);
+     shutdown(this->fd, SHUT_RDWR);
+     close(this->fd);
+     this->fd = -1;
+}
+
+/* == `poll()` handler methods == */
+
+/**
+ * @details `srv_recv` is a `srv_poll` subroutine that empties the listening
+ *          socket queue, receiving up to `TFTP_MMSG_BATCH` requests per
+ *          `recvmmsg` call (so a burst of requests costs a few syscalls
+ *          instead of a wakeup each) and passing them to `new_conn`.
+ *          When demultiplexing, every datagram goes to `demux` instead
+ *          (and one call serves the packets of many transfers).
+ */
+void TFTPServerWorker::srv_recv(int sock) {
+     while (true) {
+          /* Reset in/out address lengths */
+          for (int i = 0; i < TFTP_MMSG_BATCH; i++) {
+               this->rx_msgs[i].msg_hdr.msg_name = &this->rx_addrs[i];
+               this->rx_msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+          }
+
+          /* Receive batch */
+          int n_msgs = recvmmsg(sock, this->rx_msgs.data(), TFTP_MMSG_BATCH,
+                                MSG_DONTWAIT, nullptr);
+          if (n_msgs <= 0) {
+               if (n_msgs < 0 && errno == EINTR) continue;
+               return;  // Queue empty (or error)
+          }
+          this->rx_batches.add(n_msgs);
+
+          /* Handle requests */
+          for (int i = 0; i < n_msgs; i++) {
+               size_t len = this->rx_msgs[i].msg_len;
+               if (len == 0) continue;
+               std::span<const char> data(this->rx_bufs[i].data(), len);
+               if (this->demux_socks < 0)
+                    this->new_conn(data, this->rx_addrs[i]);
+               else
+                    this->demux(sock, data, this->rx_addrs[i]);
+          }
+
+          /* Short batch => queue is empty */
+          if (n_msgs < TFTP_MMSG_BATCH) return;
+     }
+}
+
+/**
+ * @details `new_conn` is a `srv_recv` subroutine that handles new connections,
+ *          parsing the packet, logging it, validating that it is a RRQ/WRQ
+ *          and then instantiating a new connection object.
+ * @details A request equal to one being served (or queued) is a client
+ *          retransmit and is dropped. As the kernel picks the worker by
+ *          the client address and port, retransmits always arrive at the
+ *          same worker, so the table of requests is per worker. Requests
+ *          over the admission caps are queued (if there is room) or
+ *          refused.
+ */
+void TFTPServerWorker::new_conn(std::span<const char> data,
+                                const sockaddr_in& c_addr) {
+     /* Parse packet */
+     auto packet_ptr = PacketFactory::create(data);
+     if (!packet_ptr) return Logger::glob_err("Received an unparsable packet!");
+
+     Logger::packet(*packet_ptr, c_addr);
+     if (packet_ptr->get_opcode() != TFTPOpcode::RRQ
+         && packet_ptr->get_opcode() != TFTPOpcode::WRQ) {
+          // Am I supposed to handle this somehow?
+          return;
+     }
+
+     /* Cast to RRQ/WRQ */
+     RequestPacket* req_packet_ptr
+         = dynamic_cast<RequestPacket*>(packet_ptr.get());
+
+     /* Count the request */
+     (req_packet_ptr->get_type() == TFTPRequestType::Read ? this->metrics.rrq
+                                                          : this->metrics.wrq)
+         .add();
+
+     std::string client = std::string(inet_ntoa(c_addr.sin_addr)) + ":"
+                          + std::to_string(ntohs(c_addr.sin_port));
+
+     /* Join the multicast session of the file, if there is one */
+     if (this->groups && this->demux_socks < 0) {
+          auto session = TFTPMulticastSession::session_key(*req_packet_ptr);
+          auto it = session ? this->sessions.find(*session)
+                            : this->sessions.end();
+          if (it != this->sessions.end()) {
+               Logger::glob_event("Multicast request from " + client);
+               return static_cast<TFTPMulticastSession*>(
+                          this->connections.at(it->second).get())
+                   ->join(c_addr, *req_packet_ptr);
+          }
+     }
+
+     /* Drop duplicates */
+     RequestKey key{c_addr.sin_addr.s_addr, c_addr.sin_port,
+                    req_packet_ptr->get_type(),
+                    req_packet_ptr->get_filename()};
+     if (this->requests.count(key)) {
+          this->metrics.req_duplicate.add();
+          return Logger::glob_event("Duplicate request from " + client
+                                    + " (ignoring)");
+     }
+
+     /* Over the caps => queue or refuse */
+     if (this->admission
+         && !this->admission->acquire(c_addr.sin_addr.s_addr)) {
+          if (this->queue.size() < this->queue_max) {
+               this->metrics.req_queued.add();
+               this->requests.emplace(key, -1);
+               this->queue.push_back({std::vector<char>(data.begin(),
+                                                        data.end()),
+                                      c_addr, key,
+                                      std::chrono::steady_clock::now()});
+               return Logger::glob_event("Queued request from " + client);
+          }
+
+          this->metrics.req_rejected.add();
+          return this->refuse(c_addr, "Server busy, try again later");
+     }
+
+     Logger::glob_event("New connection from " + client);
+     this->open_conn(*req_packet_ptr, c_addr, key);
+}
+
+/**
+ * @details A demultiplexed connection is found by its remote host only,
+ *          so a second transfer from the same address and port (ex.
+ *          another file requested before the first one finished)
+ *          is refused.
+ * @details An RRQ asking for `multicast` starts a multicast session on
+ *          a group of the pool; with none left, it is served as
+ *          a plain download (the option is then not answered).
+ */
+void TFTPServerWorker::open_conn(const RequestPacket& req,
+                                 const sockaddr_in& c_addr,
+                                 const RequestKey& key) {
+     if (this->demux_socks >= 0 && this->peers.find(c_addr) >= 0) {
+          this->metrics.req_rejected.add();
+          if (this->admission) this->admission->release(key.addr);
+          this->requests.erase(key);
+          return this->refuse(c_addr, "Transfer from this port in progress");
+     }
+
+     /* Instantiate a connection (or a multicast session) */
+     auto setup_start = std::chrono::steady_clock::now();
+     std::optional<std::string> session;
+     std::optional<sockaddr_in> group;
+     if (this->groups && this->demux_socks < 0)
+          session = TFTPMulticastSession::session_key(req);
+     if (session.has_value()) {
+          group = this->groups->acquire();
+          if (!group.has_value())
+               Logger::glob_event("No multicast group left, serving "
+                                  + req.get_filename() + " by unicast");
+     }
+
+     std::shared_ptr<TFTPServerConnection> conn;
+     if (group.has_value())
+          conn = std::make_shared<TFTPMulticastSession>(
+              c_addr, req, this->rootdir, this->shutd_flag, *this->groups,
+              *group);
+     else
+          conn = std::make_shared<TFTPServerConnection>(
+              c_addr, req, this->rootdir, this->shutd_flag, this->rollover);
+     this->metrics.conn_opened.add();
+     conn->set_metrics(&this->metrics);
+     conn->set_cache(this->cache.get());
+     conn->set_paths(this->paths.get());
+     conn->set_mtu(this->mtu);
+     conn->set_writer(&this->writer);
+     conn->set_scheduled(this->egress != nullptr);
+     conn->set_addr_static();  // Client already has generated TID
+
+     /* Recycled buffers and a pre-bound (or shared) socket */
+     if (!this->buffers.empty()) {
+          conn->set_buffers(std::move(this->buffers.back()));
+          this->buffers.pop_back();
+     }
+
+     int conn_key;
+     if (this->demux_socks < 0) {
+          auto sock = this->sockets.acquire();
+          conn->sock_adopt(sock.fd, sock.port);
+          conn_key = sock.fd;
+     } else {
+          SocketPool::Socket sock{this->fd, static_cast<uint16_t>(this->port)};
+          if (!this->reply_socks.empty())
+               sock = this->reply_socks[this->reply_next++
+                                        % this->reply_socks.size()];
+          conn->sock_share(sock.fd, sock.port);
+
+          int slot = static_cast<int>(this->demuxed.size());
+          if (!this->demux_free.empty()) {
+               slot = this->demux_free.back();
+               this->demux_free.pop_back();
+          } else {
+               this->demuxed.emplace_back();
+          }
+          this->demuxed[slot] = {conn.get(), c_addr};
+          this->peers.insert(c_addr, slot);
+          conn_key = demux_key(slot);
+     }
+     this->metrics.setup_us.observe(
+         std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - setup_start)
+             .count());
+
+     /* Add connection to storage and the event loop */
+     this->connections.emplace(conn_key, conn);
+     this->requests[key] = conn_key;
+     this->conn_requests.emplace(conn_key, key);
+     if (group.has_value()) this->sessions[*session] = conn_key;
+     if (conn_key >= 0) this->loop->add(conn_key, conn.get());
+
+     /* Send response to request */
+     this->conn_exec(conn.get(), conn_key);  // `exec` suspends after
+                                             // sending the response
+}
+
+/**
+ * @details Queued requests are admitted in order, but one over the cap
+ *          of its client does not hold up requests of other clients.
+ */
+void TFTPServerWorker::admit_queued() {
+     auto now = std::chrono::steady_clock::now();
+     for (auto it = this->queue.begin(); it != this->queue.end();) {
+          if (now - it->since >= std::chrono::seconds(TFTP_QUEUE_TIMEO)) {
+               this->metrics.req_expired.add();
+               this->requests.erase(it->key);
+               this->refuse(it->addr, "Server busy, try again later");
+               it = this->queue.erase(it);
+               continue;
+          }
+
+          if (!this->admission->acquire(it->addr.sin_addr.s_addr)) {
+               ++it;
+               continue;
+          }
+
+          QueuedRequest queued = std::move(*it);
+          it = this->queue.erase(it);
+
+          auto packet_ptr = PacketFactory::create(queued.data);
+          Logger::glob_event("New connection from "
+                             + std::string(inet_ntoa(queued.addr.sin_addr))
+                             + ":"
+                             + std::to_string(ntohs(queued.addr.sin_port))
+                             + " (queued)");
+          this->open_conn(dynamic_cast<RequestPacket&>(*packet_ptr),
+                          queued.addr, queued.key);
+     }
+}
+
+void TFTPServerWorker::refuse(const sockaddr_in& c_addr,
+                              const std::string& msg) {
+     Logger::glob_event("Refusing request from "
+                        + std::string(inet_ntoa(c_addr.sin_addr)) + ":"
+                        + std::to_string(ntohs(c_addr.sin_port)) + ": "
+                        + msg);
+
+     auto payload = ErrorPacket(TFTPErrorCode::Unknown, msg).to_binary();
+     sendto(this->fd, payload.data(), payload.size(), 0,
+            reinterpret_cast<const sockaddr*>(&c_addr), sizeof(c_addr));
+}
+
+/**
+ * @details Packets from unknown hosts, or from a known one but on
+ *          another reply socket than its connection's, are answered
+ *          with an ERROR (unknown TID) – the check a connection on its
+ *          own socket makes in `recv_packet`. On the listening socket,
+ *          those go to `new_conn` instead, same as requests.
+ */
+void TFTPServerWorker::demux(int sock, std::span<const char> data,
+                             const sockaddr_in& c_addr) {
+     bool request = data.size() >= 2 && data[0] == 0
+                    && (data[1] == static_cast<char>(TFTPOpcode::RRQ)
+                        || data[1] == static_cast<char>(TFTPOpcode::WRQ));
+     if (request && sock == this->fd) return this->new_conn(data, c_addr);
+
+     int slot = this->peers.find(c_addr);
+     if (slot < 0 || this->demuxed[slot].conn->get_fd() != sock) {
+          if (sock == this->fd) return this->new_conn(data, c_addr);
+
+          Logger::glob_info("Received packet from unexpected origin");
+          auto payload = ErrorPacket(TFTPErrorCode::UnknownTID,
+                                     "Unexpected packet origin")
+                             .to_binary();
+          sendto(sock, payload.data(), payload.size(), 0,
+                 reinterpret_cast<const sockaddr*>(&c_addr), sizeof(c_addr));
+          return;
+     }
+
+     auto* conn = this->demuxed[slot].conn;
+     conn->deliver(data);
+     this->conn_exec(conn, demux_key(slot));
+}
+
+void TFTPServerWorker::demux_expire() {
+     this->demux_expired.clear();
+     this->demux_timers.expire(TimerQueue::Clock::now(), this->demux_expired);
+     for (const auto& timer : this->demux_expired)
+          this->conn_exec(static_cast<TFTPServerConnection*>(timer.data),
+                          demux_key(timer.fd));
+}
+
+/**
+ * @details Turns (see `DrrQueue`) of the connections with DATA
+ *          waiting, each sending as far as its deficit, its pacer and
+ *          the budget of the egress limit let. Then `tx_wake` is
+ *          set to the time the next of them may send: the nearest
+ *          pacer (of those in the round), but not before the egress
+ *          budget covers the smallest packet waiting.
+ */
+void TFTPServerWorker::sched_flush() {
+     auto now = TimerQueue::Clock::now();
+     size_t budget = this->egress->budget(now);
+     auto wake = TimerQueue::TimePoint::max();
+     size_t want = SIZE_MAX;
+     size_t sent = this->drr.serve(
+         budget, [&](int key, void* data, size_t allowance) {
+              auto* conn = static_cast<TFTPServerConnection*>(data);
+              size_t bytes = conn->flush(allowance);
+              if (bytes > 0) this->conn_arm(conn, key);  // Deadline moved
+              if (!conn->has_unsent()) return DrrQueue::Served{bytes, false};
+
+              auto ready = conn->pace_ready();
+              wake = std::min(wake, ready);
+              want = std::min(want, conn->unsent_size());
+              return DrrQueue::Served{bytes, true,
+                                      ready > TimerQueue::Clock::now()};
+         });
+     if (budget != SIZE_MAX && sent > 0) this->egress->consume(sent);
+
+     if (wake == TimerQueue::TimePoint::max()) wake = now;  // Not visited
+     this->tx_wake = std::max(
+         wake, this->egress->ready_at(want == SIZE_MAX ? TFTP_DFLT_MAXSIZE
+                                                       : want));
+}
+
+/**
+ * @details After `exec()` returns, the connection either finished (and
+ *          is removed) or awaits a packet, in which case its timer is
+ *          re-armed to the current retransmit deadline (or cancelled,
+ *          if there is none). A paced connection that left DATA to send
+ *          is queued for its turn.
+ */
+void TFTPServerWorker::conn_exec(TFTPServerConnection* conn, int key) {
+     conn->exec(); /** @see TFTPConnectionBase::exec */
+
+     /* Remove connection, if finished */
+     if (!conn->is_running())
+          return this->conn_remove(
+              key); /** @see TFTPServerWorker::conn_remove */
+
+     if (this->egress && conn->has_unsent()) this->drr.push(key, conn);
+     this->conn_arm(conn, key);
+}
+
+void TFTPServerWorker::conn_arm(TFTPServerConnection* conn, int key) {
+     auto deadline = conn->get_deadline();
+     if (key >= 0) {
+          if (deadline.has_value())
+               this->loop->arm_timer(key, conn, *deadline);
+          else
+               this->loop->cancel_timer(key);
+     } else {
+          if (deadline.has_value())
+               this->demux_timers.arm(demux_key(key), conn, *deadline);
+          else
+               this->demux_timers.cancel(demux_key(key));
+     }
+}
+
+/**
+ * @details The `conn_remove` is a clean-up method used to remove a specific
+ *          key-identified connection from both the `connections` map and
+ *          the event loop (both O(1), incl. its timer). This method is
+ *          called after a connection finished execution.
+ */
+void TFTPServerWorker::conn_remove(int key) {
+     /* Stop watching before the connection closes its socket */
+     this->conn_unwatch(key);
+
+     auto it = this->connections.find(key);
+     if (it == this->connections.end()) return;
+     this->conn_account(*it->second);
+     this->conn_release(key);
+     this->conn_recycle(*it->second, key);
+     this->connections.erase(it);
+}
+
+/**
+ * @details `demux_key` is its own inverse, so it also turns the key of
+ *          a demultiplexed connection back into its slot.
+ */
+void TFTPServerWorker::conn_unwatch(int key) {
+     this->drr.remove(key);
+     if (key >= 0) return this->loop->remove(key);
+
+     int slot = demux_key(key);
+     if (!this->demuxed[slot].conn) return;
+     this->demux_timers.cancel(slot);
+     this->peers.erase(this->demuxed[slot].peer);
+     this->demuxed[slot] = {};
+     this->demux_free.push_back(slot);
+}
+
+/**
+ * @details `conn_cleanup` is a clean-up subroutine of `drain`, used to
+ *          remove all finished (whether successfully or not) connections.
+ * @note Connections stuck in `Awaiting` do not need to be swept: their
+ *       retransmit timer makes them error out after `TFTP_MAX_RETRIES`.
+ */
+void TFTPServerWorker::conn_cleanup() {
+     for (auto it = this->connections.begin();
+          it != this->connections.end();) {
+          if (it->second->is_running()) {
+               ++it;
+               continue;
+          }
+
+          this->conn_unwatch(it->first);
+          this->conn_account(*it->second);
+          this->conn_release(it->first);
+          this->conn_recycle(*it->second, it->first);
+          it = this->connections.erase(it);
+     }
+}
+
+/**
+ * @details Folds the batch counters and statistics of a finished
+ *          connection into the worker totals.
+ */
+void TFTPServerWorker::conn_account(const TFTPServerConnection& conn) {
+     this->tx_batches.merge(conn.get_tx_batches());
+     this->metrics.add_conn(conn.get_stats(), conn.is_errored());
+}
+
+/**
+ * @details With admission control, every connection holds a slot of its
+ *          client (taken before `open_conn`). A multicast session holds
+ *          only that of its first client.
+ */
+void TFTPServerWorker::conn_release(int key) {
+     std::erase_if(this->sessions, [key](const auto& session) {
+          return session.second == key;
+     });
+
+     auto it = this->conn_requests.find(key);
+     if (it == this->conn_requests.end()) return;
+
+     if (this->admission) this->admission->release(it->second.addr);
+     this->requests.erase(it->second);
+     this->conn_requests.erase(it);
+}
+
+/**
+ * @details Only buffer sets within `TFTP_BUFFER_POOL_MAX` are kept, so
+ *          that a few big transfers do not pin their memory. Shared
+ *          sockets stay with the worker.
+ */
+void TFTPServerWorker::conn_recycle(TFTPServerConnection& conn, int key) {
+     int tid = conn.get_tid();
+     if (key >= 0)
+          this->sockets.release(
+              {conn.take_socket(), static_cast<uint16_t>(tid)});
+
+     auto bufs = conn.take_buffers();
+     if (this->buffers.size() < TFTP_BUFFER_POOL
+         && bufs.capacity() <= TFTP_BUFFER_POOL_MAX)
+          this->buffers.push_back(std::move(bufs));
+}
+
+/* === Helper types === */
+
+size_t TFTPServerWorker::RequestKeyHash::operator()(
+    const RequestKey& key) const {
+     uint64_t tid = uint64_t{key.addr} << 17 | uint64_t{key.port} << 1
+                    | (key.type == TFTPRequestType::Write);
+     size_t hash = std::hash<std::string>()(key.filename);
+     return hash
+            ^ (std::hash<uint64_t>()(tid) + 0x9e3779b9 + (hash << 6)
+               + (hash >> 2));
+}
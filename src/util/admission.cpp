@@ -0,0 +1,43 @@
+/**
+ * @file admission.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Admission control of server connections
+ * @date 2023-11-22
+ */
+
+#include "util/admission.hpp"
+
+/* === Core methods === */
+
+bool AdmissionControl::acquire(in_addr_t client) {
+     std::lock_guard<std::mutex> lock(this->mtx);
+     if (this->max_total > 0 && this->active >= this->max_total)
+          return false;
+
+     auto it = this->per_client.find(client);
+     if (this->max_per_client > 0 && it != this->per_client.end()
+         && it->second >= this->max_per_client)
+          return false;
+
+     this->per_client[client]++;
+     this->active++;
+     return true;
+}
+
+/**
+ * @details Clients without any connection are dropped from the table,
+ *          so it stays as big as the set of active clients.
+ */
+void AdmissionControl::release(in_addr_t client) {
+     std::lock_guard<std::mutex> lock(this->mtx);
+     auto it = this->per_client.find(client);
+     if (it == this->per_client.end()) return;
+
+     if (--it->second == 0) this->per_client.erase(it);
+     this->active--;
+}
+
+size_t AdmissionControl::get_active() const {
+     std::lock_guard<std::mutex> lock(this->mtx);
+     return this->active;
+}
@@ -7,6 +7,12 @@
 
 #include "util/connection.hpp"
 
+#include <netinet/udp.h>
+#include <strings.h>
+#include <sys/statvfs.h>
+
+#include <random>
+
 /* === Setup methods === */
 
 /**
@@ -21,16 +27,28 @@
  *          destruction via the `Logger` util class. If the connection
  *          was downloading a file, but it ended prematurely, destructor
  *          will remove this incomplete file.
+ * @details Blocks preallocated past the written end (a `tsize` larger
+ *          than the data, or NetASCII decoded shorter) are given back by
+ *          truncating the file to its size once the writes are done.
  * @see https://moodle.vut.cz/mod/forum/discuss.php?d=2929#p4633
  */
 TFTPConnectionBase::~TFTPConnectionBase() {
-     /* Close the socket */
-     if (this->conn_fd != -1) {
+     /* Close the socket (unless shared) */
+     if (this->conn_fd != -1 && !this->sock_shared) {
           close(this->conn_fd);
           this->conn_fd = -1;
      }
+     if (this->group_fd != -1) {
+          close(this->group_fd);  // Leaves the group
+          this->group_fd = -1;
+     }
 
-     /* Close the file */
+     /* Wait for writes in flight, then close the file */
+     this->write_behind.reset();
+     struct stat st;
+     if (this->preallocated && !this->is_errored()
+         && fstat(this->file_fd, &st) == 0)
+          (void)ftruncate(this->file_fd, st.st_size);  // Frees KEEP_SIZE
      if (this->file_fd != -1) {
           close(this->file_fd);
           this->file_fd = -1;
@@ -43,7 +61,7 @@ TFTPConnectionBase::~TFTPConnectionBase() {
           }
      }
 
-     if (this->tid > 0)
+     if (this->tid > 0 && Logger::enabled(LogLevel::Info))
           Logger::glob_event("Closed connection [" + std::to_string(this->tid)
                              + "]");
 }
@@ -66,27 +84,7 @@ void TFTPConnectionBase::sock_init() {
      this->con_addr.sin_port = htons(0);  // => random port
      this->con_addr.sin_addr.s_addr = htonl(INADDR_ANY);
 
-     /* Set timeout */
-     struct timeval timeout {
-          TFTP_TIMEO, 0
-     };
-
-     if (setsockopt(this->conn_fd, SOL_SOCKET, SO_RCVTIMEO,
-                    reinterpret_cast<char *>(&timeout), sizeof(timeout))
-             < 0
-         || setsockopt(this->conn_fd, SOL_SOCKET, SO_SNDTIMEO,
-                       reinterpret_cast<char *>(&timeout), sizeof(timeout))
-                < 0)
-          throw std::runtime_error("Failed to set socket timeout");
-
-     /* Allow address:port reuse */
-     int optval = 1;
-     if (setsockopt(this->conn_fd, SOL_SOCKET, SO_REUSEADDR | SO_REUSEPORT,
-                    &optval, sizeof(optval))
-         < 0)
-          throw std::runtime_error("Failed to set socket options");
-
-     /* Bind socket */
+     /* Bind socket (a fresh ephemeral port needs no address reuse) */
      if (bind(this->conn_fd,
               reinterpret_cast<struct sockaddr *>(&this->con_addr),
               this->con_addr_len)
@@ -105,16 +103,75 @@ void TFTPConnectionBase::sock_init() {
      Logger::glob_info("socket bound to "
                        + std::string(inet_ntoa(this->con_addr.sin_addr)) + ":"
                        + std::to_string(ntohs(this->con_addr.sin_port)));
+
+     /* `exec` must never block on `recvfrom` (waits are up to its
+      * caller, see `run`), so no socket timeouts either */
+     int flags = fcntl(this->conn_fd, F_GETFL, 0);
+     if (flags < 0 || fcntl(this->conn_fd, F_SETFL, flags | O_NONBLOCK) < 0)
+          throw std::runtime_error("Failed to set socket flags");
+
      rx_buffer.resize(this->blksize + 4);
      this->set_state(TFTPConnectionState::Requesting);
 }
 
+/**
+ * @details Skips all the socket setup syscalls of `sock_init` – the
+ *          socket was created non-blocking and bound ahead of time.
+ */
+void TFTPConnectionBase::sock_adopt(int fd, uint16_t port) {
+     this->conn_fd = fd;
+     this->tid = port;
+     this->con_addr.sin_family = AF_INET;
+     this->con_addr.sin_port = htons(port);
+     this->con_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+     this->rx_buffer.resize(this->blksize + 4);
+     this->set_state(TFTPConnectionState::Requesting);
+}
+
+/**
+ * @details Same as `sock_adopt`, except that the socket is left open on
+ *          destruction (`take_socket` is not needed).
+ */
+void TFTPConnectionBase::sock_share(int fd, uint16_t port) {
+     this->sock_shared = true;
+     this->sock_adopt(fd, port);
+}
+
+/**
+ * @details The packet is copied into `rx_buffer`, where `recv_packet`
+ *          would have received it. `flow` does not suspend with
+ *          a delivered packet pending, so the next `exec` always
+ *          processes it (after a retransmit timeout, if one is due).
+ */
+void TFTPConnectionBase::deliver(std::span<const char> data) {
+     size_t len = std::min(data.size(), this->rx_buffer.size());
+     std::copy_n(data.begin(), len, this->rx_buffer.begin());
+     this->rx_len = static_cast<ssize_t>(len);
+     this->rx_pending = true;
+}
+
+void TFTPConnectionBase::set_buffers(Buffers &&buffers) {
+     this->rx_buffer = std::move(buffers.rx);
+     this->na_buffer = std::move(buffers.na);
+     this->window = std::move(buffers.window);
+}
+
+TFTPConnectionBase::Buffers TFTPConnectionBase::take_buffers() {
+     this->win_data.clear();
+     this->win_ready = false;
+     return {std::move(this->rx_buffer), std::move(this->na_buffer),
+             std::move(this->window)};
+}
+
 /**
  * @details The `run` method is the main method of the connection.
  *          It will create a socket and set up the connection
  *          (incl. TID, binding and whatnot), after which it will
- *          call the internal `exec()` method that handles state
- *          logic. As such, `run()` is a blocking method.
+ *          drive the connection `flow` (see `exec`), blocking in
+ *          `await_readable` while it awaits a packet – the same flow
+ *          an event loop drives. As such, `run()` is a blocking
+ *          method.
  * @throws std::runtime_error if the socket creation screws up
  * @see
  * https://moodle.vut.cz/pluginfile.php/550189/mod_folder/content/0/IPK2022-23L-03-PROGRAMOVANI.pdf#page=16
@@ -125,40 +182,50 @@ void TFTPConnectionBase::run() {
      /* Init socket */
      this->sock_init();
 
-     /* Start connection */
-     this->exec();  // ! Blocking until connection is done or errs
+     /* Start connection, wait for packets whenever it suspends */
+     this->exec();
+     while (!this->task.done()) {
+          this->await_readable();
+          this->exec();
+     }
 }
 
 /* === Connection flow === */
 
 /**
- * @details The `exec` method is the handling loop of the connection.
+ * @details The coroutine of `flow` is created on the first call (its
+ *          frame lives as long as the connection) and resumed on every
+ *          call after.
+ */
+void TFTPConnectionBase::exec() {
+     if (!this->task.valid()) this->task = this->flow();
+     this->task.resume();
+}
+
+/**
+ * @details The `flow` coroutine is the handling loop of the connection.
  *          It will call handler function for each state, which will
  *          handle the state logic and return the next state. The
  *          loop will run until the connection is done or errored.
+ * @details Awaiting a packet suspends the coroutine (unless one was
+ *          delivered already) until its owner resumes it with `exec`
+ *          – an event loop on socket readiness or at the `deadline`,
+ *          or `run` after `await_readable`. Every resumption handles
+ *          (at most) one packet or the timeout, and the flow suspends
+ *          again if it still awaits. Suspended transfers cost only the
+ *          coroutine frame (a few locals) on top of the connection.
  * @note Derived classes are expected to set up a virtual method
  *       `should_shutd()` using which they can terminate the
  *       connection (server sets it to a shared pointer atomic flag
  *       using which the server can terminate all its connections).
- * @note The `exec_unblock` flag was added later to allow `poll()`
- *       server handling (it was originally multi-threaded). The flag
- *       is set when conn transitions to the `Awaiting` state, which
- *       meants it, well, is awaitng a packet – so the server can
- *       `poll()` the connection and unblock it when a packet arrives.
  */
-void TFTPConnectionBase::exec() {
+Task TFTPConnectionBase::flow() {
      while (this->is_running()) {
-          /* Check unblock flag */
-          if (this->exec_unblock) {
-               this->exec_unblock = false;
-               break;
-          }
-
           /* Check shutdown flag */
           if (this->should_shutd()) {
                log_info("Shutdown flag detected, stopping...");
                this->send_error(TFTPErrorCode::Unknown, "Terminated by user");
-               break;
+               co_return;
           }
 
           /* Handle state */
@@ -168,6 +235,13 @@ void TFTPConnectionBase::exec() {
                                       : this->handle_request_download();
                     break;
                case TFTPConnectionState::Awaiting:
+                    /* Wait for the next event (packet or deadline) */
+                    if (!this->rx_pending) {
+                         co_await std::suspend_always{};
+                         if (this->should_shutd() || !this->is_running())
+                              continue;  // Ex. failed sending in `flush`
+                    }
+
                     this->is_upload() ? this->handle_await_upload()
                                       : this->handle_await_download();
                     break;
@@ -179,13 +253,10 @@ void TFTPConnectionBase::exec() {
                     break;
                default:
                     log_error("`run` called in invalid state");
-                    return send_error(TFTPErrorCode::Unknown,
-                                      "Bad internal state");
+                    this->send_error(TFTPErrorCode::Unknown,
+                                     "Bad internal state");
+                    co_return;
           }
-
-          /* Short sleep (to prevent CPU-hogging) */
-          std::this_thread::sleep_for(
-              std::chrono::microseconds(TFTP_THREAD_DELAY));
      }
 }
 
@@ -197,8 +268,26 @@ void TFTPConnectionBase::exec() {
  *          (when we can be sure server is OK with out options).
  *          Method returns a vector of SUCCESSFULLY processed options
  *          (so that server can send back an OACK right away).
- * @note Currently the RFC 2347 is implemented, but no extending RFCs
- *       that uitilise options are. This method is essentally a stub.
+ * @note Supported options are `blksize` (RFC 2348), `tsize` and
+ *       `timeout` (RFC 2349), `windowsize` (RFC 7440) and `rollover`
+ *       (value `0` or `1`, as per the expired block number rollover
+ *       draft) and `range` (our own, see `parse_range`), all others are
+ *       ignored.
+ * @note `timeout` fixes the retransmission timeout, turning the RTT
+ *       adaptation off. `tsize` is only stored – in a RRQ, the server
+ *       answers it with the file size once the file is open.
+ * @note `range` limits a download (RRQ) in octet mode to a byte range of
+ *       the file: the server sends only those bytes (blocks numbered
+ *       from 1 as usual) and the client writes them at the range start.
+ *       The server answers it with the range it will send (end clamped
+ *       to the file size), so a client resuming a download knows where
+ *       the data go. Hosts not knowing the option ignore it.
+ * @note `multicast` (RFC 2090) is asked for with an empty value in
+ *       a RRQ, which only sets `mcast_req` – the server answers it from
+ *       the multicast session (see `TFTPMulticastSession`), if any.
+ *       Its value in an OACK sets `mcast`. It is never returned.
+ * @note `windowsize` is lowered to fit the window limits once all
+ *       options are in (see `fit_window`).
  */
 std::vector<std::pair<std::string, std::string>> TFTPConnectionBase::proc_opts(
     const std::vector<std::pair<std::string, std::string>> &new_opts) {
@@ -213,31 +302,219 @@ std::vector<std::pair<std::string, std::string>> TFTPConnectionBase::proc_opts(
 
           if (opt_name == "blksize") {
                /** @see https://datatracker.ietf.org/doc/html/rfc2348#page-2 */
-               int blksize = std::stoi(opt.second);
-               if (blksize < TFTP_MIN_BLKSIZE || blksize > TFTP_MAX_BLKSIZE) {
+               auto blksize = parse_number(opt.second);
+               if (!blksize.has_value() || *blksize < TFTP_MIN_BLKSIZE
+                   || *blksize > TFTP_MAX_BLKSIZE) {
                     Logger::glob_info("ignoring invalid blksize option");
                     continue;
                }
 
-               this->blksize = blksize;
-               this->rx_buffer.resize(blksize + 4);
+               this->blksize = static_cast<uint16_t>(*blksize);
+               this->rx_buffer.resize(*blksize + 4);
+               acc_opts.push_back(opt);
+          } else if (opt_name == "windowsize") {
+               /** @see https://datatracker.ietf.org/doc/html/rfc7440#section-3 */
+               auto windowsize = parse_number(opt.second);
+               if (!windowsize.has_value() || *windowsize < TFTP_MIN_WINDOWSIZE
+                   || *windowsize > TFTP_MAX_WINDOWSIZE) {
+                    Logger::glob_info("ignoring invalid windowsize option");
+                    continue;
+               }
+
+               this->windowsize = static_cast<uint16_t>(*windowsize);
                acc_opts.push_back(opt);
+          } else if (opt_name == "timeout") {
+               /** @see https://datatracker.ietf.org/doc/html/rfc2349#section-3 */
+               auto timeout = parse_number(opt.second);
+               if (!timeout.has_value()
+                   || *timeout < static_cast<uint64_t>(TFTP_MIN_TIMEOUT)
+                   || *timeout > static_cast<uint64_t>(TFTP_MAX_TIMEOUT)) {
+                    Logger::glob_info("ignoring invalid timeout option");
+                    continue;
+               }
+
+               this->rtt.set_fixed(std::chrono::seconds(*timeout));
+               acc_opts.push_back(opt);
+          } else if (opt_name == "tsize") {
+               /** @see https://datatracker.ietf.org/doc/html/rfc2349#section-4 */
+               auto tsize = parse_number(opt.second);
+               if (!tsize.has_value()) {
+                    Logger::glob_info("ignoring invalid tsize option");
+                    continue;
+               }
+
+               this->tsize = *tsize;
+               acc_opts.push_back(opt);
+          } else if (opt_name == "rollover") {
+               auto rollover = parse_rollover(opt.second);
+               if (!rollover.has_value()) {
+                    Logger::glob_info("ignoring invalid rollover option");
+                    continue;
+               }
+
+               this->rollover = *rollover;
+               acc_opts.push_back(opt);
+          } else if (opt_name == "range") {
+               auto range = parse_range(opt.second);
+               if (!range.has_value() || this->type != TFTPRequestType::Read
+                   || this->format != TFTPDataFormat::Octet) {
+                    Logger::glob_info("ignoring invalid range option");
+                    continue;
+               }
+
+               this->ranged = true;
+               this->range_start = range->first;
+               this->range_end = range->second;
+               acc_opts.push_back(opt);
+          } else if (opt_name == "multicast") {
+               /** @see https://datatracker.ietf.org/doc/html/rfc2090 */
+               auto mcast = opt.second.empty()
+                                ? std::optional<Multicast>(std::nullopt)
+                                : parse_multicast(opt.second);
+               if (this->type != TFTPRequestType::Read
+                   || (!opt.second.empty() && !mcast.has_value())) {
+                    Logger::glob_info("ignoring invalid multicast option");
+                    continue;
+               }
+
+               this->mcast_req = true;
+               if (mcast.has_value()) this->mcast = mcast;
           } else {
                Logger::glob_info("ignoring unknown option '" + opt_name + "'");
           }
      }
 
+     this->fit_window(acc_opts);
      return acc_opts;
 }
 
+/**
+ * @details The window buffers of an upload take up to `windowsize` times
+ *          `blksize` + 4 bytes, which the peer picks – the product is
+ *          held within `TFTP_MAX_WINDOW_BYTES`. RFC 7440 lets the OACK
+ *          answer a smaller `windowsize` than asked for.
+ * @details With rollover, `block_delta` tells past blocks from future
+ *          ones within half of the wire numbers, so larger windows
+ *          (whose ACKs would read as stray) are lowered too.
+ */
+void TFTPConnectionBase::fit_window(
+    std::vector<std::pair<std::string, std::string>> &acc_opts) {
+     size_t slot = static_cast<size_t>(this->blksize) + 4;
+     size_t max_window = std::max<size_t>(TFTP_MAX_WINDOW_BYTES / slot,
+                                          TFTP_MIN_WINDOWSIZE);
+     if (this->rollover != TFTPBlockRollover::None)
+          max_window = std::min<size_t>(max_window,
+                                        TFTP_MAX_ROLLOVER_WINDOWSIZE);
+     if (this->windowsize <= max_window) return;
+
+     this->windowsize = static_cast<uint16_t>(max_window);
+     Logger::glob_info("lowering windowsize to "
+                       + std::to_string(this->windowsize));
+     for (auto &opt : acc_opts)
+          if (strcasecmp(opt.first.c_str(), "windowsize") == 0)
+               opt.second = std::to_string(this->windowsize);
+}
+
+/**
+ * @details Values of the numeric options come from the peer, so they
+ *          are checked first rather than handed to `std::stoull`
+ *          (which throws on garbage or overflow).
+ */
+std::optional<uint64_t> TFTPConnectionBase::parse_number(
+    const std::string &str) {
+     if (str.empty() || str.size() > 19
+         || !std::all_of(str.begin(), str.end(),
+                         [](unsigned char c) { return std::isdigit(c); }))
+          return std::nullopt;
+     return std::stoull(str);
+}
+
+/**
+ * @details Range "start-end" has both parts decimal (19 digits at most,
+ *          as `tsize`), the end not before the start; "start-" leaves
+ *          the end up to the file size.
+ */
+std::optional<std::pair<uint64_t, std::optional<uint64_t>>>
+TFTPConnectionBase::parse_range(const std::string &str) {
+     auto is_num = [](const std::string &num) {
+          return !num.empty() && num.size() <= 19
+                 && std::all_of(num.begin(), num.end(), [](unsigned char c) {
+                         return std::isdigit(c);
+                    });
+     };
+
+     size_t dash = str.find('-');
+     if (dash == std::string::npos) return std::nullopt;
+     std::string start = str.substr(0, dash);
+     std::string end = str.substr(dash + 1);
+     if (!is_num(start) || (!end.empty() && !is_num(end))) return std::nullopt;
+
+     uint64_t start_n = std::stoull(start);
+     if (end.empty()) return std::make_pair(start_n, std::nullopt);
+     uint64_t end_n = std::stoull(end);
+     if (end_n < start_n) return std::nullopt;
+     return std::make_pair(start_n, std::optional<uint64_t>(end_n));
+}
+
+/**
+ * @details The group must be a multicast address and the port non-zero;
+ *          an address without a port (or the other way around), which
+ *          RFC 2090 allows for the clients already in the session, is
+ *          not sent by our server, so it is refused as well.
+ */
+std::optional<TFTPConnectionBase::Multicast>
+TFTPConnectionBase::parse_multicast(const std::string &str) {
+     size_t comma1 = str.find(',');
+     size_t comma2 = comma1 == std::string::npos ? comma1
+                                                  : str.find(',', comma1 + 1);
+     if (comma2 == std::string::npos) return std::nullopt;
+     std::string addr = str.substr(0, comma1);
+     std::string port = str.substr(comma1 + 1, comma2 - comma1 - 1);
+     std::string mc = str.substr(comma2 + 1);
+
+     Multicast mcast;
+     mcast.group.sin_family = AF_INET;
+     if (inet_pton(AF_INET, addr.c_str(), &mcast.group.sin_addr) != 1
+         || !IN_MULTICAST(ntohl(mcast.group.sin_addr.s_addr)))
+          return std::nullopt;
+     if (port.empty() || port.size() > 5
+         || !std::all_of(port.begin(), port.end(),
+                         [](unsigned char c) { return std::isdigit(c); })
+         || std::stoi(port) < 1 || std::stoi(port) > 65535)
+          return std::nullopt;
+     if (mc != "0" && mc != "1") return std::nullopt;
+
+     mcast.group.sin_port = htons(static_cast<uint16_t>(std::stoi(port)));
+     mcast.master = mc == "1";
+     return mcast;
+}
+
 /* == Uploading handlers == */
 
 /**
- * @details The `handle_upload` method sends a DATA packet to the
+ * @details The `handle_upload` method sends DATA packets to the
  *          remote host. It is expected from derived classes to
  *          implement the `next_data` method to create the
  *          `DataPacket` to send (return the `.to_binary`) for
  *          flexibility.
+ * @details With RFC 7440 `windowsize`, up to `windowsize` blocks
+ *          are kept in `window` (sent, but not acknowledged yet).
+ *          Handler first tops the window up with new blocks and then
+ *          sends all packets of the window not sent yet (`win_sent`),
+ *          so a timeout or a partial ACK only has to reset `win_sent`
+ *          to retransmit from the last ACKed block. Window of size 1
+ *          makes this the original RFC 1350 lock-step.
+ * @details `window` is a ring of up to `windowsize` packet buffers of
+ *          `blksize + 4` bytes, grown as blocks fill it (so a short file
+ *          takes as many as it has blocks) and sized on the first use of
+ *          a slot. Buffers handed over by `set_buffers` keep their
+ *          capacity. Blocks are
+ *          built in place (header, then `next_data` right after it)
+ *          and retransmits resend the buffers unchanged. Sources that
+ *          hold the data in memory hand out slices (`next_slice`)
+ *          instead, sent right after the header, without a copy.
+ * @details A `scheduled` connection leaves the window unsent, its owner
+ *          sends it in turns with other connections (see `flush`).
  */
 void TFTPConnectionBase::handle_upload() {
      /* OACK response */
@@ -256,36 +533,342 @@ void TFTPConnectionBase::handle_upload() {
           return;
      }
 
-     /* No OACK => no ACK 0 */
-     if (this->block_n == 0) this->block_n = 1;
-
-     /* Get data to send */
-     std::vector<char> payload = this->next_data();
+     /* Set up packet buffers (options are final by now) */
+     if (!this->win_ready) {
+          this->window.resize(std::clamp<size_t>(this->window.size(), 1,
+                                                 this->windowsize));
+          this->win_data.assign(this->window.size(), {});
+          this->win_ready = true;
+     }
 
-     /* Remember if this packet will be the last */
-     this->is_last = (payload.size() < static_cast<size_t>(this->blksize + 4));
+     /* Fill the window with new blocks */
+     while (!this->is_last && this->win_count < this->windowsize) {
+          /* Check for block overflow */
+          if (this->rollover == TFTPBlockRollover::None
+              && this->block_ack + this->win_count + 1 > TFTP_MAX_FILE_BLOCKS)
+               return send_error(TFTPErrorCode::Unknown,
+                                 "Block overflow (file too big)");
+          this->block_n = this->block_ack + this->win_count + 1;
+
+          /* Build the packet in place (or as header + slice) */
+          if (this->win_count == this->window.size()) this->win_grow();
+          auto &buf = this->win_slot(this->win_count);
+          auto &slice = this->win_slice(this->win_count);
+          buf.resize(this->blksize + 4);  // Recycled => no allocation
+          DataPacket::write_header(buf.data(), this->wire_block(this->block_n));
+          size_t data_len;
+          try {
+               TraceSpan trace("file",
+                               this->format == TFTPDataFormat::NetASCII
+                                   ? "encode"
+                                   : "read",
+                               this->tid);
+               auto data = this->next_slice(this->blksize);
+               if (data.has_value()) {
+                    slice = *data;
+                    data_len = slice.size();
+                    buf.resize(4);
+               } else {
+                    slice = {};
+                    data_len = this->next_data(
+                        std::span<char>(buf.data() + 4, this->blksize));
+                    buf.resize(data_len + 4);
+               }
+               trace.set_bytes(static_cast<int64_t>(data_len));
+          } catch (const std::runtime_error &e) {
+               return send_error(TFTPErrorCode::AccessViolation, e.what());
+          }
+          this->win_count++;
 
-     log_info("Sending DATA block " + this->get_block_n_hex() + " ("
-              + std::to_string(payload.size() - 4) + " bytes)");
+          /* Remember if this packet will be the last */
+          this->is_last = (data_len < this->blksize);
+     }
 
-     /* Send data */
+     /* Send data not sent yet (unless the owner does) */
      this->update_sent_time();
-     sendto(this->conn_fd, payload.data(), payload.size(), 0,
-            reinterpret_cast<const sockaddr *>(&this->rem_addr),
-            sizeof(this->rem_addr));
+     if (!this->scheduled) this->send_window();
+     if (!this->is_running()) return;
 
      /* Await acknowledgement */
-     log_info("Awaiting ACK for block " + this->get_block_n_hex());
+     if (Logger::enabled(LogLevel::Block))
+          log_block("Awaiting ACK for block " + this->get_block_n_hex());
      this->set_state(TFTPConnectionState::Awaiting);
 }
 
 /**
- * @details Awaits present block ACK packet from the remote host, incl.
+ * @details The ring is full when it grows, so rotating the oldest packet
+ *          to the front keeps the order and lets the new slot go last.
+ */
+void TFTPConnectionBase::win_grow() {
+     std::rotate(this->window.begin(), this->window.begin() + this->win_head,
+                 this->window.end());
+     std::rotate(this->win_data.begin(),
+                 this->win_data.begin() + this->win_head,
+                 this->win_data.end());
+     this->win_head = 0;
+     this->window.emplace_back();
+     this->win_data.emplace_back();
+}
+
+/**
+ * @details The unsent part of the window is handed to the kernel in
+ *          `sendmmsg` calls of up to `TFTP_MMSG_BATCH` packets (one
+ *          per lock-step block). If the kernel refuses (ex. full
+ *          socket buffer), the rest stays unsent – it goes out after
+ *          the next ACK slides the window, or on retransmission.
+ * @details Runs of full blocks go out as one GSO datagram each
+ *          (`UDP_SEGMENT` of the packet size, up to `TFTP_GSO_SEGMENTS`
+ *          packets, the final shorter block can close a run), which the
+ *          kernel (or the NIC) cuts into the very same packets after
+ *          a single pass through the stack. Where that is refused
+ *          (ex. a device without checksum offload, blocks over the
+ *          MTU – segments are never fragmented), the connection sends
+ *          packets one by one again.
+ * @details Slices of a file mapping are read by the kernel, so a file
+ *          truncated under the transfer fails the send with `EFAULT`
+ *          (instead of SIGBUS) – that ends the transfer with an ERROR.
+ */
+void TFTPConnectionBase::send_window(size_t max_pkts) {
+     std::array<struct mmsghdr, TFTP_MMSG_BATCH> msgs{};
+     std::array<struct iovec, 2 * TFTP_MMSG_BATCH> iovs{};
+     std::array<size_t, TFTP_MMSG_BATCH> n_segs{}; /**< Packets per msg */
+     std::array<std::array<char, CMSG_SPACE(sizeof(uint16_t))>,
+                TFTP_MMSG_BATCH>
+         ctrls{};
+     auto packet_size = [this](size_t i) {
+          return this->win_slot(i).size() + this->win_slice(i).size();
+     };
+
+     size_t end = this->win_count - this->win_sent > max_pkts
+                      ? this->win_sent + max_pkts
+                      : this->win_count;
+     while (this->win_sent < end) {
+          size_t n_pkts
+              = std::min<size_t>(end - this->win_sent, TFTP_MMSG_BATCH);
+
+          /* Prepare the batch (a run of full blocks per message) */
+          size_t n_msgs = 0, n_iovs = 0;
+          for (size_t i = 0; i < n_pkts; n_msgs++) {
+               size_t first = i, seg = packet_size(this->win_sent + i);
+               size_t bytes = 0, iov_first = n_iovs;
+               do {
+                    auto &payload = this->win_slot(this->win_sent + i);
+                    auto &slice = this->win_slice(this->win_sent + i);
+
+                    if (Logger::enabled(LogLevel::Block))
+                         log_block("Sending DATA block "
+                                   + to_hex(this->block_ack + this->win_sent
+                                            + i + 1)
+                                   + " ("
+                                   + std::to_string(payload.size() - 4
+                                                    + slice.size())
+                                   + " bytes)");
+
+                    iovs[n_iovs++] = {payload.data(), payload.size()};
+                    if (!slice.empty())
+                         iovs[n_iovs++] = {const_cast<char *>(slice.data()),
+                                           slice.size()};
+                    bytes += packet_size(this->win_sent + i++);
+               } while (this->gso && i < n_pkts
+                        && i - first < TFTP_GSO_SEGMENTS
+                        && packet_size(this->win_sent + i - 1) == seg
+                        && packet_size(this->win_sent + i) <= seg
+                        && bytes + packet_size(this->win_sent + i)
+                               <= TFTP_GSO_MAX_BYTES);
+
+               auto &hdr = msgs[n_msgs].msg_hdr;
+               hdr = {};
+               hdr.msg_name = const_cast<sockaddr_in *>(&this->data_addr());
+               hdr.msg_namelen = sizeof(sockaddr_in);
+               hdr.msg_iov = &iovs[iov_first];
+               hdr.msg_iovlen = n_iovs - iov_first;
+               n_segs[n_msgs] = i - first;
+               if (n_segs[n_msgs] > 1) {
+                    hdr.msg_control = ctrls[n_msgs].data();
+                    hdr.msg_controllen = ctrls[n_msgs].size();
+                    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr);
+                    cmsg->cmsg_level = SOL_UDP;
+                    cmsg->cmsg_type = UDP_SEGMENT;
+                    cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                    uint16_t gso_size = static_cast<uint16_t>(seg);
+                    memcpy(CMSG_DATA(cmsg), &gso_size, sizeof(gso_size));
+               }
+          }
+
+          /* Send the batch */
+          TraceSpan trace("net", "sendmmsg", this->tid);
+          int n_sent = sendmmsg(this->conn_fd, msgs.data(), n_msgs, 0);
+          if (n_sent <= 0) {
+               if (errno == EINTR) continue;
+               if (n_segs[0] > 1
+                   && (errno == EIO || errno == EINVAL || errno == EMSGSIZE)) {
+                    log_info("GSO refused (" + std::string(strerror(errno))
+                             + "), sending packets one by one");
+                    this->gso = false;
+                    continue;
+               }
+               if (errno == EMSGSIZE && this->pmtu_fallback()) continue;
+               if (errno == EFAULT) {
+                    this->win_sent = this->win_count;  // Nothing to flush
+                    return this->send_error(TFTPErrorCode::AccessViolation,
+                                            "File changed during transfer");
+               }
+               log_info("Failed to send DATA: " + std::string(strerror(errno)));
+               return;
+          }
+
+          /* Account new blocks and retransmissions */
+          size_t pkts_sent = 0, bytes_sent = 0;
+          for (int m = 0; m < n_sent; m++) {
+               pkts_sent += n_segs[m];
+               bytes_sent += msgs[m].msg_len;
+          }
+          trace.set_bytes(static_cast<int64_t>(bytes_sent));
+          for (size_t i = 0; i < pkts_sent; i++) {
+               uint64_t block = this->block_ack + this->win_sent + i + 1;
+               if (block <= this->stats.hi_block) {
+                    this->stats.retransmits++;
+                    continue;
+               }
+               this->stats.hi_block = block;
+               this->stats.blocks_tx++;
+               this->stats.bytes_tx += packet_size(this->win_sent + i) - 4;
+          }
+
+          this->tx_batches.add(pkts_sent);
+          this->win_sent += pkts_sent;
+     }
+}
+
+/**
+ * @details Packets go out while the pacer has tokens (the last one may
+ *          overdraw it) and they fit in `allowance` whole. The
+ *          retransmission deadline (and the RTT sample) then counts
+ *          from the latest packet sent, so time spent waiting for
+ *          a turn is not taken for a lost window.
+ */
+size_t TFTPConnectionBase::flush(size_t allowance) {
+     if (!this->has_unsent()) return 0;
+     auto packet_size = [this](size_t i) {
+          return this->win_slot(i).size() + this->win_slice(i).size();
+     };
+
+     /* Count the packets that may go */
+     auto now = std::chrono::steady_clock::now();
+     double tokens = this->pacer.available(now);
+     size_t n_pkts = 0, bytes = 0;
+     while (this->win_sent + n_pkts < this->win_count && tokens > 0) {
+          size_t size = packet_size(this->win_sent + n_pkts);
+          if (bytes + size > allowance) break;
+          bytes += size;
+          tokens -= static_cast<double>(size);
+          n_pkts++;
+     }
+     if (n_pkts == 0) return 0;
+
+     /* Send them, account what the kernel took */
+     size_t first = this->win_sent;
+     this->send_window(n_pkts);
+     if (!this->is_running()) return 0;
+     bytes = 0;
+     for (size_t i = first; i < this->win_sent; i++) bytes += packet_size(i);
+     if (bytes == 0) return 0;
+
+     this->pacer.consume(static_cast<double>(bytes));
+     this->last_packet_time = std::chrono::steady_clock::now();
+     this->deadline = this->last_packet_time + this->rtt.get_rto();
+     return bytes;
+}
+
+/**
+ * @details The window goes out at `pace_gain` windows per SRTT, in
+ *          bursts of `TFTP_PACE_BURST_US` at that rate (at least two
+ *          packets). A loss (timeout or partly ACKed window, likely
+ *          a burst that overflowed a queue on the way) halves the gain,
+ *          every window ACKed whole raises it by `TFTP_PACE_GAIN_STEP`
+ *          again. Before the first RTT sample, DATA are not paced.
+ */
+void TFTPConnectionBase::pace_update(bool loss) {
+     if (!this->scheduled) return;
+     this->pace_gain
+         = loss ? std::max(this->pace_gain / 2, TFTP_PACE_GAIN_MIN)
+                : std::min(this->pace_gain + TFTP_PACE_GAIN_STEP,
+                           TFTP_PACE_GAIN_MAX);
+
+     auto srtt = this->rtt.get_srtt();
+     if (!srtt.has_value() || srtt->count() <= 0) return;
+     double packet = this->blksize + 4.0;
+     double rate = this->pace_gain * this->windowsize * packet * 1e6
+                   / static_cast<double>(srtt->count());
+     this->pacer.set_rate(
+         rate, std::max(rate * TFTP_PACE_BURST_US / 1e6, 2 * packet));
+}
+
+/**
+ * @details With `IP_PMTUDISC_DO` on the socket (server `-M` policy),
+ *          datagrams over the path MTU are refused right away once the
+ *          kernel learns of a lower one (ICMP "fragmentation needed"
+ *          for a block lost on the way). The block size is fixed for
+ *          the transfer, so the socket is switched to
+ *          `IP_PMTUDISC_DONT` and the window is resent fragmented.
+ */
+bool TFTPConnectionBase::pmtu_fallback() {
+     int val = IP_PMTUDISC_DONT;
+     if (this->pmtu_frag || this->sock_shared
+         || setsockopt(this->conn_fd, IPPROTO_IP, IP_MTU_DISCOVER, &val,
+                       sizeof(val))
+                != 0)
+          return false;
+
+     this->pmtu_frag = true;
+     this->stats.pmtu_fallbacks++;
+     log_info("Path MTU dropped below the block size, fragmenting DATA");
+     return true;
+}
+
+/**
+ * @details With `UDP_GRO`, the kernel hands a burst of equal-sized
+ *          datagrams of the sender (ex. a window sent as GSO datagrams)
+ *          over in one `recvmsg` (see `recv_gro`), which `recv_packet`
+ *          then takes apart without further syscalls. Lock-step
+ *          downloads, shared sockets (see `deliver`) and kernels
+ *          without GRO keep receiving datagram by datagram.
+ * @details The socket receive buffer is grown to hold a whole window
+ *          (the kernel caps it at `net.core.rmem_max`). The default one
+ *          holds a few hundred blocks: the tail of a larger window was
+ *          dropped, unseen as a gap, and every window waited for the
+ *          timeout.
+ */
+void TFTPConnectionBase::gro_init() {
+     if (this->gro || this->sock_shared || this->windowsize < 2) return;
+
+     int rcvbuf = 0;
+     socklen_t rcvbuf_len = sizeof(rcvbuf);
+     int window = static_cast<int>(static_cast<size_t>(this->windowsize)
+                                   * (this->blksize + 4));
+     if (getsockopt(this->conn_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf,
+                    &rcvbuf_len)
+             == 0
+         && rcvbuf < window)
+          setsockopt(this->conn_fd, SOL_SOCKET, SO_RCVBUF, &window,
+                     sizeof(window));
+
+     int val = 1;
+     if (setsockopt(this->conn_fd, IPPROTO_UDP, UDP_GRO, &val, sizeof(val))
+         < 0)
+          return;
+     this->rx_buffer.resize(TFTP_GRO_BUFFER);
+     this->gro = true;
+}
+
+/**
+ * @details Awaits block ACK packet from the remote host, incl.
  *          all the associated checks – timeo, packet validity
  *          block_n and whatnot. Transitions to `Uploading`
- *          state on success (block_n++), previous state on
+ *          state on success (window slides), previous state on
  *          timeo, loops on `WOULDBLOCK`, `Errored` on err
- *          and `Completed` on last ACK.
+ *          and `Completed` on last ACK. ACKs are checked and slide
+ *          the window in `handle_ack`.
  * @note After extending with RFC 2347, this handler also accepts
  *       OACKs if `oack_expect` is set to true (flag reset on handle).
  *       On OACK, it calls `handle_oack` "sub-handler". OACKs
@@ -299,9 +882,15 @@ void TFTPConnectionBase::handle_await_upload() {
                return this->send_error(TFTPErrorCode::Unknown,
                                        "Retransmission timeout");
 
-          /* if not, retransmit last packet */
-          log_info("Retransmitting block " + this->get_block_n_hex()
-                   + " (attempt " + std::to_string(this->send_tries) + ")");
+          /* if not, retransmit from the last ACKed block */
+          this->on_timeout();
+          this->pace_update(true);
+          log_info("Retransmitting from block "
+                   + to_hex(this->block_ack + 1) + " (attempt "
+                   + std::to_string(this->send_tries) + ", RTO "
+                   + std::to_string(this->rtt.get_rto().count() / 1000)
+                   + " ms)");
+          this->win_sent = 0;
           this->set_state(this->pstate);
           return;
      }
@@ -309,91 +898,120 @@ void TFTPConnectionBase::handle_await_upload() {
      /* Receive packet */
      auto packet_res = this->recv_packet((this->block_n == 0));
      if (!packet_res.has_value()) return;  // No packet => loop in state
-     auto packet_ptr = std::move(packet_res.value());
+     const PacketView &packet_view = packet_res.value();
 
      /* ERROR handling */
-     if (packet_ptr->get_opcode() == TFTPOpcode::ERROR) {
-          /* Cast */
-          auto *packet = dynamic_cast<ErrorPacket *>(packet_ptr.get());
-          auto errmsg = packet->get_message();
-
-          /* Log */
-          log_error("Host errored with code "
-                    + std::to_string(packet->get_errcode()));
-          if (errmsg.has_value()) log_error("'" + errmsg.value() + "'");
-
-          /* Set state */
-          this->set_state(TFTPConnectionState::Errored);
-          return;
-     }
+     if (const auto *packet = packet_view.get<ErrorView>())
+          return this->handle_error(*packet);
 
      /* Check if packet type is as expected */
-     if (packet_ptr->get_opcode() != TFTPOpcode::ACK
-         && packet_ptr->get_opcode() != TFTPOpcode::OACK)
+     const auto *oack = packet_view.get<OackView>();
+     const auto *ack = packet_view.get<AckView>();
+     if (!ack && !oack)
           return send_error(TFTPErrorCode::IllegalOperation,
                             "Received a non-(O)ACK packet");
 
      /* OACK handling */
-     if (packet_ptr->get_opcode() == TFTPOpcode::OACK) {
+     if (oack) {
           /* Ignore if `oack_expect` is unset */
           if (!this->oack_expect)
                return log_info(
                    "Received OACK but oack_expect is not set, ignoring");
           this->oack_expect = false;
 
-          /* Cast and handle options */
-          auto *packet = dynamic_cast<OptionAckPacket *>(packet_ptr.get());
-          this->handle_oack(*packet);
-     } else {
-          /* ACK handling */
-          auto *packet
-              = dynamic_cast<AcknowledgementPacket *>(packet_ptr.get());
-
-          /* Check ACK block number */
-          if (packet->get_block_number() < this->block_n) {
-               /* Stray old block ACK */
-               log_info("Received ACK for block "
-                        + std::to_string(packet->get_block_number())
-                        + " (stray, ignoring)");
-               return;  // As if nothing happened => loop in state
-          }
-
-          if (packet->get_block_number() > this->block_n) {
-               /* Future block => error */
-               return send_error(TFTPErrorCode::IllegalOperation,
-                                 "Received ACK for future block");
-          }
+          /* Handle options */
+          this->handle_oack(*oack);
+          if (!this->is_running()) return;
+     } else if (!this->handle_ack(*ack)) {
+          return;
      }
 
      // (O)ACK handled, continue
+     this->disarm_timeout();
+     this->pace_update(this->retransmit);  // Rest of the window lost?
      this->send_tries = 0;
+     this->win_sent = 0;
+     this->oack_init = false;  // OACK (if any) got its ACK 0
 
-     /* End transmission if this was the final block */
-     if (this->is_last) {
+     /* End transmission if the final block was acknowledged */
+     if (this->is_last && this->win_count == 0) {
           log_info("Upload complete!");
           this->set_state(TFTPConnectionState::Completed);
           return;
      }
 
-     /* Increment block number */
-     if (this->block_n++ == TFTP_MAX_FILE_BLOCKS)
-          return send_error(TFTPErrorCode::Unknown,
-                            "Block overflow (file too big)");
-
      /* Continue transferring */
      this->set_state(TFTPConnectionState::Uploading);
 }
 
+/**
+ * @details Any ACK for a block in the window is accepted (RFC 7440),
+ *          acknowledging all the blocks up to and including it; if it
+ *          is not the last sent block, the rest of the window is
+ *          retransmitted. ACKs of older blocks (or duplicates) are
+ *          ignored, ACKs of blocks not sent yet are an error.
+ */
+bool TFTPConnectionBase::handle_ack(const AckView &ack) {
+     int64_t ack_d = this->block_delta(ack.block_n, this->block_ack);
+
+     /* Check ACK block number */
+     if (ack_d < 0 || (ack_d == 0 && this->win_count > 0)) {
+          /* Stray old block (or duplicate) ACK */
+          if (Logger::enabled(LogLevel::Block))
+               log_block("Received ACK for block " + std::to_string(ack.block_n)
+                         + " (stray, ignoring)");
+          return false;  // As if nothing happened => loop in state
+     }
+
+     if (static_cast<uint64_t>(ack_d) > this->block_n - this->block_ack) {
+          /* Future block => error */
+          this->send_error(TFTPErrorCode::IllegalOperation,
+                           "Received ACK for future block");
+          return false;
+     }
+
+     /* Slide the window */
+     size_t acked = ack_d;
+     if (acked > 0) {
+          size_t acked_len = 0;
+          for (size_t i = 0; i < acked; i++)
+               acked_len
+                   += this->win_slot(i).size() - 4 + this->win_slice(i).size();
+          this->win_head = (this->win_head + acked) % this->window.size();
+          this->win_count -= acked;
+          this->release_data(acked_len);
+     }
+     this->block_ack += acked;
+
+     /* Partial window ACK => retransmit the rest */
+     if (this->win_count > 0) {
+          log_info("Window ACKed up to block " + to_hex(this->block_ack)
+                   + ", retransmitting the rest");
+          this->retransmit = true;
+     }
+     return true;
+}
+
 /* == Downloading handlers == */
 
 /**
  * @details The `handle_download` method handles writing the received
  *          DATA packet data to the file and sending an ACK packet
- *          for the block. The packet is read from `rx_buffer`.
- *          Method also includes NetASCII conversion and adjustment
- *          for `[... CR ] | [ LF/NUL ...]` block split.
+ *          for the block. The payload (NetASCII decoded into `na_buffer`
+ *          first, with a CR ending the block held back in `na_state`
+ *          until the next block resolves it – `[... CR ] | [ LF/NUL ...]`
+ *          split) is appended to the `write_behind` buffer, which writes
+ *          it to the file in large chunks on the `writer` thread, so the
+ *          ACK does not wait for the disk. The final ACK is only sent
+ *          once all data are written, so that a failed write (ex. disk
+ *          full) is reported instead.
+ * @note With RFC 7440 `windowsize`, ACK is only sent after every
+ *       `windowsize`-th block (and after the final one).
  */
 void TFTPConnectionBase::handle_download() {
+     /* Receive the window in GRO batches (options are final by now) */
+     if (this->block_n == 0) this->gro_init();
+
      /* OACK response */
      if (this->block_n == 0 && this->oack_init) {
           log_info("Sending OACK");
@@ -410,12 +1028,15 @@ void TFTPConnectionBase::handle_download() {
           return;
      }
 
-     AcknowledgementPacket ack = AcknowledgementPacket(this->block_n);
+     AcknowledgementPacket ack
+         = AcknowledgementPacket(this->wire_block(this->block_n));
      auto payload = ack.to_binary();
 
      /* No data || block 0 => no writing, just send ACK (init or timeo) */
      if (this->block_n == 0 || this->rx_len <= 0) {
-          log_info("Sending ACK for block " + this->get_block_n_hex());
+          if (Logger::enabled(LogLevel::Block))
+               log_block("Sending ACK for block " + this->get_block_n_hex());
+          this->win_recv = 0;
 
           this->update_sent_time();
           sendto(this->conn_fd, payload.data(), payload.size(), 0,
@@ -427,57 +1048,70 @@ void TFTPConnectionBase::handle_download() {
      }
 
      /* Parse packet from buffer */
-     DataPacket packet;
-     std::vector<char> data;
-     try {
-          packet = DataPacket::from_binary(std::vector<char>(
-              this->rx_buffer.begin(), this->rx_buffer.begin() + this->rx_len));
-          data = packet.get_data();
-     } catch (const std::exception &e) {
+     char *packet = this->rx_buffer.data() + this->rx_off;
+     auto packet_view
+         = PacketView::parse(std::span<const char>(packet, this->rx_len));
+     if (!packet_view.has_value() || !packet_view->get<DataView>())
           return send_error(TFTPErrorCode::IllegalOperation,
                             "Failed to parse DATA packet");
+     size_t payload_len = packet_view->get<DataView>()->data.size();
+     char *data = packet + 4;  // after 2B opcode + 2B block_n
+     size_t data_len = payload_len;
+     bool last = payload_len < this->blksize;
+
+     /* Convert from NetASCII if needed */
+     if (this->format == TFTPDataFormat::NetASCII) {
+          TraceSpan trace("file", "decode", this->tid);
+          this->na_buffer.resize(NetASCII::max_decoded(this->blksize));
+          std::span<char> out(this->na_buffer);
+          data_len = NetASCII::decode(std::span<const char>(data, data_len),
+                                      out, this->na_state);
+          if (last)
+               data_len += NetASCII::decode_end(out.subspan(data_len),
+                                                this->na_state);
+          data = this->na_buffer.data();
      }
-
-     /* Convert to NetASCII if needed */
-     if (this->format == TFTPDataFormat::NetASCII && !data.empty()) {
-          /* Adjustment for [... CR] | [LF/NUL ...] block split*/
-          if (this->cr_end && data[0] == '\n') {
-               /* CR | LF -> LF */
-               off_t file_size = lseek(this->file_fd, 0, SEEK_END);
-               if (file_size > 0 && ftruncate(this->file_fd, file_size - 1))
-                    return this->send_error(TFTPErrorCode::AccessViolation,
-                                            "Failed to truncate file on CR");
-               lseek(this->file_fd, 0, SEEK_END);
-          } else if (this->cr_end && data[0] == '\0') {
-               /* CR | NUL -> CR */
-               data.erase(data.begin());
-          }
-
-          data = NetASCII::na_to_vec(data);
+     if (Logger::enabled(LogLevel::Block))
+          log_block("Received block " + this->get_block_n_hex() + " ("
+                    + std::to_string(data_len) + " bytes)");
+
+     /* Write to file (behind) */
+     if (!this->write_behind)
+          this->write_behind = std::make_unique<WriteBehind>(
+              this->file_fd, this->writer, TFTP_WRITE_CHUNK, TFTP_WRITE_DEPTH,
+              static_cast<off_t>(this->range_start));
+     int err;
+     {
+          TraceSpan trace("file", "write", this->tid);
+          trace.set_bytes(static_cast<int64_t>(data_len));
+          err = this->write_behind->append(data, data_len);
+          if (err == 0 && last) err = this->write_behind->finish();
      }
-
-     this->cr_end = (!data.empty() && data.back() == '\r');
-     log_info("Received block " + this->get_block_n_hex() + " ("
-              + std::to_string(data.size()) + " bytes)");
-
-     /* Write to file */
-     if (write(this->file_fd, data.data(), data.size()) < 0)
+     if (err == ENOSPC || err == EDQUOT || err == EFBIG)
+          return this->send_error(TFTPErrorCode::DiskFull, "Disk full");
+     if (err != 0)
           return this->send_error(TFTPErrorCode::AccessViolation,
                                   "Failed to write to file");
-
-     /* Clear buffer */
-     std::fill(rx_buffer.begin(), rx_buffer.end(), 0);
      this->rx_len = 0;
-
-     /* Send ACK */
-     log_info("Sending ACK for block " + this->get_block_n_hex());
-     this->update_sent_time();
-     sendto(this->conn_fd, payload.data(), payload.size(), 0,
-            reinterpret_cast<const sockaddr *>(&this->rem_addr),
-            sizeof(this->rem_addr));
+     this->stats.blocks_rx++;
+     this->stats.bytes_rx += payload_len;
+
+     /* Send ACK (only once per window, or on the final block) */
+     bool acked = false;
+     if (last || ++this->win_recv >= this->windowsize) {
+          if (Logger::enabled(LogLevel::Block))
+               log_block("Sending ACK for block " + this->get_block_n_hex());
+          this->win_recv = 0;
+          TraceSpan trace("net", "sendto", this->tid);
+          sendto(this->conn_fd, payload.data(), payload.size(), 0,
+                 reinterpret_cast<const sockaddr *>(&this->rem_addr),
+                 sizeof(this->rem_addr));
+          acked = true;
+     }
+     this->update_sent_time(acked);  // Mid-window DATA are no RTT sample
 
      /* End transmission if this was the final block */
-     if (packet.get_data().size() < this->blksize) {
+     if (last) {
           log_info("Download complete!");
           this->set_state(TFTPConnectionState::Completed);
           return;
@@ -493,6 +1127,9 @@ void TFTPConnectionBase::handle_download() {
  *          block_n and whatnot. Transitions to `Downloading`
  *          state on success (block_n++), previous state on
  *          timeo, loops on `WOULDBLOCK` and `Errored` on err.
+ * @note In a window (RFC 7440), DATA block after a gap makes the
+ *       handler ACK the last in-order block, so that the sender
+ *       retransmits from there. This is done once per gap.
  */
 void TFTPConnectionBase::handle_await_download() {
      /* Timeout check */
@@ -502,9 +1139,14 @@ void TFTPConnectionBase::handle_await_download() {
                return this->send_error(TFTPErrorCode::Unknown,
                                        "Retransmission timeout");
 
-          /* if not, retransmit last packet */
+          /* if not, retransmit last packet (ACK only, nothing to write) */
+          this->on_timeout();
+          this->stats.retransmits++;
+          this->rx_len = 0;
           log_info("Retransmitting ACK for block " + this->get_block_n_hex()
-                   + " (attempt " + std::to_string(this->send_tries) + ")");
+                   + " (attempt " + std::to_string(this->send_tries) + ", RTO "
+                   + std::to_string(this->rtt.get_rto().count() / 1000)
+                   + " ms)");
           this->set_state(this->pstate);
           return;
      }
@@ -512,67 +1154,75 @@ void TFTPConnectionBase::handle_await_download() {
      /* Receive packet */
      auto packet_res = this->recv_packet((this->block_n == 0));
      if (!packet_res.has_value()) return;  // No packet => loop in state
-     auto packet_ptr = std::move(packet_res.value());
+     const PacketView &packet_view = packet_res.value();
 
      /* ERROR handling */
-     if (packet_ptr->get_opcode() == TFTPOpcode::ERROR) {
-          /* Cast */
-          auto *packet = dynamic_cast<ErrorPacket *>(packet_ptr.get());
-          auto errmsg = packet->get_message();
-
-          /* Log */
-          log_error("Host errored with code "
-                    + std::to_string(packet->get_errcode()));
-          if (errmsg.has_value()) log_error("'" + errmsg.value() + "'");
-
-          /* Set state */
-          this->set_state(TFTPConnectionState::Errored);
-          return;
-     }
+     if (const auto *packet = packet_view.get<ErrorView>())
+          return this->handle_error(*packet);
 
      /* Check if packet type is as expected */
-     if (packet_ptr->get_opcode() != TFTPOpcode::DATA
-         && packet_ptr->get_opcode() != TFTPOpcode::OACK)
+     const auto *oack = packet_view.get<OackView>();
+     const auto *data = packet_view.get<DataView>();
+     if (!data && !oack)
           return send_error(TFTPErrorCode::IllegalOperation,
                             "Received a non-DATA/OACK packet");
 
      /* OACK handling */
-     if (packet_ptr->get_opcode() == TFTPOpcode::OACK) {
+     if (oack) {
           /* Ignore if `oack_expect` is unset */
           if (!this->oack_expect)
                return log_info(
                    "Received OACK but oack_expect is not set, ignoring");
           this->oack_expect = false;
 
-          /* Cast and handle options */
-          auto *packet = dynamic_cast<OptionAckPacket *>(packet_ptr.get());
-          this->handle_oack(*packet);
+          /* Handle options */
+          this->handle_oack(*oack);
+          if (!this->is_running()) return;
      } else {
           /* DATA handling */
-          auto *packet = dynamic_cast<DataPacket *>(packet_ptr.get());
+          int64_t data_d = this->block_delta(data->block_n, this->block_n);
 
           /* Check DATA block number */
-          if (packet->get_block_number() < this->block_n + 1) {
-               /* Stray old block ACK */
-               log_info("Received DATA for block "
-                        + std::to_string(packet->get_block_number())
-                        + " (stray, ignoring)");
+          if (data_d < 1) {
+               /* Stray old block => dropped (not to be written) */
+               this->stats.dup_rx++;
+               this->rx_len = 0;
+               if (Logger::enabled(LogLevel::Block))
+                    log_block("Received DATA for block "
+                              + std::to_string(data->block_n)
+                              + " (stray, ignoring)");
                return;  // As if nothing happened => loop in state
           }
 
-          if (packet->get_block_number() > this->block_n + 1) {
+          if (data_d > 1 && this->windowsize > 1) {
+               /* Window gap => ACK last received block (once) */
+               if (this->win_gap) return;
+               log_info("Received DATA for block "
+                        + std::to_string(data->block_n)
+                        + " (out of order), ACKing block "
+                        + this->get_block_n_hex());
+               this->win_gap = true;
+               this->rx_len = 0;
+               this->set_state(TFTPConnectionState::Downloading);
+               return;
+          }
+
+          if (data_d > 1) {
                /* Future block => error */
                return send_error(TFTPErrorCode::IllegalOperation,
-                                 "Received ACK for future block");
+                                 "Received DATA for future block");
           }
+          this->win_gap = false;
 
           /* Increment block number */
-          if (this->block_n++ == TFTP_MAX_FILE_BLOCKS - 1)
+          if (this->block_n++ == TFTP_MAX_FILE_BLOCKS - 1
+              && this->rollover == TFTPBlockRollover::None)
                return send_error(TFTPErrorCode::Unknown,
                                  "Block overflow (file too big)");
      }
 
      // DATA/OACK handled, continue
+     this->disarm_timeout();
      this->send_tries = 0;
 
      /* Write to file in `Downloading` state */
@@ -581,31 +1231,151 @@ void TFTPConnectionBase::handle_await_download() {
 
 /* === Utility methods === */
 
+/**
+ * @details The span starts when the state was entered; a state entered
+ *          while not tracing is cut at the start of tracing (see
+ *          `Trace::span`). `Idle` (before the setup) is not recorded,
+ *          terminal states are never left.
+ */
+void TFTPConnectionBase::trace_state() {
+     static const char *const names[] = {"Idle",     "Requesting",
+                                         "Uploading", "Downloading",
+                                         "Awaiting", "Errored",
+                                         "Completed"};
+     if (this->state != TFTPConnectionState::Idle)
+          Trace::span("state", names[static_cast<int>(this->state)],
+                      this->tid, this->state_since);
+     this->state_since = Trace::Clock::now();
+}
+
+/**
+ * @details Without rollover, block numbers never exceed 65535, so the
+ *          number is sent as is. Rollover to 0 sends the number modulo
+ *          2^16; rollover to 1 never reuses block 0 and cycles through
+ *          blocks 1 to 65535.
+ */
+uint16_t TFTPConnectionBase::wire_block(uint64_t n) const {
+     if (this->rollover == TFTPBlockRollover::One && n > TFTP_MAX_FILE_BLOCKS)
+          return static_cast<uint16_t>((n - 1) % TFTP_MAX_FILE_BLOCKS + 1);
+     return static_cast<uint16_t>(n);
+}
+
+/**
+ * @details With rollover, the wire number is taken as the block number
+ *          closest to `ref` (within half of the wire number space),
+ *          which is unambiguous as long as the window is smaller than
+ *          that – stray packets of past blocks end up negative and
+ *          future ones positive, just like without rollover.
+ */
+int64_t TFTPConnectionBase::block_delta(uint16_t wire, uint64_t ref) const {
+     switch (this->rollover) {
+          case TFTPBlockRollover::Zero:
+               return static_cast<int16_t>(
+                   static_cast<uint16_t>(wire - static_cast<uint16_t>(ref)));
+
+          case TFTPBlockRollover::One: {
+               /* Block 0 is only the first one, then 1 to 65535 cycle */
+               if (wire == 0 || ref == 0)
+                    return static_cast<int64_t>(wire)
+                           - static_cast<int64_t>(ref);
+
+               const int64_t period = TFTP_MAX_FILE_BLOCKS;
+               int64_t diff = static_cast<int64_t>(wire - 1)
+                              - static_cast<int64_t>((ref - 1) % period);
+               if (diff > period / 2) diff -= period;
+               if (diff < -period / 2) diff += period;
+               return diff;
+          }
+
+          default:
+               return static_cast<int64_t>(wire) - static_cast<int64_t>(ref);
+     }
+}
+
+/**
+ * @details The kernel reports the size of the coalesced datagrams in
+ *          a `UDP_GRO` control message (all but the last are that
+ *          long); without one, the buffer holds a single datagram.
+ *          The rest of a batch is left in `rx_buffer` for the next
+ *          `recv_packet` calls (`rx_pending`).
+ */
+ssize_t TFTPConnectionBase::recv_gro(struct sockaddr_in &origin_addr) {
+     std::array<char, CMSG_SPACE(sizeof(int))> ctrl{};
+     struct iovec iov = {this->rx_buffer.data(), this->rx_buffer.size()};
+     struct msghdr msg {};
+     msg.msg_name = &origin_addr;
+     msg.msg_namelen = sizeof(origin_addr);
+     msg.msg_iov = &iov;
+     msg.msg_iovlen = 1;
+     msg.msg_control = ctrl.data();
+     msg.msg_controllen = ctrl.size();
+
+     ssize_t len = recvmsg(this->conn_fd, &msg, 0);
+     if (len < 0) return len;
+
+     this->rx_off = 0;
+     this->rx_end = static_cast<size_t>(len);
+     this->rx_seg = this->rx_end;
+     for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr;
+          cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+          if (cmsg->cmsg_level != SOL_UDP || cmsg->cmsg_type != UDP_GRO)
+               continue;
+          int seg;
+          memcpy(&seg, CMSG_DATA(cmsg), sizeof(seg));
+          if (seg > 0) this->rx_seg = static_cast<size_t>(seg);
+     }
+
+     this->rx_pending = this->rx_seg < this->rx_end;
+     return static_cast<ssize_t>(std::min(this->rx_seg, this->rx_end));
+}
+
 /**
  * @details The `recv_packet` method is a wrapper around the `recvfrom`
- *          system call. It will receive a packet from the socket and
- *          parse it into a packet object. If the packet not valid,
- *          it sends ERROR and transitions to `Errored` state.
- *          If no packet was received or error happened, it will return
- *          a nullopt. If the packet IS valid, it will return opt
- *          containing the packet object.
+ *          system call (`recv_gro` on GRO sockets, then one datagram of
+ *          the batch per call). It will receive a packet from the
+ *          socket and parse it into a `PacketView` of `rx_buffer` (no
+ *          copies and no allocation). If the packet not valid, it sends
+ *          ERROR and transitions to `Errored` state. If no packet was
+ *          received or error happened, it will return a nullopt. If the
+ *          packet IS valid, it will return opt containing the packet view,
+ *          valid until the next receive.
  * @param addr_overwrite If true, the method will overwrite `host_addr`
  *                       with the origin address of the received packet.
  *                       This is used in client connection on first
  *                       packet to store the server-side TID.
- * @return `optional` containing the `BasePacket` object if the
- *         packet was valid,
+ * @return `optional` containing the `PacketView` if the packet was valid,
  * @return `nullopt` otherwise.
  */
-std::optional<std::unique_ptr<BasePacket>> TFTPConnectionBase::recv_packet(
+std::optional<PacketView> TFTPConnectionBase::recv_packet(
     bool addr_overwrite) {
      struct sockaddr_in origin_addr {};
      socklen_t origin_addr_len = sizeof(origin_addr);
 
-     /* Receive packet */
-     this->rx_len = recvfrom(
-         this->conn_fd, this->rx_buffer.data(), this->rx_buffer.size(), 0,
-         reinterpret_cast<struct sockaddr *>(&origin_addr), &origin_addr_len);
+     /* Receive packet (or take the delivered one, already matched to
+      * the remote host by the owner of the shared socket) */
+     if (this->sock_shared) {
+          if (!this->rx_pending) return std::nullopt;
+          this->rx_pending = false;
+          origin_addr = this->rem_addr;
+     } else if (this->rx_pending) {
+          /* Next datagram of the GRO batch (same origin as the first) */
+          this->rx_off += this->rx_seg;
+          this->rx_len = static_cast<ssize_t>(
+              std::min(this->rx_seg, this->rx_end - this->rx_off));
+          this->rx_pending = this->rx_off + this->rx_seg < this->rx_end;
+          origin_addr = this->rem_addr;
+     } else if (this->gro) {
+          TraceSpan trace("net", "recvmsg", this->tid);
+          this->rx_len = this->recv_gro(origin_addr);
+          trace.set_bytes(static_cast<int64_t>(this->rx_end));
+     } else {
+          TraceSpan trace("net", "recvfrom", this->tid);
+          this->rx_len = recvfrom(
+              this->conn_fd, this->rx_buffer.data(), this->rx_buffer.size(),
+              0, reinterpret_cast<struct sockaddr *>(&origin_addr),
+              &origin_addr_len);
+          trace.set_bytes(this->rx_len);
+     }
 
      /* Handle errors */
      if (rx_len < 0) {
@@ -619,16 +1389,26 @@ std::optional<std::unique_ptr<BasePacket>> TFTPConnectionBase::recv_packet(
           return std::nullopt;
      }
 
+     /* Injected loss => as if never received */
+     if (this->loss > 0) {
+          static thread_local std::minstd_rand rng(std::random_device{}());
+          if (std::bernoulli_distribution(this->loss)(rng)) {
+               this->stats.dropped++;
+               this->rx_len = 0;
+               return std::nullopt;
+          }
+     }
+
      /* Parse incoming packet */
-     auto packet_ptr = PacketFactory::create(
-         std::vector<char>(rx_buffer.begin(), rx_buffer.begin() + rx_len));
-     if (!packet_ptr) {
+     auto packet_view = PacketView::parse(std::span<const char>(
+         this->rx_buffer.data() + this->rx_off, this->rx_len));
+     if (!packet_view.has_value()) {
           send_error(TFTPErrorCode::IllegalOperation,
                      "Received an invalid packet");
           return std::nullopt;
      }
 
-     Logger::packet(*packet_ptr, origin_addr, this->con_addr);
+     Logger::packet(*packet_view, origin_addr, this->con_addr);
 
      /* Overwrite host_addr if applicable,      */
      /* otherwise check TID/origin-client match */
@@ -638,27 +1418,103 @@ std::optional<std::unique_ptr<BasePacket>> TFTPConnectionBase::recv_packet(
           this->rem_addr_len = origin_addr_len;
      } else if (!this->is_remote_addr(origin_addr)) {
           /* Packet not from established remote host */
-          log_info("Received packet from unexpected origin");
-
-          /* Send an ERROR packet to the host */
-          ErrorPacket err = ErrorPacket(TFTPErrorCode::UnknownTID,
-                                        "Unexpected packet origin");
-          auto err_payload = err.to_binary();
-
-          this->update_sent_time();
-          sendto(this->conn_fd, err_payload.data(), err_payload.size(), 0,
-                 reinterpret_cast<const sockaddr *>(&origin_addr),
-                 sizeof(origin_addr));
+          this->handle_stray(origin_addr, *packet_view);
 
-          /* Clear buffer */
-          std::fill(rx_buffer.begin(), rx_buffer.end(), 0);
+          /* Drop the packet (and the rest of its GRO batch) */
           this->rx_len = 0;
+          this->rx_pending = false;
 
           /* …as if nothing happened */
           return std::nullopt;
      }
 
-     return packet_ptr;
+     return packet_view;
+}
+
+/**
+ * @details Logs the remote ERROR (code and message, if any) and
+ *          transitions to `Errored` – no ERROR is sent back.
+ */
+void TFTPConnectionBase::handle_error(const ErrorView &err) {
+     this->stats.err_recv = err.errcode;
+     log_error("Host errored with code " + std::to_string(err.errcode));
+     if (!err.message.empty())
+          log_error("'" + NetASCII::na_to_str(std::vector<char>(
+                        err.message.begin(), err.message.end()))
+                    + "'");
+
+     this->set_state(TFTPConnectionState::Errored);
+}
+
+/**
+ * @details Answers with an ERROR (unknown TID, RFC 1350), which is not
+ *          awaited and does not affect the connection.
+ */
+void TFTPConnectionBase::handle_stray(const sockaddr_in &origin,
+                                      const PacketView &packet) {
+     (void)packet;
+     log_info("Received packet from unexpected origin");
+
+     ErrorPacket err = ErrorPacket(TFTPErrorCode::UnknownTID,
+                                   "Unexpected packet origin");
+     auto payload = err.to_binary();
+     sendto(this->conn_fd, payload.data(), payload.size(), 0,
+            reinterpret_cast<const sockaddr *>(&origin), sizeof(origin));
+}
+
+/**
+ * @details Waits with `poll()` on the connection socket (and the group
+ *          socket of a multicast download) for at most the time left
+ *          until `deadline` (rounded up, so that `is_timedout` holds
+ *          after a timeout). Interrupted waits just return, so that
+ *          `exec` can check the shutdown flag.
+ */
+void TFTPConnectionBase::await_readable() const {
+     int timeout_ms = TFTP_PACKET_TIMEO * 1000;
+     if (this->deadline.has_value()) {
+          auto left = *this->deadline - std::chrono::steady_clock::now();
+          timeout_ms = std::max<int>(
+              0, std::chrono::ceil<std::chrono::milliseconds>(left).count());
+     }
+
+     struct pollfd pfds[] = {{this->conn_fd, POLLIN, 0},
+                             {this->group_fd, POLLIN, 0}};
+     poll(pfds, this->group_fd < 0 ? 1 : 2, timeout_ms);
+}
+
+/**
+ * @details Uses `fallocate` with `FALLOC_FL_KEEP_SIZE`, so the file
+ *          keeps growing by writes as usual – only the blocks are
+ *          reserved up front. Reserved blocks left past the end are
+ *          freed by the destructor. File systems without `fallocate`
+ *          support are not an error.
+ * @details `size` is claimed by the remote: more than the free space
+ *          of the file system fails without reserving anything, more
+ *          than `TFTP_MAX_PREALLOC` is written without preallocation.
+ */
+bool TFTPConnectionBase::prealloc(uint64_t size) {
+     if (size == 0 || this->file_fd < 0) return true;
+     struct stat st;
+     struct statvfs vfs;
+     if (fstat(this->file_fd, &st) == 0 && fstatvfs(this->file_fd, &vfs) == 0) {
+          uint64_t have = static_cast<uint64_t>(st.st_blocks) * 512;
+          if (size > have && (size - have) / vfs.f_frsize >= vfs.f_bavail)
+               return false;
+     }
+     if (size > TFTP_MAX_PREALLOC) {
+          log_info("Not preallocating " + std::to_string(size) + " bytes");
+          return true;
+     }
+
+     if (fallocate(this->file_fd, FALLOC_FL_KEEP_SIZE, 0,
+                   static_cast<off_t>(size))
+         == 0) {
+          this->preallocated = true;
+          return true;
+     }
+
+     this->preallocated = true;  // Partly reserved blocks are freed too
+     return errno != ENOSPC && errno != EFBIG;
 }
 
 /**
@@ -670,6 +1526,7 @@ std::optional<std::unique_ptr<BasePacket>> TFTPConnectionBase::recv_packet(
 void TFTPConnectionBase::send_error(TFTPErrorCode code,
                                     const std::string &message) {
      log_error(message);
+     this->stats.err_sent = code;
 
      ErrorPacket res = ErrorPacket(code, message);
      auto payload = res.to_binary();
@@ -0,0 +1,50 @@
+/**
+ * @file diskwriter.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Background thread for file writes
+ * @date 2023-11-20
+ */
+
+#include "util/diskwriter.hpp"
+
+/* === Constructors === */
+
+DiskWriter::DiskWriter() : thread([this]() { this->run(); }) {}
+
+DiskWriter::~DiskWriter() {
+     {
+          std::lock_guard<std::mutex> lock(this->mtx);
+          this->stop = true;
+     }
+     this->cv.notify_one();
+     this->thread.join();
+}
+
+/* === Core methods === */
+
+void DiskWriter::submit(std::function<void()> task) {
+     {
+          std::lock_guard<std::mutex> lock(this->mtx);
+          this->queue.push_back(std::move(task));
+     }
+     this->cv.notify_one();
+}
+
+/**
+ * @details Tasks are run without the lock held. On stop, the queue is
+ *          emptied first, so that no submitted write is lost.
+ */
+void DiskWriter::run() {
+     std::unique_lock<std::mutex> lock(this->mtx);
+     while (true) {
+          this->cv.wait(
+              lock, [this]() { return this->stop || !this->queue.empty(); });
+          if (this->queue.empty()) return;  // Stopped and drained
+
+          auto task = std::move(this->queue.front());
+          this->queue.pop_front();
+          lock.unlock();
+          task();
+          lock.lock();
+     }
+}
@@ -0,0 +1,85 @@
+/**
+ * @file drrqueue.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Deficit round-robin queue of backlogged transfers
+ * @date 2023-11-25
+ */
+
+#include "util/drrqueue.hpp"
+
+#include <algorithm>
+
+/* === Core methods === */
+
+void DrrQueue::push(int key, void* data) {
+     auto [it, added] = this->flows.try_emplace(key, Flow{data});
+     it->second.data = data;
+     if (!added) return;
+
+     it->second.gen = ++this->gen;
+     this->fresh.push_back({key, it->second.gen});
+}
+
+void DrrQueue::remove(int key) { this->flows.erase(key); }
+
+/**
+ * @details Every flow gets (at most) one turn per call, fresh flows
+ *          first. A turn ends once the flow's deficit does not cover
+ *          its next packet (what is left carries over), it runs out of
+ *          data or its pacer holds it (deficit dropped). If the budget
+ *          does not cover the next packet instead, the call ends and
+ *          the turn goes on in the next one.
+ * @details A flow out of data leaves the queue on its turn in `order`,
+ *          fresh ones move there first (RFC 8290): one with data again
+ *          by its next turn was not sparse, and stays in the order.
+ */
+size_t DrrQueue::serve(size_t budget, const Sender& send) {
+     size_t total = 0;
+     this->round++;
+     while (budget > 0) {
+          auto& list = this->fresh.empty() ? this->order : this->fresh;
+          if (list.empty()) break;
+
+          /* Next flow (dropping stale entries) */
+          Entry entry = list.front();
+          auto it = this->flows.find(entry.key);
+          if (it == this->flows.end() || it->second.gen != entry.gen) {
+               list.pop_front();
+               continue;  // Removed (and maybe queued again since)
+          }
+          if (it->second.round == this->round) break;  // Everyone had one
+          it->second.round = this->round;
+          if (!it->second.turn) {
+               it->second.turn = true;
+               it->second.deficit += this->quantum;
+          }
+
+          /* Its turn (the sender may remove or queue flows) */
+          size_t allowance = std::min(it->second.deficit, budget);
+          Served res = send(entry.key, it->second.data, allowance);
+          res.bytes = std::min(res.bytes, allowance);
+          total += res.bytes;
+          budget -= res.bytes;
+          it = this->flows.find(entry.key);
+          if (it == this->flows.end() || it->second.gen != entry.gen)
+               continue;
+          Flow& flow = it->second;
+          flow.deficit -= res.bytes;
+
+          if (!res.more && &list == &this->order) {
+               this->flows.erase(it);
+               list.pop_front();
+               continue;
+          }
+          if (!res.more || res.paced) {
+               flow.deficit = 0;
+          } else if (allowance < flow.deficit + res.bytes) {
+               break;  // Cut short by the budget, goes on next time
+          }
+
+          flow.turn = false;
+          list.pop_front();
+          this->order.push_back(entry);
+     }
+     return total;
+}
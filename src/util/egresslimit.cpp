@@ -0,0 +1,41 @@
+/**
+ * @file egresslimit.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Egress rate limit shared by the server workers
+ * @date 2023-11-25
+ */
+
+#include "util/egresslimit.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "common.hpp"
+
+/**
+ * @details The bucket holds a `TFTP_PACE_BURST_US` worth of the rate,
+ *          but at least the largest DATA packet.
+ */
+EgressLimit::EgressLimit(double rate)
+    : bucket(rate, std::max(rate * TFTP_PACE_BURST_US / 1e6,
+                            TFTP_MAX_BLKSIZE + 4.0)) {}
+
+/* === Core methods === */
+
+size_t EgressLimit::budget(TimePoint now) {
+     std::lock_guard<std::mutex> lock(this->mtx);
+     if (!this->bucket.is_limited()) return SIZE_MAX;
+     return static_cast<size_t>(
+         std::max(std::floor(this->bucket.available(now)), 0.0));
+}
+
+void EgressLimit::consume(size_t bytes) {
+     std::lock_guard<std::mutex> lock(this->mtx);
+     this->bucket.consume(static_cast<double>(bytes));
+}
+
+EgressLimit::TimePoint EgressLimit::ready_at(size_t bytes) const {
+     std::lock_guard<std::mutex> lock(this->mtx);
+     return this->bucket.ready_at(static_cast<double>(bytes));
+}
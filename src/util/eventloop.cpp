@@ -0,0 +1,159 @@
+/**
+ * @file eventloop.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Pluggable I/O event loop (poll, epoll, io_uring)
+ * @date 2023-11-18
+ */
+
+#include "util/eventloop.hpp"
+
+#ifdef TFTP_IO_URING
+#     include "util/eventloop_uring.hpp"
+#endif
+
+/* === Factory === */
+
+std::unique_ptr<EventLoop> EventLoop::create(EventLoopBackend backend) {
+     switch (backend) {
+          case EventLoopBackend::Poll:
+               return std::make_unique<PollEventLoop>();
+          case EventLoopBackend::Epoll:
+               return std::make_unique<EpollEventLoop>();
+          case EventLoopBackend::IoUring:
+#ifdef TFTP_IO_URING
+               return std::make_unique<UringEventLoop>();
+#else
+               throw std::runtime_error(
+                   "io_uring backend not built (build with IO_URING=1)");
+#endif
+     }
+
+     throw std::runtime_error("Unknown event loop backend");
+}
+
+/* === Core methods === */
+
+void EventLoop::remove(int fd) {
+     this->timers.cancel(fd);
+     this->remove_io(fd);
+
+     /* Invalidate pending events of `fd` (fd might get reused) */
+     for (auto& event : this->events)
+          if (event.fd == fd) event.data = nullptr;
+}
+
+/**
+ * @details The wait is cut short at the nearest timer deadline. Timers
+ *          that expired by the time the backend returns are appended
+ *          after the I/O events, with the `expired` flag set.
+ */
+int EventLoop::wait(int timeout_ms) {
+     this->events.clear();
+
+     this->wait_io(this->timers.timeout_ms(TimerQueue::Clock::now(),
+                                            timeout_ms));
+
+     this->expired.clear();
+     this->timers.expire(TimerQueue::Clock::now(), this->expired);
+     for (const auto& timer : this->expired)
+          this->events.push_back({timer.fd, timer.data, true});
+
+     return this->events.size();
+}
+
+/* === poll() === */
+
+void PollEventLoop::add_io(int fd, void* data) {
+     if (static_cast<size_t>(fd) >= this->fd_pos.size())
+          this->fd_pos.resize(fd + 1, -1);
+
+     this->fd_pos[fd] = this->fds.size();
+     this->fds.push_back({fd, POLLIN, 0});
+     this->fds_data.push_back(data);
+}
+
+/**
+ * @details The removed descriptor is replaced by the last one,
+ *          whose position is then updated in `fd_pos`.
+ */
+void PollEventLoop::remove_io(int fd) {
+     if (static_cast<size_t>(fd) >= this->fd_pos.size()
+         || this->fd_pos[fd] < 0)
+          return;
+
+     size_t pos = this->fd_pos[fd];
+     this->fds[pos] = this->fds.back();
+     this->fds_data[pos] = this->fds_data.back();
+     this->fd_pos[this->fds[pos].fd] = pos;
+     this->fds.pop_back();
+     this->fds_data.pop_back();
+     this->fd_pos[fd] = -1;
+}
+
+void PollEventLoop::wait_io(int timeout_ms) {
+     int n_events = poll(this->fds.data(), this->fds.size(), timeout_ms);
+     if (n_events < 0) {
+          if (errno == EINTR) return;
+          throw std::runtime_error("Polling error : "
+                                   + std::string(strerror(errno)));
+     }
+
+     for (size_t i = 0; i < this->fds.size() && n_events > 0; i++) {
+          if (this->fds[i].revents == 0) continue;
+          n_events--;
+          if (this->fds[i].revents & (POLLIN | POLLERR | POLLHUP))
+               this->events.push_back({this->fds[i].fd, this->fds_data[i]});
+          this->fds[i].revents = 0;
+     }
+}
+
+/* === epoll === */
+
+EpollEventLoop::EpollEventLoop() : ready(256) {
+     this->epfd = epoll_create1(EPOLL_CLOEXEC);
+     if (this->epfd < 0)
+          throw std::runtime_error("Failed to create epoll : "
+                                   + std::string(strerror(errno)));
+}
+
+EpollEventLoop::~EpollEventLoop() {
+     if (this->epfd != -1) close(this->epfd);
+}
+
+void EpollEventLoop::add_io(int fd, void* data) {
+     struct epoll_event ev {};
+     ev.events = EPOLLIN;
+     ev.data.fd = fd;
+     if (epoll_ctl(this->epfd, EPOLL_CTL_ADD, fd, &ev) < 0)
+          throw std::runtime_error("Failed to add fd to epoll : "
+                                   + std::string(strerror(errno)));
+
+     if (static_cast<size_t>(fd) >= this->fd_data.size())
+          this->fd_data.resize(fd + 1, nullptr);
+     this->fd_data[fd] = data;
+}
+
+void EpollEventLoop::remove_io(int fd) {
+     epoll_ctl(this->epfd, EPOLL_CTL_DEL, fd, nullptr);
+     if (static_cast<size_t>(fd) < this->fd_data.size())
+          this->fd_data[fd] = nullptr;
+}
+
+void EpollEventLoop::wait_io(int timeout_ms) {
+     int n_events = epoll_wait(this->epfd, this->ready.data(),
+                               this->ready.size(), timeout_ms);
+     if (n_events < 0) {
+          if (errno == EINTR) return;
+          throw std::runtime_error("Polling error : "
+                                   + std::string(strerror(errno)));
+     }
+
+     for (int i = 0; i < n_events; i++) {
+          int fd = this->ready[i].data.fd;
+          this->events.push_back({fd, this->fd_data[fd]});
+     }
+
+     /* Full buffer => grow for the next round */
+     if (static_cast<size_t>(n_events) == this->ready.size())
+          this->ready.resize(this->ready.size() * 2);
+}
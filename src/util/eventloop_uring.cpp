@@ -0,0 +1,199 @@
+/**
+ * @file eventloop_uring.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief io_uring event loop backend (built with IO_URING=1)
+ * @date 2023-11-18
+ * @see https://man7.org/linux/man-pages/man7/io_uring.7.html
+ */
+
+#ifdef TFTP_IO_URING
+
+#     include "util/eventloop_uring.hpp"
+
+#     include <signal.h>
+#     include <sys/mman.h>
+#     include <sys/syscall.h>
+
+/** @brief User data of SQEs whose completions are ignored */
+static const uint64_t URING_IGNORE = UINT64_MAX;
+
+/** @brief Number of SQ entries */
+static const unsigned URING_ENTRIES = 1024;
+
+/* === Constructors === */
+
+/**
+ * @details Sets up the ring and maps the SQ ring, CQ ring and SQE array
+ *          as described in `io_uring(7)`.
+ */
+UringEventLoop::UringEventLoop() {
+     struct io_uring_params params {};
+     this->ring_fd = syscall(__NR_io_uring_setup, URING_ENTRIES, &params);
+     if (this->ring_fd < 0)
+          throw std::runtime_error("Failed to set up io_uring : "
+                                   + std::string(strerror(errno)));
+
+     if (!(params.features & IORING_FEAT_EXT_ARG)
+         || !(params.features & IORING_FEAT_SINGLE_MMAP)) {
+          close(this->ring_fd);
+          throw std::runtime_error("io_uring lacks required features");
+     }
+     this->entries = params.sq_entries;
+
+     /* Map rings (single mapping for both SQ and CQ) */
+     this->sq_ring_sz
+         = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+     this->cq_ring_sz = params.cq_off.cqes
+                        + params.cq_entries * sizeof(struct io_uring_cqe);
+     this->sq_ring_sz = std::max(this->sq_ring_sz, this->cq_ring_sz);
+     this->sq_ring
+         = mmap(nullptr, this->sq_ring_sz, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, this->ring_fd, IORING_OFF_SQ_RING);
+     if (this->sq_ring == MAP_FAILED) {
+          close(this->ring_fd);
+          throw std::runtime_error("Failed to map io_uring");
+     }
+     this->cq_ring = this->sq_ring;
+
+     this->sqes_sz = params.sq_entries * sizeof(struct io_uring_sqe);
+     void* sqes_map
+         = mmap(nullptr, this->sqes_sz, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, this->ring_fd, IORING_OFF_SQES);
+     if (sqes_map == MAP_FAILED) {
+          munmap(this->sq_ring, this->sq_ring_sz);
+          close(this->ring_fd);
+          throw std::runtime_error("Failed to map io_uring SQEs");
+     }
+     this->sqes = static_cast<struct io_uring_sqe*>(sqes_map);
+
+     /* Ring pointers */
+     char* sq = static_cast<char*>(this->sq_ring);
+     char* cq = static_cast<char*>(this->cq_ring);
+     this->sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+     this->sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+     this->sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+     this->sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+     this->cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+     this->cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+     this->cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+     this->cqes
+         = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+}
+
+UringEventLoop::~UringEventLoop() {
+     if (this->sqes) munmap(this->sqes, this->sqes_sz);
+     if (this->sq_ring) munmap(this->sq_ring, this->sq_ring_sz);
+     if (this->ring_fd != -1) close(this->ring_fd);
+}
+
+/* === Submission === */
+
+/**
+ * @details SQEs are published to the kernel right away (tail store with
+ *          release semantics), but only submitted by the next
+ *          `io_uring_enter` – in `wait()`, or here when the SQ is full.
+ */
+struct io_uring_sqe* UringEventLoop::get_sqe() {
+     unsigned head = __atomic_load_n(this->sq_head, __ATOMIC_ACQUIRE);
+     unsigned tail = *this->sq_tail;
+
+     /* Full submission queue => submit what we have */
+     if (tail - head >= this->entries)
+          syscall(__NR_io_uring_enter, this->ring_fd, tail - head, 0, 0,
+                  nullptr, 0);
+
+     unsigned idx = tail & *this->sq_mask;
+     struct io_uring_sqe* sqe = &this->sqes[idx];
+     memset(sqe, 0, sizeof(*sqe));
+     this->sq_array[idx] = idx;
+     __atomic_store_n(this->sq_tail, tail + 1, __ATOMIC_RELEASE);
+     return sqe;
+}
+
+void UringEventLoop::arm(int fd) {
+     struct io_uring_sqe* sqe = this->get_sqe();
+     sqe->opcode = IORING_OP_POLL_ADD;
+     sqe->fd = fd;
+     sqe->poll32_events = POLLIN;
+     sqe->user_data = this->user_data(fd);
+}
+
+/* === Core methods === */
+
+void UringEventLoop::add_io(int fd, void* data) {
+     if (static_cast<size_t>(fd) >= this->regs.size())
+          this->regs.resize(fd + 1);
+
+     auto& reg = this->regs[fd];
+     reg.data = data;
+     reg.gen++;
+     reg.active = true;
+     this->arm(fd);
+}
+
+/**
+ * @details The pending poll request is cancelled by its user data.
+ *          Bumping the generation makes its (cancelled) completion
+ *          stale, even if the descriptor number gets reused meanwhile.
+ */
+void UringEventLoop::remove_io(int fd) {
+     if (static_cast<size_t>(fd) >= this->regs.size()
+         || !this->regs[fd].active)
+          return;
+
+     struct io_uring_sqe* sqe = this->get_sqe();
+     sqe->opcode = IORING_OP_POLL_REMOVE;
+     sqe->fd = -1;
+     sqe->addr = this->user_data(fd);
+     sqe->user_data = URING_IGNORE;
+
+     this->regs[fd].gen++;
+     this->regs[fd].active = false;
+     this->regs[fd].data = nullptr;
+}
+
+/**
+ * @details Submits all queued SQEs and waits for at least one CQE (or
+ *          the timeout) in one `io_uring_enter`, then reaps all CQEs.
+ *          Descriptors with an event are re-armed for the next round.
+ */
+void UringEventLoop::wait_io(int timeout_ms) {
+     struct __kernel_timespec ts {};
+     ts.tv_sec = timeout_ms / 1000;
+     ts.tv_nsec = (timeout_ms % 1000) * 1000000L;
+
+     struct io_uring_getevents_arg arg {};
+     arg.sigmask_sz = _NSIG / 8;
+     arg.ts = timeout_ms < 0 ? 0 : reinterpret_cast<uint64_t>(&ts);
+
+     /* Submit everything the kernel has not consumed yet */
+     unsigned to_submit
+         = *this->sq_tail - __atomic_load_n(this->sq_head, __ATOMIC_ACQUIRE);
+     int res = syscall(__NR_io_uring_enter, this->ring_fd, to_submit, 1,
+                       IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg,
+                       sizeof(arg));
+     if (res < 0 && errno != ETIME && errno != EINTR && errno != EBUSY)
+          throw std::runtime_error("io_uring error : "
+                                   + std::string(strerror(errno)));
+
+     /* Reap completions */
+     unsigned head = *this->cq_head;
+     unsigned tail = __atomic_load_n(this->cq_tail, __ATOMIC_ACQUIRE);
+     for (; head != tail; head++) {
+          const struct io_uring_cqe& cqe = this->cqes[head & *this->cq_mask];
+          if (cqe.user_data == URING_IGNORE) continue;
+
+          int fd = static_cast<int>(cqe.user_data & 0xFFFFFFFF);
+          uint32_t gen = static_cast<uint32_t>(cqe.user_data >> 32);
+          if (static_cast<size_t>(fd) >= this->regs.size()) continue;
+          auto& reg = this->regs[fd];
+          if (!reg.active || reg.gen != gen) continue;  // Stale
+
+          /* Ready (or errored – owner finds out on read) */
+          if (cqe.res != 0) this->events.push_back({fd, reg.data});
+          this->arm(fd);  // One-shot => re-arm (submitted on next wait)
+     }
+     __atomic_store_n(this->cq_head, head, __ATOMIC_RELEASE);
+}
+
+#endif
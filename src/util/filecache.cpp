@@ -0,0 +1,168 @@
+/**
+ * @file filecache.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Shared read-only cache of file images
+ * @date 2023-11-19
+ */
+
+#include "util/filecache.hpp"
+
+#include <unistd.h>
+
+#include <cerrno>
+#include <sstream>
+#include <stdexcept>
+
+/* === Stamp === */
+
+FileCache::Stamp::Stamp(const struct stat& st)
+    : dev(st.st_dev),
+      ino(st.st_ino),
+      size(st.st_size),
+      mtime(st.st_mtim),
+      ctime(st.st_ctim) {}
+
+/**
+ * @details A changed ctime catches also permission changes (a file no
+ *          longer readable must not be served from the cache).
+ */
+bool FileCache::Stamp::operator==(const Stamp& other) const {
+     return this->dev == other.dev && this->ino == other.ino
+            && this->size == other.size
+            && this->mtime.tv_sec == other.mtime.tv_sec
+            && this->mtime.tv_nsec == other.mtime.tv_nsec
+            && this->ctime.tv_sec == other.ctime.tv_sec
+            && this->ctime.tv_nsec == other.ctime.tv_nsec;
+}
+
+/* === Core methods === */
+
+std::shared_ptr<FileCache::Image> FileCache::get(const std::string& path,
+                                                 const struct stat& st,
+                                                 TFTPDataFormat format) {
+     std::lock_guard<std::mutex> lock(this->mtx);
+
+     auto it = this->entries.find(make_key(path, format));
+     if (it == this->entries.end()) {
+          this->stats.misses++;
+          return nullptr;
+     }
+
+     /* File changed since => drop the stale image */
+     if (!(it->second.stamp == Stamp(st))) {
+          this->erase(it);
+          this->stats.evictions++;
+          this->stats.misses++;
+          return nullptr;
+     }
+
+     this->lru.splice(this->lru.begin(), this->lru, it->second.lru_it);
+     this->stats.hits++;
+     return it->second.image;
+}
+
+/**
+ * @details Octet images are read as they are, NetASCII images are
+ *          encoded in one go (`NetASCII::encode`). Misses of the same
+ *          file in several workers at once may load it more times, the
+ *          last loaded image stays cached.
+ */
+std::shared_ptr<FileCache::Image> FileCache::load(const std::string& path,
+                                                  int fd,
+                                                  const struct stat& st,
+                                                  TFTPDataFormat format) {
+     if (format == TFTPDataFormat::NetASCII && !this->netascii) return nullptr;
+     size_t size = st.st_size;
+     if (size > this->budget) return nullptr;
+
+     /* Read the whole file */
+     std::vector<char> data(size);
+     size_t len = 0;
+     while (len < size) {
+          ssize_t bytes_rx = pread(fd, data.data() + len, size - len, len);
+          if (bytes_rx < 0) {
+               if (errno == EINTR) continue;
+               throw std::runtime_error("Could not read file");
+          }
+          if (bytes_rx == 0) break;  // Truncated meanwhile
+          len += bytes_rx;
+     }
+     data.resize(len);
+
+     /* Encode NetASCII */
+     if (format == TFTPDataFormat::NetASCII) {
+          std::vector<char> encoded(NetASCII::max_encoded(len));
+          NetASCII::State state;
+          size_t enc_len = NetASCII::encode(data, encoded, state);
+          enc_len += NetASCII::encode_end(
+              std::span<char>(encoded).subspan(enc_len), state);
+          encoded.resize(enc_len);
+          encoded.shrink_to_fit();
+          data = std::move(encoded);
+     }
+     auto image = std::make_shared<Image>(std::move(data));
+     if (image->size() > this->budget) return image;  // Serve, not cache
+
+     std::lock_guard<std::mutex> lock(this->mtx);
+
+     /* Replace an older entry */
+     std::string key = make_key(path, format);
+     if (auto it = this->entries.find(key); it != this->entries.end())
+          this->erase(it);
+
+     /* Evict least recently used images to fit in the budget */
+     while (!this->lru.empty()
+            && this->stats.bytes + image->size() > this->budget) {
+          this->erase(this->entries.find(this->lru.back()));
+          this->stats.evictions++;
+     }
+
+     this->lru.push_front(key);
+     this->entries.emplace(key, Entry{Stamp(st), image, this->lru.begin()});
+     this->stats.entries++;
+     this->stats.bytes += image->size();
+     return image;
+}
+
+FileCache::Stats FileCache::get_stats() const {
+     std::lock_guard<std::mutex> lock(this->mtx);
+     return this->stats;
+}
+
+std::string FileCache::to_prometheus() const {
+     Stats st = this->get_stats();
+     std::ostringstream out;
+
+     out << "# HELP tftp_file_cache_lookups_total File cache lookups by "
+            "result\n"
+         << "# TYPE tftp_file_cache_lookups_total counter\n"
+         << "tftp_file_cache_lookups_total{result=\"hit\"} " << st.hits
+         << "\n"
+         << "tftp_file_cache_lookups_total{result=\"miss\"} " << st.misses
+         << "\n"
+         << "# HELP tftp_file_cache_evictions_total Evicted file images\n"
+         << "# TYPE tftp_file_cache_evictions_total counter\n"
+         << "tftp_file_cache_evictions_total " << st.evictions << "\n"
+         << "# HELP tftp_file_cache_entries Cached file images\n"
+         << "# TYPE tftp_file_cache_entries gauge\n"
+         << "tftp_file_cache_entries " << st.entries << "\n"
+         << "# HELP tftp_file_cache_bytes Bytes of cached file images\n"
+         << "# TYPE tftp_file_cache_bytes gauge\n"
+         << "tftp_file_cache_bytes " << st.bytes << "\n";
+
+     return out.str();
+}
+
+/* === Helper methods === */
+
+std::string FileCache::make_key(const std::string& path,
+                                TFTPDataFormat format) {
+     return (format == TFTPDataFormat::NetASCII ? "a:" : "o:") + path;
+}
+
+void FileCache::erase(std::unordered_map<std::string, Entry>::iterator it) {
+     this->stats.entries--;
+     this->stats.bytes -= it->second.image->size();
+     this->lru.erase(it->second.lru_it);
+     this->entries.erase(it);
+}
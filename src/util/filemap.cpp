@@ -0,0 +1,114 @@
+/**
+ * @file filemap.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Read-only memory mapping of a file
+ * @date 2023-11-19
+ */
+
+#include "util/filemap.hpp"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <csetjmp>
+#include <csignal>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+#include "common.hpp"
+
+/* === SIGBUS guard === */
+
+/** @brief Jump out of the copy in flight (read by the handler) */
+static thread_local sigjmp_buf* volatile bus_guard = nullptr;
+/** @brief SIGBUS handler before the guard */
+static struct sigaction bus_prev;
+
+/**
+ * @brief Jumps out of a guarded copy, other faults go to the previous
+ *        handler (by default, killing the process)
+ */
+static void bus_handler(int sig, siginfo_t* info, void* ctx) {
+     if (bus_guard) siglongjmp(*bus_guard, 1);
+     if (bus_prev.sa_flags & SA_SIGINFO)
+          return bus_prev.sa_sigaction(sig, info, ctx);
+     sigaction(SIGBUS, &bus_prev, nullptr);  // Faults again, unguarded
+}
+
+/* === Constructors === */
+
+FileMap::FileMap(int fd, size_t size) : size(size) {
+     if (size == 0) throw std::runtime_error("Cannot map an empty file");
+
+     /* Guard copies (again, if another handler took over since) */
+     static std::mutex guard_mutex;
+     {
+          std::lock_guard<std::mutex> lock(guard_mutex);
+          struct sigaction cur {};
+          sigaction(SIGBUS, nullptr, &cur);
+          if (!(cur.sa_flags & SA_SIGINFO)
+              || cur.sa_sigaction != bus_handler) {
+               struct sigaction sa {};
+               sa.sa_sigaction = bus_handler;
+               sa.sa_flags = SA_SIGINFO;
+               sigemptyset(&sa.sa_mask);
+               sigaction(SIGBUS, &sa, &bus_prev);
+          }
+     }
+
+     void* addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+     if (addr == MAP_FAILED) throw std::runtime_error("Failed to map file");
+     this->data = static_cast<const char*>(addr);
+
+     /* Only hints – failures are harmless */
+     madvise(addr, size, MADV_SEQUENTIAL);
+     this->advised = std::min(size, TFTP_MMAP_READAHEAD);
+     madvise(addr, this->advised, MADV_WILLNEED);
+}
+
+FileMap::~FileMap() {
+     munmap(const_cast<char*>(this->data), this->size);
+}
+
+/* === Core methods === */
+
+/**
+ * @details Pages past the end of a file truncated while mapped raise
+ *          SIGBUS on access. The copy runs under a guard that turns the
+ *          signal into an exception, so only the reader fails.
+ */
+size_t FileMap::read(char* out, size_t len, size_t off) {
+     auto part = this->slice(len, off);
+     sigjmp_buf env;
+     if (sigsetjmp(env, 1) != 0) {
+          bus_guard = nullptr;
+          throw std::runtime_error("File changed while mapped");
+     }
+     bus_guard = &env;
+     memcpy(out, part.data(), part.size());
+     bus_guard = nullptr;
+     return part.size();
+}
+
+/**
+ * @details Once the reader gets within half a window of the advised end,
+ *          the next window is requested, so that the disk reads overlap
+ *          sending the current one. Windows start at multiples of
+ *          `TFTP_MMAP_READAHEAD`, which keeps them page-aligned.
+ */
+std::span<const char> FileMap::slice(size_t len, size_t off) {
+     if (off >= this->size) return {};
+     len = std::min(len, this->size - off);
+
+     if (this->advised < this->size
+         && off + len + TFTP_MMAP_READAHEAD / 2 > this->advised) {
+          size_t win
+              = std::min(TFTP_MMAP_READAHEAD, this->size - this->advised);
+          madvise(const_cast<char*>(this->data) + this->advised, win,
+                  MADV_WILLNEED);
+          this->advised += win;
+     }
+
+     return {this->data + off, len};
+}
@@ -0,0 +1,57 @@
+/**
+ * @file grouppool.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Pool of multicast group addresses (RFC 2090 sessions)
+ * @date 2023-11-25
+ */
+
+#include "util/grouppool.hpp"
+
+#include <stdexcept>
+
+/* === Setup methods === */
+
+GroupPool::GroupPool(const sockaddr_in& base, size_t size)
+    : base(ntohl(base.sin_addr.s_addr)), port(base.sin_port), used(size) {
+     if (size == 0 || !IN_MULTICAST(this->base)
+         || !IN_MULTICAST(this->base + (size - 1))
+         || this->base + (size - 1) < this->base)
+          throw std::runtime_error("Invalid multicast group range");
+}
+
+/* === Core methods === */
+
+/**
+ * @details Free groups are searched from the one after the last taken,
+ *          wrapping around (O(size) at worst, the pool is small).
+ */
+std::optional<sockaddr_in> GroupPool::acquire() {
+     std::lock_guard<std::mutex> lock(this->mtx);
+     if (this->active == this->used.size()) return std::nullopt;
+
+     while (this->used[this->next])
+          this->next = (this->next + 1) % this->used.size();
+     this->used[this->next] = true;
+     this->active++;
+
+     sockaddr_in group{};
+     group.sin_family = AF_INET;
+     group.sin_port = this->port;
+     group.sin_addr.s_addr = htonl(this->base + this->next);
+     this->next = (this->next + 1) % this->used.size();
+     return group;
+}
+
+void GroupPool::release(const sockaddr_in& group) {
+     std::lock_guard<std::mutex> lock(this->mtx);
+     size_t slot = ntohl(group.sin_addr.s_addr) - this->base;
+     if (slot >= this->used.size() || !this->used[slot]) return;
+
+     this->used[slot] = false;
+     this->active--;
+}
+
+size_t GroupPool::get_active() const {
+     std::lock_guard<std::mutex> lock(this->mtx);
+     return this->active;
+}
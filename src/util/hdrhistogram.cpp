@@ -0,0 +1,84 @@
+/**
+ * @file hdrhistogram.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief High dynamic range histogram (percentiles of latencies)
+ * @date 2023-11-25
+ */
+
+#include "util/hdrhistogram.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+/** @brief Values counted exactly (below 2^`SUB_BITS`) */
+static const uint64_t EXACT = uint64_t{1} << HdrHistogram::SUB_BITS;
+
+/** @brief Buckets per power of two above `EXACT` */
+static const uint64_t HALF = EXACT / 2;
+
+HdrHistogram::HdrHistogram()
+    : buckets(EXACT + (64 - SUB_BITS) * HALF) {}
+
+/* === Core methods === */
+
+void HdrHistogram::record(uint64_t value, uint64_t n) {
+     if (n == 0) return;
+     this->buckets[index_of(value)] += n;
+     this->count += n;
+     this->min = std::min(this->min, value);
+     this->max = std::max(this->max, value);
+     this->sum += static_cast<double>(value) * static_cast<double>(n);
+}
+
+void HdrHistogram::merge(const HdrHistogram &other) {
+     for (size_t i = 0; i < this->buckets.size(); i++)
+          this->buckets[i] += other.buckets[i];
+     this->count += other.count;
+     this->min = std::min(this->min, other.min);
+     this->max = std::max(this->max, other.max);
+     this->sum += other.sum;
+}
+
+/**
+ * @details The percentile is the value the `ceil(pct% * count)`-th
+ *          lowest value was recorded as, so p0 is the minimum and p100
+ *          the maximum.
+ */
+uint64_t HdrHistogram::percentile(double pct) const {
+     if (this->count == 0) return 0;
+     if (pct <= 0) return this->min;
+
+     auto rank = static_cast<uint64_t>(
+         std::ceil(std::min(pct, 100.0) / 100.0 * this->count));
+     rank = std::max<uint64_t>(rank, 1);
+
+     uint64_t seen = 0;
+     for (size_t i = 0; i < this->buckets.size(); i++) {
+          seen += this->buckets[i];
+          if (seen >= rank)
+               return std::clamp(highest_of(i), this->min, this->max);
+     }
+     return this->max;
+}
+
+/* === Helper methods === */
+
+/**
+ * @details Above `EXACT`, a value is shifted right until it has
+ *          `SUB_BITS` bits; the shift picks the power of two and the
+ *          remaining top bits (always with the highest one set) the
+ *          bucket within it.
+ */
+size_t HdrHistogram::index_of(uint64_t value) {
+     if (value < EXACT) return value;
+     unsigned shift = std::bit_width(value) - SUB_BITS;
+     return EXACT + (shift - 1) * HALF + ((value >> shift) - HALF);
+}
+
+uint64_t HdrHistogram::highest_of(size_t idx) {
+     if (idx < EXACT) return idx;
+     unsigned shift = (idx - EXACT) / HALF + 1;
+     uint64_t top = (idx - EXACT) % HALF + HALF;
+     return (top << shift) + ((uint64_t{1} << shift) - 1);
+}
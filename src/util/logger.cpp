@@ -0,0 +1,289 @@
+/**
+ * @file logger.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Logging utility class
+ * @date 2023-11-18
+ */
+
+#include "util/logger.hpp"
+
+#include <thread>
+
+namespace {
+
+/**
+ * @brief Background writer of the log ring
+ * @details Producers only fill a ring record and bump `wake`; the
+ *          writer thread sleeps on `wake` (futex-backed `atomic::wait`)
+ *          and writes out everything queued with one `write` per
+ *          buffer-full. A full ring makes producers yield until the
+ *          writer catches up (no entry is ever dropped).
+ */
+class LogSink {
+   public:
+     LogSink() : writer([this] { this->run(); }) {}
+
+     ~LogSink() {
+          this->stop.store(true, std::memory_order_release);
+          this->wake.fetch_add(1, std::memory_order_release);
+          this->wake.notify_one();
+          this->writer.join();
+     }
+
+     LogSink& operator=(LogSink&& other) = delete;
+     LogSink& operator=(const LogSink&) = delete;
+     LogSink(LogSink&& other) = delete;
+     LogSink(const LogSink&) = delete;
+
+     /**
+      * @brief Queues a record, filled in place by `fill`
+      */
+     template <typename F>
+     void push(F&& fill) {
+          while (!this->ring.try_push(fill)) {
+               this->wake.fetch_add(1, std::memory_order_release);
+               this->wake.notify_one();
+               std::this_thread::yield();
+          }
+
+          this->n_pushed.fetch_add(1, std::memory_order_release);
+          this->wake.fetch_add(1, std::memory_order_release);
+          this->wake.notify_one();
+     }
+
+     /**
+      * @brief Waits until all records pushed so far are written
+      */
+     void flush() {
+          uint64_t target = this->n_pushed.load(std::memory_order_acquire);
+          uint64_t written;
+          while ((written = this->n_written.load(std::memory_order_acquire))
+                 < target)
+               this->n_written.wait(written, std::memory_order_acquire);
+     }
+
+   private:
+     /**
+      * @brief Writer thread loop
+      */
+     void run() {
+          std::string out, err;
+          out.reserve(2 * BUF_SIZE);
+          err.reserve(2 * BUF_SIZE);
+
+          while (true) {
+               uint32_t seen = this->wake.load(std::memory_order_acquire);
+
+               /* Drain the ring */
+               uint64_t n_recs = 0;
+               while (this->ring.try_pop([&](const LogRecord &rec) {
+                    auto &buf = (rec.stream == LogStream::Err) ? err : out;
+                    buf.append(rec.text, rec.len);
+                    buf.push_back('\n');
+               })) {
+                    n_recs++;
+                    if (out.size() >= BUF_SIZE) write_all(STDOUT_FILENO, out);
+                    if (err.size() >= BUF_SIZE) write_all(STDERR_FILENO, err);
+               }
+               write_all(STDOUT_FILENO, out);
+               write_all(STDERR_FILENO, err);
+
+               if (n_recs > 0) {
+                    this->n_written.fetch_add(n_recs,
+                                              std::memory_order_release);
+                    this->n_written.notify_all();
+               }
+
+               /* Exit only once empty */
+               if (this->stop.load(std::memory_order_acquire)) {
+                    if (n_recs == 0) return;
+                    continue;
+               }
+
+               this->wake.wait(seen, std::memory_order_acquire);
+          }
+     }
+
+     /**
+      * @brief Writes the whole buffer to `fd` and clears it
+      */
+     static void write_all(int fd, std::string &buf) {
+          size_t off = 0;
+          while (off < buf.size()) {
+               ssize_t n = write(fd, buf.data() + off, buf.size() - off);
+               if (n < 0 && errno == EINTR) continue;
+               if (n <= 0) break;  // Nowhere to log to
+               off += n;
+          }
+          buf.clear();
+     }
+
+     static const size_t BUF_SIZE = 32768; /**< Write-out threshold */
+
+     LogRing ring;                         /**< Record ring */
+     std::atomic<uint32_t> wake{0};        /**< Writer wake-up counter */
+     std::atomic<uint64_t> n_pushed{0};    /**< Records pushed */
+     std::atomic<uint64_t> n_written{0};   /**< Records written */
+     std::atomic<bool> stop{false};        /**< Writer stop flag */
+     std::thread writer;                   /**< Writer thread (last!) */
+};
+
+/**
+ * @brief Returns the (lazily started) log sink
+ */
+LogSink &sink() {
+     static LogSink instance;
+     return instance;
+}
+
+/**
+ * @brief Gets the name of a packet opcode (with a space)
+ * @return std::string_view name, empty if opcode is unknown
+ */
+std::string_view opcode_name(TFTPOpcode opcode) {
+     switch (opcode) {
+          case TFTPOpcode::RRQ:
+               return "RRQ ";
+          case TFTPOpcode::WRQ:
+               return "WRQ ";
+          case TFTPOpcode::ACK:
+               return "ACK ";
+          case TFTPOpcode::DATA:
+               return "DATA ";
+          case TFTPOpcode::ERROR:
+               return "ERROR ";
+          case TFTPOpcode::OACK:
+               return "OACK ";
+          default:
+               return {};
+     }
+}
+
+/**
+ * @brief Appends `SRC_IP:SRC_PORT[:DST_PORT]` to the line
+ * @note DST_PORT is only logged for DATA and ERROR (if defined).
+ */
+void put_addrs(LogLine &line, TFTPOpcode opcode, const sockaddr_in &src,
+               const std::optional<sockaddr_in> &dst) {
+     line << src.sin_addr << ':' << ntohs(src.sin_port);
+     if (dst.has_value()
+         && (opcode == TFTPOpcode::DATA || opcode == TFTPOpcode::ERROR))
+          line << ':' << ntohs(dst->sin_port);
+}
+
+}  // namespace
+
+/* === Core methods === */
+
+void Logger::flush() { sink().flush(); }
+
+void Logger::emit(LogLevel lvl, LogStream stream, std::string_view prefix,
+                  std::string_view txt) {
+     if (!Logger::enabled(lvl)) return;
+
+     sink().push(
+         [&](LogRecord &rec) { LogLine(rec, stream) << prefix << txt; });
+}
+
+void Logger::emit_conn(LogLevel lvl, int id, std::string_view tag,
+                       std::string_view txt) {
+     if (!Logger::enabled(lvl)) return;
+
+     sink().push([&](LogRecord &rec) {
+          LogLine(rec, LogStream::Out)
+              << "  [" << id << "] - " << tag << " - " << txt;
+     });
+}
+
+/* === Packet logs === */
+
+void Logger::packet(const BasePacket &packet, const sockaddr_in &src,
+                    const std::optional<sockaddr_in> &dst) {
+     auto name = opcode_name(packet.get_opcode());
+     if (!Logger::enabled(LogLevel::Packet) || name.empty()) return;
+
+     sink().push([&](LogRecord &rec) {
+          LogLine line(rec, LogStream::Err);
+          line << name;
+          put_addrs(line, packet.get_opcode(), src, dst);
+
+          /* Type-specific */
+          switch (packet.get_opcode()) {
+               case TFTPOpcode::RRQ:
+               case TFTPOpcode::WRQ: {
+                    const auto &rq_packet
+                        = dynamic_cast<const RequestPacket &>(packet);
+                    line << " \"" << rq_packet.get_filename() << "\" "
+                         << rq_packet.get_mode_str();
+                    for (size_t i = 0; i < rq_packet.get_options_count(); i++)
+                         line << ' ' << rq_packet.get_option_str(i);
+                    break;
+               }
+
+               case TFTPOpcode::ACK:
+                    line << ' '
+                         << dynamic_cast<const AcknowledgementPacket &>(packet)
+                                .get_block_number();
+                    break;
+
+               case TFTPOpcode::DATA:
+                    line << ' '
+                         << dynamic_cast<const DataPacket &>(packet)
+                                .get_block_number();
+                    break;
+
+               case TFTPOpcode::ERROR: {
+                    const auto &err_packet
+                        = dynamic_cast<const ErrorPacket &>(packet);
+                    line << ' '
+                         << static_cast<uint16_t>(err_packet.get_errcode());
+                    if (err_packet.get_message().has_value())
+                         line << " \"" << err_packet.get_message().value()
+                              << '"';
+                    break;
+               }
+
+               case TFTPOpcode::OACK: {
+                    const auto &oack_packet
+                        = dynamic_cast<const OptionAckPacket &>(packet);
+                    for (size_t i = 0; i < oack_packet.get_options_count(); i++)
+                         line << ' ' << oack_packet.get_option_str(i);
+                    break;
+               }
+
+               default:
+                    break;
+          }
+     });
+}
+
+/**
+ * @details Same format as for owning packets, read from the view.
+ */
+void Logger::packet(const PacketView &packet, const sockaddr_in &src,
+                    const std::optional<sockaddr_in> &dst) {
+     auto name = opcode_name(packet.get_opcode());
+     if (!Logger::enabled(LogLevel::Packet) || name.empty()) return;
+
+     sink().push([&](LogRecord &rec) {
+          LogLine line(rec, LogStream::Err);
+          line << name;
+          put_addrs(line, packet.get_opcode(), src, dst);
+
+          /* Type-specific */
+          if (const auto *ack = packet.get<AckView>()) {
+               line << ' ' << ack->block_n;
+          } else if (const auto *data = packet.get<DataView>()) {
+               line << ' ' << data->block_n;
+          } else if (const auto *err = packet.get<ErrorView>()) {
+               line << ' ' << static_cast<uint16_t>(err->errcode);
+               if (!err->message.empty())
+                    line << " \"" << err->message << '"';
+          } else if (const auto *oack = packet.get<OackView>()) {
+               oack->for_each_option(
+                   [&line](std::string_view name, std::string_view value) {
+                        line << ' ' << name << '=' << value;
+                   });
+          }
+     });
+}
@@ -0,0 +1,204 @@
+/**
+ * @file metrics.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Transfer and server metrics (counters and histograms)
+ * @date 2023-11-18
+ */
+
+#include "util/metrics.hpp"
+
+#include <bit>
+#include <sstream>
+
+/* === Histogram === */
+
+/**
+ * @details The bucket is the smallest `i` with `value <= 4^i`, that is
+ *          half of the bit width of `value - 1`, rounded up.
+ */
+void Histogram::observe(uint64_t value) {
+     size_t i = (value <= 1) ? 0 : (std::bit_width(value - 1) + 1) / 2;
+     this->buckets[std::min(i, N_BUCKETS - 1)].add();
+     this->count.add();
+     this->sum.add(value);
+}
+
+void Histogram::merge(const Histogram &other) {
+     for (size_t i = 0; i < N_BUCKETS; i++)
+          this->buckets[i].add(other.buckets[i].get());
+     this->count.add(other.count.get());
+     this->sum.add(other.sum.get());
+}
+
+/* === ServerMetrics === */
+
+void ServerMetrics::add_conn(const ConnStats &stats, bool errored) {
+     (errored ? this->conn_errored : this->conn_completed).add();
+
+     this->bytes_tx.add(stats.bytes_tx);
+     this->bytes_rx.add(stats.bytes_rx);
+     this->blocks_tx.add(stats.blocks_tx);
+     this->blocks_rx.add(stats.blocks_rx);
+     this->retransmits.add(stats.retransmits);
+     this->timeouts.add(stats.timeouts);
+     this->blksize_clamps.add(stats.blksize_clamps);
+     this->pmtu_fallbacks.add(stats.pmtu_fallbacks);
+     if (stats.err_sent.has_value()) this->errors_sent[*stats.err_sent].add();
+     if (stats.err_recv.has_value()) this->errors_recv[*stats.err_recv].add();
+
+     auto duration = std::chrono::steady_clock::now() - stats.start;
+     this->transfer_us.observe(
+         std::chrono::duration_cast<std::chrono::microseconds>(duration)
+             .count());
+}
+
+void ServerMetrics::merge(const ServerMetrics &other) {
+     this->rrq.add(other.rrq.get());
+     this->wrq.add(other.wrq.get());
+     this->req_duplicate.add(other.req_duplicate.get());
+     this->req_rejected.add(other.req_rejected.get());
+     this->req_queued.add(other.req_queued.get());
+     this->req_expired.add(other.req_expired.get());
+     this->conn_opened.add(other.conn_opened.get());
+     this->conn_completed.add(other.conn_completed.get());
+     this->conn_errored.add(other.conn_errored.get());
+
+     this->bytes_tx.add(other.bytes_tx.get());
+     this->bytes_rx.add(other.bytes_rx.get());
+     this->blocks_tx.add(other.blocks_tx.get());
+     this->blocks_rx.add(other.blocks_rx.get());
+     this->retransmits.add(other.retransmits.get());
+     this->timeouts.add(other.timeouts.get());
+     this->blksize_clamps.add(other.blksize_clamps.get());
+     this->pmtu_fallbacks.add(other.pmtu_fallbacks.get());
+     for (size_t i = 0; i < TFTP_N_ERRCODES; i++) {
+          this->errors_sent[i].add(other.errors_sent[i].get());
+          this->errors_recv[i].add(other.errors_recv[i].get());
+     }
+
+     this->rtt_us.merge(other.rtt_us);
+     this->transfer_us.merge(other.transfer_us);
+     this->loop_us.merge(other.loop_us);
+     this->setup_us.merge(other.setup_us);
+}
+
+/**
+ * @brief Writes a Prometheus histogram (microseconds => seconds)
+ */
+static void put_histogram(std::ostringstream &out, const std::string &name,
+                          const std::string &help, const Histogram &hist) {
+     out << "# HELP " << name << " " << help << "\n"
+         << "# TYPE " << name << " histogram\n";
+
+     uint64_t cumulative = 0;
+     for (size_t i = 0; i < Histogram::N_BUCKETS - 1; i++) {
+          cumulative += hist.get_bucket(i);
+          out << name << "_bucket{le=\"" << Histogram::bound(i) / 1e6
+              << "\"} " << cumulative << "\n";
+     }
+     cumulative += hist.get_bucket(Histogram::N_BUCKETS - 1);
+     out << name << "_bucket{le=\"+Inf\"} " << cumulative << "\n"
+         << name << "_sum " << hist.get_sum() / 1e6 << "\n"
+         << name << "_count " << hist.get_count() << "\n";
+}
+
+/**
+ * @brief Writes a Prometheus metric header
+ */
+static void put_header(std::ostringstream &out, const std::string &name,
+                       const std::string &type, const std::string &help) {
+     out << "# HELP " << name << " " << help << "\n"
+         << "# TYPE " << name << " " << type << "\n";
+}
+
+/**
+ * @details Follows the Prometheus text exposition format (version
+ *          0.0.4); rates (ex. requests per second) are left to the
+ *          scraper, as usual for counters.
+ * @see https://prometheus.io/docs/instrumenting/exposition_formats/
+ */
+std::string ServerMetrics::to_prometheus() const {
+     std::ostringstream out;
+
+     uint64_t finished = this->conn_completed.get() + this->conn_errored.get();
+     put_header(out, "tftp_connections_active", "gauge",
+                "Currently open connections");
+     out << "tftp_connections_active " << this->conn_opened.get() - finished
+         << "\n";
+
+     put_header(out, "tftp_connections_total", "counter",
+                "Finished connections by result");
+     out << "tftp_connections_total{result=\"completed\"} "
+         << this->conn_completed.get() << "\n"
+         << "tftp_connections_total{result=\"errored\"} "
+         << this->conn_errored.get() << "\n";
+
+     put_header(out, "tftp_requests_total", "counter",
+                "Received requests by type");
+     out << "tftp_requests_total{type=\"rrq\"} " << this->rrq.get() << "\n"
+         << "tftp_requests_total{type=\"wrq\"} " << this->wrq.get() << "\n";
+
+     put_header(out, "tftp_requests_dropped_total", "counter",
+                "Requests not served by reason");
+     out << "tftp_requests_dropped_total{reason=\"duplicate\"} "
+         << this->req_duplicate.get() << "\n"
+         << "tftp_requests_dropped_total{reason=\"rejected\"} "
+         << this->req_rejected.get() << "\n"
+         << "tftp_requests_dropped_total{reason=\"expired\"} "
+         << this->req_expired.get() << "\n";
+
+     put_header(out, "tftp_requests_queued_total", "counter",
+                "Requests queued for admission");
+     out << "tftp_requests_queued_total " << this->req_queued.get() << "\n";
+
+     put_header(out, "tftp_data_bytes_total", "counter",
+                "DATA payload bytes of finished connections");
+     out << "tftp_data_bytes_total{direction=\"sent\"} "
+         << this->bytes_tx.get() << "\n"
+         << "tftp_data_bytes_total{direction=\"received\"} "
+         << this->bytes_rx.get() << "\n";
+
+     put_header(out, "tftp_data_blocks_total", "counter",
+                "DATA blocks of finished connections");
+     out << "tftp_data_blocks_total{direction=\"sent\"} "
+         << this->blocks_tx.get() << "\n"
+         << "tftp_data_blocks_total{direction=\"received\"} "
+         << this->blocks_rx.get() << "\n";
+
+     put_header(out, "tftp_retransmits_total", "counter",
+                "Retransmitted packets");
+     out << "tftp_retransmits_total " << this->retransmits.get() << "\n";
+
+     put_header(out, "tftp_timeouts_total", "counter",
+                "Retransmission timeouts");
+     out << "tftp_timeouts_total " << this->timeouts.get() << "\n";
+
+     put_header(out, "tftp_blksize_clamps_total", "counter",
+                "blksize options lowered to fit the path MTU");
+     out << "tftp_blksize_clamps_total " << this->blksize_clamps.get() << "\n";
+
+     put_header(out, "tftp_pmtu_fallbacks_total", "counter",
+                "Transfers fragmenting DATA after a path MTU drop");
+     out << "tftp_pmtu_fallbacks_total " << this->pmtu_fallbacks.get() << "\n";
+
+     put_header(out, "tftp_errors_total", "counter",
+                "ERROR packets ending a transfer by direction and code");
+     for (size_t i = 0; i < TFTP_N_ERRCODES; i++)
+          out << "tftp_errors_total{direction=\"sent\",code=\"" << i << "\"} "
+              << this->errors_sent[i].get() << "\n";
+     for (size_t i = 0; i < TFTP_N_ERRCODES; i++)
+          out << "tftp_errors_total{direction=\"received\",code=\"" << i
+              << "\"} " << this->errors_recv[i].get() << "\n";
+
+     put_histogram(out, "tftp_rtt_seconds", "Round-trip time samples",
+                   this->rtt_us);
+     put_histogram(out, "tftp_transfer_duration_seconds",
+                   "Durations of finished connections", this->transfer_us);
+     put_histogram(out, "tftp_loop_iteration_seconds",
+                   "Event loop iteration handling times", this->loop_us);
+     put_histogram(out, "tftp_connection_setup_seconds",
+                   "Connection setup times (socket and buffers)",
+                   this->setup_us);
+
+     return out.str();
+}
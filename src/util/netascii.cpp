@@ -0,0 +1,326 @@
+/**
+ * @file netascii.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief NetASCII scanning kernels and chunked conversion
+ * @date 2023-11-19
+ */
+
+#include "util/netascii.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#     include <immintrin.h>
+#     define TFTP_NA_X86
+#elif defined(__ARM_NEON)
+#     include <arm_neon.h>
+#     define TFTP_NA_NEON
+#endif
+
+/* === Scanning kernels === */
+
+namespace {
+
+using ScanFn = size_t (*)(const char*, size_t, char, char);
+
+size_t scan_scalar(const char* data, size_t len, char a, char b) {
+     for (size_t i = 0; i < len; i++)
+          if (data[i] == a || data[i] == b) return i;
+     return len;
+}
+
+#ifdef TFTP_NA_X86
+size_t scan_sse2(const char* data, size_t len, char a, char b) {
+     const __m128i va = _mm_set1_epi8(a);
+     const __m128i vb = _mm_set1_epi8(b);
+
+     size_t i = 0;
+     for (; i + 16 <= len; i += 16) {
+          __m128i v
+              = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+          int mask = _mm_movemask_epi8(
+              _mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)));
+          if (mask) return i + __builtin_ctz(mask);
+     }
+
+     return i + scan_scalar(data + i, len - i, a, b);
+}
+
+__attribute__((target("avx2"))) size_t scan_avx2(const char* data,
+                                                  size_t len, char a,
+                                                  char b) {
+     const __m256i va = _mm256_set1_epi8(a);
+     const __m256i vb = _mm256_set1_epi8(b);
+
+     size_t i = 0;
+     for (; i + 32 <= len; i += 32) {
+          __m256i v = _mm256_loadu_si256(
+              reinterpret_cast<const __m256i*>(data + i));
+          auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+              _mm256_or_si256(_mm256_cmpeq_epi8(v, va),
+                              _mm256_cmpeq_epi8(v, vb))));
+          if (mask) return i + __builtin_ctz(mask);
+     }
+
+     return i + scan_sse2(data + i, len - i, a, b);
+}
+#endif
+
+#ifdef TFTP_NA_NEON
+/**
+ * @details NEON has no movemask – the comparison is narrowed to 4 bits
+ *          per byte, so the first match is the trailing zero count / 4.
+ */
+size_t scan_neon(const char* data, size_t len, char a, char b) {
+     const uint8x16_t va = vdupq_n_u8(static_cast<uint8_t>(a));
+     const uint8x16_t vb = vdupq_n_u8(static_cast<uint8_t>(b));
+
+     size_t i = 0;
+     for (; i + 16 <= len; i += 16) {
+          uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(data + i));
+          uint8x16_t eq = vorrq_u8(vceqq_u8(v, va), vceqq_u8(v, vb));
+          uint64_t mask = vget_lane_u64(
+              vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)),
+              0);
+          if (mask) return i + (__builtin_ctzll(mask) >> 2);
+     }
+
+     return i + scan_scalar(data + i, len - i, a, b);
+}
+#endif
+
+/**
+ * @brief Checks whether the CPU supports a kernel
+ */
+bool supported(NetASCII::Kernel kernel) {
+     switch (kernel) {
+          case NetASCII::Kernel::Scalar:
+               return true;
+#ifdef TFTP_NA_X86
+          case NetASCII::Kernel::SSE2:
+               return __builtin_cpu_supports("sse2");
+          case NetASCII::Kernel::AVX2:
+               return __builtin_cpu_supports("avx2");
+#endif
+#ifdef TFTP_NA_NEON
+          case NetASCII::Kernel::NEON:
+               return true;
+#endif
+          default:
+               return false;
+     }
+}
+
+ScanFn kernel_fn(NetASCII::Kernel kernel) {
+     switch (kernel) {
+#ifdef TFTP_NA_X86
+          case NetASCII::Kernel::SSE2:
+               return scan_sse2;
+          case NetASCII::Kernel::AVX2:
+               return scan_avx2;
+#endif
+#ifdef TFTP_NA_NEON
+          case NetASCII::Kernel::NEON:
+               return scan_neon;
+#endif
+          default:
+               return scan_scalar;
+     }
+}
+
+/**
+ * @brief Picks the widest supported kernel
+ */
+NetASCII::Kernel best_kernel() {
+     for (auto kernel : {NetASCII::Kernel::AVX2, NetASCII::Kernel::SSE2,
+                         NetASCII::Kernel::NEON})
+          if (supported(kernel)) return kernel;
+     return NetASCII::Kernel::Scalar;
+}
+
+/**
+ * @brief Active kernel (picked on first use)
+ */
+struct Active {
+     NetASCII::Kernel kernel = best_kernel();
+     ScanFn fn = kernel_fn(kernel);
+};
+
+Active& active() {
+     static Active act;
+     return act;
+}
+
+}  // namespace
+
+NetASCII::Kernel NetASCII::get_kernel() { return active().kernel; }
+
+bool NetASCII::set_kernel(Kernel kernel) {
+     if (!supported(kernel)) return false;
+     active().kernel = kernel;
+     active().fn = kernel_fn(kernel);
+     return true;
+}
+
+size_t NetASCII::scan(const char* data, size_t len, char a, char b) {
+     return active().fn(data, len, a, b);
+}
+
+/* === Chunked conversion === */
+
+/**
+ * @details The held-back CR is resolved by the first byte of the chunk,
+ *          then clean runs up to the next CR or LF are copied in bulk
+ *          and only the line endings themselves are handled bytewise.
+ */
+size_t NetASCII::encode(std::span<const char> in, std::span<char> out,
+                        State& state) {
+     if (out.size() < max_encoded(in.size()))
+          throw std::length_error("NetASCII output buffer too small");
+     if (in.empty()) return 0;
+
+     const char* src = in.data();
+     const size_t len = in.size();
+     char* dst = out.data();
+     size_t i = 0, o = 0;
+
+     /* CR held back from the last chunk */
+     if (state.cr) {
+          state.cr = false;
+          dst[o++] = '\r';
+          if (src[0] == '\n') {
+               dst[o++] = '\n';  // CR LF -> CR LF
+               i++;
+          } else {
+               dst[o++] = '\0';  // CR -> CR NUL
+          }
+     }
+
+     while (i < len) {
+          /* Clean run */
+          size_t run = scan(src + i, len - i, '\r', '\n');
+          memcpy(dst + o, src + i, run);
+          i += run;
+          o += run;
+          if (i == len) break;
+
+          /* Line ending */
+          dst[o++] = '\r';
+          if (src[i] == '\n') {
+               dst[o++] = '\n';  // LF -> CR LF
+               i++;
+          } else if (i + 1 == len) {
+               o--;  // CR at the chunk end => hold it back
+               state.cr = true;
+               i++;
+          } else if (src[i + 1] == '\n') {
+               dst[o++] = '\n';  // CR LF -> CR LF
+               i += 2;
+          } else {
+               dst[o++] = '\0';  // CR -> CR NUL
+               i++;
+          }
+     }
+
+     return o;
+}
+
+size_t NetASCII::encode_end(std::span<char> out, State& state) {
+     if (!state.cr) return 0;
+     if (out.size() < 2)
+          throw std::length_error("NetASCII output buffer too small");
+
+     state.cr = false;
+     out[0] = '\r';
+     out[1] = '\0';
+     return 2;
+}
+
+size_t NetASCII::decode(std::span<const char> in, std::span<char> out,
+                        State& state) {
+     if (out.size() < max_decoded(in.size()))
+          throw std::length_error("NetASCII output buffer too small");
+     if (in.empty()) return 0;
+
+     const char* src = in.data();
+     const size_t len = in.size();
+     char* dst = out.data();
+     size_t i = 0, o = 0;
+
+     /* CR held back from the last chunk */
+     if (state.cr) {
+          state.cr = false;
+          if (src[0] == '\n') {
+               dst[o++] = '\n';  // CR LF -> LF
+               i++;
+          } else if (src[0] == '\0') {
+               dst[o++] = '\r';  // CR NUL -> CR
+               i++;
+          } else {
+               dst[o++] = '\r';  // Lone CR
+          }
+     }
+
+     while (i < len) {
+          /* Clean run */
+          size_t run = scan(src + i, len - i, '\r', '\r');
+          memcpy(dst + o, src + i, run);
+          i += run;
+          o += run;
+          if (i == len) break;
+
+          /* CR sequence */
+          if (i + 1 == len) {
+               state.cr = true;  // CR at the chunk end => hold it back
+               i++;
+          } else if (src[i + 1] == '\n') {
+               dst[o++] = '\n';  // CR LF -> LF
+               i += 2;
+          } else if (src[i + 1] == '\0') {
+               dst[o++] = '\r';  // CR NUL -> CR
+               i += 2;
+          } else {
+               dst[o++] = '\r';  // Lone CR
+               i++;
+          }
+     }
+
+     return o;
+}
+
+size_t NetASCII::decode_end(std::span<char> out, State& state) {
+     if (!state.cr) return 0;
+     if (out.empty())
+          throw std::length_error("NetASCII output buffer too small");
+
+     state.cr = false;
+     out[0] = '\r';
+     return 1;
+}
+
+/**
+ * @details The output never overtakes the input (every CR sequence
+ *          shrinks or keeps its size), so runs are moved down in place.
+ */
+size_t NetASCII::na_decode(char* data, size_t len) {
+     size_t i = 0, o = 0;
+
+     while (i < len) {
+          /* Clean run */
+          size_t run = scan(data + i, len - i, '\r', '\r');
+          if (o != i) memmove(data + o, data + i, run);
+          i += run;
+          o += run;
+          if (i == len) break;
+
+          /* CR sequence */
+          if (i + 1 < len && (data[i + 1] == '\n' || data[i + 1] == '\0')) {
+               // CR LF -> LF, CR NUL -> CR
+               data[o++] = (data[i + 1] == '\n') ? '\n' : '\r';
+               i += 2;
+          } else {
+               data[o++] = '\r';  // Lone CR
+               i++;
+          }
+     }
+
+     return o;
+}
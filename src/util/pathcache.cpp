@@ -0,0 +1,217 @@
+/**
+ * @file pathcache.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Shared cache of resolved request paths (open files)
+ * @date 2023-11-25
+ */
+
+#include "util/pathcache.hpp"
+
+#include <fcntl.h>
+#include <sys/inotify.h>
+
+#include <cerrno>
+#include <sstream>
+#include <stdexcept>
+
+/**
+ * @brief Directory changes that can change a cached path
+ */
+static const uint32_t WATCH_MASK = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE
+                                   | IN_CREATE | IN_DELETE | IN_MOVED_FROM
+                                   | IN_MOVED_TO | IN_DELETE_SELF
+                                   | IN_MOVE_SELF;
+
+/* === Constructors === */
+
+PathCache::PathCache(size_t max_entries)
+    : max_entries(std::max<size_t>(max_entries, 1)),
+      notify_fd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) {
+     if (this->notify_fd < 0)
+          throw std::runtime_error("Failed to set up inotify: "
+                                   + std::string(strerror(errno)));
+}
+
+PathCache::~PathCache() { close(this->notify_fd); }
+
+/* === Core methods === */
+
+/**
+ * @details A miss leaves a placeholder entry while the file is opened
+ *          without the lock. A change of the path in the meantime drops
+ *          the placeholder, and the result is then not cached (it could
+ *          be stale already). Failures other than a missing or
+ *          forbidden file (ex. out of descriptors) are never cached.
+ */
+PathCache::Lookup PathCache::open(const std::string& path) {
+     auto now = std::chrono::steady_clock::now();
+     uint64_t gen;
+     bool cacheable;
+     {
+          std::lock_guard<std::mutex> lock(this->mtx);
+          this->drain();
+
+          auto it = this->entries.find(path);
+          if (it != this->entries.end() && it->second.err != -1
+              && it->second.expires > now) {
+               this->stats.hits++;
+               return {it->second.file, it->second.err};
+          }
+          if (it != this->entries.end()) this->entries.erase(it);
+          this->stats.misses++;
+
+          gen = this->next_gen++;
+          cacheable = this->watch(dir_of(path));
+          if (cacheable) {
+               this->make_room();
+               this->entries.emplace(path, Entry{nullptr, -1, gen, {}});
+          }
+     }
+
+     Lookup res = open_file(path);
+     if (!cacheable) return res;
+     cacheable = res.file || res.err == ENOENT || res.err == ENOTDIR
+                 || res.err == EACCES;
+
+     std::lock_guard<std::mutex> lock(this->mtx);
+     this->drain();
+     auto it = this->entries.find(path);
+     if (it == this->entries.end() || it->second.gen != gen) return res;
+     if (!cacheable) {
+          this->entries.erase(it);
+          return res;
+     }
+     it->second = {res.file, res.err, gen,
+                   now + std::chrono::milliseconds(TFTP_PATH_CACHE_TTL_MS)};
+     return res;
+}
+
+PathCache::Stats PathCache::get_stats() const {
+     std::lock_guard<std::mutex> lock(this->mtx);
+     Stats st = this->stats;
+     st.entries = this->entries.size();
+     return st;
+}
+
+std::string PathCache::to_prometheus() const {
+     Stats st = this->get_stats();
+     std::ostringstream out;
+
+     out << "# HELP tftp_path_cache_lookups_total Path cache lookups by "
+            "result\n"
+         << "# TYPE tftp_path_cache_lookups_total counter\n"
+         << "tftp_path_cache_lookups_total{result=\"hit\"} " << st.hits
+         << "\n"
+         << "tftp_path_cache_lookups_total{result=\"miss\"} " << st.misses
+         << "\n"
+         << "# HELP tftp_path_cache_invalidations_total Paths dropped on "
+            "changes\n"
+         << "# TYPE tftp_path_cache_invalidations_total counter\n"
+         << "tftp_path_cache_invalidations_total " << st.invalidations
+         << "\n"
+         << "# HELP tftp_path_cache_entries Cached paths\n"
+         << "# TYPE tftp_path_cache_entries gauge\n"
+         << "tftp_path_cache_entries " << st.entries << "\n";
+
+     return out.str();
+}
+
+/* === Helper methods === */
+
+PathCache::Lookup PathCache::open_file(const std::string& path) {
+     int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+     if (fd < 0) return {nullptr, errno};
+
+     struct stat st;
+     if (fstat(fd, &st) != 0) {
+          int err = errno;
+          close(fd);
+          return {nullptr, err};
+     }
+     return {std::make_shared<const File>(fd, st), 0};
+}
+
+std::string PathCache::dir_of(const std::string& path) {
+     size_t slash = path.rfind('/');
+     return slash == std::string::npos ? "./" : path.substr(0, slash + 1);
+}
+
+/**
+ * @details One directory can be watched under several names (ex.
+ *          `root/` and `root//`): inotify returns the same watch for
+ *          them, so a watch keeps all of its names.
+ */
+bool PathCache::watch(const std::string& dir) {
+     if (this->dir_wds.contains(dir)) return true;
+
+     int wd = inotify_add_watch(this->notify_fd, dir.c_str(),
+                                WATCH_MASK | IN_ONLYDIR);
+     if (wd < 0) return false;
+
+     this->dir_wds.emplace(dir, wd);
+     this->wd_dirs[wd].push_back(dir);
+     return true;
+}
+
+/**
+ * @details Events name the changed entry of a watched directory, so
+ *          the path is rebuilt from the names of the directory. Changes
+ *          that can affect many paths at once (a subdirectory renamed
+ *          or removed, a directory gone, lost events) drop everything.
+ */
+void PathCache::drain() {
+     while (true) {
+          ssize_t len
+              = read(this->notify_fd, this->events.data(), this->events.size());
+          if (len <= 0) return;  // EAGAIN => nothing more
+
+          for (ssize_t off = 0; off < len;) {
+               const auto* ev = reinterpret_cast<const inotify_event*>(
+                   this->events.data() + off);
+               off += sizeof(inotify_event) + ev->len;
+
+               if (ev->mask & IN_IGNORED) {  // Watch gone (directory removed)
+                    auto it = this->wd_dirs.find(ev->wd);
+                    if (it != this->wd_dirs.end()) {
+                         for (const auto& dir : it->second)
+                              this->dir_wds.erase(dir);
+                         this->wd_dirs.erase(it);
+                    }
+                    this->clear();
+                    continue;
+               }
+               if (ev->mask & (IN_Q_OVERFLOW | IN_ISDIR | IN_DELETE_SELF
+                               | IN_MOVE_SELF | IN_UNMOUNT)) {
+                    this->clear();
+                    continue;
+               }
+
+               auto it = this->wd_dirs.find(ev->wd);
+               if (it == this->wd_dirs.end() || ev->len == 0) continue;
+               for (const auto& dir : it->second) {
+                    if (this->entries.erase(dir + ev->name) > 0)
+                         this->stats.invalidations++;
+               }
+          }
+     }
+}
+
+void PathCache::clear() {
+     this->stats.invalidations += this->entries.size();
+     this->entries.clear();
+}
+
+/**
+ * @details Expired entries go first; if there are none, an arbitrary
+ *          entry is dropped (hot paths are cached again right away).
+ */
+void PathCache::make_room() {
+     if (this->entries.size() < this->max_entries) return;
+
+     auto now = std::chrono::steady_clock::now();
+     std::erase_if(this->entries, [&](const auto& entry) {
+          return entry.second.err != -1 && entry.second.expires <= now;
+     });
+     if (this->entries.size() >= this->max_entries)
+          this->entries.erase(this->entries.begin());
+}
@@ -0,0 +1,81 @@
+/**
+ * @file peertable.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Flat hash table of remote peers (demultiplexing)
+ * @date 2023-11-23
+ */
+
+#include "util/peertable.hpp"
+
+/* === Core methods === */
+
+bool PeerTable::insert(const sockaddr_in& peer, int value) {
+     if (2 * (this->count + 1) > this->entries.size()) this->grow();
+
+     uint64_t key = pack(peer);
+     size_t mask = this->entries.size() - 1;
+     for (size_t i = this->home(key);; i = (i + 1) & mask) {
+          auto& entry = this->entries[i];
+          if (entry.key == key) return false;
+          if (entry.key != EMPTY) continue;
+
+          entry = {key, value};
+          this->count++;
+          return true;
+     }
+}
+
+int PeerTable::find(const sockaddr_in& peer) const {
+     uint64_t key = pack(peer);
+     size_t mask = this->entries.size() - 1;
+     for (size_t i = this->home(key);; i = (i + 1) & mask) {
+          const auto& entry = this->entries[i];
+          if (entry.key == key) return entry.value;
+          if (entry.key == EMPTY) return -1;
+     }
+}
+
+/**
+ * @details Backward-shift deletion: entries after the hole that would
+ *          not be found past it any more (their home is not within
+ *          the probe stretch from the hole to them) are moved into it,
+ *          until a free slot ends the run.
+ */
+void PeerTable::erase(const sockaddr_in& peer) {
+     uint64_t key = pack(peer);
+     size_t mask = this->entries.size() - 1;
+     size_t hole = this->home(key);
+     while (this->entries[hole].key != key) {
+          if (this->entries[hole].key == EMPTY) return;
+          hole = (hole + 1) & mask;
+     }
+
+     for (size_t i = (hole + 1) & mask; this->entries[i].key != EMPTY;
+          i = (i + 1) & mask) {
+          size_t dist_i = (i - this->home(this->entries[i].key)) & mask;
+          size_t dist_hole = (i - hole) & mask;
+          if (dist_i < dist_hole) continue;  // Home between hole and `i`
+
+          this->entries[hole] = this->entries[i];
+          hole = i;
+     }
+
+     this->entries[hole] = {};
+     this->count--;
+}
+
+/* === Helper methods === */
+
+void PeerTable::grow() {
+     std::vector<Entry> old(this->entries.size() * 2);
+     old.swap(this->entries);
+     this->bits++;
+
+     size_t mask = this->entries.size() - 1;
+     for (const auto& entry : old) {
+          if (entry.key == EMPTY) continue;
+          size_t i = this->home(entry.key);
+          while (this->entries[i].key != EMPTY) i = (i + 1) & mask;
+          this->entries[i] = entry;
+     }
+}
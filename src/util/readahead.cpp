@@ -0,0 +1,175 @@
+/**
+ * @file readahead.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Read-ahead buffer of an uploaded stream
+ * @date 2023-11-21
+ */
+
+#include "util/readahead.hpp"
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "common.hpp"
+
+/* === Constructors === */
+
+ReadAhead::ReadAhead(int fd, size_t block, size_t chunk, size_t depth,
+                     const std::atomic<bool>* cancel)
+    : fd(fd),
+      cancel(cancel),
+      block(block),
+      chunk_size(std::max<size_t>(chunk / block, 1) * block),
+      chunks(std::max<size_t>(depth, 2)) {
+     this->stop_fd = eventfd(0, EFD_CLOEXEC);
+     if (this->stop_fd < 0)
+          throw std::runtime_error("Failed to create eventfd");
+     for (auto& c : this->chunks) c.data.resize(this->chunk_size);
+     this->thread = std::thread([this]() { this->run(); });
+}
+
+ReadAhead::~ReadAhead() {
+     {
+          std::lock_guard<std::mutex> lock(this->mtx);
+          this->stop = true;
+     }
+     this->cv.notify_all();
+     uint64_t one = 1;
+     (void)!write(this->stop_fd, &one, sizeof(one));
+     this->thread.join();
+     close(this->stop_fd);
+}
+
+/* === Core methods === */
+
+/**
+ * @details Blocks of a chunk already read are handed out without taking
+ *          the lock, so waiting (and locking) happens once per chunk.
+ *          The `cancel` flag is checked every `TFTP_READ_POLL_MS` of waiting
+ *          (it is set from a signal handler, which cannot notify).
+ */
+std::span<const char> ReadAhead::next() {
+     const auto interval = std::chrono::milliseconds(TFTP_READ_POLL_MS);
+     while (true) {
+          if (this->cur >= this->filled.load(std::memory_order_acquire)) {
+               std::unique_lock<std::mutex> lock(this->mtx);
+               while (!this->cv.wait_for(lock, interval, [this]() {
+                    return this->cur < this->filled.load() || this->err
+                           || this->eof;
+               })) {
+                    if (this->cancel && this->cancel->load())
+                         throw std::runtime_error("Upload interrupted");
+               }
+               if (this->cur >= this->filled.load()) {
+                    if (this->err)
+                         throw std::runtime_error(
+                             "Could not read upload source: "
+                             + std::string(strerror(this->err)));
+                    return {};  // End of the stream on a chunk boundary
+               }
+          }
+
+          const Chunk& chunk = this->chunks[this->cur % this->chunks.size()];
+          if (this->cur_off < chunk.len) {
+               size_t len = std::min(this->block, chunk.len - this->cur_off);
+               std::span<const char> part(chunk.data.data() + this->cur_off,
+                                          len);
+               this->cur_off += len;
+               return part;
+          }
+
+          /* Short chunk => end of the stream */
+          if (chunk.len < this->chunk_size) return {};
+          this->cur++;
+          this->cur_off = 0;
+     }
+}
+
+void ReadAhead::release(size_t len) {
+     this->released += len;
+
+     size_t n_freed = this->freed.load(std::memory_order_relaxed);
+     size_t done = std::min(this->released / this->chunk_size, this->cur);
+     if (done <= n_freed) return;
+
+     {
+          std::lock_guard<std::mutex> lock(this->mtx);
+          this->freed.store(done);
+     }
+     this->cv.notify_all();
+}
+
+/* === Helper methods === */
+
+/**
+ * @details A chunk is read only into a free ring slot – the reader
+ *          waits for `release` otherwise. The stream ends with a short
+ *          (possibly empty) chunk.
+ */
+void ReadAhead::run() {
+     while (true) {
+          {
+               std::unique_lock<std::mutex> lock(this->mtx);
+               this->cv.wait(lock, [this]() {
+                    return this->stop
+                           || this->filled.load() - this->freed.load()
+                                  < this->chunks.size();
+               });
+               if (this->stop) return;
+          }
+
+          Chunk& chunk
+              = this->chunks[this->filled.load() % this->chunks.size()];
+          bool ok = this->fill(chunk);
+
+          {
+               std::lock_guard<std::mutex> lock(this->mtx);
+               if (ok) {
+                    this->filled.fetch_add(1, std::memory_order_release);
+                    this->eof = chunk.len < this->chunk_size;
+               }
+          }
+          this->cv.notify_all();
+          if (!ok || this->eof) return;
+     }
+}
+
+/**
+ * @details Waits for the source together with `stop_fd`, so a reader
+ *          blocked on an idle pipe (or terminal) can still be stopped.
+ */
+bool ReadAhead::fill(Chunk& chunk) {
+     chunk.len = 0;
+     while (chunk.len < this->chunk_size) {
+          struct pollfd fds[2] = {{this->fd, POLLIN, 0},
+                                  {this->stop_fd, POLLIN, 0}};
+          if (poll(fds, 2, -1) < 0) {
+               if (errno == EINTR) continue;
+               std::lock_guard<std::mutex> lock(this->mtx);
+               this->err = errno;
+               return false;
+          }
+          if (fds[1].revents) return false;  // Stopped
+
+          ssize_t bytes_rx = read(this->fd, chunk.data.data() + chunk.len,
+                                  this->chunk_size - chunk.len);
+          if (bytes_rx < 0) {
+               if (errno == EINTR || errno == EAGAIN) continue;
+               std::lock_guard<std::mutex> lock(this->mtx);
+               this->err = errno;
+               return false;
+          }
+          if (bytes_rx == 0) break;  // End of the stream
+          chunk.len += bytes_rx;
+     }
+     return true;
+}
@@ -0,0 +1,56 @@
+/**
+ * @file rttestimator.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Round-trip time estimator for the retransmission timer
+ * @date 2023-11-18
+ */
+
+#include "util/rttestimator.hpp"
+
+/* === Core methods === */
+
+/**
+ * @details First sample initialises SRTT to the sample and RTTVAR to
+ *          its half, further samples are blended in with the RFC 6298
+ *          gains (1/8 for SRTT, 1/4 for RTTVAR). RTO is then
+ *          `SRTT + max(G, 4 * RTTVAR)`, with a 1 ms clock granularity
+ *          `G`. A sample also discards any backoff.
+ */
+void RttEstimator::sample(Duration rtt) {
+     if (this->fixed) return;
+     if (rtt < Duration::zero()) rtt = Duration::zero();
+
+     if (!this->has_sample) {
+          this->srtt = rtt;
+          this->rttvar = rtt / 2;
+          this->has_sample = true;
+     } else {
+          Duration err = this->srtt > rtt ? this->srtt - rtt : rtt - this->srtt;
+          this->rttvar = (3 * this->rttvar + err) / 4;
+          this->srtt = (7 * this->srtt + rtt) / 8;
+     }
+
+     this->rto = this->srtt
+                 + std::max<Duration>(std::chrono::milliseconds(1),
+                                      4 * this->rttvar);
+     this->clamp();
+}
+
+void RttEstimator::backoff() {
+     if (this->fixed) return;
+     this->rto *= 2;
+     this->clamp();
+}
+
+void RttEstimator::set_fixed(Duration rto) {
+     this->rto = rto;
+     this->fixed = true;
+}
+
+/* === Helper methods === */
+
+void RttEstimator::clamp() {
+     this->rto = std::clamp<Duration>(this->rto,
+                                      std::chrono::milliseconds(TFTP_MIN_RTO_MS),
+                                      std::chrono::milliseconds(TFTP_MAX_RTO_MS));
+}
@@ -0,0 +1,149 @@
+/**
+ * @file socketpool.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Pool of pre-bound connection sockets
+ * @date 2023-11-22
+ */
+
+#include "util/socketpool.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+/* === Constructors === */
+
+SocketPool::~SocketPool() {
+     while (this->count > 0) close(this->acquire().fd);
+}
+
+/* === Core methods === */
+
+void SocketPool::fill() {
+     while (this->count < this->idle.size()) this->push(open_socket());
+}
+
+SocketPool::Socket SocketPool::acquire() {
+     if (this->count == 0) return open_socket();
+
+     Socket sock = this->idle[this->head];
+     this->head = (this->head + 1) % this->idle.size();
+     this->count--;
+     return sock;
+}
+
+/**
+ * @details Datagrams are dropped in `recvmmsg` batches with truncation
+ *          into a tiny buffer – only their count matters. Reading
+ *          `SO_ERROR` clears a pending error (ex. ICMP port unreachable
+ *          from the last peer).
+ * @details Options a connection may have set are put back to those of
+ *          a new socket: `UDP_GRO` and the receive buffer size (see
+ *          `TFTPConnectionBase::gro_init`) and `IP_MTU_DISCOVER`
+ *          (server `-M` policy, PMTU fallback).
+ */
+void SocketPool::release(Socket sock) {
+     if (sock.fd < 0) return;
+     if (this->count >= this->idle.size()) {
+          close(sock.fd);
+          return;
+     }
+
+     char sink[1];
+     std::array<struct iovec, 16> iovs{};
+     std::array<struct mmsghdr, 16> msgs{};
+     for (size_t i = 0; i < msgs.size(); i++) {
+          iovs[i] = {sink, sizeof(sink)};
+          msgs[i].msg_hdr.msg_iov = &iovs[i];
+          msgs[i].msg_hdr.msg_iovlen = 1;
+     }
+     while (recvmmsg(sock.fd, msgs.data(), msgs.size(), MSG_DONTWAIT,
+                     nullptr)
+            == static_cast<int>(msgs.size())) {}
+
+     int err = 0;
+     socklen_t err_len = sizeof(err);
+     getsockopt(sock.fd, SOL_SOCKET, SO_ERROR, &err, &err_len);
+
+     const Defaults& dflt = defaults();
+     int gro = 0, rcvbuf = 0;
+     socklen_t rcvbuf_len = sizeof(rcvbuf);
+     setsockopt(sock.fd, IPPROTO_UDP, UDP_GRO, &gro, sizeof(gro));
+     setsockopt(sock.fd, IPPROTO_IP, IP_MTU_DISCOVER, &dflt.pmtudisc,
+                sizeof(dflt.pmtudisc));
+     if (getsockopt(sock.fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, &rcvbuf_len) == 0
+         && rcvbuf != 2 * dflt.rcvbuf)
+          setsockopt(sock.fd, SOL_SOCKET, SO_RCVBUF, &dflt.rcvbuf,
+                     sizeof(dflt.rcvbuf));
+
+     this->push(sock);
+}
+
+/* === Helper methods === */
+
+/**
+ * @details Read once from a new socket (they follow the
+ *          `net.ipv4.ip_no_pmtu_disc` and `net.core.rmem_default`
+ *          sysctls). Linux doubles a `SO_RCVBUF` set (for its own
+ *          overhead) and reports the doubled size, hence the half.
+ */
+const SocketPool::Defaults& SocketPool::defaults() {
+     static const Defaults dflt = [] {
+          Defaults res;
+          int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+          if (fd == -1) return res;
+          socklen_t len = sizeof(res.pmtudisc);
+          getsockopt(fd, IPPROTO_IP, IP_MTU_DISCOVER, &res.pmtudisc, &len);
+          len = sizeof(res.rcvbuf);
+          if (getsockopt(fd, SOL_SOCKET, SO_RCVBUF, &res.rcvbuf, &len) == 0)
+               res.rcvbuf /= 2;
+          close(fd);
+          return res;
+     }();
+     return dflt;
+}
+
+void SocketPool::push(Socket sock) {
+     this->idle[(this->head + this->count) % this->idle.size()] = sock;
+     this->count++;
+}
+
+/**
+ * @details One `socket` call (non-blocking, close-on-exec), `bind` to
+ *          port 0 and `getsockname` for the port the kernel picked.
+ *          Sockets of event-driven connections need no timeouts, and
+ *          ephemeral ports need no address reuse.
+ */
+SocketPool::Socket SocketPool::open_socket() {
+     Socket sock;
+     sock.fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+     if (sock.fd == -1) throw std::runtime_error("Failed to create socket");
+
+     struct sockaddr_in addr {};
+     addr.sin_family = AF_INET;
+     addr.sin_port = htons(0);  // => random port
+     addr.sin_addr.s_addr = htonl(INADDR_ANY);
+     socklen_t addr_len = sizeof(addr);
+
+     if (bind(sock.fd, reinterpret_cast<struct sockaddr*>(&addr), addr_len)
+             < 0
+         || getsockname(sock.fd, reinterpret_cast<struct sockaddr*>(&addr),
+                        &addr_len)
+                < 0) {
+          int err = errno;
+          close(sock.fd);
+          throw std::runtime_error("Failed to bind socket : "
+                                   + std::string(strerror(err)));
+     }
+
+     sock.port = ntohs(addr.sin_port);
+     return sock;
+}
@@ -0,0 +1,87 @@
+/**
+ * @file timerqueue.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Deadline timer queue (min-heap) for event loops
+ * @date 2023-11-18
+ */
+
+#include "util/timerqueue.hpp"
+
+/* === Core methods === */
+
+/**
+ * @details Re-arming with an unchanged deadline is a no-op, so that
+ *          an owner syncing its timer after every event does not
+ *          flood the heap with stale entries.
+ */
+void TimerQueue::arm(int fd, void* data, TimePoint deadline) {
+     if (static_cast<size_t>(fd) >= this->slots.size())
+          this->slots.resize(fd + 1);
+
+     auto& slot = this->slots[fd];
+     slot.data = data;
+     if (slot.armed && slot.deadline == deadline) return;
+
+     if (!slot.armed) this->n_armed++;
+     slot.armed = true;
+     slot.deadline = deadline;
+     this->heap.push({deadline, fd, ++slot.gen});
+}
+
+void TimerQueue::cancel(int fd) {
+     if (!this->is_armed(fd)) return;
+
+     auto& slot = this->slots[fd];
+     slot.armed = false;
+     slot.data = nullptr;
+     slot.gen++;  // Invalidate the heap entry
+     this->n_armed--;
+}
+
+void TimerQueue::expire(TimePoint now, std::vector<Expired>& out) {
+     while (!this->heap.empty()) {
+          const Entry top = this->heap.top();
+          if (!this->is_live(top)) {
+               this->heap.pop();
+               continue;
+          }
+
+          if (top.deadline > now) return;
+          this->heap.pop();
+
+          auto& slot = this->slots[top.fd];
+          out.push_back({top.fd, slot.data});
+          slot.armed = false;
+          slot.data = nullptr;
+          this->n_armed--;
+     }
+}
+
+std::optional<TimerQueue::TimePoint> TimerQueue::next_deadline() {
+     this->drop_stale();
+     if (this->heap.empty()) return std::nullopt;
+     return this->heap.top().deadline;
+}
+
+/**
+ * @details The timeout is rounded up to whole milliseconds so that
+ *          the wait never ends before the deadline (which would make
+ *          the loop spin until it is reached).
+ */
+int TimerQueue::timeout_ms(TimePoint now, int max_ms) {
+     auto deadline = this->next_deadline();
+     if (!deadline.has_value()) return max_ms;
+     if (*deadline <= now) return 0;
+
+     auto left = std::chrono::ceil<std::chrono::milliseconds>(*deadline - now)
+                     .count();
+     if (max_ms >= 0 && left > max_ms) return max_ms;
+     return static_cast<int>(left);
+}
+
+/* === Helper methods === */
+
+void TimerQueue::drop_stale() {
+     while (!this->heap.empty() && !this->is_live(this->heap.top()))
+          this->heap.pop();
+}
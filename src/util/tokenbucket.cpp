@@ -0,0 +1,56 @@
+/**
+ * @file tokenbucket.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Token bucket (byte rate limiter) for pacing transfers
+ * @date 2023-11-25
+ */
+
+#include "util/tokenbucket.hpp"
+
+#include <algorithm>
+#include <limits>
+
+/* === Core methods === */
+
+/**
+ * @details A new (or unlimited so far) bucket starts full, so the first
+ *          burst goes out right away.
+ */
+void TokenBucket::set_rate(double rate, double burst) {
+     if (!this->is_limited()) this->tokens = burst;
+     this->rate = std::max(rate, 0.0);
+     this->burst = std::max(burst, 0.0);
+     this->tokens = std::min(this->tokens, this->burst);
+}
+
+/**
+ * @details The first refill only sets the time the bucket is filled
+ *          from (it is full by then).
+ */
+double TokenBucket::available(TimePoint now) {
+     if (!this->is_limited())
+          return std::numeric_limits<double>::infinity();
+
+     if (this->primed && now > this->last) {
+          double elapsed = std::chrono::duration<double>(now - this->last)
+                               .count();
+          this->tokens
+              = std::min(this->tokens + elapsed * this->rate, this->burst);
+     }
+     if (!this->primed || now > this->last) this->last = now;
+     this->primed = true;
+     return this->tokens;
+}
+
+void TokenBucket::consume(double bytes) {
+     if (this->is_limited()) this->tokens -= bytes;
+}
+
+TokenBucket::TimePoint TokenBucket::ready_at(double bytes) const {
+     double missing = std::min(bytes, this->burst) - this->tokens;
+     if (!this->is_limited() || missing <= 0) return this->last;
+
+     return this->last
+            + std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(missing / this->rate));
+}
@@ -0,0 +1,124 @@
+/**
+ * @file trace.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Low-overhead tracing of connections (Chrome trace events)
+ * @date 2023-11-25
+ */
+
+#include "util/trace.hpp"
+
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+
+/**
+ * @brief Recorded span
+ */
+struct TraceEvent {
+     const char* cat;  /**< Category */
+     const char* name; /**< Name */
+     int id;           /**< Connection (TID) */
+     int64_t bytes;    /**< Bytes handled, -1 if not applicable */
+     int64_t ts;       /**< Start (ns since `EPOCH`) */
+     int64_t dur;      /**< Duration (ns) */
+};
+
+/**
+ * @brief Ring of the spans of one thread
+ */
+struct TraceRing {
+     std::vector<TraceEvent> events; /**< Spans, oldest overwritten */
+     uint64_t count = 0;             /**< Spans recorded so far */
+     size_t thread;                  /**< Index of the thread */
+};
+
+/** @brief Origin of the timestamps (process start) */
+static const Trace::Clock::time_point EPOCH = Trace::Clock::now();
+
+/** @brief Rings of all threads (kept after the threads exit) */
+static std::vector<std::shared_ptr<TraceRing>> rings;
+
+/** @brief Lock of `rings` (taken once per thread, and by `write`) */
+static std::mutex rings_mtx;
+
+std::atomic<bool> Trace::on(false);
+std::atomic<Trace::Clock::rep> Trace::started(0);
+
+/* === Core methods === */
+
+void Trace::start() {
+     Trace::started.store(Clock::now().time_since_epoch().count(),
+                          std::memory_order_relaxed);
+     Trace::on.store(true, std::memory_order_release);
+}
+
+/**
+ * @details The first span of a thread allocates and registers its ring;
+ *          later ones only write a slot of it.
+ */
+void Trace::span(const char* cat, const char* name, int id,
+                 Clock::time_point begin, int64_t bytes) {
+     thread_local std::shared_ptr<TraceRing> ring;
+     if (!ring) {
+          ring = std::make_shared<TraceRing>();
+          ring->events.resize(TFTP_TRACE_EVENTS);
+          std::lock_guard<std::mutex> lock(rings_mtx);
+          ring->thread = rings.size();
+          rings.push_back(ring);
+     }
+
+     auto end = Clock::now();
+     begin = std::max(begin, Clock::time_point(Clock::duration(
+                                 started.load(std::memory_order_relaxed))));
+     ring->events[ring->count++ % ring->events.size()] = {
+         cat,
+         name,
+         id,
+         bytes,
+         std::chrono::nanoseconds(begin - EPOCH).count(),
+         std::chrono::nanoseconds(end - begin).count(),
+     };
+}
+
+/**
+ * @details Every span is a complete ("X") event; the thread is the
+ *          process (`pid`) and the connection the thread (`tid`) of
+ *          the viewer, so that every connection gets a row. Timestamps
+ *          are in microseconds.
+ * @see https://docs.google.com/document/d/1CvAClvFfyA5R-PhYUmn5OOQtYMH4h6I0nSsKchNAySU
+ */
+bool Trace::write(const std::string& path) {
+     std::ofstream out(path, std::ios::trunc);
+     out << std::fixed << std::setprecision(3) << "{\"traceEvents\": [\n";
+
+     std::lock_guard<std::mutex> lock(rings_mtx);
+     uint64_t dropped = 0;
+     bool first = true;
+     for (const auto& ring : rings) {
+          out << (first ? "" : ",\n")
+              << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": "
+              << ring->thread << ", \"args\": {\"name\": \"thread "
+              << ring->thread << "\"}}";
+          first = false;
+
+          uint64_t size = ring->events.size();
+          uint64_t from = ring->count > size ? ring->count - size : 0;
+          dropped += from;
+          for (uint64_t i = from; i < ring->count; i++) {
+               const TraceEvent& ev = ring->events[i % size];
+               out << ",\n{\"name\": \"" << ev.name << "\", \"cat\": \""
+                   << ev.cat << "\", \"ph\": \"X\", \"ts\": " << ev.ts / 1e3
+                   << ", \"dur\": " << ev.dur / 1e3
+                   << ", \"pid\": " << ring->thread << ", \"tid\": " << ev.id;
+               if (ev.bytes >= 0)
+                    out << ", \"args\": {\"bytes\": " << ev.bytes << "}";
+               out << "}";
+          }
+     }
+
+     out << "\n], \"displayTimeUnit\": \"ms\", \"otherData\": {\"dropped\": "
+         << dropped << "}}\n";
+     out.close();
+     return static_cast<bool>(out);
+}
@@ -0,0 +1,118 @@
+/**
+ * @file writebehind.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Write-behind buffer of a downloaded file
+ * @date 2023-11-20
+ */
+
+#include "util/writebehind.hpp"
+
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+/* === Constructors === */
+
+WriteBehind::WriteBehind(int fd, DiskWriter* writer, size_t chunk,
+                         size_t depth, off_t start)
+    : fd(fd),
+      writer(writer),
+      chunk(chunk),
+      depth(depth),
+      off(start),
+      flight(std::make_shared<Flight>()) {
+     this->buf.reserve(chunk);
+}
+
+WriteBehind::~WriteBehind() { this->wait(0); }
+
+/* === Core methods === */
+
+int WriteBehind::append(const char* data, size_t len) {
+     while (len > 0) {
+          size_t part = std::min(len, this->chunk - this->buf.size());
+          this->buf.insert(this->buf.end(), data, data + part);
+          data += part;
+          len -= part;
+
+          if (this->buf.size() == this->chunk) {
+               if (int err = this->wait(this->depth - 1)) return err;
+               this->flush();
+          }
+     }
+
+     std::lock_guard<std::mutex> lock(this->flight->mtx);
+     return this->flight->err;
+}
+
+int WriteBehind::finish() {
+     if (!this->buf.empty()) this->flush();
+     return this->wait(0);
+}
+
+/* === Helper methods === */
+
+/**
+ * @details The chunk is handed over to the writer with its offset, and
+ *          its buffer comes back to `spare` once written, so that a
+ *          transfer cycles through at most `depth + 1` buffers. Chunks
+ *          after a failed write are dropped.
+ */
+void WriteBehind::flush() {
+     std::vector<char> data;
+     {
+          std::lock_guard<std::mutex> lock(this->flight->mtx);
+          if (!this->flight->spare.empty()) {
+               data = std::move(this->flight->spare.back());
+               this->flight->spare.pop_back();
+          }
+          this->flight->pending++;
+     }
+     data.clear();
+     data.reserve(this->chunk);
+     std::swap(data, this->buf);
+     off_t off = this->off;
+     this->off += data.size();
+
+     auto task = [fd = this->fd, off, flight = this->flight,
+                  data = std::move(data)]() mutable {
+          std::unique_lock<std::mutex> lock(flight->mtx);
+          if (flight->err == 0) {
+               lock.unlock();
+               int err = write_all(fd, data, off);
+               lock.lock();
+               if (flight->err == 0) flight->err = err;
+          }
+          flight->pending--;
+          flight->spare.push_back(std::move(data));
+          flight->cv.notify_all();
+     };
+
+     if (this->writer)
+          this->writer->submit(std::move(task));
+     else
+          task();
+}
+
+int WriteBehind::wait(size_t max) {
+     std::unique_lock<std::mutex> lock(this->flight->mtx);
+     this->flight->cv.wait(
+         lock, [this, max]() { return this->flight->pending <= max; });
+     return this->flight->err;
+}
+
+int WriteBehind::write_all(int fd, const std::vector<char>& buf, off_t off) {
+     size_t len = 0;
+     while (len < buf.size()) {
+          ssize_t bytes_tx = pwrite(fd, buf.data() + len, buf.size() - len,
+                                    off + static_cast<off_t>(len));
+          if (bytes_tx < 0) {
+               if (errno == EINTR) continue;
+               return errno;
+          }
+          if (bytes_tx == 0) return EIO;
+          len += bytes_tx;
+     }
+     return 0;
+}
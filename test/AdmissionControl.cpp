@@ -0,0 +1,52 @@
+/**
+ * @file test/AdmissionControl.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Admission control unit tests
+ * @date 2023-11-22
+ */
+
+#include "util/admission.hpp"
+
+#include "catch_amalgamated.hpp"
+
+TEST_CASE("Admission Control Functionality", "[admission]") {
+     const in_addr_t alice = 0x0100007f, bob = 0x0200007f;
+
+     SECTION("No caps") {
+          AdmissionControl adm(0, 0);
+          for (int i = 0; i < 100; i++) REQUIRE(adm.acquire(alice));
+          CHECK(adm.get_active() == 100);
+     }
+
+     SECTION("Total cap") {
+          AdmissionControl adm(3, 0);
+          REQUIRE(adm.acquire(alice));
+          REQUIRE(adm.acquire(alice));
+          REQUIRE(adm.acquire(bob));
+          CHECK_FALSE(adm.acquire(bob));
+
+          adm.release(alice);
+          CHECK(adm.acquire(bob));
+          CHECK(adm.get_active() == 3);
+     }
+
+     SECTION("Per-client cap") {
+          AdmissionControl adm(0, 2);
+          REQUIRE(adm.acquire(alice));
+          REQUIRE(adm.acquire(alice));
+          CHECK_FALSE(adm.acquire(alice));
+          CHECK(adm.acquire(bob));  // Others are not affected
+
+          adm.release(alice);
+          CHECK(adm.acquire(alice));
+          CHECK(adm.get_active() == 3);
+     }
+
+     SECTION("Releasing more than acquired") {
+          AdmissionControl adm(1, 1);
+          adm.release(alice);
+          CHECK(adm.get_active() == 0);
+          REQUIRE(adm.acquire(alice));
+          CHECK_FALSE(adm.acquire(bob));
+     }
+}
@@ -0,0 +1,36 @@
+/**
+ * @file test/BatchCounter.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief BatchCounter unit tests
+ * @date 2023-11-18
+ */
+
+#include "util/batchcounter.hpp"
+
+#include "catch_amalgamated.hpp"
+
+TEST_CASE("Batch Counter Functionality", "[batchcounter]") {
+     BatchCounter bc;
+
+     SECTION("Empty counter") {
+          REQUIRE(bc.get_calls() == 0);
+          REQUIRE(bc.get_msgs() == 0);
+          REQUIRE(bc.average() == 0.0);
+          REQUIRE(bc.to_string() == "0 in 0 batches (avg. 0.00)");
+     }
+
+     SECTION("Adding and merging") {
+          bc.add(32);
+          bc.add(1);
+          REQUIRE(bc.get_calls() == 2);
+          REQUIRE(bc.get_msgs() == 33);
+          REQUIRE(bc.average() == 16.5);
+
+          BatchCounter other;
+          other.add(3);
+          bc.merge(other);
+          REQUIRE(bc.get_calls() == 3);
+          REQUIRE(bc.get_msgs() == 36);
+          REQUIRE(bc.to_string() == "36 in 3 batches (avg. 12.00)");
+     }
+}
@@ -0,0 +1,335 @@
+/**
+ * @file test/Client.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Transfer tests (clients and raw requests against a worker on
+ *        the loopback)
+ * @date 2023-11-25
+ */
+
+#include "client/client.hpp"
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+#include "client/batch.hpp"
+#include "server/worker.hpp"
+
+static const int TEST_PORT = 16969;
+
+/**
+ * @brief Server worker serving a temporary directory on the loopback,
+ *        stopped (and the directory removed) at the end of scope
+ */
+struct TestServer {
+     std::string root;
+     std::shared_ptr<std::atomic<bool>> shutd
+         = std::make_shared<std::atomic<bool>>(false);
+     std::unique_ptr<TFTPServerWorker> worker;
+     std::thread thread;
+
+     TestServer() {
+          char tmpl[] = "/tmp/tftp-client-XXXXXX";
+          REQUIRE(mkdtemp(tmpl) != nullptr);
+          this->root = tmpl;
+          this->worker = std::make_unique<TFTPServerWorker>(
+              0, this->root, TEST_PORT, this->shutd, EventLoopBackend::Poll,
+              TFTPBlockRollover::None);
+          this->worker->sock_init();
+          this->thread = std::thread([this] { this->worker->run(); });
+     }
+     ~TestServer() {
+          this->shutd->store(true);
+          this->thread.join();
+          std::string cmd = "rm -rf " + this->root;
+          REQUIRE(system(cmd.c_str()) == 0);
+     }
+
+     /**
+      * @brief Creates a sparse file with a marker at its end
+      */
+     void create(const std::string& name, off_t size,
+                 const std::string& marker) const {
+          std::string path = this->root + "/" + name;
+          int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+          REQUIRE(fd != -1);
+          REQUIRE(ftruncate(fd, size) == 0);
+          off_t off = size - static_cast<off_t>(marker.size());
+          REQUIRE(pwrite(fd, marker.data(), marker.size(), off)
+                  == static_cast<ssize_t>(marker.size()));
+          close(fd);
+     }
+};
+
+/**
+ * @brief Sends a RRQ of `name` (octet) with options to the test server
+ * @return std::string options of the OACK answered (empty if none)
+ */
+static std::string request_opts(
+    const std::string& name,
+    const std::vector<std::pair<std::string, std::string>>& opts) {
+     int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+     REQUIRE(fd != -1);
+     struct timeval tv = {2, 0};
+     setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+     std::string rrq
+         = std::string("\x00\x01", 2) + name + '\0' + "octet" + '\0';
+     for (const auto& [key, value] : opts) rrq += key + '\0' + value + '\0';
+     auto addr = TFTPClient::resolve("127.0.0.1", TEST_PORT);
+     REQUIRE(sendto(fd, rrq.data(), rrq.size(), 0,
+                    reinterpret_cast<const sockaddr*>(&addr), sizeof(addr))
+             == static_cast<ssize_t>(rrq.size()));
+
+     char buf[1024];
+     sockaddr_in from{};
+     socklen_t from_len = sizeof(from);
+     ssize_t len = recvfrom(fd, buf, sizeof(buf), 0,
+                            reinterpret_cast<sockaddr*>(&from), &from_len);
+     std::string res;
+     if (len > 2 && buf[1] == TFTPOpcode::OACK) res.assign(buf + 2, len - 2);
+
+     /* Abort the transfer (RFC 2347) */
+     const char abort[] = "\x00\x05\x00\x08";
+     if (len > 0)
+          sendto(fd, abort, sizeof(abort), 0,
+                 reinterpret_cast<const sockaddr*>(&from), from_len);
+     close(fd);
+     return res;
+}
+
+/**
+ * @brief Uploads `data` in one block by a raw WRQ of `name` announcing
+ *        `tsize` to the test server
+ * @return int opcode of the answer to the WRQ (-1 if none)
+ */
+static int upload_tsize(const std::string& name, const std::string& tsize,
+                        const std::string& data) {
+     int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+     REQUIRE(fd != -1);
+     struct timeval tv = {2, 0};
+     setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+     std::string wrq = std::string("\x00\x02", 2) + name + '\0' + "octet"
+                       + '\0' + "tsize" + '\0' + tsize + '\0';
+     auto addr = TFTPClient::resolve("127.0.0.1", TEST_PORT);
+     REQUIRE(sendto(fd, wrq.data(), wrq.size(), 0,
+                    reinterpret_cast<const sockaddr*>(&addr), sizeof(addr))
+             == static_cast<ssize_t>(wrq.size()));
+
+     char buf[1024];
+     sockaddr_in from{};
+     socklen_t from_len = sizeof(from);
+     ssize_t len = recvfrom(fd, buf, sizeof(buf), 0,
+                            reinterpret_cast<sockaddr*>(&from), &from_len);
+     int opcode = len >= 2 ? buf[1] : -1;
+     if (opcode == TFTPOpcode::OACK) {
+          std::string block = std::string("\x00\x03\x00\x01", 4) + data;
+          sendto(fd, block.data(), block.size(), 0,
+                 reinterpret_cast<const sockaddr*>(&from), from_len);
+          REQUIRE(recv(fd, buf, sizeof(buf), 0) == 4);
+          REQUIRE(buf[1] == TFTPOpcode::ACK);
+     }
+     close(fd);
+     return opcode;
+}
+
+TEST_CASE("Server Upload Preallocation", "[client]") {
+     Logger::set_level(LogLevel::Error);
+     TestServer server;
+
+     SECTION("Blocks reserved past the uploaded data are freed") {
+          REQUIRE(upload_tsize("short.img", "67108864", "end")
+                  == TFTPOpcode::OACK);
+          std::string path = server.root + "/short.img";
+          struct stat st {};
+          for (int i = 0; i < 100; i++) {  // Freed as the connection ends
+               REQUIRE(stat(path.c_str(), &st) == 0);
+               if (st.st_blocks * 512 < 1024 * 1024) break;
+               std::this_thread::sleep_for(std::chrono::milliseconds(20));
+          }
+          REQUIRE(st.st_size == 3);
+          REQUIRE(st.st_blocks * 512 < 1024 * 1024);
+     }
+
+     SECTION("Sizes beyond the free space are refused") {
+          REQUIRE(upload_tsize("huge.img", "9223372036854775807", "end")
+                  == TFTPOpcode::ERROR);
+          std::string path = server.root + "/huge.img";
+          std::this_thread::sleep_for(std::chrono::milliseconds(100));
+          REQUIRE(access(path.c_str(), F_OK) != 0);
+     }
+     Logger::set_level(LogLevel::Info);
+}
+
+TEST_CASE("Server Window Limits", "[client]") {
+     Logger::set_level(LogLevel::Error);
+     TestServer server;
+     server.create("small.img", 100, "end");
+
+     SECTION("Windows over the byte limit are answered smaller") {
+          std::string max_window = std::to_string(
+              TFTP_MAX_WINDOW_BYTES / (TFTP_MAX_BLKSIZE + 4));
+          auto oack = request_opts("small.img", {{"blksize", "65464"},
+                                                 {"windowsize", "65535"}});
+          REQUIRE(oack == std::string("blksize") + '\0' + "65464" + '\0'
+                              + "windowsize" + '\0' + max_window + '\0');
+     }
+
+     SECTION("Windows with rollover stay within half the block numbers") {
+          auto oack = request_opts("small.img", {{"blksize", "8"},
+                                                 {"windowsize", "65535"},
+                                                 {"rollover", "0"}});
+          REQUIRE(oack == std::string("blksize") + '\0' + "8" + '\0'
+                              + "windowsize" + '\0'
+                              + std::to_string(TFTP_MAX_ROLLOVER_WINDOWSIZE)
+                              + '\0' + "rollover" + '\0' + "0" + '\0');
+     }
+
+     SECTION("Windows within the limit are kept") {
+          auto oack = request_opts("small.img", {{"windowsize", "64"}});
+          REQUIRE(oack == std::string("windowsize") + '\0' + "64" + '\0');
+     }
+     Logger::set_level(LogLevel::Info);
+}
+
+TEST_CASE("Server Truncated Files", "[client]") {
+     Logger::set_level(LogLevel::Error);
+     TestServer server;
+     server.create("shrink.img", TFTP_MMAP_MIN_SIZE * 4, "end");
+
+     SECTION("Files truncated during a transfer fail only the transfer") {
+          int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+          REQUIRE(fd != -1);
+          struct timeval tv = {2, 0};
+          setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+          /* First block (of the mapping) arrives */
+          std::string rrq = std::string("\x00\x01", 2) + "shrink.img" + '\0'
+                            + "octet" + '\0';
+          auto addr = TFTPClient::resolve("127.0.0.1", TEST_PORT);
+          REQUIRE(sendto(fd, rrq.data(), rrq.size(), 0,
+                         reinterpret_cast<const sockaddr*>(&addr),
+                         sizeof(addr))
+                  == static_cast<ssize_t>(rrq.size()));
+          char buf[1024];
+          sockaddr_in from{};
+          socklen_t from_len = sizeof(from);
+          REQUIRE(recvfrom(fd, buf, sizeof(buf), 0,
+                           reinterpret_cast<sockaddr*>(&from), &from_len)
+                  == static_cast<ssize_t>(TFTP_DFLT_MAXSIZE));
+          REQUIRE(buf[1] == TFTPOpcode::DATA);
+
+          /* Next block is past the end of the truncated file */
+          std::string path = server.root + "/shrink.img";
+          REQUIRE(truncate(path.c_str(), 0) == 0);
+          const char ack[] = "\x00\x04\x00\x01";
+          sendto(fd, ack, 4, 0, reinterpret_cast<const sockaddr*>(&from),
+                 from_len);
+          REQUIRE(recv(fd, buf, sizeof(buf), 0) >= 4);
+          CHECK(buf[1] == TFTPOpcode::ERROR);
+          close(fd);
+
+          /* The worker lives on */
+          server.create("small.img", 100, "end");
+          auto oack = request_opts("small.img", {{"windowsize", "2"}});
+          CHECK(oack == std::string("windowsize") + '\0' + "2" + '\0');
+     }
+     Logger::set_level(LogLevel::Info);
+}
+
+TEST_CASE("Client Windowed Uploads", "[client]") {
+     Logger::set_level(LogLevel::Error);
+     TestServer server;
+     auto addr = TFTPClient::resolve("127.0.0.1", TEST_PORT);
+
+     SECTION("Windows larger than a socket buffer arrive intact") {
+          /* Every block holds its number, so misplaced blocks show */
+          std::string data;
+          for (uint32_t block = 1; block <= 16 * 1024; block++)
+               for (size_t i = 0; i < TFTP_DFLT_BLKSIZE / sizeof(block); i++)
+                    data.append(reinterpret_cast<const char*>(&block),
+                                sizeof(block));
+          data += "end";
+          std::string src = server.root + "/src.img";
+          int fd = open(src.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+          REQUIRE(fd != -1);
+          REQUIRE(write(fd, data.data(), data.size())
+                  == static_cast<ssize_t>(data.size()));
+          REQUIRE(lseek(fd, 0, SEEK_SET) == 0);
+
+          TFTPClient client(addr, "up.img", std::nullopt,
+                            {{"windowsize", "2000"}});
+          client.set_source(fd);
+          client.run();
+          REQUIRE_FALSE(client.is_errored());
+
+          std::string up = server.root + "/up.img";
+          fd = open(up.c_str(), O_RDONLY);
+          REQUIRE(fd != -1);
+          std::string got(data.size() + 1, '\0');
+          ssize_t len = read(fd, got.data(), got.size());
+          close(fd);
+          REQUIRE(len == static_cast<ssize_t>(data.size()));
+          got.resize(len);
+          REQUIRE(got == data);
+     }
+     Logger::set_level(LogLevel::Info);
+}
+
+TEST_CASE("Client Split Downloads", "[client]") {
+     Logger::set_level(LogLevel::Error);
+     TestServer server;
+     auto addr = TFTPClient::resolve("127.0.0.1", TEST_PORT);
+
+     SECTION("Files over the block number limit are probed and split") {
+          /* More blocks (of 512 B) than 16-bit block numbers cover */
+          const off_t size
+              = static_cast<off_t>(TFTP_DFLT_BLKSIZE) * TFTP_MAX_FILE_BLOCKS
+                + 4096;
+          const std::string marker = "end of the image";
+          server.create("big.img", size, marker);
+          std::string dest = server.root + "/big.out";
+
+          auto probed = TFTPClient::probe_size(addr, dest, "big.img", {});
+          REQUIRE(probed.has_value());
+          REQUIRE(*probed == static_cast<uint64_t>(size));
+
+          TFTPBatchClient client(
+              "127.0.0.1", TEST_PORT,
+              TFTPBatchClient::split("big.img", dest, *probed, 4), 4);
+          client.set_options({{"windowsize", "16"}});
+          REQUIRE(client.run() == 0);
+
+          std::string part = TFTPClient::part_path(dest);
+          int fd = open(part.c_str(), O_RDONLY);
+          REQUIRE(fd != -1);
+          struct stat st;
+          REQUIRE(fstat(fd, &st) == 0);
+          REQUIRE(st.st_size >= size);
+          std::string tail(marker.size(), '\0');
+          REQUIRE(pread(fd, tail.data(), tail.size(),
+                        size - static_cast<off_t>(marker.size()))
+                  == static_cast<ssize_t>(tail.size()));
+          close(fd);
+          REQUIRE(tail == marker);
+     }
+
+     SECTION("Missing files have no size") {
+          std::string dest = server.root + "/none.out";
+          REQUIRE_FALSE(
+              TFTPClient::probe_size(addr, dest, "none.img", {}).has_value());
+     }
+     Logger::set_level(LogLevel::Info);
+}
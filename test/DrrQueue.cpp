@@ -0,0 +1,149 @@
+/**
+ * @file test/DrrQueue.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief DrrQueue unit tests
+ * @date 2023-11-25
+ */
+
+#include "util/drrqueue.hpp"
+
+#include "catch_amalgamated.hpp"
+
+/**
+ * @brief Flow of test packets of one size
+ */
+struct TestFlow {
+     size_t packet;      /**< Packet size */
+     size_t left;        /**< Packets waiting */
+     size_t sent = 0;    /**< Bytes sent */
+     bool paced = false; /**< Flag if held back by its pacer */
+};
+
+/**
+ * @brief Sends whole packets of a `TestFlow` within the allowance
+ */
+static DrrQueue::Served send_flow(int, void* data, size_t allow) {
+     auto* flow = static_cast<TestFlow*>(data);
+     size_t bytes = 0;
+     while (!flow->paced && flow->left > 0 && bytes + flow->packet <= allow) {
+          bytes += flow->packet;
+          flow->left--;
+     }
+     flow->sent += bytes;
+     return {bytes, flow->left > 0, flow->paced};
+}
+
+TEST_CASE("DRR Queue Functionality", "[drrqueue]") {
+     DrrQueue drr(1000);
+
+     SECTION("Equal bytes whatever the packet size") {
+          TestFlow a{100, 1000}, b{700, 1000}, c{1000, 1000};
+          drr.push(1, &a);
+          drr.push(2, &b);
+          drr.push(3, &c);
+          drr.push(2, &b);  // No-op
+          REQUIRE(drr.size() == 3);
+
+          for (int round = 0; round < 70; round++)
+               drr.serve(SIZE_MAX, send_flow);
+          CHECK(a.sent == 70000);
+          CHECK(c.sent == 70000);
+          CHECK(b.sent >= 69300);  // Deficit carried over
+          CHECK(b.sent <= 70000);
+     }
+
+     SECTION("Drained flows leave the queue") {
+          TestFlow a{500, 3}, b{500, 100};
+          drr.push(1, &a);
+          drr.push(2, &b);
+          REQUIRE(drr.serve(SIZE_MAX, send_flow) == 2000);
+          REQUIRE(drr.size() == 2);
+          REQUIRE(drr.serve(SIZE_MAX, send_flow) == 1500);
+          REQUIRE(drr.size() == 1);
+          REQUIRE(a.left == 0);
+     }
+
+     SECTION("Turns cut short by the budget go on") {
+          TestFlow a{500, 100}, b{500, 100}, c{500, 100};
+          drr.push(1, &a);
+          drr.push(2, &b);
+          drr.push(3, &c);
+          REQUIRE(drr.serve(1500, send_flow) == 1500);
+          REQUIRE(a.sent == 1000);
+          REQUIRE(b.sent == 500);
+          REQUIRE(c.sent == 0);
+
+          REQUIRE(drr.serve(1000, send_flow) == 1000);
+          REQUIRE(b.sent == 1000);  // No new quantum
+          REQUIRE(c.sent == 500);
+     }
+
+     SECTION("Fresh flows go first") {
+          TestFlow a{100, 1000}, b{100, 2};
+          drr.push(1, &a);
+          drr.serve(SIZE_MAX, send_flow);
+          REQUIRE(a.sent == 1000);
+
+          drr.push(2, &b);
+          REQUIRE(drr.serve(300, send_flow) == 300);
+          REQUIRE(b.sent == 200);
+          REQUIRE(a.sent == 1100);
+          REQUIRE(drr.size() == 2);  // Leaves on its turn in the order
+
+          b.left = 5;
+          drr.push(2, &b);  // Not sparse => keeps its place after `a`
+          TestFlow c{100, 1000};
+          drr.push(3, &c);
+          REQUIRE(drr.serve(1400, send_flow) == 1400);
+          REQUIRE(c.sent == 1000);
+          REQUIRE(a.sent == 1500);  // The rest of its turn
+          REQUIRE(b.sent == 200);
+
+          drr.serve(SIZE_MAX, send_flow);
+          REQUIRE(b.sent == 700);
+          REQUIRE(drr.size() == 2);
+     }
+
+     SECTION("Paced flows do not save up deficit") {
+          TestFlow a{100, 1000}, b{100, 1000};
+          b.paced = true;
+          drr.push(1, &a);
+          drr.push(2, &b);
+          for (int round = 0; round < 10; round++)
+               drr.serve(SIZE_MAX, send_flow);
+          REQUIRE(b.sent == 0);
+
+          b.paced = false;
+          drr.serve(SIZE_MAX, send_flow);
+          REQUIRE(b.sent == 1000);  // Deficit given up while paced
+     }
+
+     SECTION("Removed flows are skipped, keys can be reused") {
+          TestFlow a{100, 1000}, b{100, 1000}, c{100, 1000};
+          drr.push(1, &a);
+          drr.push(2, &b);
+          drr.remove(1);
+          drr.remove(7);  // No-op
+          drr.push(1, &c);
+          REQUIRE(drr.size() == 2);
+
+          drr.serve(SIZE_MAX, send_flow);
+          REQUIRE(a.sent == 0);
+          REQUIRE(b.sent == 1000);
+          REQUIRE(c.sent == 1000);  // Once per round, despite two entries
+     }
+
+     SECTION("Flows removed by the sender") {
+          TestFlow a{100, 1000}, b{100, 1000};
+          drr.push(1, &a);
+          drr.push(2, &b);
+          auto sender = [&](int key, void* data, size_t allow) {
+               drr.remove(2);
+               return send_flow(key, data, allow);
+          };
+          drr.serve(SIZE_MAX, sender);
+          REQUIRE(drr.size() == 1);
+          REQUIRE(a.sent == 1000);
+          REQUIRE(b.sent == 0);
+     }
+}
@@ -0,0 +1,175 @@
+/**
+ * @file test/FileCache.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief File cache unit tests
+ * @date 2023-11-19
+ */
+
+#include "util/filecache.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "catch_amalgamated.hpp"
+
+/**
+ * @brief Temporary file removed at the end of scope
+ */
+struct TempFile {
+     std::string path;
+
+     TempFile() {
+          char tmpl[] = "/tmp/tftp-filecache-XXXXXX";
+          int fd = mkstemp(tmpl);
+          REQUIRE(fd != -1);
+          close(fd);
+          this->path = tmpl;
+     }
+     ~TempFile() { unlink(this->path.c_str()); }
+
+     /**
+      * @brief Replaces the file contents (the mtime is bumped explicitly,
+      *        a coarse clock could leave it unchanged)
+      */
+     void write(const std::string& data) const {
+          int fd = open(this->path.c_str(), O_WRONLY | O_TRUNC);
+          REQUIRE(fd != -1);
+          REQUIRE(::write(fd, data.data(), data.size())
+                  == static_cast<ssize_t>(data.size()));
+          struct stat st;
+          REQUIRE(fstat(fd, &st) == 0);
+          struct timespec times[2] = {st.st_atim, st.st_mtim};
+          times[1].tv_sec += 1;
+          REQUIRE(futimens(fd, times) == 0);
+          close(fd);
+     }
+
+     struct stat stat() const {
+          struct stat st;
+          REQUIRE(::stat(this->path.c_str(), &st) == 0);
+          return st;
+     }
+};
+
+/**
+ * @brief Looks up a file and loads it on a miss
+ */
+static std::shared_ptr<FileCache::Image> fetch(FileCache& cache,
+                                               const TempFile& file,
+                                               TFTPDataFormat format) {
+     struct stat st = file.stat();
+     auto image = cache.get(file.path, st, format);
+     if (image) return image;
+
+     int fd = open(file.path.c_str(), O_RDONLY);
+     REQUIRE(fd != -1);
+     image = cache.load(file.path, fd, st, format);
+     close(fd);
+     return image;
+}
+
+TEST_CASE("File Cache Functionality", "[filecache]") {
+     SECTION("Miss, load and hit") {
+          FileCache cache(1 << 20);
+          TempFile file;
+          file.write("hello, world");
+
+          REQUIRE(cache.get(file.path, file.stat(), TFTPDataFormat::Octet)
+                  == nullptr);
+          auto image = fetch(cache, file, TFTPDataFormat::Octet);
+          REQUIRE(image);
+          CHECK(std::string(image->begin(), image->end()) == "hello, world");
+
+          auto again = fetch(cache, file, TFTPDataFormat::Octet);
+          CHECK(again == image);
+
+          auto stats = cache.get_stats();
+          CHECK(stats.hits == 1);
+          CHECK(stats.misses == 2);
+          CHECK(stats.entries == 1);
+          CHECK(stats.bytes == 12);
+     }
+
+     SECTION("Changed file is reloaded") {
+          FileCache cache(1 << 20);
+          TempFile file;
+          file.write("first");
+          auto old_image = fetch(cache, file, TFTPDataFormat::Octet);
+
+          file.write("second");
+          REQUIRE(cache.get(file.path, file.stat(), TFTPDataFormat::Octet)
+                  == nullptr);
+          auto image = fetch(cache, file, TFTPDataFormat::Octet);
+          CHECK(std::string(image->begin(), image->end()) == "second");
+
+          /* Transfers of the old image are not affected */
+          CHECK(std::string(old_image->begin(), old_image->end()) == "first");
+
+          auto stats = cache.get_stats();
+          CHECK(stats.evictions == 1);
+          CHECK(stats.entries == 1);
+          CHECK(stats.bytes == 6);
+     }
+
+     SECTION("Least recently used images are evicted") {
+          FileCache cache(25);
+          TempFile a, b, c;
+          a.write(std::string(10, 'a'));
+          b.write(std::string(10, 'b'));
+          c.write(std::string(10, 'c'));
+
+          fetch(cache, a, TFTPDataFormat::Octet);
+          fetch(cache, b, TFTPDataFormat::Octet);
+          fetch(cache, a, TFTPDataFormat::Octet);  // `b` is now the LRU
+          fetch(cache, c, TFTPDataFormat::Octet);
+
+          CHECK(cache.get(a.path, a.stat(), TFTPDataFormat::Octet));
+          CHECK(cache.get(c.path, c.stat(), TFTPDataFormat::Octet));
+          CHECK(cache.get(b.path, b.stat(), TFTPDataFormat::Octet)
+                == nullptr);
+
+          auto stats = cache.get_stats();
+          CHECK(stats.evictions == 1);
+          CHECK(stats.entries == 2);
+          CHECK(stats.bytes == 20);
+     }
+
+     SECTION("Files over the budget are not cached") {
+          FileCache cache(8);
+          TempFile file;
+          file.write("more than eight bytes");
+
+          CHECK(fetch(cache, file, TFTPDataFormat::Octet) == nullptr);
+
+          /* Encoded image over the budget is served, but not cached */
+          TempFile text;
+          text.write("\n\n\n\n\n\n");
+          auto image = fetch(cache, text, TFTPDataFormat::NetASCII);
+          REQUIRE(image);
+          CHECK(image->size() == 12);
+          CHECK(cache.get_stats().entries == 0);
+     }
+
+     SECTION("NetASCII images") {
+          FileCache cache(1 << 20);
+          TempFile file;
+          std::string data = "line\nCR\rCRLF\r\nend\r";
+          file.write(data);
+
+          auto image = fetch(cache, file, TFTPDataFormat::NetASCII);
+          REQUIRE(image);
+          CHECK(*image
+                == NetASCII::vec_to_na(std::vector<char>(data.begin(),
+                                                         data.end())));
+
+          /* Modes are cached separately */
+          auto octet = fetch(cache, file, TFTPDataFormat::Octet);
+          CHECK(std::string(octet->begin(), octet->end()) == data);
+          CHECK(cache.get_stats().entries == 2);
+
+          FileCache no_na(1 << 20, false);
+          CHECK(fetch(no_na, file, TFTPDataFormat::NetASCII) == nullptr);
+     }
+}
@@ -0,0 +1,91 @@
+/**
+ * @file test/FileMap.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief File mapping unit tests
+ * @date 2023-11-19
+ */
+
+#include "util/filemap.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+#include "common.hpp"
+
+TEST_CASE("File Map Functionality", "[filemap]") {
+     char tmpl[] = "/tmp/tftp-filemap-XXXXXX";
+     int fd = mkstemp(tmpl);
+     REQUIRE(fd != -1);
+
+     SECTION("Sequential reads across readahead windows") {
+          /* Size not a multiple of the blocks nor of the pages */
+          std::vector<char> data(TFTP_MMAP_READAHEAD * 2 + 12345);
+          std::mt19937 rng(42);
+          for (auto& c : data) c = static_cast<char>(rng());
+          REQUIRE(write(fd, data.data(), data.size())
+                  == static_cast<ssize_t>(data.size()));
+
+          FileMap map(fd, data.size());
+          CHECK(map.get_size() == data.size());
+
+          std::vector<char> out;
+          std::vector<char> block(65464);
+          size_t off = 0;
+          while (true) {
+               size_t len = map.read(block.data(), block.size(), off);
+               out.insert(out.end(), block.begin(), block.begin() + len);
+               off += len;
+               if (len < block.size()) break;
+          }
+          CHECK(out == data);
+          CHECK(map.read(block.data(), block.size(), off) == 0);
+     }
+
+     SECTION("Random access (retransmits)") {
+          std::string data = "0123456789abcdef";
+          REQUIRE(write(fd, data.data(), data.size())
+                  == static_cast<ssize_t>(data.size()));
+
+          FileMap map(fd, data.size());
+          char out[8];
+          REQUIRE(map.read(out, 4, 10) == 4);
+          CHECK(std::string(out, 4) == "abcd");
+          REQUIRE(map.read(out, 8, 12) == 4);
+          CHECK(std::string(out, 4) == "cdef");
+          REQUIRE(map.read(out, 4, 0) == 4);
+          CHECK(std::string(out, 4) == "0123");
+
+          /* Slices point into the mapping */
+          auto part = map.slice(8, 12);
+          CHECK(std::string(part.begin(), part.end()) == "cdef");
+          CHECK(map.slice(8, 16).empty());
+     }
+
+     SECTION("Files truncated while mapped") {
+          std::vector<char> data(TFTP_MMAP_READAHEAD, 'x');
+          REQUIRE(write(fd, data.data(), data.size())
+                  == static_cast<ssize_t>(data.size()));
+
+          FileMap map(fd, data.size());
+          char out[8];
+          REQUIRE(map.read(out, 8, 0) == 8);
+          REQUIRE(ftruncate(fd, 0) == 0);
+          CHECK_THROWS_AS(map.read(out, 8, data.size() / 2),
+                          std::runtime_error);
+          CHECK_THROWS_AS(map.read(out, 8, 0), std::runtime_error);
+     }
+
+     SECTION("Unmappable files") {
+          CHECK_THROWS_AS(FileMap(fd, 0), std::runtime_error);
+          CHECK_THROWS_AS(FileMap(-1, 4096), std::runtime_error);
+     }
+
+     close(fd);
+     unlink(tmpl);
+}
@@ -0,0 +1,76 @@
+/**
+ * @file test/GroupPool.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Multicast group pool unit tests
+ * @date 2023-11-25
+ */
+
+#include "util/grouppool.hpp"
+
+#include <arpa/inet.h>
+
+#include <stdexcept>
+
+#include "catch_amalgamated.hpp"
+
+/**
+ * @brief Makes a group address
+ */
+static sockaddr_in group(const char* addr, uint16_t port) {
+     sockaddr_in group{};
+     group.sin_family = AF_INET;
+     group.sin_port = htons(port);
+     inet_pton(AF_INET, addr, &group.sin_addr);
+     return group;
+}
+
+TEST_CASE("Group Pool Functionality", "[grouppool]") {
+     SECTION("Groups are consecutive and share the port") {
+          GroupPool pool(group("239.255.0.1", 1758), 3);
+          auto a = pool.acquire(), b = pool.acquire(), c = pool.acquire();
+          REQUIRE(a.has_value());
+          REQUIRE(b.has_value());
+          REQUIRE(c.has_value());
+          CHECK(a->sin_addr.s_addr == group("239.255.0.1", 0).sin_addr.s_addr);
+          CHECK(b->sin_addr.s_addr == group("239.255.0.2", 0).sin_addr.s_addr);
+          CHECK(c->sin_addr.s_addr == group("239.255.0.3", 0).sin_addr.s_addr);
+          CHECK(c->sin_port == htons(1758));
+          CHECK_FALSE(pool.acquire().has_value());
+          CHECK(pool.get_active() == 3);
+     }
+
+     SECTION("Released groups are reused last") {
+          GroupPool pool(group("239.255.0.1", 1758), 3);
+          auto a = pool.acquire();
+          auto b = pool.acquire();
+          REQUIRE(a.has_value());
+          REQUIRE(b.has_value());
+          pool.release(*a);
+          CHECK(pool.get_active() == 1);
+
+          auto c = pool.acquire();
+          REQUIRE(c.has_value());
+          CHECK(c->sin_addr.s_addr == group("239.255.0.3", 0).sin_addr.s_addr);
+          auto d = pool.acquire();
+          REQUIRE(d.has_value());
+          CHECK(d->sin_addr.s_addr == a->sin_addr.s_addr);
+     }
+
+     SECTION("Foreign and double releases are ignored") {
+          GroupPool pool(group("239.255.0.1", 1758), 2);
+          auto a = pool.acquire();
+          REQUIRE(a.has_value());
+          pool.release(group("239.255.1.1", 1758));
+          pool.release(*a);
+          pool.release(*a);
+          CHECK(pool.get_active() == 0);
+     }
+
+     SECTION("Ranges must be multicast") {
+          CHECK_THROWS_AS(GroupPool(group("10.0.0.1", 1758), 4),
+                          std::runtime_error);
+          CHECK_THROWS_AS(GroupPool(group("239.255.255.255", 1758), 2),
+                          std::runtime_error);
+          CHECK_NOTHROW(GroupPool(group("239.255.255.254", 1758), 2));
+     }
+}
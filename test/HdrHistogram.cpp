@@ -0,0 +1,73 @@
+/**
+ * @file test/HdrHistogram.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief High dynamic range histogram unit tests
+ * @date 2023-11-25
+ */
+
+#include "util/hdrhistogram.hpp"
+
+#include <cmath>
+#include <cstdint>
+
+#include "catch_amalgamated.hpp"
+
+TEST_CASE("HDR Histogram Functionality", "[hdrhistogram]") {
+     HdrHistogram hist;
+
+     SECTION("Empty histogram") {
+          CHECK(hist.get_count() == 0);
+          CHECK(hist.get_min() == 0);
+          CHECK(hist.percentile(50) == 0);
+          CHECK(hist.get_mean() == 0);
+     }
+
+     SECTION("Small values are exact") {
+          for (uint64_t v = 1; v <= 100; v++) hist.record(v);
+          CHECK(hist.get_count() == 100);
+          CHECK(hist.percentile(0) == 1);
+          CHECK(hist.percentile(50) == 50);
+          CHECK(hist.percentile(99) == 99);
+          CHECK(hist.percentile(100) == 100);
+          CHECK(hist.get_mean() == 50.5);
+     }
+
+     SECTION("Large values are within the relative error") {
+          for (uint64_t v : {uint64_t{1000}, uint64_t{123456},
+                             uint64_t{987654321}, UINT64_MAX / 3}) {
+               HdrHistogram one;
+               one.record(v);
+               one.record(v - 1);  // Percentiles below the max
+               uint64_t got = one.percentile(1);
+               CHECK(got >= v - 1);
+               CHECK(static_cast<double>(got - (v - 1))
+                     <= static_cast<double>(v) / 128);
+          }
+
+          hist.record(UINT64_MAX);
+          CHECK(hist.percentile(100) == UINT64_MAX);
+     }
+
+     SECTION("Percentiles of a spread") {
+          for (uint64_t v = 1; v <= 100000; v++) hist.record(v * 10);
+          for (double pct : {50.0, 90.0, 99.0, 99.9}) {
+               double want = pct / 100 * 1000000;
+               double got = static_cast<double>(hist.percentile(pct));
+               CHECK(std::abs(got - want) <= want / 100);
+          }
+          CHECK(hist.get_max() == 1000000);
+          CHECK(hist.get_min() == 10);
+     }
+
+     SECTION("Merging") {
+          hist.record(5, 3);
+          HdrHistogram other;
+          other.record(7000);
+          hist.merge(other);
+          CHECK(hist.get_count() == 4);
+          CHECK(hist.get_min() == 5);
+          CHECK(hist.get_max() == 7000);
+          CHECK(hist.percentile(75) == 5);
+          CHECK(hist.percentile(76) == 7000);
+     }
+}
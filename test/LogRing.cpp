@@ -0,0 +1,76 @@
+/**
+ * @file test/LogRing.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief LogRing unit tests
+ * @date 2023-11-18
+ */
+
+#include "util/logring.hpp"
+
+#include <string>
+#include <thread>
+
+#include "catch_amalgamated.hpp"
+
+static auto fill_with(const std::string& txt) {
+     return [txt](LogRecord& rec) {
+          rec.len = txt.size();
+          memcpy(rec.text, txt.data(), txt.size());
+     };
+}
+
+TEST_CASE("Log Ring Functionality", "[logring]") {
+     SECTION("Capacity is a power of two") {
+          LogRing ring(100);
+          REQUIRE(ring.capacity() == 128);
+     }
+
+     SECTION("FIFO order and full ring") {
+          LogRing ring(4);
+          for (int i = 0; i < 4; i++)
+               REQUIRE(ring.try_push(fill_with(std::to_string(i))));
+          REQUIRE_FALSE(ring.try_push(fill_with("x")));
+
+          for (int i = 0; i < 4; i++) {
+               std::string txt;
+               REQUIRE(ring.try_pop([&txt](const LogRecord& rec) {
+                    txt.assign(rec.text, rec.len);
+               }));
+               REQUIRE(txt == std::to_string(i));
+          }
+          REQUIRE_FALSE(ring.try_pop([](const LogRecord&) {}));
+
+          /* Wraps around */
+          REQUIRE(ring.try_push(fill_with("again")));
+          REQUIRE(ring.try_pop([](const LogRecord&) {}));
+     }
+
+     SECTION("Concurrent producers") {
+          LogRing ring(64);
+          const int n_threads = 4, n_recs = 1000;
+          std::vector<std::thread> producers;
+          for (int t = 0; t < n_threads; t++)
+               producers.emplace_back([&ring, t] {
+                    for (int i = 0; i < n_recs; i++)
+                         while (!ring.try_push([t](LogRecord& rec) {
+                              rec.len = 1;
+                              rec.text[0] = static_cast<char>('a' + t);
+                         }))
+                              std::this_thread::yield();
+               });
+
+          std::array<int, n_threads> counts{};
+          int popped = 0;
+          while (popped < n_threads * n_recs) {
+               if (ring.try_pop([&counts](const LogRecord& rec) {
+                        counts[rec.text[0] - 'a']++;
+                   }))
+                    popped++;
+               else
+                    std::this_thread::yield();
+          }
+          for (auto& thread : producers) thread.join();
+
+          for (int count : counts) REQUIRE(count == n_recs);
+     }
+}
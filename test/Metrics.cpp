@@ -0,0 +1,99 @@
+/**
+ * @file test/Metrics.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Metrics (Histogram, ServerMetrics) unit tests
+ * @date 2023-11-18
+ */
+
+#include "util/metrics.hpp"
+
+#include "catch_amalgamated.hpp"
+
+TEST_CASE("Histogram Functionality", "[metrics]") {
+     Histogram hist;
+
+     SECTION("Bucket placement") {
+          hist.observe(0);
+          hist.observe(1);
+          hist.observe(4);
+          hist.observe(5);
+          hist.observe(16);
+          hist.observe(UINT64_MAX);
+          REQUIRE(hist.get_bucket(0) == 2);
+          REQUIRE(hist.get_bucket(1) == 1);
+          REQUIRE(hist.get_bucket(2) == 2);
+          REQUIRE(hist.get_bucket(Histogram::N_BUCKETS - 1) == 1);
+          REQUIRE(hist.get_count() == 6);
+     }
+
+     SECTION("Bounds") {
+          REQUIRE(Histogram::bound(0) == 1);
+          REQUIRE(Histogram::bound(1) == 4);
+          REQUIRE(Histogram::bound(5) == 1024);
+     }
+
+     SECTION("Merging") {
+          hist.observe(3);
+          Histogram other;
+          other.observe(3);
+          other.observe(100);
+          hist.merge(other);
+          REQUIRE(hist.get_bucket(1) == 2);
+          REQUIRE(hist.get_bucket(4) == 1);
+          REQUIRE(hist.get_count() == 3);
+          REQUIRE(hist.get_sum() == 106);
+     }
+}
+
+TEST_CASE("Server Metrics Functionality", "[metrics]") {
+     ServerMetrics metrics;
+     metrics.rrq.add();
+     metrics.req_duplicate.add();
+     metrics.conn_opened.add(2);
+
+     ConnStats stats;
+     stats.bytes_tx = 1024;
+     stats.blocks_tx = 2;
+     stats.retransmits = 1;
+     stats.blksize_clamps = 1;
+     stats.err_sent = TFTPErrorCode::FileNotFound;
+     metrics.add_conn(stats, true);
+
+     SECTION("Adding a connection") {
+          REQUIRE(metrics.conn_errored.get() == 1);
+          REQUIRE(metrics.conn_completed.get() == 0);
+          REQUIRE(metrics.bytes_tx.get() == 1024);
+          REQUIRE(metrics.errors_sent[TFTPErrorCode::FileNotFound].get() == 1);
+          REQUIRE(metrics.transfer_us.get_count() == 1);
+     }
+
+     SECTION("Merging") {
+          ServerMetrics total;
+          total.merge(metrics);
+          total.merge(metrics);
+          REQUIRE(total.rrq.get() == 2);
+          REQUIRE(total.req_duplicate.get() == 2);
+          REQUIRE(total.blocks_tx.get() == 4);
+          REQUIRE(total.retransmits.get() == 2);
+          REQUIRE(total.blksize_clamps.get() == 2);
+          REQUIRE(total.pmtu_fallbacks.get() == 0);
+          REQUIRE(total.transfer_us.get_count() == 2);
+     }
+
+     SECTION("Prometheus output") {
+          std::string text = metrics.to_prometheus();
+          auto has = [&](const std::string &line) {
+               return text.find(line + "\n") != std::string::npos;
+          };
+          REQUIRE(has("# TYPE tftp_connections_active gauge"));
+          REQUIRE(has("tftp_connections_active 1"));
+          REQUIRE(has("tftp_requests_total{type=\"rrq\"} 1"));
+          REQUIRE(
+              has("tftp_requests_dropped_total{reason=\"duplicate\"} 1"));
+          REQUIRE(has("tftp_data_bytes_total{direction=\"sent\"} 1024"));
+          REQUIRE(has("tftp_blksize_clamps_total 1"));
+          REQUIRE(has("tftp_errors_total{direction=\"sent\",code=\"1\"} 1"));
+          REQUIRE(has("tftp_transfer_duration_seconds_count 1"));
+          REQUIRE(has("tftp_rtt_seconds_bucket{le=\"+Inf\"} 0"));
+     }
+}
@@ -0,0 +1,201 @@
+/**
+ * @file test/NetASCII.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief NetASCII conversion unit tests
+ * @date 2023-11-17
+ */
+
+#include "util/netascii.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <random>
+#include <string>
+
+#include "catch_amalgamated.hpp"
+
+/**
+ * @brief Encodes the whole file with the streaming encoder
+ * @param path Path to the file
+ * @param block_size Size of the blocks
+ * @return std::vector<char> concatenated blocks
+ */
+static std::vector<char> encode_file(const std::string& path,
+                                     size_t block_size) {
+     int fd = open(path.c_str(), O_RDONLY);
+     REQUIRE(fd != -1);
+
+     NetASCII::Encoder encoder(fd);
+     std::vector<char> encoded;
+     while (true) {
+          std::vector<char> block = encoder.next_block(block_size);
+          REQUIRE(block.size() <= block_size);
+          encoded.insert(encoded.end(), block.begin(), block.end());
+          if (block.size() < block_size) break;
+     }
+
+     close(fd);
+     return encoded;
+}
+
+/**
+ * @brief Converts data in chunks of `chunk` bytes with `encode`/`decode`
+ * @param data Data to convert
+ * @param chunk Chunk size
+ * @param enc Encode (true) or decode (false)
+ * @return std::vector<char> converted data
+ */
+static std::vector<char> convert_chunked(const std::vector<char>& data,
+                                         size_t chunk, bool enc) {
+     std::vector<char> out;
+     std::vector<char> buf(NetASCII::max_encoded(chunk));
+     NetASCII::State state;
+     for (size_t i = 0; i < data.size(); i += chunk) {
+          std::span<const char> in(data.data() + i,
+                                   std::min(chunk, data.size() - i));
+          size_t len = enc ? NetASCII::encode(in, buf, state)
+                           : NetASCII::decode(in, buf, state);
+          out.insert(out.end(), buf.begin(), buf.begin() + len);
+     }
+     size_t len = enc ? NetASCII::encode_end(buf, state)
+                      : NetASCII::decode_end(buf, state);
+     out.insert(out.end(), buf.begin(), buf.begin() + len);
+     return out;
+}
+
+TEST_CASE("NetASCII Functionality", "[netascii]") {
+     SECTION("Conversion") {
+          std::vector<char> bin = {'a', '\n', 'b', '\r', 'c', '\r', '\n'};
+          std::vector<char> na = NetASCII::vec_to_na(bin);
+          REQUIRE(na
+                  == std::vector<char>{'a', '\r', '\n', 'b', '\r', '\0', 'c',
+                                       '\r', '\n'});
+          REQUIRE(NetASCII::na_to_vec(na)
+                  == std::vector<char>{'a', '\n', 'b', '\r', 'c', '\n'});
+          REQUIRE(NetASCII::na_to_str(NetASCII::str_to_na("abc")) == "abc");
+     }
+
+     SECTION("In-place decoding") {
+          std::vector<char> na = {'a', '\r', '\n', 'b', '\r', '\0',
+                                  'c', '\r', 'd',  '\r'};
+          std::vector<char> expected = NetASCII::na_to_vec(na);
+          size_t len = NetASCII::na_decode(na.data(), na.size());
+          REQUIRE(std::vector<char>(na.begin(), na.begin() + len) == expected);
+          REQUIRE(len == 8);
+     }
+
+     SECTION("Streaming encoder") {
+          /* Encoded stream must match whole-file conversion */
+          for (const std::string path :
+               {"test/files/abc.txt", "test/files/newlines.txt",
+                "test/files/long.txt", "test/files/aligned-lf.txt"}) {
+               int fd = open(path.c_str(), O_RDONLY);
+               REQUIRE(fd != -1);
+               std::vector<char> raw(4096);
+               raw.resize(read(fd, raw.data(), raw.size()));
+               close(fd);
+
+               std::vector<char> expected = NetASCII::vec_to_na(raw);
+               for (size_t block_size : {1, 3, 8, 512})
+                    REQUIRE(encode_file(path, block_size) == expected);
+          }
+     }
+
+     SECTION("Positional encoders sharing a descriptor") {
+          /* Interleaved blocks of two encoders must not mix up */
+          int fd = open("test/files/long.txt", O_RDONLY);
+          REQUIRE(fd != -1);
+          std::vector<char> raw(4096);
+          raw.resize(pread(fd, raw.data(), raw.size(), 0));
+          std::vector<char> expected = NetASCII::vec_to_na(raw);
+
+          NetASCII::Encoder first(fd, 0), second(fd, 0);
+          std::vector<char> out_first, out_second;
+          for (bool done = false; !done;) {
+               auto a = first.next_block(7);
+               auto b = second.next_block(5);
+               out_first.insert(out_first.end(), a.begin(), a.end());
+               out_second.insert(out_second.end(), b.begin(), b.end());
+               done = a.size() < 7 && b.size() < 5;
+          }
+          CHECK(out_first == expected);
+          CHECK(out_second == expected);
+          CHECK(lseek(fd, 0, SEEK_CUR) == 0);  // File offset untouched
+          close(fd);
+     }
+
+     SECTION("Streaming encoder block split") {
+          /* CR LF and CR NUL split over the block boundary */
+          char path[] = "/tmp/tftp-na-XXXXXX";
+          int fd = mkstemp(path);
+          REQUIRE(fd != -1);
+          REQUIRE(write(fd, "a\r\nb\rc\r", 7) == 7);
+          close(fd);
+
+          std::vector<char> expected
+              = {'a', '\r', '\n', 'b', '\r', '\0', 'c', '\r', '\0'};
+          REQUIRE(encode_file(path, 2) == expected);
+          REQUIRE(encode_file(path, 9) == expected);
+          unlink(path);
+     }
+
+     SECTION("Chunked conversion") {
+          /* Every split point of every CR/LF/NUL sequence */
+          std::vector<char> bin = {'a', '\r', '\n', '\r', '\r', 'b',  '\n',
+                                   '\n', '\r', '\0', 'c', '\r'};
+          std::vector<char> na = {'a', '\r', '\n', '\r', '\0', 'b', '\r',
+                                  '\r', '\n', '\r', 'c',  '\r', '\0', '\r'};
+          for (size_t chunk = 1; chunk <= bin.size(); chunk++) {
+               REQUIRE(convert_chunked(bin, chunk, true)
+                       == NetASCII::vec_to_na(bin));
+               REQUIRE(convert_chunked(na, chunk, false)
+                       == NetASCII::na_to_vec(na));
+          }
+     }
+
+     SECTION("Output buffer size") {
+          std::vector<char> in(8, '\n');
+          std::vector<char> out(NetASCII::max_encoded(8) - 1);
+          NetASCII::State state;
+          REQUIRE_THROWS_AS(NetASCII::encode(in, out, state),
+                            std::length_error);
+          REQUIRE_THROWS_AS(NetASCII::decode(in, std::span<char>(out).first(8),
+                                             state),
+                            std::length_error);
+     }
+
+     SECTION("Scanning kernels") {
+          /* Every supported kernel must match the scalar one */
+          const auto best = NetASCII::get_kernel();
+          std::mt19937 rng(42);
+          std::vector<char> data(1000);
+          for (auto kernel :
+               {NetASCII::Kernel::Scalar, NetASCII::Kernel::SSE2,
+                NetASCII::Kernel::AVX2, NetASCII::Kernel::NEON}) {
+               if (!NetASCII::set_kernel(kernel)) continue;
+               for (int round = 0; round < 200; round++) {
+                    for (auto& c : data) c = 'a' + rng() % 26;
+                    size_t len = rng() % data.size();
+                    size_t pos = rng() % (len + 1);
+                    if (pos < len) data[pos] = (rng() % 2) ? '\r' : '\n';
+
+                    size_t expected = len;
+                    for (size_t i = 0; i < len; i++)
+                         if (data[i] == '\r' || data[i] == '\n') {
+                              expected = i;
+                              break;
+                         }
+                    REQUIRE(NetASCII::scan(data.data(), len, '\r', '\n')
+                            == expected);
+               }
+
+               /* Conversions stay the same */
+               std::vector<char> bin = {'a', '\n', 'b', '\r', 'c', '\r', '\n'};
+               REQUIRE(NetASCII::na_to_vec(NetASCII::vec_to_na(bin))
+                       == std::vector<char>{'a', '\n', 'b', '\r', 'c', '\n'});
+          }
+
+          NetASCII::set_kernel(best);
+     }
+}
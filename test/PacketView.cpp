@@ -0,0 +1,106 @@
+/**
+ * @file test/PacketView.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief PacketView (non-owning received packet) unit tests
+ * @date 2023-11-18
+ */
+
+#include "packet/PacketView.hpp"
+
+#include "catch_amalgamated.hpp"
+#include "packet/PacketFactory.hpp"
+
+TEST_CASE("Packet View Functionality", "[packet_view]") {
+     SECTION("DATA view") {
+          std::vector<char> payload = {'h', 'e', 'l', 'l', 'o'};
+          DataPacket dp(payload, 258);
+          dp.set_no_seek(true);  // `payload` is the block itself
+          std::vector<char> binary = dp.to_binary();
+
+          auto view = PacketView::parse(binary);
+          REQUIRE(view.has_value());
+          REQUIRE(view->get_opcode() == TFTPOpcode::DATA);
+          REQUIRE(view->get<AckView>() == nullptr);
+
+          const auto* data = view->get<DataView>();
+          REQUIRE(data != nullptr);
+          REQUIRE(data->block_n == 258);
+          REQUIRE(std::vector<char>(data->data.begin(), data->data.end())
+                  == payload);
+          REQUIRE(data->data.data() == binary.data() + 4);  // No copy
+
+          /* Empty (final) block */
+          binary = {0x00, 0x03, 0x00, 0x07};
+          view = PacketView::parse(binary);
+          REQUIRE(view.has_value());
+          REQUIRE(view->get<DataView>()->data.empty());
+     }
+
+     SECTION("ACK view") {
+          std::vector<char> binary = AcknowledgementPacket(65535).to_binary();
+
+          auto view = PacketView::parse(binary);
+          REQUIRE(view.has_value());
+          REQUIRE(view->get_opcode() == TFTPOpcode::ACK);
+          REQUIRE(view->get<AckView>()->block_n == 65535);
+
+          binary.push_back(0);  // ACK has a fixed size
+          REQUIRE_FALSE(PacketView::parse(binary).has_value());
+     }
+
+     SECTION("ERROR view") {
+          std::vector<char> binary
+              = ErrorPacket(TFTPErrorCode::FileNotFound, "No such file")
+                    .to_binary();
+
+          auto view = PacketView::parse(binary);
+          REQUIRE(view.has_value());
+          const auto* err = view->get<ErrorView>();
+          REQUIRE(err != nullptr);
+          REQUIRE(err->errcode == TFTPErrorCode::FileNotFound);
+          REQUIRE(err->message == "No such file");
+
+          binary = ErrorPacket(TFTPErrorCode::DiskFull).to_binary();
+          view = PacketView::parse(binary);
+          REQUIRE(view.has_value());
+          REQUIRE(view->get<ErrorView>()->message.empty());
+
+          binary = {0x00, 0x05, 0x00, 0x63, 0x00};  // Unknown error code
+          REQUIRE_FALSE(PacketView::parse(binary).has_value());
+     }
+
+     SECTION("OACK view") {
+          std::vector<std::pair<std::string, std::string>> opts
+              = {{"blksize", "1432"}, {"windowsize", "16"}};
+          std::vector<char> binary = OptionAckPacket(opts).to_binary();
+
+          auto view = PacketView::parse(binary);
+          REQUIRE(view.has_value());
+          const auto* oack = view->get<OackView>();
+          REQUIRE(oack != nullptr);
+          REQUIRE(oack->get_options() == opts);
+
+          binary.pop_back();  // Unterminated option value
+          REQUIRE_FALSE(PacketView::parse(binary).has_value());
+     }
+
+     SECTION("Requests and invalid packets") {
+          std::vector<char> binary
+              = RequestPacket(TFTPRequestType::Write, "file.txt",
+                              TFTPDataFormat::Octet)
+                    .to_binary();
+
+          auto view = PacketView::parse(binary);
+          REQUIRE(view.has_value());
+          REQUIRE(view->get_opcode() == TFTPOpcode::WRQ);
+          REQUIRE(view->get<DataView>() == nullptr);
+
+          REQUIRE_FALSE(PacketView::parse(std::vector<char>{}).has_value());
+          REQUIRE_FALSE(
+              PacketView::parse(std::vector<char>{0x00, 0x03, 0x00})
+                  .has_value());
+          REQUIRE_FALSE(
+              PacketView::parse(std::vector<char>{0x00, 0x09, 0x00, 0x00})
+                  .has_value());
+     }
+}
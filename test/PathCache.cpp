@@ -0,0 +1,124 @@
+/**
+ * @file test/PathCache.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Path cache unit tests
+ * @date 2023-11-25
+ */
+
+#include "util/pathcache.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <string>
+
+#include "catch_amalgamated.hpp"
+
+/**
+ * @brief Temporary directory removed (with its files) at the end of scope
+ */
+struct TempDir {
+     std::string path;
+
+     TempDir() {
+          char tmpl[] = "/tmp/tftp-pathcache-XXXXXX";
+          REQUIRE(mkdtemp(tmpl) != nullptr);
+          this->path = tmpl;
+     }
+     ~TempDir() {
+          for (const char* name : {"a", "b", "c"})
+               unlink((this->path + "/" + name).c_str());
+          rmdir(this->path.c_str());
+     }
+
+     /**
+      * @brief Writes a file in the directory
+      */
+     void write(const std::string& name, const std::string& data) const {
+          int fd = open((this->path + "/" + name).c_str(),
+                        O_WRONLY | O_CREAT | O_TRUNC, 0644);
+          REQUIRE(fd != -1);
+          REQUIRE(::write(fd, data.data(), data.size())
+                  == static_cast<ssize_t>(data.size()));
+          close(fd);
+     }
+};
+
+TEST_CASE("Path Cache Functionality", "[pathcache]") {
+     TempDir dir;
+     PathCache cache(16);
+     std::string a = dir.path + "/a";
+
+     SECTION("Hits share the descriptor") {
+          dir.write("a", "hello");
+          auto first = cache.open(a);
+          REQUIRE(first.file);
+          CHECK(first.file->st.st_size == 5);
+
+          auto second = cache.open(a);
+          CHECK(second.file == first.file);
+
+          char buf[8];
+          CHECK(pread(second.file->fd, buf, sizeof(buf), 0) == 5);
+          CHECK(cache.get_stats().hits == 1);
+          CHECK(cache.get_stats().misses == 1);
+     }
+
+     SECTION("Missing files are cached until created") {
+          auto missing = cache.open(a);
+          CHECK_FALSE(missing.file);
+          CHECK(missing.err == ENOENT);
+          CHECK(cache.open(a).err == ENOENT);
+          CHECK(cache.get_stats().hits == 1);
+
+          dir.write("a", "now");
+          auto created = cache.open(a);
+          REQUIRE(created.file);
+          CHECK(created.file->st.st_size == 3);
+     }
+
+     SECTION("Changes invalidate entries") {
+          dir.write("a", "old");
+          dir.write("b", "other");
+          auto old = cache.open(a);
+          auto other = cache.open(dir.path + "/b");
+          REQUIRE(old.file);
+
+          dir.write("a", "longer");
+          auto fresh = cache.open(a);
+          REQUIRE(fresh.file);
+          CHECK(fresh.file != old.file);
+          CHECK(fresh.file->st.st_size == 6);
+          CHECK(cache.open(dir.path + "/b").file == other.file);  // Kept
+
+          /* Replaced by a rename */
+          dir.write("c", "renamed");
+          REQUIRE(rename((dir.path + "/c").c_str(), a.c_str()) == 0);
+          auto renamed = cache.open(a);
+          REQUIRE(renamed.file);
+          CHECK(renamed.file->st.st_size == 7);
+
+          /* Removed */
+          REQUIRE(unlink(a.c_str()) == 0);
+          CHECK(cache.open(a).err == ENOENT);
+          CHECK(cache.get_stats().invalidations >= 3);
+     }
+
+     SECTION("Size is bounded") {
+          PathCache small(2);
+          for (const char* name : {"a", "b", "c"}) {
+               dir.write(name, name);
+               REQUIRE(small.open(dir.path + "/" + name).file);
+          }
+          CHECK(small.get_stats().entries == 2);
+     }
+
+     SECTION("Paths in unwatchable directories are not cached") {
+          std::string deep = dir.path + "/none/a";
+          CHECK(cache.open(deep).err == ENOENT);
+          CHECK(cache.open(deep).err == ENOENT);
+          CHECK(cache.get_stats().misses == 2);
+          CHECK(cache.get_stats().entries == 0);
+     }
+}
@@ -0,0 +1,82 @@
+/**
+ * @file test/PeerTable.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief PeerTable unit tests
+ * @date 2023-11-23
+ */
+
+#include "util/peertable.hpp"
+
+#include <arpa/inet.h>
+
+#include <random>
+#include <unordered_map>
+
+#include "catch_amalgamated.hpp"
+
+/**
+ * @brief Makes a peer address
+ */
+static sockaddr_in peer(uint32_t addr, uint16_t port) {
+     sockaddr_in sa{};
+     sa.sin_family = AF_INET;
+     sa.sin_addr.s_addr = htonl(addr);
+     sa.sin_port = htons(port);
+     return sa;
+}
+
+TEST_CASE("Peer Table Functionality", "[peertable]") {
+     PeerTable table;
+
+     SECTION("Insert, find and erase") {
+          REQUIRE(table.find(peer(0x7f000001, 1000)) == -1);
+          REQUIRE(table.insert(peer(0x7f000001, 1000), 7));
+          REQUIRE_FALSE(table.insert(peer(0x7f000001, 1000), 8));
+          REQUIRE(table.insert(peer(0x7f000001, 1001), 9));
+          REQUIRE(table.insert(peer(0x7f000002, 1000), 0));
+
+          CHECK(table.find(peer(0x7f000001, 1000)) == 7);
+          CHECK(table.find(peer(0x7f000001, 1001)) == 9);
+          CHECK(table.find(peer(0x7f000002, 1000)) == 0);
+          CHECK(table.size() == 3);
+
+          table.erase(peer(0x7f000001, 1000));
+          table.erase(peer(0x7f000003, 1000));  // Not in the table
+          CHECK(table.find(peer(0x7f000001, 1000)) == -1);
+          CHECK(table.find(peer(0x7f000001, 1001)) == 9);
+          CHECK(table.size() == 2);
+     }
+
+     SECTION("Matches std::unordered_map under churn") {
+          std::unordered_map<uint64_t, int> model;
+          std::mt19937 rng(42);
+          std::uniform_int_distribution<uint32_t> addr(0, 63);
+          std::uniform_int_distribution<uint32_t> port(0, 63);
+
+          for (int i = 0; i < 20000; i++) {
+               auto sa = peer(0x0a000000 + addr(rng), 1024 + port(rng));
+               uint64_t key = uint64_t{sa.sin_addr.s_addr} << 16 | sa.sin_port;
+               if (rng() % 3 == 0) {
+                    table.erase(sa);
+                    model.erase(key);
+               } else {
+                    bool added = table.insert(sa, i);
+                    REQUIRE(added == model.emplace(key, i).second);
+               }
+
+               auto it = model.find(key);
+               REQUIRE(table.find(sa) == (it == model.end() ? -1 : it->second));
+          }
+
+          REQUIRE(table.size() == model.size());
+          for (uint32_t a = 0; a < 64; a++) {
+               for (uint32_t p = 0; p < 64; p++) {
+                    auto sa = peer(0x0a000000 + a, 1024 + p);
+                    auto it = model.find(uint64_t{sa.sin_addr.s_addr} << 16
+                                         | sa.sin_port);
+                    CHECK(table.find(sa)
+                          == (it == model.end() ? -1 : it->second));
+               }
+          }
+     }
+}
@@ -0,0 +1,86 @@
+/**
+ * @file test/ReadAhead.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Read-ahead buffer unit tests
+ * @date 2023-11-21
+ */
+
+#include "util/readahead.hpp"
+
+#include <unistd.h>
+
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+
+/**
+ * @brief Writes data into a pipe in pieces of random sizes
+ */
+static void write_pieces(int fd, const std::vector<char>& data) {
+     std::mt19937 rng(3);
+     size_t off = 0;
+     while (off < data.size()) {
+          size_t len = std::min<size_t>(rng() % 700 + 1, data.size() - off);
+          ssize_t n = write(fd, data.data() + off, len);
+          if (n <= 0) break;
+          off += n;
+     }
+     close(fd);
+}
+
+/**
+ * @brief Reads all blocks, releasing those older than `window` blocks
+ */
+static std::vector<char> read_all(ReadAhead& ra, size_t block,
+                                  size_t window) {
+     std::vector<char> out;
+     std::vector<size_t> lens;
+     while (true) {
+          auto part = ra.next();
+          out.insert(out.end(), part.begin(), part.end());
+          lens.push_back(part.size());
+          if (lens.size() > window) ra.release(lens[lens.size() - 1 - window]);
+          if (part.size() < block) break;
+     }
+     return out;
+}
+
+TEST_CASE("Read Ahead Functionality", "[readahead]") {
+     int fds[2];
+     REQUIRE(pipe(fds) == 0);
+
+     SECTION("Blocks in order, across chunks") {
+          /* Not a multiple of the block size */
+          std::vector<char> data(54321);
+          std::mt19937 rng(5);
+          for (auto& c : data) c = static_cast<char>(rng());
+          std::thread writer(write_pieces, fds[1], std::cref(data));
+
+          ReadAhead ra(fds[0], 100, 1050, 4);  // Chunks of 1000 bytes
+          CHECK(read_all(ra, 100, 8) == data);
+          CHECK(ra.next().empty());
+          writer.join();
+     }
+
+     SECTION("End of the stream on a chunk boundary") {
+          std::vector<char> data(3000, 'x');
+          std::thread writer(write_pieces, fds[1], std::cref(data));
+
+          ReadAhead ra(fds[0], 100, 1000, 3);
+          auto out = read_all(ra, 100, 4);
+          CHECK(out == data);
+          writer.join();
+     }
+
+     SECTION("Waits are cancelled") {
+          std::atomic<bool> cancel(true);
+          ReadAhead ra(fds[0], 100, 1000, 2, &cancel);
+          CHECK_THROWS_AS(ra.next(), std::runtime_error);
+          close(fds[1]);
+     }
+
+     close(fds[0]);
+}
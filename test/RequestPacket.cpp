@@ -152,7 +152,7 @@ TEST_CASE("Request Packet Functionality", "[packet_rrq]") {
           offset = RequestPacket::findcstr(binary, offset, opt_val);
           REQUIRE(opt_val == "matata");
 
-          REQUIRE(binary[offset] == 0x00);  // Terminator
+          REQUIRE(binary[offset - 1] == 0x00);  // Terminator
 
           // Binary -> Packet
           RequestPacket rp2 = RequestPacket::from_binary(binary);
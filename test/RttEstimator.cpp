@@ -0,0 +1,59 @@
+/**
+ * @file test/RttEstimator.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief RttEstimator unit tests
+ * @date 2023-11-18
+ */
+
+#include "util/rttestimator.hpp"
+
+#include "catch_amalgamated.hpp"
+
+using namespace std::chrono_literals;
+
+TEST_CASE("RTT Estimator Functionality", "[rttestimator]") {
+     RttEstimator rtt;
+
+     SECTION("Initial state") {
+          REQUIRE(rtt.get_rto() == std::chrono::milliseconds(TFTP_INIT_RTO_MS));
+          REQUIRE_FALSE(rtt.get_srtt().has_value());
+          REQUIRE_FALSE(rtt.is_fixed());
+     }
+
+     SECTION("Samples") {
+          rtt.sample(400ms);
+          REQUIRE(rtt.get_srtt() == 400ms);
+          REQUIRE(rtt.get_rto() == 1200ms);  // 400 + 4 * 200
+
+          rtt.sample(800ms);  // RTTVAR = (3 * 200 + 400) / 4 = 250
+          REQUIRE(rtt.get_srtt() == 450ms);
+          REQUIRE(rtt.get_rto() == 1450ms);
+     }
+
+     SECTION("Clamping") {
+          rtt.sample(10us);
+          REQUIRE(rtt.get_rto() == std::chrono::milliseconds(TFTP_MIN_RTO_MS));
+
+          for (int i = 0; i < 32; i++) rtt.backoff();
+          REQUIRE(rtt.get_rto() == std::chrono::milliseconds(TFTP_MAX_RTO_MS));
+     }
+
+     SECTION("Backoff and recovery") {
+          rtt.sample(400ms);
+          rtt.backoff();
+          REQUIRE(rtt.get_rto() == 2400ms);
+          rtt.backoff();
+          REQUIRE(rtt.get_rto() == 4800ms);
+
+          rtt.sample(400ms);  // New sample discards backoff
+          REQUIRE(rtt.get_rto() < 2400ms);
+     }
+
+     SECTION("Fixed timeout") {
+          rtt.set_fixed(5s);
+          rtt.sample(10ms);
+          rtt.backoff();
+          REQUIRE(rtt.is_fixed());
+          REQUIRE(rtt.get_rto() == 5s);
+     }
+}
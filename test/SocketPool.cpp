@@ -0,0 +1,122 @@
+/**
+ * @file test/SocketPool.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Connection socket pool unit tests
+ * @date 2023-11-22
+ */
+
+#include "util/socketpool.hpp"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "catch_amalgamated.hpp"
+
+/**
+ * @brief Sends a datagram to a local port
+ */
+static void send_to(uint16_t port) {
+     int fd = socket(AF_INET, SOCK_DGRAM, 0);
+     REQUIRE(fd != -1);
+     struct sockaddr_in addr {};
+     addr.sin_family = AF_INET;
+     addr.sin_port = htons(port);
+     addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+     REQUIRE(sendto(fd, "late", 4, 0,
+                    reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr))
+             == 4);
+     close(fd);
+}
+
+TEST_CASE("Socket Pool Functionality", "[socketpool]") {
+     SocketPool pool(2);
+
+     SECTION("Sockets are bound and non-blocking") {
+          pool.fill();
+          CHECK(pool.get_idle() == 2);
+
+          auto sock = pool.acquire();
+          CHECK(pool.get_idle() == 1);
+          REQUIRE(sock.fd != -1);
+          CHECK(sock.port != 0);
+          CHECK(fcntl(sock.fd, F_GETFL) & O_NONBLOCK);
+          pool.release(sock);
+     }
+
+     SECTION("Released sockets are reset and reused last") {
+          auto first = pool.acquire();
+          auto second = pool.acquire();
+          send_to(first.port);
+          send_to(first.port);
+          usleep(10000);
+
+          pool.release(first);
+          pool.release(second);
+          auto again = pool.acquire();
+          CHECK(again.fd == first.fd);
+
+          char buf[8];
+          CHECK(recv(again.fd, buf, sizeof(buf), 0) == -1);
+          CHECK(errno == EAGAIN);
+          pool.release(again);
+     }
+
+     SECTION("Released sockets get the options of a new one back") {
+          auto fresh = SocketPool::open_socket();
+          int pmtu_dflt = -1;
+          socklen_t len = sizeof(pmtu_dflt);
+          REQUIRE(getsockopt(fresh.fd, IPPROTO_IP, IP_MTU_DISCOVER,
+                             &pmtu_dflt, &len)
+                  == 0);
+          int rcvbuf_dflt = -1;
+          len = sizeof(rcvbuf_dflt);
+          REQUIRE(getsockopt(fresh.fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf_dflt,
+                             &len)
+                  == 0);
+          close(fresh.fd);
+
+          auto sock = pool.acquire();
+          int on = 1, pmtu = IP_PMTUDISC_DO;
+          REQUIRE(setsockopt(sock.fd, IPPROTO_UDP, UDP_GRO, &on, sizeof(on))
+                  == 0);
+          REQUIRE(setsockopt(sock.fd, IPPROTO_IP, IP_MTU_DISCOVER, &pmtu,
+                             sizeof(pmtu))
+                  == 0);
+          int rcvbuf = rcvbuf_dflt * 2;
+          REQUIRE(setsockopt(sock.fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf,
+                             sizeof(rcvbuf))
+                  == 0);
+          pool.release(sock);
+
+          auto again = pool.acquire();
+          REQUIRE(again.fd == sock.fd);
+          int gro = -1;
+          len = sizeof(gro);
+          REQUIRE(getsockopt(again.fd, IPPROTO_UDP, UDP_GRO, &gro, &len)
+                  == 0);
+          CHECK(gro == 0);
+          len = sizeof(pmtu);
+          REQUIRE(getsockopt(again.fd, IPPROTO_IP, IP_MTU_DISCOVER, &pmtu,
+                             &len)
+                  == 0);
+          CHECK(pmtu == pmtu_dflt);
+          len = sizeof(rcvbuf);
+          REQUIRE(getsockopt(again.fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, &len)
+                  == 0);
+          CHECK(rcvbuf == rcvbuf_dflt);
+          pool.release(again);
+     }
+
+     SECTION("Sockets over the capacity are closed") {
+          auto a = pool.acquire(), b = pool.acquire(), c = pool.acquire();
+          pool.release(a);
+          pool.release(b);
+          pool.release(c);
+          CHECK(pool.get_idle() == 2);
+          CHECK(fcntl(c.fd, F_GETFD) == -1);
+     }
+}
@@ -0,0 +1,77 @@
+/**
+ * @file test/Task.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Task (coroutine) unit tests
+ * @date 2023-11-24
+ */
+
+#include "util/task.hpp"
+
+#include <stdexcept>
+
+#include "catch_amalgamated.hpp"
+
+/**
+ * @brief Counts up to `n`, suspending after every step
+ */
+static Task count_to(int& counter, int n) {
+     while (counter < n) {
+          counter++;
+          co_await std::suspend_always{};
+     }
+}
+
+/**
+ * @brief Throws after one suspension
+ */
+static Task fail_later() {
+     co_await std::suspend_always{};
+     throw std::runtime_error("failed");
+}
+
+TEST_CASE("Task Functionality", "[task]") {
+     SECTION("Empty task") {
+          Task task;
+          CHECK_FALSE(task.valid());
+          CHECK(task.done());
+          task.resume();  // No-op
+     }
+
+     SECTION("Starts suspended, runs step by step") {
+          int counter = 0;
+          Task task = count_to(counter, 3);
+          REQUIRE(task.valid());
+          CHECK(counter == 0);
+
+          for (int i = 1; i <= 3; i++) {
+               task.resume();
+               CHECK(counter == i);
+               CHECK_FALSE(task.done());
+          }
+
+          task.resume();  // Returns after the last suspension
+          CHECK(task.done());
+          task.resume();  // Finished => no-op
+          CHECK(counter == 3);
+     }
+
+     SECTION("Exceptions are rethrown by resume") {
+          Task task = fail_later();
+          task.resume();
+          CHECK_THROWS_AS(task.resume(), std::runtime_error);
+          CHECK(task.done());
+     }
+
+     SECTION("Move transfers the coroutine") {
+          int counter = 0;
+          Task task = count_to(counter, 2);
+          Task moved = std::move(task);
+          CHECK_FALSE(task.valid());
+          moved.resume();
+          CHECK(counter == 1);
+
+          moved = count_to(counter, 5);  // Destroys the suspended one
+          moved.resume();
+          CHECK(counter == 2);
+     }
+}
@@ -0,0 +1,73 @@
+/**
+ * @file test/TimerQueue.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief TimerQueue unit tests
+ * @date 2023-11-18
+ */
+
+#include "util/timerqueue.hpp"
+
+#include "catch_amalgamated.hpp"
+
+using namespace std::chrono_literals;
+
+TEST_CASE("Timer Queue Functionality", "[timerqueue]") {
+     TimerQueue tq;
+     auto now = TimerQueue::Clock::now();
+     int a = 1, b = 2, c = 3;
+     std::vector<TimerQueue::Expired> out;
+
+     SECTION("Empty queue") {
+          REQUIRE(tq.size() == 0);
+          REQUIRE_FALSE(tq.next_deadline().has_value());
+          REQUIRE(tq.timeout_ms(now, -1) == -1);
+          REQUIRE(tq.timeout_ms(now, 1000) == 1000);
+          tq.expire(now + 1h, out);
+          REQUIRE(out.empty());
+     }
+
+     SECTION("Expiry in deadline order") {
+          tq.arm(5, &a, now + 30ms);
+          tq.arm(6, &b, now + 10ms);
+          tq.arm(7, &c, now + 20ms);
+          REQUIRE(tq.size() == 3);
+          REQUIRE(tq.next_deadline() == now + 10ms);
+
+          tq.expire(now + 5ms, out);
+          REQUIRE(out.empty());
+
+          tq.expire(now + 20ms, out);
+          REQUIRE(out.size() == 2);
+          REQUIRE(out[0].fd == 6);
+          REQUIRE(out[0].data == &b);
+          REQUIRE(out[1].fd == 7);
+          REQUIRE(out[1].data == &c);
+          REQUIRE(tq.size() == 1);
+          REQUIRE_FALSE(tq.is_armed(6));
+          REQUIRE(tq.is_armed(5));
+     }
+
+     SECTION("Re-arm and cancel") {
+          tq.arm(5, &a, now + 10ms);
+          tq.arm(5, &a, now + 50ms);  // Re-arm => old entry stale
+          tq.arm(6, &b, now + 20ms);
+          tq.cancel(6);
+          tq.cancel(6);  // No-op
+          REQUIRE(tq.size() == 1);
+          REQUIRE(tq.next_deadline() == now + 50ms);
+
+          tq.expire(now + 40ms, out);
+          REQUIRE(out.empty());
+          tq.expire(now + 50ms, out);
+          REQUIRE(out.size() == 1);
+          REQUIRE(out[0].fd == 5);
+          REQUIRE(tq.size() == 0);
+     }
+
+     SECTION("Timeout computation") {
+          tq.arm(3, &a, now + 1500us);
+          REQUIRE(tq.timeout_ms(now, -1) == 2);  // Rounded up
+          REQUIRE(tq.timeout_ms(now, 1) == 1);   // Capped
+          REQUIRE(tq.timeout_ms(now + 2ms, -1) == 0);
+     }
+}
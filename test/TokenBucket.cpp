@@ -0,0 +1,66 @@
+/**
+ * @file test/TokenBucket.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief TokenBucket unit tests
+ * @date 2023-11-25
+ */
+
+#include "util/tokenbucket.hpp"
+
+#include <cmath>
+
+#include "catch_amalgamated.hpp"
+
+using namespace std::chrono_literals;
+
+TEST_CASE("Token Bucket Functionality", "[tokenbucket]") {
+     auto now = TokenBucket::Clock::now();
+
+     SECTION("Unlimited bucket") {
+          TokenBucket bucket;
+          REQUIRE_FALSE(bucket.is_limited());
+          REQUIRE(std::isinf(bucket.available(now)));
+          bucket.consume(1e9);
+          REQUIRE(std::isinf(bucket.available(now)));
+     }
+
+     SECTION("Starts full, refills up to the burst") {
+          TokenBucket bucket(1000, 500);  // 1 byte per ms
+          REQUIRE(bucket.available(now) == 500);
+
+          bucket.consume(400);
+          REQUIRE(bucket.available(now) == 100);
+          REQUIRE(bucket.available(now + 100ms) == 200);
+          REQUIRE(bucket.available(now + 10s) == 500);
+     }
+
+     SECTION("Overdraft delays the next send") {
+          TokenBucket bucket(1000, 500);
+          REQUIRE(bucket.available(now) == 500);
+          bucket.consume(700);
+          REQUIRE(bucket.available(now) == -200);
+          REQUIRE(bucket.ready_at(0) == now + 200ms);
+          REQUIRE(bucket.ready_at(100) == now + 300ms);
+          REQUIRE(bucket.ready_at(1e6) == now + 700ms);  // Capped burst
+          REQUIRE(std::abs(bucket.available(now + 200ms)) < 1e-6);
+     }
+
+     SECTION("Time going back does not refill") {
+          TokenBucket bucket(1000, 500);
+          REQUIRE(bucket.available(now + 1s) == 500);
+          bucket.consume(500);
+          REQUIRE(bucket.available(now) == 0);
+          REQUIRE(bucket.available(now + 1s + 50ms) == 50);
+     }
+
+     SECTION("Rate changes keep the tokens") {
+          TokenBucket bucket(1000, 500);
+          REQUIRE(bucket.available(now) == 500);
+          bucket.consume(300);
+          bucket.set_rate(2000, 100);  // Capped to the new burst
+          REQUIRE(bucket.get_rate() == 2000);
+          REQUIRE(bucket.available(now) == 100);
+          bucket.consume(100);
+          REQUIRE(bucket.available(now + 25ms) == 50);
+     }
+}
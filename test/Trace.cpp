@@ -0,0 +1,79 @@
+/**
+ * @file test/Trace.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Connection tracer unit tests
+ * @date 2023-11-25
+ */
+
+#include "util/trace.hpp"
+
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include "catch_amalgamated.hpp"
+
+/**
+ * @brief Writes the trace and reads it back
+ */
+static std::string written() {
+     std::string path = "/tmp/tftp_trace_test_"
+                        + std::to_string(getpid()) + ".json";
+     REQUIRE(Trace::write(path));
+     std::ifstream in(path);
+     std::stringstream ss;
+     ss << in.rdbuf();
+     unlink(path.c_str());
+     return ss.str();
+}
+
+TEST_CASE("Trace Functionality", "[trace]") {
+     SECTION("Nothing is recorded while stopped") {
+          Trace::stop();
+          CHECK_FALSE(Trace::enabled());
+          {
+               TraceSpan span("test", "trace_stopped_span", 1);
+          }
+          CHECK(written().find("trace_stopped_span") == std::string::npos);
+     }
+
+     SECTION("Spans are written as complete events") {
+          Trace::start();
+          REQUIRE(Trace::enabled());
+          {
+               TraceSpan span("test", "trace_bytes_span", 42);
+               span.set_bytes(512);
+          }
+          std::thread([] {
+               TraceSpan span("test", "trace_thread_span", 43);
+          }).join();
+          Trace::stop();
+
+          std::string json = written();
+          CHECK(json.rfind("{\"traceEvents\": [", 0) == 0);
+          CHECK(json.find("\"name\": \"trace_bytes_span\", \"cat\": \"test\", "
+                          "\"ph\": \"X\"")
+                != std::string::npos);
+          CHECK(json.find("\"tid\": 42, \"args\": {\"bytes\": 512}")
+                != std::string::npos);
+          CHECK(json.find("trace_thread_span") != std::string::npos);
+          CHECK(json.find("\"process_name\"") != std::string::npos);
+          CHECK(json.find("\"dropped\": 0") != std::string::npos);
+     }
+
+     SECTION("Spans begun before the start are cut at it") {
+          auto before = Trace::Clock::now() - std::chrono::hours(1);
+          Trace::start();
+          Trace::span("test", "trace_cut_span", 7, before);
+          Trace::stop();
+
+          std::string json = written();
+          size_t at = json.find("trace_cut_span");
+          REQUIRE(at != std::string::npos);
+          size_t dur = json.find("\"dur\": ", at);
+          REQUIRE(dur != std::string::npos);
+          CHECK(std::stod(json.substr(dur + 7)) < 3.6e9 / 2);
+     }
+}
@@ -0,0 +1,103 @@
+/**
+ * @file test/WriteBehind.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Write-behind buffer unit tests
+ * @date 2023-11-20
+ */
+
+#include "util/writebehind.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "catch_amalgamated.hpp"
+
+/**
+ * @brief Reads the whole file back
+ */
+static std::vector<char> read_file(int fd) {
+     std::vector<char> data(lseek(fd, 0, SEEK_END));
+     REQUIRE(pread(fd, data.data(), data.size(), 0)
+             == static_cast<ssize_t>(data.size()));
+     return data;
+}
+
+/**
+ * @brief Appends random data in blocks of random sizes
+ */
+static std::vector<char> append_random(WriteBehind& wb, size_t size) {
+     std::mt19937 rng(7);
+     std::vector<char> data(size);
+     for (auto& c : data) c = static_cast<char>(rng());
+
+     size_t off = 0;
+     while (off < size) {
+          size_t len = std::min<size_t>(rng() % 1500, size - off);
+          REQUIRE(wb.append(data.data() + off, len) == 0);
+          off += len;
+     }
+     return data;
+}
+
+TEST_CASE("Write Behind Functionality", "[writebehind]") {
+     char tmpl[] = "/tmp/tftp-writebehind-XXXXXX";
+     int fd = mkstemp(tmpl);
+     REQUIRE(fd != -1);
+
+     SECTION("Synchronous coalesced writes") {
+          WriteBehind wb(fd, nullptr, 4096, 1);
+          auto data = append_random(wb, 100000);
+          REQUIRE(wb.finish() == 0);
+          CHECK(read_file(fd) == data);
+     }
+
+     SECTION("Background writes") {
+          DiskWriter writer;
+          WriteBehind wb(fd, &writer, 4096, 3);
+          auto data = append_random(wb, 100000);
+          REQUIRE(wb.finish() == 0);
+          CHECK(read_file(fd) == data);
+
+          /* Nothing more to write */
+          CHECK(wb.finish() == 0);
+          CHECK(read_file(fd) == data);
+     }
+
+     SECTION("Writes from a start offset") {
+          std::vector<char> head(5000, 'h');
+          REQUIRE(pwrite(fd, head.data(), head.size(), 0)
+                  == static_cast<ssize_t>(head.size()));
+
+          DiskWriter writer;
+          WriteBehind wb(fd, &writer, 4096, 2, 3000);
+          auto data = append_random(wb, 20000);
+          REQUIRE(wb.finish() == 0);
+
+          auto file = read_file(fd);
+          REQUIRE(file.size() == 3000 + data.size());
+          CHECK(std::equal(head.begin(), head.begin() + 3000, file.begin()));
+          CHECK(std::equal(data.begin(), data.end(), file.begin() + 3000));
+     }
+
+     SECTION("Failed writes are reported") {
+          int full = open("/dev/full", O_WRONLY);
+          REQUIRE(full != -1);
+          DiskWriter writer;
+          WriteBehind wb(full, &writer, 16, 2);
+
+          /* Buffered only => no error yet */
+          CHECK(wb.append("short", 5) == 0);
+          CHECK(wb.finish() == ENOSPC);
+          CHECK(wb.append("more data, even more data", 25) == ENOSPC);
+          close(full);
+     }
+
+     close(fd);
+     unlink(tmpl);
+}
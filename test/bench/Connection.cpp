@@ -0,0 +1,81 @@
+/**
+ * @file test/bench/Connection.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Connection option processing microbenchmarks
+ * @date 2023-11-19
+ */
+
+#include "util/connection.hpp"
+#include "util/socketpool.hpp"
+
+#include "allocs.hpp"
+#include "catch_amalgamated.hpp"
+
+/**
+ * @brief Bare connection exposing `proc_opts` (no socket, no file)
+ */
+class BenchConnection : public TFTPConnectionBase {
+   public:
+     using TFTPConnectionBase::proc_opts;
+
+   protected:
+     void handle_request_upload() override {}
+     void handle_request_download() override {}
+     bool should_shutd() override { return false; }
+     size_t next_data(std::span<char> payload) override {
+          (void)payload;
+          return 0;
+     }
+};
+
+/* Allocation budgets (per op) – raise only with a reason in review */
+static const double PROC_OPTS_ALLOCS = 3;
+static const double POOLED_SETUP_ALLOCS = 0;
+
+TEST_CASE("TFTPConnectionBase::proc_opts", "[microbench][connection]") {
+     const std::vector<std::pair<std::string, std::string>> opts
+         = {{"blksize", "1468"},
+            {"windowsize", "16"},
+            {"timeout", "3"},
+            {"tsize", "104857600"}};
+     BenchConnection conn;
+
+     /* Allocations per op */
+     double allocs = allocs_per_op([&] { conn.proc_opts(opts); });
+     report_allocs("proc_opts (4 options)", allocs);
+     CHECK(allocs <= PROC_OPTS_ALLOCS);
+
+     /* Timings */
+     BENCHMARK("proc_opts (4 options)") { return conn.proc_opts(opts); };
+}
+
+TEST_CASE("TFTPConnectionBase socket setup", "[microbench][connection]") {
+     SocketPool pool(TFTP_SOCKET_POOL);
+     pool.fill();
+     auto bufs = BenchConnection().take_buffers();
+     Logger::set_level(LogLevel::Error);  // `sock_init` logs at Info
+
+     /* A pooled socket and recycled buffers */
+     auto pooled = [&] {
+          BenchConnection conn;
+          conn.set_buffers(std::move(bufs));
+          auto sock = pool.acquire();
+          conn.sock_adopt(sock.fd, sock.port);
+          pool.release({conn.take_socket(), sock.port});
+          bufs = conn.take_buffers();
+     };
+
+     /* Allocations per op (the connection itself is on the stack) */
+     double allocs = allocs_per_op(pooled);
+     report_allocs("pooled setup", allocs);
+     CHECK(allocs <= POOLED_SETUP_ALLOCS);
+
+     /* Timings */
+     BENCHMARK("sock_init (socket, bind, getsockname, close)") {
+          BenchConnection conn;
+          conn.sock_init();
+          return conn.get_fd();
+     };
+     BENCHMARK("pooled setup") { pooled(); };
+     Logger::set_level(LogLevel::Info);
+}
@@ -0,0 +1,130 @@
+/**
+ * @file test/bench/NetASCII.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief NetASCII conversion microbenchmarks
+ * @date 2023-11-19
+ */
+
+#include "util/netascii.hpp"
+
+#include <chrono>
+#include <string>
+
+#include "allocs.hpp"
+#include "catch_amalgamated.hpp"
+
+/**
+ * @brief Unix text of about `size` bytes (`line_len` characters per line)
+ */
+static std::vector<char> make_text(size_t size, size_t line_len = 72) {
+     std::string line(line_len - 1, 'a');
+     for (size_t i = 0; i < line.size(); i++) line[i] = 32 + (i % 95);
+     line += '\n';
+
+     std::vector<char> text;
+     while (text.size() < size)
+          text.insert(text.end(), line.begin(), line.end());
+     text.resize(size);
+     return text;
+}
+
+/* Allocation budgets (per op) – raise only with a reason in review */
+static const double VEC_TO_NA_ALLOCS = 1;
+static const double NA_TO_VEC_ALLOCS = 1;
+static const double NA_DECODE_ALLOCS = 0;
+static const double CHUNKED_ALLOCS = 0;
+
+/**
+ * @brief Prints the throughput of `op` over `bytes` of input
+ */
+template <typename F>
+static void report_rate(std::string_view name, size_t bytes, F&& op) {
+     using Clock = std::chrono::steady_clock;
+     op();
+     int iters = 0;
+     auto start = Clock::now();
+     std::chrono::duration<double> elapsed{};
+     do {
+          op();
+          iters++;
+          elapsed = Clock::now() - start;
+     } while (elapsed.count() < 0.2);
+     std::printf("GB/s       %-44.*s %8.2f\n", static_cast<int>(name.size()),
+                 name.data(), bytes * iters / elapsed.count() / 1e9);
+}
+
+TEST_CASE("NetASCII conversion", "[microbench][netascii]") {
+     auto text = make_text(64 * 1024);
+     auto na = NetASCII::vec_to_na(text);
+
+     /* Allocations per op */
+     double to_allocs
+         = allocs_per_op([&] { NetASCII::vec_to_na(text); }, 100);
+     double from_allocs
+         = allocs_per_op([&] { NetASCII::na_to_vec(na); }, 100);
+     auto buf = na;
+     double decode_allocs = allocs_per_op(
+         [&] { NetASCII::na_decode(buf.data(), buf.size()); }, 100);
+     report_allocs("NetASCII::vec_to_na (64 KiB text)", to_allocs);
+     report_allocs("NetASCII::na_to_vec (64 KiB text)", from_allocs);
+     report_allocs("NetASCII::na_decode (64 KiB text)", decode_allocs);
+     CHECK(to_allocs <= VEC_TO_NA_ALLOCS);
+     CHECK(from_allocs <= NA_TO_VEC_ALLOCS);
+     CHECK(decode_allocs <= NA_DECODE_ALLOCS);
+
+     /* Timings */
+     BENCHMARK("NetASCII::vec_to_na (64 KiB text)") {
+          return NetASCII::vec_to_na(text);
+     };
+     BENCHMARK("NetASCII::na_to_vec (64 KiB text)") {
+          return NetASCII::na_to_vec(na);
+     };
+     BENCHMARK_ADVANCED("NetASCII::na_decode (64 KiB text)")
+     (Catch::Benchmark::Chronometer meter) {
+          std::vector<std::vector<char>> bufs(meter.runs(), na);
+          meter.measure([&](int i) {
+               return NetASCII::na_decode(bufs[i].data(), bufs[i].size());
+          });
+     };
+}
+
+TEST_CASE("NetASCII chunked kernels", "[microbench][netascii]") {
+     /* Config-like text with few line endings (4 KiB lines) */
+     auto text = make_text(1 << 20, 4096);
+     auto na = NetASCII::vec_to_na(text);
+     std::vector<char> out(NetASCII::max_encoded(text.size()));
+     NetASCII::State state;
+
+     /* Allocations per op */
+     double enc_allocs
+         = allocs_per_op([&] { NetASCII::encode(text, out, state); }, 10);
+     double dec_allocs
+         = allocs_per_op([&] { NetASCII::decode(na, out, state); }, 10);
+     report_allocs("NetASCII::encode (1 MiB, 4 KiB lines)", enc_allocs);
+     report_allocs("NetASCII::decode (1 MiB, 4 KiB lines)", dec_allocs);
+     CHECK(enc_allocs <= CHUNKED_ALLOCS);
+     CHECK(dec_allocs <= CHUNKED_ALLOCS);
+
+     /* Throughput of every supported kernel */
+     const auto best = NetASCII::get_kernel();
+     for (auto [kernel, name] :
+          {std::pair{NetASCII::Kernel::Scalar, "scalar"},
+           std::pair{NetASCII::Kernel::SSE2, "sse2"},
+           std::pair{NetASCII::Kernel::AVX2, "avx2"},
+           std::pair{NetASCII::Kernel::NEON, "neon"}}) {
+          if (!NetASCII::set_kernel(kernel)) continue;
+          report_rate(std::string("encode, ") + name, text.size(),
+                      [&] { NetASCII::encode(text, out, state); });
+          report_rate(std::string("decode, ") + name, na.size(),
+                      [&] { NetASCII::decode(na, out, state); });
+     }
+     NetASCII::set_kernel(best);
+
+     /* Timings */
+     BENCHMARK("NetASCII::encode (1 MiB, 4 KiB lines)") {
+          return NetASCII::encode(text, out, state);
+     };
+     BENCHMARK("NetASCII::decode (1 MiB, 4 KiB lines)") {
+          return NetASCII::decode(na, out, state);
+     };
+}
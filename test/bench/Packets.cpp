@@ -0,0 +1,135 @@
+/**
+ * @file test/bench/Packets.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Packet codec microbenchmarks
+ * @date 2023-11-19
+ */
+
+#include "allocs.hpp"
+#include "catch_amalgamated.hpp"
+#include "packet/PacketFactory.hpp"
+#include "packet/PacketView.hpp"
+
+/**
+ * @brief Read request as sent by a typical client (four options)
+ */
+static std::vector<char> make_rrq() {
+     RequestPacket rrq(TFTPRequestType::Read, "images/pxelinux.0",
+                       TFTPDataFormat::Octet);
+     rrq.add_option("blksize", "1468");
+     rrq.add_option("windowsize", "16");
+     rrq.add_option("timeout", "3");
+     rrq.add_option("tsize", "0");
+     return rrq.to_binary();
+}
+
+/**
+ * @brief Full DATA packet of a 1468 blksize (Ethernet MTU) transfer
+ */
+static std::vector<char> make_data() {
+     std::vector<char> bin(4 + 1468, 'x');
+     DataPacket::write_header(bin.data(), 42);
+     return bin;
+}
+
+/* Allocation budgets (per op) – raise only with a reason in review */
+static const double RRQ_CREATE_ALLOCS = 7;
+static const double DATA_CREATE_ALLOCS = 3;
+static const double ACK_CREATE_ALLOCS = 1;
+static const double DATA_TO_BINARY_ALLOCS = 2;
+static const double DATA_FROM_BINARY_ALLOCS = 2;
+static const double OACK_FROM_BINARY_ALLOCS = 3;
+static const double VIEW_PARSE_ALLOCS = 0;
+
+TEST_CASE("PacketFactory::create", "[microbench][packet]") {
+     auto rrq = make_rrq();
+     auto data = make_data();
+     auto ack = AcknowledgementPacket(42).to_binary();
+
+     /* Allocations per op */
+     double rrq_allocs
+         = allocs_per_op([&] { PacketFactory::create(rrq); });
+     double data_allocs
+         = allocs_per_op([&] { PacketFactory::create(data); });
+     double ack_allocs
+         = allocs_per_op([&] { PacketFactory::create(ack); });
+     report_allocs("create RRQ (4 options)", rrq_allocs);
+     report_allocs("create DATA (1468 B)", data_allocs);
+     report_allocs("create ACK", ack_allocs);
+     CHECK(rrq_allocs <= RRQ_CREATE_ALLOCS);
+     CHECK(data_allocs <= DATA_CREATE_ALLOCS);
+     CHECK(ack_allocs <= ACK_CREATE_ALLOCS);
+
+     /* Timings */
+     BENCHMARK("create RRQ (4 options)") {
+          return PacketFactory::create(rrq);
+     };
+     BENCHMARK("create DATA (1468 B)") {
+          return PacketFactory::create(data);
+     };
+     BENCHMARK("create ACK") { return PacketFactory::create(ack); };
+}
+
+TEST_CASE("DataPacket codec", "[microbench][packet]") {
+     auto bin = make_data();
+     DataPacket packet(std::vector<char>(bin.begin() + 4, bin.end()), 1);
+     packet.set_block_size(1468);
+
+     /* Allocations per op */
+     double to_allocs = allocs_per_op([&] { packet.to_binary(); });
+     double from_allocs = allocs_per_op(
+         [&] { DataPacket::from_binary(bin, TFTPDataFormat::Octet); });
+     report_allocs("DataPacket::to_binary (1468 B)", to_allocs);
+     report_allocs("DataPacket::from_binary (1468 B)", from_allocs);
+     CHECK(to_allocs <= DATA_TO_BINARY_ALLOCS);
+     CHECK(from_allocs <= DATA_FROM_BINARY_ALLOCS);
+
+     /* Timings */
+     BENCHMARK("DataPacket::to_binary (1468 B)") {
+          return packet.to_binary();
+     };
+     BENCHMARK("DataPacket::from_binary (1468 B)") {
+          return DataPacket::from_binary(bin, TFTPDataFormat::Octet);
+     };
+}
+
+TEST_CASE("OptionAckPacket parsing", "[microbench][packet]") {
+     auto bin = OptionAckPacket({{"blksize", "1468"},
+                                 {"windowsize", "16"},
+                                 {"timeout", "3"},
+                                 {"tsize", "104857600"}})
+                    .to_binary();
+
+     /* Allocations per op */
+     double allocs
+         = allocs_per_op([&] { OptionAckPacket::from_binary(bin); });
+     report_allocs("OptionAckPacket::from_binary (4 options)", allocs);
+     CHECK(allocs <= OACK_FROM_BINARY_ALLOCS);
+
+     /* Timings */
+     BENCHMARK("OptionAckPacket::from_binary (4 options)") {
+          return OptionAckPacket::from_binary(bin);
+     };
+}
+
+TEST_CASE("PacketView::parse", "[microbench][packet]") {
+     auto rrq = make_rrq();
+     auto data = make_data();
+
+     /* Allocations per op */
+     double rrq_allocs = allocs_per_op([&] { (void)PacketView::parse(rrq); });
+     double data_allocs
+         = allocs_per_op([&] { (void)PacketView::parse(data); });
+     report_allocs("PacketView::parse RRQ (4 options)", rrq_allocs);
+     report_allocs("PacketView::parse DATA (1468 B)", data_allocs);
+     CHECK(rrq_allocs <= VIEW_PARSE_ALLOCS);
+     CHECK(data_allocs <= VIEW_PARSE_ALLOCS);
+
+     /* Timings */
+     BENCHMARK("PacketView::parse RRQ (4 options)") {
+          return PacketView::parse(rrq);
+     };
+     BENCHMARK("PacketView::parse DATA (1468 B)") {
+          return PacketView::parse(data);
+     };
+}
@@ -0,0 +1,37 @@
+/**
+ * @file test/bench/allocs.cpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Counting replacement of the global `operator new`
+ * @date 2023-11-19
+ */
+
+#include "allocs.hpp"
+
+#include <cstdlib>
+#include <new>
+
+/**
+ * @brief Allocations of this thread (benchmarks run on the main thread)
+ */
+static thread_local uint64_t n_allocs = 0;
+
+uint64_t alloc_count() { return n_allocs; }
+
+/* === Replaced allocation functions === */
+
+/**
+ * @details Array and nothrow forms call this one in libstdc++, so it
+ *          counts them as well.
+ */
+void* operator new(std::size_t size) {
+     n_allocs++;
+     if (void* ptr = std::malloc(size ? size : 1)) return ptr;
+     throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+
+void operator delete(void* ptr, std::size_t size) noexcept {
+     (void)size;
+     std::free(ptr);
+}
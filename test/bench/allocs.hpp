@@ -0,0 +1,47 @@
+/**
+ * @file test/bench/allocs.hpp
+ * @author Onegen Something <xkrame00@vutbr.cz>
+ * @brief Allocation counting for the microbenchmarks
+ * @date 2023-11-19
+ */
+
+#pragma once
+#ifndef TFTP_BENCH_ALLOCS_HPP
+#     define TFTP_BENCH_ALLOCS_HPP
+#     include <cstdint>
+#     include <cstdio>
+#     include <string_view>
+
+/**
+ * @brief Gets the number of `operator new` calls of this thread so far
+ * @details Counted by the global `operator new` replacement linked into
+ *          the microbenchmark binary only (see allocs.cpp).
+ * @return uint64_t allocation count
+ */
+uint64_t alloc_count();
+
+/**
+ * @brief Measures heap allocations per call of `op`
+ * @param op Operation to measure
+ * @param iters Number of measured calls (after one warm-up call)
+ * @return double allocations per call
+ */
+template <typename F>
+double allocs_per_op(F&& op, int iters = 1000) {
+     op();
+     uint64_t before = alloc_count();
+     for (int i = 0; i < iters; i++) op();
+     return static_cast<double>(alloc_count() - before) / iters;
+}
+
+/**
+ * @brief Prints an allocations-per-op line next to the timings
+ * @param name Benchmark name
+ * @param per_op Allocations per op
+ */
+inline void report_allocs(std::string_view name, double per_op) {
+     std::printf("allocs/op  %-44.*s %8.2f\n", static_cast<int>(name.size()),
+                 name.data(), per_op);
+}
+
+#endif